@@ -66,6 +66,40 @@ DEALINGS IN THE SOFTWARE.
 #define DEVICE_MAXIMUM_HEAPS                  1
 #endif
 
+//
+// Enables the slab allocator for the payloads of managed types (ManagedBuffer, ManagedString, Image...).
+// Each size class holds payloads of up to 16, 32, 64, 128, 256 and 512 bytes respectively, in a statically
+// allocated array of the number of blocks given below. Requests that do not fit, or find their class full,
+// are passed on to the heap. Set '1' to enable.
+//
+#ifndef DEVICE_SLAB_ALLOCATOR
+#define DEVICE_SLAB_ALLOCATOR                 0
+#endif
+
+#ifndef DEVICE_SLAB_BLOCKS_16
+#define DEVICE_SLAB_BLOCKS_16                 16
+#endif
+
+#ifndef DEVICE_SLAB_BLOCKS_32
+#define DEVICE_SLAB_BLOCKS_32                 8
+#endif
+
+#ifndef DEVICE_SLAB_BLOCKS_64
+#define DEVICE_SLAB_BLOCKS_64                 8
+#endif
+
+#ifndef DEVICE_SLAB_BLOCKS_128
+#define DEVICE_SLAB_BLOCKS_128                4
+#endif
+
+#ifndef DEVICE_SLAB_BLOCKS_256
+#define DEVICE_SLAB_BLOCKS_256                6
+#endif
+
+#ifndef DEVICE_SLAB_BLOCKS_512
+#define DEVICE_SLAB_BLOCKS_512                6
+#endif
+
 // If enabled, RefCounted objects include a constant tag at the beginning.
 // Set '1' to enable.
 #ifndef DEVICE_TAG
@@ -121,6 +155,18 @@ DEALINGS IN THE SOFTWARE.
 #define MESSAGE_BUS_LISTENER_MAX_QUEUE_DEPTH    10
 #endif
 
+//
+// Number of Listeners, and of events queued on busy Listeners, held in statically allocated pools.
+// Once a pool is exhausted, further ones are allocated from the heap.
+//
+#ifndef MESSAGE_BUS_LISTENER_POOL_SIZE
+#define MESSAGE_BUS_LISTENER_POOL_SIZE          16
+#endif
+
+#ifndef MESSAGE_BUS_EVENT_POOL_SIZE
+#define MESSAGE_BUS_EVENT_POOL_SIZE             16
+#endif
+
 //Configures the default serial mode used by serial read and send calls.
 #ifndef DEVICE_DEFAULT_SERIAL_MODE
 #define DEVICE_DEFAULT_SERIAL_MODE            SYNC_SLEEP
@@ -158,12 +204,29 @@ DEALINGS IN THE SOFTWARE.
 #endif
 
 // When non-zero internal debug messages (DMESG() macro) go to a in-memory buffer of this size (in bytes).
+// The buffer is a ring: once full, the oldest messages are overwritten.
 // It can be inspected from GDB (with 'print codalLogStore'), or accessed by the application.
 // Typical size range between 512 and 4096. Set to 0 to disable.
 #ifndef DEVICE_DMESG_BUFFER_SIZE
 #define DEVICE_DMESG_BUFFER_SIZE              1024
 #endif
 
+// The longest line a single DMESG() call writes (in bytes). Longer lines are truncated.
+// The line is formatted on the stack of the caller, which may be an interrupt handler.
+#ifndef DEVICE_DMESG_LINE_SIZE
+#define DEVICE_DMESG_LINE_SIZE                128
+#endif
+
+// When non-zero, DMESG() only records its format string and arguments in a queue of this many entries
+// (32 bytes each), and formatting into the log is deferred to codal_dmesg_encode(). This makes logging
+// from timing sensitive code much cheaper. Messages are dropped (and counted) while the queue is full,
+// %s arguments are cut to the room left in their entry, and the log only shows queued messages once
+// codal_dmesg_encode() (or codal_dmesg_read/peek/flush) has run.
+// When 0, every message is formatted as it is logged.
+#ifndef DEVICE_DMESG_DEFERRED_RECORDS
+#define DEVICE_DMESG_DEFERRED_RECORDS         0
+#endif
+
 #ifndef CODAL_DEBUG
 #define CODAL_DEBUG                           CODAL_DEBUG_DISABLED
 #endif
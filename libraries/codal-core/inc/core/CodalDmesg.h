@@ -38,9 +38,18 @@ DEALINGS IN THE SOFTWARE.
 extern "C" {
 #endif
 
+/**
+  * The in-memory log. The buffer is a ring, written without disabling interrupts: byte n of the log
+  * (counting from start up) is held at buffer[n % DEVICE_DMESG_BUFFER_SIZE], so the log consists of
+  * the last min(committed, DEVICE_DMESG_BUFFER_SIZE) bytes written.
+  */
 struct CodalLogStore
 {
-    uint32_t ptr;
+    uint32_t head;          // Number of bytes writers have reserved space for.
+    uint32_t committed;     // Number of bytes completely written.
+    uint32_t tail;          // Number of bytes taken out of the log by codal_dmesg_read().
+    uint32_t overwritten;   // Number of bytes overwritten before codal_dmesg_read() could take them.
+    uint32_t dropped;       // Number of messages lost because the deferred queue was full.
     char buffer[DEVICE_DMESG_BUFFER_SIZE];
 };
 extern struct CodalLogStore codalLogStore;
@@ -74,6 +83,31 @@ void codal_dmesg_with_flush(const char *format, ...);
 void codal_dmesg_set_flush_fn(void (*fn)(void));
 void codal_dmesg_flush();
 
+/**
+  * Formats the messages waiting in the deferred queue into the log.
+  * Does nothing unless DEVICE_DMESG_DEFERRED_RECORDS is set; the functions below call it themselves.
+  */
+void codal_dmesg_encode();
+
+/**
+  * Takes the oldest text out of the log that hasn't been read before.
+  *
+  * @param buf The buffer to copy the text into.
+  * @param len The size of buf, in bytes.
+  * @return The number of bytes copied, or 0 if there is nothing new in the log.
+  */
+int codal_dmesg_read(char *buf, int len);
+
+/**
+  * Copies text out of the log, oldest first, without taking it out.
+  *
+  * @param buf The buffer to copy the text into.
+  * @param offset The number of bytes of the log to skip.
+  * @param len The size of buf, in bytes.
+  * @return The number of bytes copied.
+  */
+int codal_dmesg_peek(char *buf, int offset, int len);
+
 void codal_vdmesg(const char *format, bool crlf, va_list ap);
 
 #define DMESG   codal_dmesg
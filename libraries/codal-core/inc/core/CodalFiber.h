@@ -30,8 +30,9 @@ DEALINGS IN THE SOFTWARE.
   * 1) To provide a clean abstraction for application languages to use when building async behaviour (callbacks).
   * 2) To provide ISR decoupling for EventModel events generated in an ISR context.
   *
-  * TODO: Consider a split mode scheduler, that monitors used stack size, and maintains a dedicated, persistent
-  * stack for any long lived fibers with large stack
+  * Fibers normally share the system stack, and have their live stack copied ("paged") into a heap buffer whenever
+  * they are descheduled. Long lived fibers with a large stack can instead be created with a dedicated, persistent
+  * stack (see create_dedicated_fiber), which is switched by stack pointer alone.
   */
 #ifndef CODAL_FIBER_H
 #define CODAL_FIBER_H
@@ -44,12 +45,27 @@ DEALINGS IN THE SOFTWARE.
 // Fiber Scheduler Flags
 #define DEVICE_SCHEDULER_RUNNING            0x01
 #define DEVICE_SCHEDULER_IDLE               0x02
+#define DEVICE_SCHEDULER_IN_IDLE            0x04
 
 // Fiber Flags
 #define DEVICE_FIBER_FLAG_FOB               0x01
 #define DEVICE_FIBER_FLAG_PARENT            0x02
 #define DEVICE_FIBER_FLAG_CHILD             0x04
 #define DEVICE_FIBER_FLAG_DO_NOT_PAGE       0x08
+#define DEVICE_FIBER_FLAG_DEDICATED_STACK   0x10
+
+// Fiber priorities. Whenever a fiber of a higher priority is runnable, it is scheduled in preference
+// to fibers of a lower priority (the scheduler remains cooperative, so this happens at the next schedule()).
+#define DEVICE_FIBER_PRIORITY_LOW           0
+#define DEVICE_FIBER_PRIORITY_NORMAL        1
+#define DEVICE_FIBER_PRIORITY_HIGH          2
+
+#ifndef DEVICE_FIBER_PRIORITY_LEVELS
+#define DEVICE_FIBER_PRIORITY_LEVELS        3
+#endif
+
+// Pattern written over a dedicated stack when it is created, used to measure its high water mark.
+#define DEVICE_FIBER_STACK_PAINT            0xC0DAF1BE
 
 #define DEVICE_SCHEDULER_EVT_TICK           1
 #define DEVICE_SCHEDULER_EVT_IDLE           2
@@ -65,9 +81,12 @@ namespace codal
     {
         void* tcb;                          // Thread context when last scheduled out.
         PROCESSOR_WORD_TYPE stack_bottom;   // The start address of this Fiber's stack. The stack is heap allocated, and full descending.
-        PROCESSOR_WORD_TYPE stack_top;      // The end address of this Fiber's stack.
+        PROCESSOR_WORD_TYPE stack_top;      // The end address of this Fiber's stack. For a fiber with DEVICE_FIBER_FLAG_DEDICATED_STACK this is the
+                                            // stack the fiber runs on, otherwise it is the buffer the fiber's stack is paged into.
         uint32_t context;                   // Context specific information.
         uint32_t flags;                     // Information about this fiber.
+        uint8_t priority;                   // The priority this fiber is scheduled with, including any inherited from a FiberLock.
+        uint8_t basePriority;               // The priority set by fiber_set_priority().
         Fiber **queue;                      // The queue this fiber is stored on.
         Fiber *qnext, *qprev;               // Position of this Fiber on the run queue.
         Fiber *next;                        // Position of this Fiber on the global list of fibers.
@@ -95,6 +114,15 @@ namespace codal
       */
     int fiber_scheduler_running();
 
+    /**
+      * Determines if the calling code may block, descheduling itself until an event or a period of time.
+      * The idle task (and the idle callbacks it runs) may not: its context is discarded whenever another
+      * fiber is scheduled.
+      *
+      * @return 1 if the scheduler is running and the caller is a fiber other than the idle task, 0 otherwise.
+      */
+    int fiber_can_block();
+
     /**
      * Provides a list of all active fibers.
      * 
@@ -165,6 +193,76 @@ namespace codal
       */
     Fiber *create_fiber(void (*entry_fn)(void *), void *param, void (*completion_fn)(void *) = release_fiber);
 
+    /**
+      * Creates a new Fiber that runs on its own, heap allocated stack, and launches it.
+      *
+      * Unlike other fibers, the stack of this fiber is never copied when it is scheduled in or out; only the stack
+      * pointer is switched. This makes context switches of fibers with a deep stack cheap, at the cost of reserving
+      * stack_size bytes for the lifetime of the fiber. Interrupts are serviced on the stack of whichever fiber is
+      * running, so stack_size must include headroom for the deepest interrupt handler.
+      *
+      * @param entry_fn The function the new Fiber will begin execution in.
+      *
+      * @param stack_size The size of the stack to allocate, in bytes.
+      *
+      * @param completion_fn The function called when the thread completes execution of entry_fn.
+      *                      Defaults to release_fiber.
+      *
+      * @return The new Fiber, or NULL if the operation could not be completed.
+      */
+    Fiber *create_dedicated_fiber(void (*entry_fn)(void), uint32_t stack_size, void (*completion_fn)(void) = release_fiber);
+
+    /**
+      * Creates a new parameterised Fiber that runs on its own, heap allocated stack, and launches it.
+      *
+      * @param entry_fn The function the new Fiber will begin execution in.
+      *
+      * @param param an untyped parameter passed into the entry_fn and completion_fn.
+      *
+      * @param stack_size The size of the stack to allocate, in bytes.
+      *
+      * @param completion_fn The function called when the thread completes execution of entry_fn.
+      *                      Defaults to release_fiber.
+      *
+      * @return The new Fiber, or NULL if the operation could not be completed.
+      */
+    Fiber *create_dedicated_fiber(void (*entry_fn)(void *), void *param, uint32_t stack_size, void (*completion_fn)(void *) = release_fiber);
+
+    /**
+      * Sets the priority of the given fiber. Whenever any fiber of a higher priority is runnable,
+      * it is scheduled in preference to those of a lower priority. Fibers are created with
+      * DEVICE_FIBER_PRIORITY_NORMAL.
+      *
+      * @param f The fiber to update.
+      *
+      * @param priority The new priority, from DEVICE_FIBER_PRIORITY_LOW to DEVICE_FIBER_PRIORITY_LEVELS - 1.
+      *
+      * @return DEVICE_OK, or DEVICE_INVALID_PARAMETER.
+      */
+    int fiber_set_priority(Fiber *f, int priority);
+
+    /**
+      * Determines the priority the given fiber is currently scheduled with.
+      *
+      * @param f The fiber to inspect.
+      *
+      * @return The priority of the fiber, including any priority inherited from a FiberLock, or DEVICE_INVALID_PARAMETER.
+      */
+    int fiber_get_priority(Fiber *f);
+
+    /**
+      * Determines the deepest stack usage of the given fiber seen so far.
+      *
+      * For a fiber with a dedicated stack, this is measured exactly by finding the deepest word of the stack
+      * that no longer holds DEVICE_FIBER_STACK_PAINT. For other fibers it is the size of the buffer their stack
+      * is paged into, i.e. the deepest stack seen at a context switch, rounded up to 32 bytes.
+      *
+      * @param f The fiber to inspect.
+      *
+      * @return The stack high water mark in bytes, or DEVICE_INVALID_PARAMETER if f is NULL.
+      */
+    int fiber_stack_high_water(Fiber *f);
+
 
     /**
       * Calls the Fiber scheduler.
@@ -190,9 +288,9 @@ namespace codal
     void fiber_sleep(unsigned long t);
 
     /**
-      * The timer callback, called from interrupt context once every SYSTEM_TICK_PERIOD_MS milliseconds.
-      * This function checks to determine if any fibers blocked on the sleep queue need to be woken up
-      * and made runnable.
+      * The timer callback, called from interrupt context when the fiber at the head of the sleep queue
+      * is due to wake up.
+      * This function wakes up any such fibers and makes them runnable, then arms the timer for the next one.
       */
     void scheduler_tick(Event);
 
@@ -325,6 +423,18 @@ namespace codal
       */
     void idle();
 
+    /**
+      * Reports how often, and for how long, the processor has slept in idle() since the last call
+      * to this function (or since the scheduler was started). The statistics are reset by this call.
+      *
+      * @param wakeups Set to the number of times the processor woke up from an idle sleep.
+      *
+      * @param sleepTime Set to the total time spent asleep, in microseconds.
+      *
+      * @param period Set to the time over which the statistics were gathered, in microseconds.
+      */
+    void scheduler_get_idle_statistics(uint32_t *wakeups, CODAL_TIMESTAMP *sleepTime, CODAL_TIMESTAMP *period);
+
     /**
       * The idle task, which is called when the runtime has no fibers that require execution.
       *
@@ -337,6 +447,7 @@ namespace codal
         private:
         int     locked;
         Fiber   *queue;
+        Fiber   *owner;             // The fiber that holds the lock, which inherits the priority of any fiber waiting for it.
 
         public:
 
@@ -346,7 +457,8 @@ namespace codal
         FiberLock();
 
         /**
-         * Block the calling fiber until the lock is available
+         * Block the calling fiber until the lock is available.
+         * While blocked, the fiber holding the lock is scheduled with at least the priority of the calling fiber.
          **/
         void wait();
 
@@ -129,6 +129,17 @@ namespace codal
           */
         ~Listener();
 
+        /**
+          * Allocates a Listener from a static pool, so that registering listeners does not fragment the heap.
+          * Falls back to the heap if the pool is exhausted.
+          */
+        static void *operator new(size_t size);
+
+        /**
+          * Returns a Listener to the pool it was allocated from.
+          */
+        static void operator delete(void *listener);
+
         /**
           * Queues and event up to be processed.
           *
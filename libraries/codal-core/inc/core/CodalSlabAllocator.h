@@ -0,0 +1,99 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2017 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+/**
+  * A size class allocator for the payloads of managed types (ManagedBuffer, ManagedString, Image...).
+  *
+  * Streams create and release a ManagedBuffer for every block of data they move, so the heap sees
+  * the same few sizes over and over again. Here each size class is a statically allocated array of
+  * equally sized blocks, kept on a free list: allocating and releasing a block takes constant time,
+  * and does not fragment the heap.
+  *
+  * Requests larger than the largest class, or for a class that has no free blocks left, are passed
+  * on to the heap. device_slab_free() accepts memory from either source.
+  */
+
+#ifndef DEVICE_SLAB_ALLOCATOR_H
+#define DEVICE_SLAB_ALLOCATOR_H
+
+#include "CodalConfig.h"
+
+#define DEVICE_SLAB_CLASSES         6       // Number of size classes, holding payloads of 16, 32, 64, 128, 256 and 512 bytes.
+#define DEVICE_SLAB_MINIMUM_SIZE    16      // Payload size of the smallest class, in bytes. Each class doubles it.
+#define DEVICE_SLAB_HEADER_SIZE     8       // Room added to each block for the header of a managed type.
+
+struct SlabStatistics
+{
+    uint16_t    blockSize;                  // Size of the blocks in this class, in bytes.
+    uint16_t    blocks;                     // Number of blocks in this class.
+    uint16_t    used;                       // Number of blocks currently allocated.
+    uint16_t    peak;                       // Largest number of blocks allocated at any one time.
+    uint32_t    allocations;                // Number of requests served by this class.
+    uint32_t    fallbacks;                  // Number of requests for this class passed on to the heap, as it was full.
+};
+
+/**
+  * Allocates a block of memory from the smallest size class that can hold it, or from the heap
+  * if there is no such class or it is full.
+  *
+  * @param size The amount of memory, in bytes, to allocate.
+  *
+  * @return A pointer to the allocated memory, or NULL if insufficient memory is available.
+  */
+void *device_slab_alloc(size_t size);
+
+/**
+  * Releases a block of memory allocated by device_slab_alloc(), or by malloc().
+  * Releasing a block of a size class twice panics with DEVICE_HEAP_ERROR.
+  *
+  * @param mem The memory area to release.
+  */
+void device_slab_free(void *mem);
+
+/**
+  * Reads the usage statistics of a size class.
+  *
+  * @param index The size class, between 0 and DEVICE_SLAB_CLASSES-1.
+  *
+  * @param stats The structure to fill in.
+  *
+  * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if there is no such class, or
+  * DEVICE_NOT_SUPPORTED if the slab allocator is disabled.
+  */
+int device_slab_statistics(int index, SlabStatistics *stats);
+
+/**
+  * Determines the number of requests passed on to the heap because they were larger than any size class.
+  */
+uint32_t device_slab_oversized();
+
+#if (CODAL_DEBUG >= CODAL_DEBUG_HEAP)
+/**
+  * Displays the usage statistics of all size classes.
+  */
+void device_slab_print();
+#endif
+
+#endif
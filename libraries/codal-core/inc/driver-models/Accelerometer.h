@@ -30,6 +30,7 @@ DEALINGS IN THE SOFTWARE.
 #include "Pin.h"
 #include "CoordinateSystem.h"
 #include "CodalUtil.h"
+#include "DataStream.h"
 
 /**
   * Status flags
@@ -173,6 +174,43 @@ namespace codal
           */
         virtual int getRange();
 
+        /**
+          * Attempts to set the number of samples the accelerometer collects before delivering them to
+          * its batch sink.
+          *
+          * @param samples The requested number of samples per batch.
+          *
+          * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the hardware cannot hold that many samples,
+          * or DEVICE_NOT_SUPPORTED if batched acquisition is not supported.
+          *
+          * @note This method should be overriden (if supported) by specific accelerometer device drivers.
+          */
+        virtual int setBatchSize(int samples);
+
+        /**
+          * Starts or stops batched acquisition. While batching, the hardware collects samples, and the sink
+          * is notified through its pullRequest() method as each batch is ready to be read with pullBatch().
+          * Batched samples raise no events and are not used for gesture tracking.
+          * An AccelerometerStream provides this as a DataSource.
+          *
+          * @param sink The component to deliver batches to, or NULL to resume sample by sample updates.
+          *
+          * @return DEVICE_OK on success, or DEVICE_NOT_SUPPORTED if batched acquisition is not supported.
+          *
+          * @note This method should be overriden (if supported) by specific accelerometer device drivers.
+          */
+        virtual int setBatchSink(DataSink *sink);
+
+        /**
+          * Reads the latest batch of samples: 16 bit signed (x, y, z) triplets in milli-g, in the
+          * coordinate system specified by the coordinateSpace variable.
+          *
+          * @return The batch, or an empty buffer if none is ready.
+          *
+          * @note This method should be overriden (if supported) by specific accelerometer device drivers.
+          */
+        virtual ManagedBuffer pullBatch();
+
         /**
          * Configures the accelerometer for G range and sample rate defined
          * in this object. The nearest values are chosen to those defined
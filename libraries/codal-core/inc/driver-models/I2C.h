@@ -29,8 +29,30 @@ DEALINGS IN THE SOFTWARE.
 #include "ErrorNo.h"
 #include "Pin.h"
 
+#define I2C_TRANSACTION_PENDING         1       // Status of a transaction that is queued or in progress.
+#define I2C_EVT_TRANSACTION_COMPLETE    1       // Raised by DEVICE_ID_I2C when a transaction without a doneHandler completes.
+
 namespace codal
 {
+typedef void (*PVoidCallback)(void *);
+
+/**
+  * A write and/or read operation, performed in the background by I2C::startTransaction().
+  * If both are given, the read follows the write after a repeated START condition, as in readRegister().
+  * The structure and its buffers must remain valid until the transaction completes.
+  */
+struct I2CTransaction
+{
+    I2CTransaction  *next;                      // Next transaction queued on the same bus.
+    uint16_t        address;                    // 8 bit I2C address of the device.
+    uint16_t        txSize;                     // Number of bytes to write, or zero.
+    uint16_t        rxSize;                     // Number of bytes to read, or zero.
+    uint8_t         *txBuffer;                  // The bytes to write.
+    uint8_t         *rxBuffer;                  // Storage for the bytes read.
+    volatile int    status;                     // I2C_TRANSACTION_PENDING, then DEVICE_OK or DEVICE_I2C_ERROR once complete.
+    PVoidCallback   doneHandler;                // Called (possibly in IRQ context) with this transaction once complete, or NULL.
+};
+
 /**
   * Class definition for an I2C interface.
   */
@@ -191,6 +213,20 @@ public:
      * @return the byte read on success, DEVICE_INVALID_PARAMETER or DEVICE_I2C_ERROR if the the read request failed.
      */
     virtual int readRegister(uint8_t address, uint8_t reg);
+
+    /**
+     * Starts a transaction, which is performed once all transactions started before it have completed.
+     * On completion, the status of the transaction is updated, and its doneHandler is called.
+     * If it has no doneHandler, an I2C_EVT_TRANSACTION_COMPLETE event is raised instead.
+     *
+     * This default implementation performs the transaction before returning, and calls the doneHandler
+     * in a new fiber. Drivers for interrupt driven hardware return as soon as it is queued.
+     *
+     * @param t The transaction to perform.
+     *
+     * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the transaction transfers no data.
+     */
+    virtual int startTransaction(I2CTransaction &t);
 };
 }
 
@@ -36,15 +36,27 @@ DEALINGS IN THE SOFTWARE.
 #endif
 
 #define KEY_VALUE_STORAGE_MAGIC                   0xC0DA1
+#define KEY_VALUE_STORAGE_LOG_MAGIC               0xC0DA2
 
 #define KEY_VALUE_STORAGE_BLOCK_SIZE              48
 #define KEY_VALUE_STORAGE_KEY_SIZE                16
 #define KEY_VALUE_STORAGE_VALUE_SIZE              KEY_VALUE_STORAGE_BLOCK_SIZE - KEY_VALUE_STORAGE_KEY_SIZE
 
-#define KEY_VALUE_STORAGE_SCRATCH_WORD_SIZE       64
-
 #define KEY_VALUE_STORAGE_MAX_PAIRS               5
 
+#define KEY_VALUE_STORAGE_RECORD_SIZE             (KEY_VALUE_STORAGE_BLOCK_SIZE + 4)
+#define KEY_VALUE_STORAGE_SCRATCH_WORD_SIZE       ((8 + KEY_VALUE_STORAGE_MAX_PAIRS * KEY_VALUE_STORAGE_RECORD_SIZE) / 4)
+
+// Record header states. Erased flash reads as all ones, so a record slot is free until its
+// header is written, which is always the last word of a record to be programmed.
+#define KEY_VALUE_RECORD_FREE                     0xFFFFFFFF
+#define KEY_VALUE_RECORD_PUT                      0xC0DA
+#define KEY_VALUE_RECORD_REMOVE                   0xDE1E
+
+#define KEY_VALUE_RECORD_HEADER(type, version)    (((uint32_t)(type) << 16) | ((version) & 0xFFFF))
+#define KEY_VALUE_RECORD_TYPE(header)             ((header) >> 16)
+#define KEY_VALUE_RECORD_VERSION(header)          ((header) & 0xFFFF)
+
 namespace codal
 {
   struct KeyValuePair
@@ -53,6 +65,19 @@ namespace codal
       uint8_t value[KEY_VALUE_STORAGE_VALUE_SIZE];
   };
 
+  struct KeyValueRecord
+  {
+      uint32_t header;
+      KeyValuePair pair;
+  };
+
+  struct KeyValueIndexEntry
+  {
+      uint32_t address;       // Logical address of the newest record for this key
+      uint16_t hash;          // Hash of the key, to avoid touching flash for non-matching keys
+      uint16_t version;       // Version of the newest record for this key
+  };
+
   struct KeyValueStore
   {
       uint32_t magic;
@@ -79,22 +104,29 @@ namespace codal
     * This class operates as a key value store, it allows the retrieval, addition
     * and deletion of KeyValuePairs.
     *
-    * The first 8 bytes are reserved for the KeyValueStore struct which gives core
-    * information such as the number of KeyValuePairs in the store, and whether the
-    * store has been initialised.
+    * The store is held as an append only log. The first 8 bytes are reserved for the
+    * KeyValueStore struct which indicates whether the store has been initialised.
+    * Every put or remove then appends a versioned KeyValueRecord to the end of the log,
+    * so the page only needs to be erased when it is full. At that point the log is
+    * compacted down to the live KeyValuePairs.
     *
-    * After the KeyValueStore struct, KeyValuePairs are arranged contiguously until
-    * the end of the block used as persistent storage.
+    * |-------8-------|--------52--------|-----|---------52---------|------------|
+    * | KeyValueStore | KeyValueRecord[0] | ... | KeyValueRecord[N-1] | free space |
+    * |---------------|------------------|-----|--------------------|------------|
     *
-    * |-------8-------|--------48-------|-----|---------48--------|
-    * | KeyValueStore | KeyValuePair[0] | ... | KeyValuePair[N-1] |
-    * |---------------|-----------------|-----|-------------------|
+    * An index of the newest record for each live key is held in RAM, so reads never
+    * need to scan the log. Pages written in the original flat layout are migrated
+    * to the log layout on first use.
     */
   class KeyValueStorage
   {
-      uint32_t          flashPagePtr;
-      NVMController&    controller;
-      uint32_t          *scratch;
+      uint32_t              flashPagePtr;
+      uint32_t              flashPageEnd;
+      uint32_t              logPtr;
+      NVMController&        controller;
+      uint32_t              *scratch;
+      KeyValueIndexEntry    index[KEY_VALUE_STORAGE_MAX_PAIRS];
+      int                   indexSize;
 
       public:
 
@@ -213,17 +245,60 @@ namespace codal
       void scratchKeyValueStore(KeyValueStore store);
 
       /**
-        * Function for populating the scratch page with a KeyValuePair.
+        * Function for populating the scratch page with a KeyValueRecord.
         *
-        * @param pair the KeyValuePair struct to write to the scratch page.
+        * @param record the KeyValueRecord struct to write to the scratch page.
         *
-        * @param flashPointer the pointer in flash where this KeyValuePair resides. This pointer
-        * is used to determine the offset into the scratch page, where the KeyValuePair should
-        * be written.
+        * @param scratchOffset the word offset into the scratch page where the KeyValueRecord
+        * should be written.
+        */
+      void scratchKeyValueRecord(KeyValueRecord *record, int scratchOffset);
+
+      /**
+        * Scans the storage page and rebuilds the RAM index of live keys.
+        * Formats the page if it is uninitialised, and migrates pages held in the flat layout.
         */
-      void scratchKeyValuePair(KeyValuePair pair, int scratchOffset);
+      void load();
 
+      /**
+        * Erases the storage page, and writes the first count words of the scratch page to it.
+        * The scratch page must begin with a valid KeyValueStore.
+        *
+        * @param count the number of words to write.
+        */
+      void commitScratch(int count);
 
+      /**
+        * Rewrites the storage page so that it contains only the newest record for each live key.
+        */
+      void compact();
+
+      /**
+        * Appends a record to the end of the log, compacting the page first if it is full.
+        *
+        * @param record the KeyValueRecord to append. Its header must be set.
+        *
+        * @return the logical address the record was written to, or 0 if no space is available.
+        */
+      uint32_t append(KeyValueRecord *record);
+
+      /**
+        * Finds the index entry of a given key.
+        *
+        * @param key the null terminated key to look for.
+        *
+        * @param h the hash of the given key.
+        *
+        * @return the position of the entry in the index, or -1 if the key is not stored.
+        */
+      int lookup(const char *key, uint16_t h);
+
+      /**
+        * Computes the 16 bit hash used by the RAM index for a given key.
+        *
+        * @param key the null terminated key to hash.
+        */
+      static uint16_t hash(const char *key);
   };
 }
 
@@ -87,12 +87,22 @@ DEALINGS IN THE SOFTWARE.
   */
 #define LSM303_A_WHOAMI_VAL           0x33
 #define LSM303_A_STATUS_DATA_READY    0x08
+#define LSM303_A_FIFO_SIZE            32      // Number of samples the FIFO holds.
+#define LSM303_A_FIFO_WTM             0x80    // FIFO_SRC_REG_A: the FIFO holds more samples than the watermark.
+#define LSM303_A_FIFO_OVRN            0x40    // FIFO_SRC_REG_A: the FIFO is full, and samples were lost.
+#define LSM303_A_FIFO_FSS             0x1F    // FIFO_SRC_REG_A: the number of unread samples in the FIFO.
+#define LSM303_A_DEFAULT_BATCH_SIZE   16      // Samples collected in the FIFO before they are read in batched mode.
 
 /**
  * LSM303 Status flags
+ * (0x1000 and up are the flags every CodalComponent has, and 0x02 is the Accelerometer's)
  */
+#define LSM303_A_STATUS_READING_FIFO  0x0040
+#define LSM303_A_STATUS_READING_BATCH 0x0080
 #define LSM303_A_STATUS_ENABLED       0x0100
 #define LSM303_A_STATUS_SLEEPING      0x0200
+#define LSM303_A_STATUS_READING       0x0400
+#define LSM303_A_STATUS_BATCHING      0x0800
 
 namespace codal
 {
@@ -105,6 +115,40 @@ namespace codal
     I2C&            i2c;                    // The I2C interface to use.
     Pin&            int1;                   // Data ready interrupt.
     uint16_t        address;                // I2C address of this accelerometer.
+    I2CTransaction  transaction;            // Reads the output registers in the background.
+    uint8_t         outputRegister;         // First register read by the transaction.
+    uint8_t         data[7];                // Storage for the registers read by the transaction.
+    uint8_t         batchSize;              // Number of samples collected in the FIFO before they are read, in batched mode.
+    DataSink        *batchSink;             // The component batches are delivered to, or NULL if not batching.
+    ManagedBuffer   batch;                  // The batch being read from the FIFO.
+    ManagedBuffer   output;                 // The latest batch read, until pulled by the sink.
+    CODAL_TIMESTAMP batchDue;               // Time from which the FIFO may have reached the watermark, in milliseconds.
+
+    /**
+     * Converts the output registers read into a sample, and indicates that it is available.
+     *
+     * @return false if the registers did not hold new data.
+     */
+    bool processSample();
+
+    /**
+     * Reads all the samples in the FIFO in a single burst, if it has reached the watermark.
+     * Called once FIFO_SRC_REG_A has been read into data[0].
+     *
+     * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the read could not be started.
+     */
+    int readBatch();
+
+    /**
+     * Converts the samples of a batch read from the FIFO in place, and delivers it to the sink.
+     */
+    void processBatch();
+
+    /**
+     * The doneHandler of our transactions. Their completion is collected by polling their status,
+     * so there is nothing to do here, but having a handler keeps the bus from raising an event per read.
+     */
+    static void transactionComplete(void *t);
 
     public:
 
@@ -131,12 +175,45 @@ namespace codal
      */
     virtual int configure() override;
 
+    /**
+     * Sets the number of samples collected in the FIFO before they are read in a single burst,
+     * while a batch sink is set.
+     *
+     * @param samples The number of samples per batch, in the range 1..32.
+     *
+     * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the FIFO cannot hold that many samples,
+     * DEVICE_I2C_ERROR if the accelerometer could not be configured.
+     */
+    virtual int setBatchSize(int samples) override;
+
+    /**
+     * Starts or stops batched acquisition. While batching, the hardware FIFO collects samples, which are read
+     * in a single burst once the batch size is reached, converted to milli-g and delivered to the given sink.
+     * No events are raised for batched samples. Otherwise, sample by sample updates resume.
+     *
+     * @param sink The component to deliver batches to, or NULL to stop batching.
+     *
+     * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the accelerometer could not be configured.
+     */
+    virtual int setBatchSink(DataSink *sink) override;
+
+    /**
+     * Reads the latest batch of samples, if available.
+     *
+     * @return The batch, or an empty buffer if none is ready.
+     */
+    virtual ManagedBuffer pullBatch() override;
+
     /**
      * Poll to see if new data is available from the hardware. If so, update it.
      * n.b. it is not necessary to explicitly call this function to update data
      * (it normally happens in the background when the scheduler is idle), but a check is performed
      * if the user explicitly requests up to date data.
      *
+     * Samples are read with an I2C transaction that completes in the background, and are
+     * collected on the next call. Only the first sample after activation is waited for.
+     * While batching, the FIFO is read instead, once it has reached the watermark.
+     *
      * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the update fails.
      *
      * @note This method should be overidden by the hardware driver to implement the requested
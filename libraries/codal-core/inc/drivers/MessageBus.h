@@ -142,15 +142,24 @@ namespace codal
           */
         virtual int remove(Listener *newListener);
 
-
+        /**
+          * Determines how well the event queue is coping with the events sent.
+          *
+          * @param dropped Set to the number of events dropped because the queue was full.
+          *
+          * @param peak Set to the largest number of events that were waiting to be processed at once.
+          */
+        void getQueueStatistics(uint32_t *dropped, uint16_t *peak);
 
         private:
 
         Listener            *listeners;           // Chain of active listeners.
-        EventQueueItem      *evt_queue_head;    // Head of queued events to be processed.
-        EventQueueItem      *evt_queue_tail;    // Tail of queued events to be processed.
+        Event               evt_queue[MESSAGE_BUS_LISTENER_MAX_QUEUE_DEPTH];    // Ring buffer of queued events to be processed.
+        uint16_t                    queueHead;          // Index of the next event to be processed.
         uint16_t                    nonce_val;          // The last nonce issued.
         uint16_t                    queueLength;        // The number of events currently waiting to be processed.
+        uint16_t                    queuePeak;          // The largest number of events ever waiting to be processed.
+        uint32_t                    queueDropped;       // The number of events dropped because the queue was full.
 
         /**
           * Cleanup any Listeners marked for deletion from the list.
@@ -170,9 +179,11 @@ namespace codal
         /**
           * Extract the next event from the front of the event queue (if present).
           *
-          * @return a pointer to the EventQueueItem that is at the head of the list.
+          * @param evt Set to the event at the front of the queue.
+          *
+          * @return true if an event was extracted, false if the queue is empty.
           */
-        EventQueueItem* dequeueEvent();
+        bool dequeueEvent(Event &evt);
 
         /**
           * Periodic callback from Device.
@@ -0,0 +1,80 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CodalConfig.h"
+#include "DataStream.h"
+#include "Accelerometer.h"
+
+#ifndef ACCELEROMETER_STREAM_H
+#define ACCELEROMETER_STREAM_H
+
+/**
+ * Streams batches of samples from an accelerometer across the Stream APIs, as 16 bit signed (x, y, z) triplets
+ * in milli-g. Batched acquisition starts when a DataSink connects, and stops when it disconnects.
+ */
+namespace codal
+{
+    class AccelerometerStream : public DataSource
+    {
+        private:
+        Accelerometer   &accelerometer;         // The accelerometer we stream from.
+        DataSink        *downstream;            // Pointer to our downstream component.
+
+        public:
+
+        /**
+         * Constructor.
+         *
+         * @param accelerometer The accelerometer to stream from. It must support batched acquisition.
+         */
+        AccelerometerStream(Accelerometer &accelerometer);
+
+        /**
+         * Allow our downstream component to register itself with us, and start batched acquisition.
+         */
+        virtual void connect(DataSink &sink);
+
+        /**
+         * Stop batched acquisition, and resume sample by sample updates.
+         */
+        virtual void disconnect();
+
+        /**
+         * Provide the latest batch of samples to our downstream caller, if available.
+         */
+        virtual ManagedBuffer pull();
+
+        /**
+         * Determine the data format of the buffers streamed out of this component.
+         */
+        virtual int getFormat();
+
+        /**
+         * Destructor. Stops batched acquisition.
+         */
+        ~AccelerometerStream();
+    };
+}
+
+#endif
@@ -129,6 +129,17 @@ namespace codal
           * @param evt The event to be queued.
           */
         EventQueueItem(Event evt);
+
+        /**
+          * Allocates an EventQueueItem from a static pool, so that queueing events does not fragment the heap.
+          * Falls back to the heap if the pool is exhausted.
+          */
+        static void *operator new(size_t size);
+
+        /**
+          * Returns an EventQueueItem to the pool it was allocated from.
+          */
+        static void operator delete(void *item);
     };
 }
 
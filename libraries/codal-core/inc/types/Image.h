@@ -38,6 +38,48 @@ namespace codal
         uint8_t data[0];    // 2D array representing the bitmap image
     };
 
+    /**
+      * A constant image, laid out exactly like ImageData with a read only reference count.
+      * Declared constexpr, it is placed in flash and can be shown without any parsing, copying or heap allocation.
+      *
+      * @code
+      * static constexpr ImageLiteral<5, 5> dot(
+      *     0, 0,   0, 0, 0,
+      *     0, 0,   0, 0, 0,
+      *     0, 0, 255, 0, 0,
+      *     0, 0,   0, 0, 0,
+      *     0, 0,   0, 0, 0);
+      *
+      * display.print(Image(dot));
+      * @endcode
+      */
+    template <uint16_t W, uint16_t H>
+    struct alignas(4) ImageLiteral
+    {
+        uint16_t refCount;
+    #if CONFIG_ENABLED(DEVICE_TAG)
+        uint16_t tag;
+    #endif
+        uint16_t width;
+        uint16_t height;
+        uint8_t data[W * H];
+
+        template <typename... Pixels>
+        constexpr ImageLiteral(Pixels... pixels) : refCount(0xffff),
+    #if CONFIG_ENABLED(DEVICE_TAG)
+            tag(REF_TAG_IMAGE),
+    #endif
+            width(W), height(H), data{(uint8_t)pixels...}
+        {
+            static_assert(sizeof...(Pixels) == W * H, "ImageLiteral needs exactly one value per pixel");
+        }
+
+        operator ImageData *() const
+        {
+            return (ImageData *)(void *)this;
+        }
+    };
+
     /**
       * Class definition for a Image.
       *
@@ -33,64 +33,457 @@ static void (*dmesg_flush_fn)(void) = NULL;
 
 using namespace codal;
 
-static void logwrite(const char *msg);
+//
+// Writers (which may be interrupt handlers) claim space in the log with a single atomic add, and copy their
+// line in afterwards. Cores without exclusive access instructions (e.g. Cortex-M0) fall back to keeping
+// interrupts off for the few instructions of the update.
+//
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+static inline uint32_t dmesg_load(uint32_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void dmesg_store(uint32_t *p, uint32_t value)
+{
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t dmesg_fetch_add(uint32_t *p, uint32_t value)
+{
+    return __atomic_fetch_add(p, value, __ATOMIC_ACQ_REL);
+}
 
-static void logwriten(const char *msg, int l)
+static inline bool dmesg_compare_exchange(uint32_t *p, uint32_t expected, uint32_t desired)
+{
+    return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+#else
+static inline uint32_t dmesg_load(uint32_t *p)
 {
-    if (codalLogStore.ptr + l >= sizeof(codalLogStore.buffer))
+    return *(volatile uint32_t *)p;
+}
+
+static inline void dmesg_store(uint32_t *p, uint32_t value)
+{
+    *(volatile uint32_t *)p = value;
+}
+
+static inline uint32_t dmesg_fetch_add(uint32_t *p, uint32_t value)
+{
+    target_disable_irq();
+    uint32_t old = *p;
+    *p = old + value;
+    target_enable_irq();
+
+    return old;
+}
+
+static inline bool dmesg_compare_exchange(uint32_t *p, uint32_t expected, uint32_t desired)
+{
+    bool swapped = false;
+
+    target_disable_irq();
+    if (*p == expected)
     {
-        const int jump = sizeof(codalLogStore.buffer) / 4;
-        codalLogStore.ptr -= jump;
-        memmove(codalLogStore.buffer, codalLogStore.buffer + jump, codalLogStore.ptr);
-        // zero-out the rest so it looks OK in the debugger
-        memset(codalLogStore.buffer + codalLogStore.ptr, 0, sizeof(codalLogStore.buffer) - codalLogStore.ptr);
+        *p = desired;
+        swapped = true;
     }
-    if (l + codalLogStore.ptr >= sizeof(codalLogStore.buffer))
+    target_enable_irq();
+
+    return swapped;
+}
+#endif
+
+/**
+ * Copies bytes into the ring, starting at the given position of the log.
+ */
+static void logcopyin(uint32_t position, const char *msg, uint32_t l)
+{
+    uint32_t offset = position % sizeof(codalLogStore.buffer);
+    uint32_t first = min(l, sizeof(codalLogStore.buffer) - offset);
+
+    memcpy(codalLogStore.buffer + offset, msg, first);
+    memcpy(codalLogStore.buffer, msg + first, l - first);
+}
+
+/**
+ * Copies bytes out of the ring, starting at the given position of the log.
+ */
+static void logcopyout(uint32_t position, char *buf, uint32_t l)
+{
+    uint32_t offset = position % sizeof(codalLogStore.buffer);
+    uint32_t first = min(l, sizeof(codalLogStore.buffer) - offset);
+
+    memcpy(buf, codalLogStore.buffer + offset, first);
+    memcpy(buf + first, codalLogStore.buffer, l - first);
+}
+
+static void logwriten(const char *msg, uint32_t l)
+{
+    // Only the end of a line longer than the whole log can be kept.
+    if (l > sizeof(codalLogStore.buffer))
     {
-        logwrite("DMESG line too long!\n");
-        return;
+        msg += l - sizeof(codalLogStore.buffer);
+        l = sizeof(codalLogStore.buffer);
+    }
+
+    uint32_t position = dmesg_fetch_add(&codalLogStore.head, l);
+    logcopyin(position, msg, l);
+    dmesg_fetch_add(&codalLogStore.committed, l);
+}
+
+/**
+ * A line being formatted on the stack. Text beyond its size is discarded.
+ */
+struct LogLine
+{
+    char buffer[DEVICE_DMESG_LINE_SIZE];
+    uint32_t length;
+};
+
+static void lineappendn(LogLine &line, const char *s, uint32_t l)
+{
+    // Keep room for the line ending.
+    uint32_t space = sizeof(line.buffer) - 2 - line.length;
+
+    if (l > space)
+        l = space;
+
+    memcpy(line.buffer + line.length, s, l);
+    line.length += l;
+}
+
+static void lineappend(LogLine &line, const char *s)
+{
+    lineappendn(line, s, strlen(s));
+}
+
+/**
+ * Appends a number: in decimal (as a signed number), or in hex with 0x, padded with zeros to 8 digits if full.
+ * The digits are written backwards into a buffer of their own, so the line gets them in one copy.
+ */
+static void lineappendnum(LogLine &line, uint32_t n, bool full, bool hex)
+{
+    char buff[12];
+    char *p = buff + sizeof(buff);
+
+    if (hex)
+    {
+        int digits = 0;
+
+        do
+        {
+            int d = n & 0xf;
+            *--p = d > 9 ? 'A' + d - 10 : '0' + d;
+            n >>= 4;
+            digits++;
+        } while (n || (full && digits < 8));
+
+        *--p = 'x';
+        *--p = '0';
+    }
+    else
+    {
+        bool negative = (int32_t)n < 0;
+
+        if (negative)
+            n = -n;
+
+        do
+        {
+            *--p = '0' + n % 10;
+            n /= 10;
+        } while (n);
+
+        if (negative)
+            *--p = '-';
+    }
+
+    lineappendn(line, p, buff + sizeof(buff) - p);
+}
+
+/**
+ * The arguments of a message: either still on the caller's stack, or packed into a deferred record.
+ * Conversions take a 32 bit value each; %s takes a string, which a record holds inline.
+ */
+struct LogArgs
+{
+    va_list *ap;
+    const uint8_t *data;
+    const uint8_t *end;
+};
+
+static bool nextnum(LogArgs &args, uint32_t &val)
+{
+    if (args.ap)
+    {
+        val = va_arg(*args.ap, uint32_t);
+        return true;
+    }
+
+    if (args.end - args.data < (int)sizeof(uint32_t))
+        return false;
+
+    memcpy(&val, args.data, sizeof(uint32_t));
+    args.data += sizeof(uint32_t);
+    return true;
+}
+
+static bool nextstring(LogArgs &args, const char *&val)
+{
+    if (args.ap)
+    {
+        val = va_arg(*args.ap, const char *);
+        return true;
+    }
+
+    if (args.data >= args.end)
+        return false;
+
+    val = (const char *)args.data;
+    args.data += strlen(val) + 1;
+    return true;
+}
+
+/**
+ * Formats a message into a line, as documented for codal_dmesg().
+ */
+static void format_line(LogLine &line, const char *format, bool crlf, LogArgs &args)
+{
+    const char *end = format;
+
+    line.length = 0;
+
+    while (*end)
+    {
+        if (*end++ == '%')
+        {
+            lineappendn(line, format, end - format - 1);
+
+            char conversion = *end++;
+            const char *s;
+            uint32_t val;
+            bool present = conversion == 's' ? nextstring(args, s) : nextnum(args, val);
+
+            // A deferred record ran out of room for the remaining arguments.
+            if (!present)
+            {
+                lineappend(line, "...");
+                format = end = "";
+                break;
+            }
+
+            switch (conversion)
+            {
+            case 'c':
+                lineappendn(line, (const char *)&val, 1);
+                break;
+            case 'u': // should be printed as unsigned, but will do for now
+            case 'd':
+                lineappendnum(line, val, false, false);
+                break;
+            case 'x':
+                lineappendnum(line, val, false, true);
+                break;
+            case 'p':
+            case 'X':
+                lineappendnum(line, val, true, true);
+                break;
+            case 's':
+                lineappend(line, s);
+                break;
+            case '%':
+                lineappend(line, "%");
+                break;
+            default:
+                lineappend(line, "???");
+                break;
+            }
+            format = end;
+        }
+    }
+    lineappendn(line, format, end - format);
+
+    if (crlf)
+    {
+        line.buffer[line.length++] = '\r';
+        line.buffer[line.length++] = '\n';
     }
-    memcpy(codalLogStore.buffer + codalLogStore.ptr, msg, l);
-    codalLogStore.ptr += l;
-    codalLogStore.buffer[codalLogStore.ptr] = 0;
 }
 
-static void logwrite(const char *msg)
+#if DEVICE_DMESG_DEFERRED_RECORDS > 0
+
+#define DMESG_RECORD_DATA_SIZE      24
+
+/**
+ * A message waiting to be formatted: its format string, and its arguments packed one after the other.
+ */
+struct LogRecord
 {
-    logwriten(msg, strlen(msg));
+    const char *format;
+    uint8_t crlf;
+    uint8_t length;
+    uint8_t ready;                              // Set once the writer has filled in the record.
+    uint8_t reserved;
+    uint8_t data[DMESG_RECORD_DATA_SIZE];
+};
+
+static LogRecord logRecords[DEVICE_DMESG_DEFERRED_RECORDS];
+static uint32_t logRecordHead = 0;              // Number of records writers have claimed.
+static uint32_t logRecordTail = 0;              // Number of records formatted into the log.
+static uint32_t logEncoding = 0;                // Non-zero while codal_dmesg_encode() is running.
+
+/**
+ * Packs the arguments of a message into a record, until the record is full.
+ */
+static void record_pack(LogRecord *r, const char *format, va_list ap)
+{
+    uint8_t *data = r->data;
+    uint8_t *end = r->data + sizeof(r->data);
+
+    while (*format)
+    {
+        if (*format++ != '%')
+            continue;
+
+        if (*format++ == 's')
+        {
+            const char *s = va_arg(ap, const char *);
+
+            // Strings may not outlive the call, so keep a copy, shortened to whatever room is left.
+            if (end - data < 2)
+                break;
+
+            uint32_t l = min(strlen(s), end - data - 1);
+
+            memcpy(data, s, l);
+            data += l;
+            *data++ = 0;
+        }
+        else
+        {
+            uint32_t val = va_arg(ap, uint32_t);
+
+            if (end - data < (int)sizeof(uint32_t))
+                break;
+
+            memcpy(data, &val, sizeof(uint32_t));
+            data += sizeof(uint32_t);
+        }
+    }
+
+    r->length = data - r->data;
 }
 
-static void writeNum(char *buf, uint32_t n, bool full)
+/**
+ * Queues a message for codal_dmesg_encode(), or counts it as dropped if the queue is full.
+ */
+static void record_write(const char *format, bool crlf, va_list ap)
 {
-    int i = 0;
-    int sh = 28;
-    while (sh >= 0)
+    uint32_t slot;
+
+    do
     {
-        int d = (n >> sh) & 0xf;
-        if (full || d || sh == 0 || i)
+        slot = dmesg_load(&logRecordHead);
+
+        if (slot - dmesg_load(&logRecordTail) >= DEVICE_DMESG_DEFERRED_RECORDS)
         {
-            buf[i++] = d > 9 ? 'A' + d - 10 : '0' + d;
+            dmesg_fetch_add(&codalLogStore.dropped, 1);
+            return;
         }
-        sh -= 4;
+    } while (!dmesg_compare_exchange(&logRecordHead, slot, slot + 1));
+
+    LogRecord *r = &logRecords[slot % DEVICE_DMESG_DEFERRED_RECORDS];
+
+    r->format = format;
+    r->crlf = crlf;
+    record_pack(r, format, ap);
+
+    __atomic_store_n(&r->ready, 1, __ATOMIC_RELEASE);
+}
+
+#endif
+
+void codal_dmesg_encode()
+{
+#if DEVICE_DMESG_DEFERRED_RECORDS > 0
+    // A reader interrupting the encoder leaves the remaining records to it.
+    if (!dmesg_compare_exchange(&logEncoding, 0, 1))
+        return;
+
+    uint32_t slot = logRecordTail;
+
+    while (slot != dmesg_load(&logRecordHead))
+    {
+        LogRecord *r = &logRecords[slot % DEVICE_DMESG_DEFERRED_RECORDS];
+
+        // Keep the log in order: wait for a writer that was interrupted while filling in its record.
+        if (!__atomic_load_n(&r->ready, __ATOMIC_ACQUIRE))
+            break;
+
+        LogLine line;
+        LogArgs args = {NULL, r->data, r->data + r->length};
+
+        format_line(line, r->format, r->crlf, args);
+        logwriten(line.buffer, line.length);
+
+        r->ready = 0;
+        dmesg_store(&logRecordTail, ++slot);
     }
-    buf[i] = 0;
+
+    dmesg_store(&logEncoding, 0);
+#endif
 }
 
-static void logwritenum(uint32_t n, bool full, bool hex)
+int codal_dmesg_read(char *buf, int len)
 {
-    char buff[20];
+    codal_dmesg_encode();
 
-    if (hex)
+    uint32_t start = codalLogStore.tail;
+    uint32_t end = dmesg_load(&codalLogStore.committed);
+
+    // Skip anything that was overwritten before we got to it.
+    if (end - start > sizeof(codalLogStore.buffer))
     {
-        writeNum(buff, n, full);
-        logwrite("0x");
+        codalLogStore.overwritten += end - start - sizeof(codalLogStore.buffer);
+        start = end - sizeof(codalLogStore.buffer);
     }
-    else
+
+    uint32_t l = min(end - start, (uint32_t)len);
+    logcopyout(start, buf, l);
+
+    // Writers may have wrapped over the oldest bytes while we were copying them; discard those.
+    uint32_t reserved = dmesg_load(&codalLogStore.head) - start;
+
+    if (reserved > sizeof(codalLogStore.buffer))
     {
-        itoa(n, buff);
+        uint32_t lost = min(reserved - sizeof(codalLogStore.buffer), l);
+
+        memmove(buf, buf + lost, l - lost);
+        codalLogStore.overwritten += lost;
+        start += lost;
+        l -= lost;
     }
 
-    logwrite(buff);
+    codalLogStore.tail = start + l;
+    return l;
+}
+
+int codal_dmesg_peek(char *buf, int offset, int len)
+{
+    codal_dmesg_encode();
+
+    uint32_t end = dmesg_load(&codalLogStore.committed);
+    uint32_t size = min(end, sizeof(codalLogStore.buffer));
+
+    if (offset < 0 || len < 0 || (uint32_t)offset >= size)
+        return 0;
+
+    uint32_t l = min(size - offset, (uint32_t)len);
+    logcopyout(end - size + offset, buf, l);
+
+    return l;
 }
 
 void codal_dmesg_nocrlf(const char *format, ...)
@@ -125,56 +518,27 @@ void codal_dmesg_set_flush_fn(void (*fn)(void))
 
 void codal_dmesg_flush()
 {
+    codal_dmesg_encode();
+
     if (dmesg_flush_fn)
         dmesg_flush_fn();
 }
 
 void codal_vdmesg(const char *format, bool crlf, va_list ap)
 {
-    const char *end = format;
+#if DEVICE_DMESG_DEFERRED_RECORDS > 0
+    record_write(format, crlf, ap);
+#else
+    LogLine line;
+    va_list copy;
+    va_copy(copy, ap);
 
-    target_disable_irq();
-    while (*end)
-    {
-        if (*end++ == '%')
-        {
-            logwriten(format, end - format - 1);
-            uint32_t val = va_arg(ap, uint32_t);
-            switch (*end++)
-            {
-            case 'c':
-                logwriten((const char *)&val, 1);
-                break;
-            case 'u': // should be printed as unsigned, but will do for now
-            case 'd':
-                logwritenum(val, false, false);
-                break;
-            case 'x':
-                logwritenum(val, false, true);
-                break;
-            case 'p':
-            case 'X':
-                logwritenum(val, true, true);
-                break;
-            case 's':
-                logwrite((char *)(void *)val);
-                break;
-            case '%':
-                logwrite("%");
-                break;
-            default:
-                logwrite("???");
-                break;
-            }
-            format = end;
-        }
-    }
-    logwriten(format, end - format);
-
-    if (crlf)
-        logwrite("\r\n");
+    LogArgs args = {&copy, NULL, NULL};
+    format_line(line, format, crlf, args);
+    va_end(copy);
 
-    target_enable_irq();
+    logwriten(line.buffer, line.length);
+#endif
 }
 
 #endif
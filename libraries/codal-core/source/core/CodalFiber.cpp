@@ -51,7 +51,8 @@ static Fiber *idleFiber = NULL;                    // the idle task - performs a
 /*
  * Scheduler state.
  */
-static Fiber *runQueue = NULL;                     // The list of runnable fibers.
+static Fiber *runQueue[DEVICE_FIBER_PRIORITY_LEVELS]; // The lists of runnable fibers, one per priority.
+static uint32_t runQueueBitmap = 0;                // Bit n is set if runQueue[n] is not empty.
 static Fiber *sleepQueue = NULL;                   // The list of blocked fibers waiting on a fiber_sleep() operation.
 static Fiber *waitQueue = NULL;                    // The list of blocked fibers waiting on an event.
 static Fiber *fiberPool = NULL;                    // Pool of unused fibers, just waiting for a job to do.
@@ -62,6 +63,19 @@ static Fiber *fiberList = NULL;                    // List of all active Fibers
  */
 static uint8_t fiber_flags = 0;
 
+/*
+ * The tick at which the scheduler timer is next due to fire (in microseconds), if it is armed.
+ */
+static CODAL_TIMESTAMP sleepQueueWakeup = 0;
+static bool sleepQueueWakeupArmed = false;
+
+/*
+ * Idle statistics, since the last call to scheduler_get_idle_statistics().
+ */
+static uint32_t idleWakeups = 0;
+static CODAL_TIMESTAMP idleSleepTime = 0;
+static CODAL_TIMESTAMP idleStatisticsStart = 0;
+
 /*
  * Fibers may perform wait/notify semantics on events. If set, these operations will be permitted on this EventModel.
  */
@@ -111,6 +125,9 @@ void codal::queue_fiber(Fiber *f, Fiber **queue)
         f->qnext = NULL;
     }
 
+    if (queue >= runQueue && queue < runQueue + DEVICE_FIBER_PRIORITY_LEVELS)
+        runQueueBitmap |= 1 << (queue - runQueue);
+
     target_enable_irq();
 }
 
@@ -136,6 +153,9 @@ void codal::dequeue_fiber(Fiber *f)
     if(f->qnext)
         f->qnext->qprev = f->qprev;
 
+    if (*(f->queue) == NULL && f->queue >= runQueue && f->queue < runQueue + DEVICE_FIBER_PRIORITY_LEVELS)
+        runQueueBitmap &= ~(1 << (f->queue - runQueue));
+
     f->qnext = NULL;
     f->qprev = NULL;
     f->queue = NULL;
@@ -143,6 +163,114 @@ void codal::dequeue_fiber(Fiber *f)
     target_enable_irq();
 }
 
+/**
+  * Adds the given fiber to the run queue of its priority.
+  *
+  * @param f The fiber to make runnable.
+  */
+static void queue_runnable(Fiber *f)
+{
+    queue_fiber(f, &runQueue[f->priority]);
+}
+
+/**
+  * Changes the priority a fiber is scheduled with, moving it to the run queue of that priority if it is runnable.
+  *
+  * @param f The fiber to update.
+  *
+  * @param priority The new priority.
+  */
+static void set_effective_priority(Fiber *f, uint8_t priority)
+{
+    target_disable_irq();
+
+    if (f->priority != priority && f->queue == &runQueue[f->priority])
+    {
+        dequeue_fiber(f);
+        f->priority = priority;
+        queue_runnable(f);
+    }
+    else
+    {
+        f->priority = priority;
+    }
+
+    target_enable_irq();
+}
+
+/**
+  * Adds the given fiber to the sleep queue, which is kept sorted by wake up time (f->context),
+  * so that the scheduler only ever needs to look at the head of the queue.
+  *
+  * @param f The fiber to add to the sleep queue.
+  */
+static void sleep_queue_insert(Fiber *f)
+{
+    target_disable_irq();
+
+    Fiber *prev = NULL;
+    Fiber *next = sleepQueue;
+
+    // Skip past all fibers due to wake up no later than this one (compared in a way that copes with wrap around).
+    while (next != NULL && (int32_t)(next->context - f->context) <= 0)
+    {
+        prev = next;
+        next = next->qnext;
+    }
+
+    f->queue = &sleepQueue;
+    f->qprev = prev;
+    f->qnext = next;
+
+    if (prev)
+        prev->qnext = f;
+    else
+        sleepQueue = f;
+
+    if (next)
+        next->qprev = f;
+
+    target_enable_irq();
+}
+
+/**
+  * Programs the scheduler timer to fire at the time the fiber at the head of the sleep queue is due
+  * to wake up. Ticks with nothing to wake up are skipped altogether, so the processor can sleep through them.
+  */
+static void sleep_queue_arm()
+{
+    target_disable_irq();
+
+    if (sleepQueue != NULL)
+    {
+        CODAL_TIMESTAMP now = system_timer_current_time_us();
+        CODAL_TIMESTAMP nowMs = now / 1000;
+
+        // The head's deadline is held as a (wrapping) 32 bit time in milliseconds. Extend it to a full timestamp
+        // relative to the current time, then wake up exactly then, or immediately if it has already passed.
+        int32_t remaining = (int32_t)(sleepQueue->context - (uint32_t)nowMs);
+        CODAL_TIMESTAMP wakeup = remaining > 0 ? (nowMs + remaining) * 1000 : now;
+
+        if (!sleepQueueWakeupArmed || wakeup != sleepQueueWakeup)
+        {
+            if (sleepQueueWakeupArmed)
+                system_timer_cancel_event(DEVICE_ID_SCHEDULER, DEVICE_SCHEDULER_EVT_TICK);
+
+            if (system_timer_event_after_us(wakeup > now ? wakeup - now : 0, DEVICE_ID_SCHEDULER, DEVICE_SCHEDULER_EVT_TICK) == DEVICE_OK)
+            {
+                sleepQueueWakeup = wakeup;
+                sleepQueueWakeupArmed = true;
+            }
+            else
+            {
+                sleepQueueWakeupArmed = false;
+            }
+        }
+    }
+
+    target_enable_irq();
+}
+
 /**
   * Provides a list of all active fibers.
   * 
@@ -166,6 +294,15 @@ Fiber *getFiberContext()
     {
         f = fiberPool;
         dequeue_fiber(f);
+
+        // A recycled fiber may still own the dedicated stack it last ran on. Release it, so the
+        // fiber can page its stack like any other (nobody is running on it any more).
+        if (f->flags & DEVICE_FIBER_FLAG_DEDICATED_STACK)
+        {
+            free((void *)f->stack_bottom);
+            f->stack_bottom = 0;
+            f->stack_top = 0;
+        }
     }
     else
     {
@@ -186,6 +323,8 @@ Fiber *getFiberContext()
 
     // Ensure this fiber is in suitable state for reuse.
     f->flags = 0;
+    f->priority = DEVICE_FIBER_PRIORITY_NORMAL;
+    f->basePriority = DEVICE_FIBER_PRIORITY_NORMAL;
 
     #if CONFIG_ENABLED(DEVICE_FIBER_USER_DATA)
     f->user_data = 0;
@@ -225,7 +364,7 @@ void codal::scheduler_init(EventModel &_messageBus)
     currentFiber = getFiberContext();
 
     // Add ourselves to the run queue.
-    queue_fiber(currentFiber, &runQueue);
+    queue_runnable(currentFiber);
 
     // Create the IDLE fiber.
     // Configure the fiber to directly enter the idle task.
@@ -240,10 +379,12 @@ void codal::scheduler_init(EventModel &_messageBus)
         messageBus->listen(DEVICE_ID_NOTIFY, DEVICE_EVT_ANY, scheduler_event, MESSAGE_BUS_LISTENER_IMMEDIATE);
         messageBus->listen(DEVICE_ID_NOTIFY_ONE, DEVICE_EVT_ANY, scheduler_event, MESSAGE_BUS_LISTENER_IMMEDIATE);
 
-        system_timer_event_every_us(SCHEDULER_TICK_PERIOD_US, DEVICE_ID_SCHEDULER, DEVICE_SCHEDULER_EVT_TICK);
+        // The scheduler tick is armed on demand by fiber_sleep(), for when the next sleeping fiber is due.
         messageBus->listen(DEVICE_ID_SCHEDULER, DEVICE_SCHEDULER_EVT_TICK, scheduler_tick, MESSAGE_BUS_LISTENER_IMMEDIATE);
     }
 
+    idleStatisticsStart = system_timer_current_time_us();
+
     fiber_flags |= DEVICE_SCHEDULER_RUNNING;
 }
 
@@ -261,33 +402,44 @@ int codal::fiber_scheduler_running()
 }
 
 /**
-  * The timer callback, called from interrupt context once every SYSTEM_TICK_PERIOD_MS milliseconds.
-  * This function checks to determine if any fibers blocked on the sleep queue need to be woken up
-  * and made runnable.
+  * Determines if the calling code may block, descheduling itself until an event or a period of time.
+  * The idle task (and the idle callbacks it runs) may not: its context is discarded whenever another
+  * fiber is scheduled.
+  *
+  * @return 1 if the scheduler is running and the caller is a fiber other than the idle task, 0 otherwise.
+  */
+int codal::fiber_can_block()
+{
+    if (!fiber_scheduler_running() || currentFiber == idleFiber || (fiber_flags & DEVICE_SCHEDULER_IN_IDLE))
+        return 0;
+
+    return 1;
+}
+
+/**
+  * The timer callback, called from interrupt context when the fiber at the head of the sleep queue
+  * is due to wake up.
+  * This function wakes up any such fibers and makes them runnable, then arms the timer for the next one.
   */
 void codal::scheduler_tick(Event evt)
 {
-    Fiber *f = sleepQueue;
-    Fiber *t;
+    Fiber *f;
 
 #if !CONFIG_ENABLED(LIGHTWEIGHT_EVENTS)
     evt.timestamp /= 1000;
 #endif
 
-    // Check the sleep queue, and wake up any fibers as necessary.
-    while (f != NULL)
-    {
-        t = f->qnext;
+    sleepQueueWakeupArmed = false;
 
-        if (evt.timestamp >= f->context)
-        {
-            // Wakey wakey!
-            dequeue_fiber(f);
-            queue_fiber(f,&runQueue);
-        }
-
-        f = t;
+    // The sleep queue is sorted by wake up time, so we only need to look at its head.
+    while ((f = sleepQueue) != NULL && (int32_t)((uint32_t)evt.timestamp - f->context) >= 0)
+    {
+        // Wakey wakey!
+        dequeue_fiber(f);
+        queue_runnable(f);
     }
+
+    sleep_queue_arm();
 }
 
 /**
@@ -326,7 +478,7 @@ void codal::scheduler_event(Event evt)
             {
                 // Wakey wakey!
                 dequeue_fiber(f);
-                queue_fiber(f,&runQueue);
+                queue_runnable(f);
                 notifyOneComplete = 1;
             }
         }
@@ -336,7 +488,7 @@ void codal::scheduler_event(Event evt)
         {
             // Wakey wakey!
             dequeue_fiber(f);
-            queue_fiber(f,&runQueue);
+            queue_runnable(f);
         }
 
         f = t;
@@ -364,6 +516,9 @@ static Fiber* handle_fob()
          // If we're out of memory, there's nothing we can do.
         // keep running in the context of the current thread as a best effort.
         if (forkedFiber != NULL) {
+            // The forked fiber carries on the work of this one, so it does so at the same priority.
+            forkedFiber->priority = f->priority;
+            forkedFiber->basePriority = f->basePriority;
 #if CONFIG_ENABLED(DEVICE_FIBER_USER_DATA)
             forkedFiber->user_data = f->user_data;
             f->user_data = NULL;
@@ -402,7 +557,11 @@ void codal::fiber_sleep(unsigned long t)
     dequeue_fiber(f);
 
     // Add fiber to the sleep queue. We maintain strict ordering here to reduce lookup times.
-    queue_fiber(f, &sleepQueue);
+    sleep_queue_insert(f);
+
+    // If we're now the first fiber due to wake up, bring the scheduler tick forward.
+    if (sleepQueue == f)
+        sleep_queue_arm();
 
     // Finally, enter the scheduler.
     schedule();
@@ -507,10 +666,11 @@ int codal::invoke(void (*entry_fn)(void))
     if (!fiber_scheduler_running())
         return DEVICE_NOT_SUPPORTED;
 
-    if (currentFiber->flags & (DEVICE_FIBER_FLAG_FOB | DEVICE_FIBER_FLAG_PARENT | DEVICE_FIBER_FLAG_CHILD) || HAS_THREAD_USER_DATA)
+    if (currentFiber->flags & (DEVICE_FIBER_FLAG_FOB | DEVICE_FIBER_FLAG_PARENT | DEVICE_FIBER_FLAG_CHILD | DEVICE_FIBER_FLAG_DEDICATED_STACK) || HAS_THREAD_USER_DATA)
     {
         // If we attempt a fork on block whilst already in a fork on block context, or if the thread 
         // already has user data set, simply launch a fiber to deal with the request and we're done.
+        // The same applies on a dedicated stack, as a forked fiber can't take over part of that stack.
         create_fiber(entry_fn);
         return DEVICE_OK;
     }
@@ -573,10 +733,11 @@ int codal::invoke(void (*entry_fn)(void *), void *param)
     if (!fiber_scheduler_running())
         return DEVICE_NOT_SUPPORTED;
 
-    if (currentFiber->flags & (DEVICE_FIBER_FLAG_FOB | DEVICE_FIBER_FLAG_PARENT | DEVICE_FIBER_FLAG_CHILD) || HAS_THREAD_USER_DATA)
+    if (currentFiber->flags & (DEVICE_FIBER_FLAG_FOB | DEVICE_FIBER_FLAG_PARENT | DEVICE_FIBER_FLAG_CHILD | DEVICE_FIBER_FLAG_DEDICATED_STACK) || HAS_THREAD_USER_DATA)
     {
         // If we attempt a fork on block whilst already in a fork on block context, or if the thread 
         // already has user data set, simply launch a fiber to deal with the request and we're done.
+        // The same applies on a dedicated stack, as a forked fiber can't take over part of that stack.
         create_fiber(entry_fn, param);
         return DEVICE_OK;
     }
@@ -656,26 +817,63 @@ void codal::launch_new_fiber_param(void (*ep)(void *), void (*cp)(void *), void
 }
 
 
-Fiber *__create_fiber(uint32_t ep, uint32_t cp, uint32_t pm, int parameterised)
+Fiber *__create_fiber(uint32_t ep, uint32_t cp, uint32_t pm, int parameterised, uint32_t stack_size = 0)
 {
+    PROCESSOR_WORD_TYPE stack = 0;
+
     // Validate our parameters.
     if (ep == 0 || cp == 0)
         return NULL;
 
+    // Allocate the dedicated stack first (if any), as it is the allocation most likely to fail.
+    // Keep the stack pointer 8 byte aligned, as required by the procedure call standard.
+    if (stack_size)
+    {
+        stack_size = (stack_size + 7) & ~7;
+        stack = (PROCESSOR_WORD_TYPE)malloc(stack_size);
+
+        if (stack == 0)
+            return NULL;
+    }
+
     // Allocate a TCB from the new fiber. This will come from the fiber pool if available,
     // else a new one will be allocated on the heap.
     Fiber *newFiber = getFiberContext();
 
     // If we're out of memory, there's nothing we can do.
     if (newFiber == NULL)
+    {
+        free((void *)stack);
         return NULL;
+    }
 
     tcb_configure_args(newFiber->tcb, ep, cp, pm);
-    tcb_configure_sp(newFiber->tcb, INITIAL_STACK_DEPTH);
+
+    if (stack)
+    {
+        // The fiber will run on its own stack, so it has no use for a buffer to page into.
+        if (newFiber->stack_bottom != 0)
+            free((void *)newFiber->stack_bottom);
+
+        newFiber->stack_bottom = stack;
+        newFiber->stack_top = stack + stack_size;
+        newFiber->flags |= DEVICE_FIBER_FLAG_DEDICATED_STACK;
+
+        for (uint32_t *p = (uint32_t *)newFiber->stack_bottom; p < (uint32_t *)newFiber->stack_top; p++)
+            *p = DEVICE_FIBER_STACK_PAINT;
+
+        tcb_configure_stack_base(newFiber->tcb, newFiber->stack_top);
+        tcb_configure_sp(newFiber->tcb, newFiber->stack_top);
+    }
+    else
+    {
+        tcb_configure_sp(newFiber->tcb, INITIAL_STACK_DEPTH);
+    }
+
     tcb_configure_lr(newFiber->tcb, parameterised ? (PROCESSOR_WORD_TYPE) &launch_new_fiber_param : (PROCESSOR_WORD_TYPE) &launch_new_fiber);
 
     // Add new fiber to the run queue.
-    queue_fiber(newFiber, &runQueue);
+    queue_runnable(newFiber);
 
     return newFiber;
 }
@@ -719,6 +917,114 @@ Fiber *codal::create_fiber(void (*entry_fn)(void *), void *param, void (*complet
     return __create_fiber((uint32_t) entry_fn, (uint32_t)completion_fn, (uint32_t) param, 1);
 }
 
+/**
+  * Creates a new Fiber that runs on its own, heap allocated stack, and launches it.
+  *
+  * @param entry_fn The function the new Fiber will begin execution in.
+  *
+  * @param stack_size The size of the stack to allocate, in bytes.
+  *
+  * @param completion_fn The function called when the thread completes execution of entry_fn.
+  *                      Defaults to release_fiber.
+  *
+  * @return The new Fiber, or NULL if the operation could not be completed.
+  */
+Fiber *codal::create_dedicated_fiber(void (*entry_fn)(void), uint32_t stack_size, void (*completion_fn)(void))
+{
+    if (!fiber_scheduler_running() || stack_size == 0)
+        return NULL;
+
+    return __create_fiber((uint32_t) entry_fn, (uint32_t)completion_fn, 0, 0, stack_size);
+}
+
+/**
+  * Creates a new parameterised Fiber that runs on its own, heap allocated stack, and launches it.
+  *
+  * @param entry_fn The function the new Fiber will begin execution in.
+  *
+  * @param param an untyped parameter passed into the entry_fn and completion_fn.
+  *
+  * @param stack_size The size of the stack to allocate, in bytes.
+  *
+  * @param completion_fn The function called when the thread completes execution of entry_fn.
+  *                      Defaults to release_fiber.
+  *
+  * @return The new Fiber, or NULL if the operation could not be completed.
+  */
+Fiber *codal::create_dedicated_fiber(void (*entry_fn)(void *), void *param, uint32_t stack_size, void (*completion_fn)(void *))
+{
+    if (!fiber_scheduler_running() || stack_size == 0)
+        return NULL;
+
+    return __create_fiber((uint32_t) entry_fn, (uint32_t)completion_fn, (uint32_t) param, 1, stack_size);
+}
+
+/**
+  * Sets the priority of the given fiber. Whenever any fiber of a higher priority is runnable,
+  * it is scheduled in preference to those of a lower priority.
+  *
+  * @param f The fiber to update.
+  *
+  * @param priority The new priority, from DEVICE_FIBER_PRIORITY_LOW to DEVICE_FIBER_PRIORITY_LEVELS - 1.
+  *
+  * @return DEVICE_OK, or DEVICE_INVALID_PARAMETER.
+  */
+int codal::fiber_set_priority(Fiber *f, int priority)
+{
+    if (f == NULL || priority < DEVICE_FIBER_PRIORITY_LOW || priority >= DEVICE_FIBER_PRIORITY_LEVELS)
+        return DEVICE_INVALID_PARAMETER;
+
+    target_disable_irq();
+
+    // If the fiber currently inherits a higher priority from a FiberLock, it keeps that until it releases the lock.
+    if (f->priority == f->basePriority || priority > f->priority)
+        set_effective_priority(f, priority);
+
+    f->basePriority = priority;
+
+    target_enable_irq();
+
+    return DEVICE_OK;
+}
+
+/**
+  * Determines the priority the given fiber is currently scheduled with.
+  *
+  * @param f The fiber to inspect.
+  *
+  * @return The priority of the fiber, including any priority inherited from a FiberLock, or DEVICE_INVALID_PARAMETER.
+  */
+int codal::fiber_get_priority(Fiber *f)
+{
+    if (f == NULL)
+        return DEVICE_INVALID_PARAMETER;
+
+    return f->priority;
+}
+
+/**
+  * Determines the deepest stack usage of the given fiber seen so far.
+  *
+  * @param f The fiber to inspect.
+  *
+  * @return The stack high water mark in bytes, or DEVICE_INVALID_PARAMETER if f is NULL.
+  */
+int codal::fiber_stack_high_water(Fiber *f)
+{
+    if (f == NULL)
+        return DEVICE_INVALID_PARAMETER;
+
+    if (!(f->flags & DEVICE_FIBER_FLAG_DEDICATED_STACK))
+        return f->stack_top - f->stack_bottom;
+
+    uint32_t *p = (uint32_t *)f->stack_bottom;
+
+    while (p < (uint32_t *)f->stack_top && *p == DEVICE_FIBER_STACK_PAINT)
+        p++;
+
+    return f->stack_top - (PROCESSOR_WORD_TYPE)p;
+}
+
 /**
   * Exit point for all fibers.
   *
@@ -751,7 +1057,8 @@ void codal::release_fiber(void)
     // limit the number of fibers in the pool
     int numFree = 0;
     for (Fiber *p = fiberPool; p; p = p->qnext) {
-        if (!p->qnext && numFree > 3) {
+        // Never free a dedicated stack here, as we may still be running on it.
+        if (!p->qnext && numFree > 3 && !(p->flags & DEVICE_FIBER_FLAG_DEDICATED_STACK)) {
             p->qprev->qnext = NULL;
             free(p->tcb);
             free((void *)p->stack_bottom);
@@ -763,7 +1070,8 @@ void codal::release_fiber(void)
     }
 
     // Reset fiber state, to ensure it can be safely reused.
-    currentFiber->flags = 0;
+    // A dedicated stack stays with the fiber until it is recycled by getFiberContext().
+    currentFiber->flags &= DEVICE_FIBER_FLAG_DEDICATED_STACK;
     tcb_configure_stack_base(currentFiber->tcb, fiber_initial_stack_base());
 
     // Remove the fiber from the list of active fibers
@@ -841,6 +1149,14 @@ void codal::verify_stack_size(Fiber *f)
     }
 }
 
+/**
+  * Determines the highest priority with a runnable fiber. Only valid if runQueueBitmap is not zero.
+  */
+static inline int highest_runnable_priority()
+{
+    return 31 - __builtin_clz(runQueueBitmap);
+}
+
 /**
   * Determines if any fibers are waiting to be scheduled.
   *
@@ -848,7 +1164,7 @@ void codal::verify_stack_size(Fiber *f)
   */
 int codal::scheduler_runqueue_empty()
 {
-    return (runQueue == NULL);
+    return (runQueueBitmap == 0);
 }
 
 /**
@@ -897,18 +1213,24 @@ void codal::schedule()
         return;
     }
 
-    // We're in a normal scheduling context, so perform a round robin algorithm across runnable fibers.
+    // We're in a normal scheduling context, so perform a round robin algorithm across the runnable fibers
+    // of the highest priority that has any.
     // OK - if we've nothing to do, then run the IDLE task (power saving sleep)
-    if (runQueue == NULL)
+    if (runQueueBitmap == 0)
         currentFiber = idleFiber;
 
-    else if (currentFiber->queue == &runQueue)
-        // If the current fiber is on the run queue, round robin.
-        currentFiber = currentFiber->qnext == NULL ? runQueue : currentFiber->qnext;
-
     else
-        // Otherwise, just pick the head of the run queue.
-        currentFiber = runQueue;
+    {
+        Fiber **queue = &runQueue[highest_runnable_priority()];
+
+        if (currentFiber->queue == queue)
+            // If the current fiber is on that run queue, round robin.
+            currentFiber = currentFiber->qnext == NULL ? *queue : currentFiber->qnext;
+
+        else
+            // Otherwise, just pick the head of the run queue.
+            currentFiber = *queue;
+    }
 
     if (currentFiber == idleFiber && oldFiber->flags & DEVICE_FIBER_FLAG_DO_NOT_PAGE)
     {
@@ -916,18 +1238,21 @@ void codal::schedule()
         // Keep idling while the runqueue is empty, or there is data to process.
 
         // Run in the context of the original fiber, to preserve state of flags...
-        // as we are running on top of this fiber's stack.
+        // as we are running on top of this fiber's stack. This is still the idle task, so it may not block.
         currentFiber = oldFiber;
+        fiber_flags |= DEVICE_SCHEDULER_IN_IDLE;
 
         do
         {
             idle();
         }
-        while (runQueue == NULL);
+        while (runQueueBitmap == 0);
+
+        fiber_flags &= ~DEVICE_SCHEDULER_IN_IDLE;
 
         // Switch to a non-idle fiber.
         // If this fiber is the same as the old one then there'll be no switching at all.
-        currentFiber = runQueue;
+        currentFiber = runQueue[highest_runnable_priority()];
     }
 
     // Swap to the context of the chosen fiber, and we're done.
@@ -942,11 +1267,18 @@ void codal::schedule()
             tcb_configure_lr(idleFiber->tcb, (PROCESSOR_WORD_TYPE)&idle_task);
         }
 
+        // Fibers with a dedicated stack are switched by stack pointer alone, so their stack is never paged in or out.
+        PROCESSOR_WORD_TYPE newStack = (currentFiber->flags & DEVICE_FIBER_FLAG_DEDICATED_STACK) ? 0 : currentFiber->stack_top;
+
         // If we're returning for IDLE or our last fiber has been destroyed, we don't need to waste time
         // saving the processor context - Just swap in the new fiber, and discard changes to stack and register context.
         if (oldFiber == idleFiber || oldFiber->queue == &fiberPool)
         {
-            swap_context(NULL, 0, currentFiber->tcb, currentFiber->stack_top);
+            swap_context(NULL, 0, currentFiber->tcb, newStack);
+        }
+        else if (oldFiber->flags & DEVICE_FIBER_FLAG_DEDICATED_STACK)
+        {
+            swap_context(oldFiber->tcb, 0, currentFiber->tcb, newStack);
         }
         else
         {
@@ -954,7 +1286,7 @@ void codal::schedule()
             verify_stack_size(oldFiber);
 
             // Schedule in the new fiber.
-            swap_context(oldFiber->tcb, oldFiber->stack_top, currentFiber->tcb, currentFiber->stack_top);
+            swap_context(oldFiber->tcb, oldFiber->stack_top, currentFiber->tcb, newStack);
         }
     }
 }
@@ -982,10 +1314,41 @@ void codal::idle()
         // because we enforce MESSAGE_BUS_LISTENER_IMMEDIATE for listeners placed
         // on the scheduler.
         fiber_flags &= ~DEVICE_SCHEDULER_IDLE;
+
+        CODAL_TIMESTAMP sleepStart = system_timer_current_time_us();
         target_wait_for_event();
+        idleSleepTime += system_timer_current_time_us() - sleepStart;
+        idleWakeups++;
     }
 }
 
+/**
+  * Reports how often, and for how long, the processor has slept in idle() since the last call
+  * to this function (or since the scheduler was started). The statistics are reset by this call.
+  *
+  * @param wakeups Set to the number of times the processor woke up from an idle sleep.
+  *
+  * @param sleepTime Set to the total time spent asleep, in microseconds.
+  *
+  * @param period Set to the time over which the statistics were gathered, in microseconds.
+  */
+void codal::scheduler_get_idle_statistics(uint32_t *wakeups, CODAL_TIMESTAMP *sleepTime, CODAL_TIMESTAMP *period)
+{
+    CODAL_TIMESTAMP now = system_timer_current_time_us();
+
+    target_disable_irq();
+
+    *wakeups = idleWakeups;
+    *sleepTime = idleSleepTime;
+    *period = now - idleStatisticsStart;
+
+    idleWakeups = 0;
+    idleSleepTime = 0;
+    idleStatisticsStart = now;
+
+    target_enable_irq();
+}
+
 /**
   * The idle task, which is called when the runtime has no fibers that require execution.
   *
@@ -1006,6 +1369,7 @@ void codal::idle_task()
 FiberLock::FiberLock()
 {
     queue = NULL;
+    owner = NULL;
     locked = false;
 }
 
@@ -1020,6 +1384,15 @@ void FiberLock::wait()
 
     target_disable_irq();
     int l = ++locked;
+
+    if (l == 1)
+        owner = currentFiber;
+
+    // Lend our priority to the fiber holding the lock, so fibers of an intermediate priority
+    // can't keep it (and therefore us) from running.
+    else if (owner != NULL && owner->priority < currentFiber->priority)
+        set_effective_priority(owner, currentFiber->priority);
+
     target_enable_irq();
 
     if (l > 1)
@@ -1045,7 +1418,7 @@ void FiberLock::wait()
             dequeue_fiber(f);
 
             // Add fiber to the sleep queue. We maintain strict ordering here to reduce lookup times.
-            queue_fiber(f, &runQueue);
+            queue_runnable(f);
         }
         target_enable_irq();
 
@@ -1061,14 +1434,24 @@ void FiberLock::notify()
 {
     Fiber *f = queue;
 
+    target_disable_irq();
+
+    // The lock passes to the fiber we wake (if any), so return any priority lent to the current owner.
+    if (owner != NULL && owner->priority != owner->basePriority)
+        set_effective_priority(owner, owner->basePriority);
+
+    owner = f;
+
     if (f)
     {
         dequeue_fiber(f);
-        queue_fiber(f, &runQueue);
+        queue_runnable(f);
     }
 
     if (locked > 0)
         locked--;
+
+    target_enable_irq();
 }
 
 /**
@@ -1078,10 +1461,19 @@ void FiberLock::notifyAll()
 {
     Fiber *f = queue;
 
+    target_disable_irq();
+
+    if (owner != NULL && owner->priority != owner->basePriority)
+        set_effective_priority(owner, owner->basePriority);
+
+    owner = NULL;
+
+    target_enable_irq();
+
     while (f)
     {
         dequeue_fiber(f);
-        queue_fiber(f, &runQueue);
+        queue_runnable(f);
         f = queue;
     }
 
@@ -29,6 +29,7 @@ DEALINGS IN THE SOFTWARE.
   */
 #include "CodalConfig.h"
 #include "CodalListener.h"
+#include "codal_target_hal.h"
 
 using namespace codal;
 
@@ -92,6 +93,68 @@ Listener::~Listener()
 {
     if(this->flags & MESSAGE_BUS_LISTENER_METHOD)
         delete cb_method;
+
+    // Release any events still queued on this listener.
+    while (evt_queue)
+    {
+        EventQueueItem *item = evt_queue;
+        evt_queue = item->next;
+        delete item;
+    }
+}
+
+static Listener *listenerPool = NULL;                                           // Unused listeners in the pool.
+static uint64_t listenerPoolMemory[MESSAGE_BUS_LISTENER_POOL_SIZE][(sizeof(Listener) + 7) / 8];
+static bool listenerPoolInitialised = false;
+
+/**
+  * Allocates a Listener from a static pool, so that registering listeners does not fragment the heap.
+  * Falls back to the heap if the pool is exhausted.
+  */
+void *Listener::operator new(size_t size)
+{
+    Listener *l;
+
+    target_disable_irq();
+
+    if (!listenerPoolInitialised)
+    {
+        for (int i = 0; i < MESSAGE_BUS_LISTENER_POOL_SIZE; i++)
+        {
+            l = (Listener *) listenerPoolMemory[i];
+            l->next = listenerPool;
+            listenerPool = l;
+        }
+
+        listenerPoolInitialised = true;
+    }
+
+    l = listenerPool;
+    if (l)
+        listenerPool = l->next;
+
+    target_enable_irq();
+
+    return l ? l : ::operator new(size);
+}
+
+/**
+  * Returns a Listener to the pool it was allocated from.
+  */
+void Listener::operator delete(void *p)
+{
+    if (p < (void *) listenerPoolMemory || p >= (void *) &listenerPoolMemory[MESSAGE_BUS_LISTENER_POOL_SIZE])
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    Listener *l = (Listener *) p;
+
+    target_disable_irq();
+    l->next = listenerPool;
+    listenerPool = l;
+    target_enable_irq();
 }
 
 /**
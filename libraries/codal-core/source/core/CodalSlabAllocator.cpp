@@ -0,0 +1,307 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2017 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+
+/**
+  * A size class allocator for the payloads of managed types (ManagedBuffer, ManagedString, Image...).
+  *
+  * Streams create and release a ManagedBuffer for every block of data they move, so the heap sees
+  * the same few sizes over and over again. Here each size class is a statically allocated array of
+  * equally sized blocks, kept on a free list: allocating and releasing a block takes constant time,
+  * and does not fragment the heap.
+  *
+  * Requests larger than the largest class, or for a class that has no free blocks left, are passed
+  * on to the heap. device_slab_free() accepts memory from either source.
+  */
+
+#include "CodalConfig.h"
+#include "CodalSlabAllocator.h"
+#include "codal_target_hal.h"
+#include "CodalDmesg.h"
+#include "ErrorNo.h"
+
+#if CONFIG_ENABLED(DEVICE_SLAB_ALLOCATOR)
+
+// Size of the blocks of a given class, in bytes. These are multiples of 8, so every block stays 8 byte aligned.
+#define SLAB_BLOCK_SIZE(c)          ((DEVICE_SLAB_MINIMUM_SIZE << (c)) + DEVICE_SLAB_HEADER_SIZE)
+
+#define SLAB_ARENA_SIZE             (DEVICE_SLAB_BLOCKS_16 * SLAB_BLOCK_SIZE(0) + \
+                                     DEVICE_SLAB_BLOCKS_32 * SLAB_BLOCK_SIZE(1) + \
+                                     DEVICE_SLAB_BLOCKS_64 * SLAB_BLOCK_SIZE(2) + \
+                                     DEVICE_SLAB_BLOCKS_128 * SLAB_BLOCK_SIZE(3) + \
+                                     DEVICE_SLAB_BLOCKS_256 * SLAB_BLOCK_SIZE(4) + \
+                                     DEVICE_SLAB_BLOCKS_512 * SLAB_BLOCK_SIZE(5))
+
+// An unused block keeps the header word of a managed type poisoned: a reference left over to a released
+// payload reads a refCount of 0xffff, as for an object in flash, so RefCounted::incr() and decr() leave the
+// block alone rather than corrupting the free list or releasing it a second time.
+#define SLAB_FREE_REFCOUNT          0xffff
+#define SLAB_FREE_MARK              0x51ab
+
+struct SlabBlock
+{
+    uint16_t        refCount;               // SLAB_FREE_REFCOUNT, where a managed type keeps its reference count.
+    uint16_t        mark;                   // SLAB_FREE_MARK, where a managed type keeps its tag.
+    SlabBlock       *next;                  // Next unused block of the same class, past the header word.
+};
+
+struct SlabClass
+{
+    uint8_t         *start;                 // Address of the first block of this class.
+    uint8_t         *end;                   // Address just past the last block of this class.
+    SlabBlock       *free;                  // Unused blocks of this class.
+    SlabStatistics  stats;
+};
+
+static const uint16_t slabBlocks[DEVICE_SLAB_CLASSES] = { DEVICE_SLAB_BLOCKS_16, DEVICE_SLAB_BLOCKS_32, DEVICE_SLAB_BLOCKS_64,
+                                                          DEVICE_SLAB_BLOCKS_128, DEVICE_SLAB_BLOCKS_256, DEVICE_SLAB_BLOCKS_512 };
+
+static uint64_t slabArena[(SLAB_ARENA_SIZE + 7) / 8];                           // The blocks of all classes, smallest class first.
+static SlabClass slabClasses[DEVICE_SLAB_CLASSES];
+static uint32_t slabOversized = 0;
+static bool slabInitialised = false;
+
+/**
+  * Poisons the header of a block and places it on the free list of its class.
+  * Called with interrupts disabled.
+  */
+static inline void slab_push(SlabClass &sc, SlabBlock *b)
+{
+    b->refCount = SLAB_FREE_REFCOUNT;
+    b->mark = SLAB_FREE_MARK;
+    b->next = sc.free;
+    sc.free = b;
+}
+
+/**
+  * Determines if a block carries the poisoned header of an unused block.
+  */
+static inline bool slab_is_free(SlabBlock *b)
+{
+    return b->refCount == SLAB_FREE_REFCOUNT && b->mark == SLAB_FREE_MARK;
+}
+
+/**
+  * Carves the arena into the blocks of each class, and places them all on their free lists.
+  * Called with interrupts disabled.
+  */
+static void slab_init()
+{
+    uint8_t *p = (uint8_t *) slabArena;
+
+    for (int c = 0; c < DEVICE_SLAB_CLASSES; c++)
+    {
+        SlabClass &sc = slabClasses[c];
+
+        sc.start = p;
+        sc.free = NULL;
+        sc.stats.blockSize = SLAB_BLOCK_SIZE(c);
+        sc.stats.blocks = slabBlocks[c];
+
+        // Push the blocks in reverse, so they are handed out in address order.
+        p += slabBlocks[c] * SLAB_BLOCK_SIZE(c);
+        sc.end = p;
+
+        for (uint8_t *b = sc.end; b > sc.start;)
+        {
+            b -= SLAB_BLOCK_SIZE(c);
+            slab_push(sc, (SlabBlock *) b);
+        }
+    }
+
+    slabInitialised = true;
+}
+
+/**
+  * Allocates a block of memory from the smallest size class that can hold it, or from the heap
+  * if there is no such class or it is full.
+  *
+  * @param size The amount of memory, in bytes, to allocate.
+  *
+  * @return A pointer to the allocated memory, or NULL if insufficient memory is available.
+  */
+void *device_slab_alloc(size_t size)
+{
+    SlabBlock *b = NULL;
+    int c = 0;
+
+    while (c < DEVICE_SLAB_CLASSES && size > SLAB_BLOCK_SIZE(c))
+        c++;
+
+    target_disable_irq();
+
+    if (!slabInitialised)
+        slab_init();
+
+    if (c == DEVICE_SLAB_CLASSES)
+    {
+        slabOversized++;
+    }
+    else
+    {
+        SlabClass &sc = slabClasses[c];
+
+        b = sc.free;
+        if (b)
+        {
+            // Something wrote over an unused block, so its link can't be trusted either.
+            if (!slab_is_free(b))
+                target_panic(DEVICE_HEAP_ERROR);
+
+            sc.free = b->next;
+            b->mark = 0;
+            sc.stats.allocations++;
+
+            if (++sc.stats.used > sc.stats.peak)
+                sc.stats.peak = sc.stats.used;
+        }
+        else
+        {
+            sc.stats.fallbacks++;
+        }
+    }
+
+    target_enable_irq();
+
+    return b ? (void *) b : malloc(size);
+}
+
+/**
+  * Releases a block of memory allocated by device_slab_alloc(), or by malloc().
+  * Releasing a block of a size class twice panics with DEVICE_HEAP_ERROR.
+  *
+  * @param mem The memory area to release.
+  */
+void device_slab_free(void *mem)
+{
+    uint8_t *p = (uint8_t *) mem;
+
+    if (p < (uint8_t *) slabArena || p >= (uint8_t *) slabArena + SLAB_ARENA_SIZE)
+    {
+        free(mem);
+        return;
+    }
+
+    // The arena only holds blocks once it is initialised, so the classes are valid here.
+    int c = 0;
+    while (p >= slabClasses[c].end)
+        c++;
+
+    SlabClass &sc = slabClasses[c];
+
+    target_disable_irq();
+
+    // Released twice.
+    if (slab_is_free((SlabBlock *) p))
+        target_panic(DEVICE_HEAP_ERROR);
+
+    slab_push(sc, (SlabBlock *) p);
+    sc.stats.used--;
+    target_enable_irq();
+}
+
+/**
+  * Reads the usage statistics of a size class.
+  *
+  * @param index The size class, between 0 and DEVICE_SLAB_CLASSES-1.
+  *
+  * @param stats The structure to fill in.
+  *
+  * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if there is no such class, or
+  * DEVICE_NOT_SUPPORTED if the slab allocator is disabled.
+  */
+int device_slab_statistics(int index, SlabStatistics *stats)
+{
+    if (index < 0 || index >= DEVICE_SLAB_CLASSES || stats == NULL)
+        return DEVICE_INVALID_PARAMETER;
+
+    target_disable_irq();
+
+    if (!slabInitialised)
+        slab_init();
+
+    *stats = slabClasses[index].stats;
+
+    target_enable_irq();
+
+    return DEVICE_OK;
+}
+
+/**
+  * Determines the number of requests passed on to the heap because they were larger than any size class.
+  */
+uint32_t device_slab_oversized()
+{
+    return slabOversized;
+}
+
+#if (CODAL_DEBUG >= CODAL_DEBUG_HEAP)
+/**
+  * Displays the usage statistics of all size classes.
+  */
+void device_slab_print()
+{
+    SlabStatistics stats;
+
+    for (int c = 0; c < DEVICE_SLAB_CLASSES; c++)
+    {
+        device_slab_statistics(c, &stats);
+        DMESG("SLAB %d: size %d blocks %d used %d peak %d allocs %d fallbacks %d", c, (int)stats.blockSize, (int)stats.blocks,
+              (int)stats.used, (int)stats.peak, (int)stats.allocations, (int)stats.fallbacks);
+    }
+
+    DMESG("SLAB oversized: %d", (int)slabOversized);
+}
+#endif
+
+#else
+
+void *device_slab_alloc(size_t size)
+{
+    return malloc(size);
+}
+
+void device_slab_free(void *mem)
+{
+    free(mem);
+}
+
+int device_slab_statistics(int, SlabStatistics *)
+{
+    return DEVICE_NOT_SUPPORTED;
+}
+
+uint32_t device_slab_oversized()
+{
+    return 0;
+}
+
+#if (CODAL_DEBUG >= CODAL_DEBUG_HEAP)
+void device_slab_print()
+{
+    DMESG("--- SLAB ALLOCATOR DISABLED ---");
+}
+#endif
+
+#endif
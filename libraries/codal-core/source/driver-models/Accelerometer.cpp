@@ -357,6 +357,52 @@ int Accelerometer::getRange()
     return (int)sampleRange;
 }
 
+/**
+  * Attempts to set the number of samples the accelerometer collects before delivering them to
+  * its batch sink.
+  *
+  * @param samples The requested number of samples per batch.
+  *
+  * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the hardware cannot hold that many samples,
+  * or DEVICE_NOT_SUPPORTED if batched acquisition is not supported.
+  *
+  * @note This method should be overriden (if supported) by specific accelerometer device drivers.
+  */
+int Accelerometer::setBatchSize(int)
+{
+    return DEVICE_NOT_SUPPORTED;
+}
+
+/**
+  * Starts or stops batched acquisition. While batching, the hardware collects samples, and the sink
+  * is notified through its pullRequest() method as each batch is ready to be read with pullBatch().
+  * Batched samples raise no events and are not used for gesture tracking.
+  * An AccelerometerStream provides this as a DataSource.
+  *
+  * @param sink The component to deliver batches to, or NULL to resume sample by sample updates.
+  *
+  * @return DEVICE_OK on success, or DEVICE_NOT_SUPPORTED if batched acquisition is not supported.
+  *
+  * @note This method should be overriden (if supported) by specific accelerometer device drivers.
+  */
+int Accelerometer::setBatchSink(DataSink *)
+{
+    return DEVICE_NOT_SUPPORTED;
+}
+
+/**
+  * Reads the latest batch of samples: 16 bit signed (x, y, z) triplets in milli-g, in the
+  * coordinate system specified by the coordinateSpace variable.
+  *
+  * @return The batch, or an empty buffer if none is ready.
+  *
+  * @note This method should be overriden (if supported) by specific accelerometer device drivers.
+  */
+ManagedBuffer Accelerometer::pullBatch()
+{
+    return ManagedBuffer();
+}
+
 /**
  * Configures the accelerometer for G range and sample rate defined
  * in this object. The nearest values are chosen to those defined
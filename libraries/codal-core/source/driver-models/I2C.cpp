@@ -24,6 +24,8 @@ DEALINGS IN THE SOFTWARE.
 
 #include "I2C.h"
 #include "ErrorNo.h"
+#include "CodalFiber.h"
+#include "Event.h"
 
 namespace codal
 {
@@ -270,6 +272,44 @@ namespace codal
         return (result == DEVICE_OK) ? (int)data : result;
     }
 
+    /**
+     * Starts a transaction, which is performed once all transactions started before it have completed.
+     * On completion, the status of the transaction is updated, and its doneHandler is called.
+     * If it has no doneHandler, an I2C_EVT_TRANSACTION_COMPLETE event is raised instead.
+     *
+     * This default implementation performs the transaction before returning, and calls the doneHandler
+     * in a new fiber. Drivers for interrupt driven hardware return as soon as it is queued.
+     *
+     * @param t The transaction to perform.
+     *
+     * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the transaction transfers no data.
+     */
+    int I2C::startTransaction(I2CTransaction &t)
+    {
+        int result = DEVICE_OK;
+
+        if (t.txSize == 0 && t.rxSize == 0)
+            return DEVICE_INVALID_PARAMETER;
+
+        t.status = I2C_TRANSACTION_PENDING;
+
+        if (t.txSize)
+            result = write(t.address, t.txBuffer, t.txSize, t.rxSize > 0);
+
+        if (result == DEVICE_OK && t.rxSize)
+            result = read(t.address, t.rxBuffer, t.rxSize);
+
+        t.status = result == DEVICE_OK ? DEVICE_OK : DEVICE_I2C_ERROR;
+
+        // As in SPI::startTransfer(), don't invoke the handler recursively.
+        if (t.doneHandler)
+            create_fiber(t.doneHandler, &t);
+        else
+            Event(DEVICE_ID_I2C, I2C_EVT_TRANSACTION_COMPLETE);
+
+        return DEVICE_OK;
+    }
+
     int I2C::write(int address, char *data, int len, bool repeated)
     {
         return write((uint16_t)address, (uint8_t *)data, len, repeated);
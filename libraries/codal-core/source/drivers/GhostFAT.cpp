@@ -454,14 +454,9 @@ static void readCurrentUF2(GFATEntry *ent, unsigned blockAddr, char *dst)
 #if DEVICE_DMESG_BUFFER_SIZE > 0
 static void readDMesg(GFATEntry *ent, unsigned blockAddr, char *dst)
 {
-    uint32_t addr = blockAddr * 512;
-    for (uint32_t i = 0; i < 512; ++i)
-    {
-        if (addr < codalLogStore.ptr)
-            *dst++ = codalLogStore.buffer[addr++];
-        else
-            *dst++ = '\n';
-    }
+    int length = codal_dmesg_peek(dst, blockAddr * 512, 512);
+
+    memset(dst + length, '\n', 512 - length);
 }
 #endif
 
@@ -48,6 +48,7 @@ using namespace codal;
 KeyValueStorage::KeyValueStorage(NVMController& controller, int pageNumber) : controller(controller)
 {
     scratch = NULL;
+    indexSize = 0;
 
     // Determine the logival address of the start of the key/value storage page
     if (pageNumber < 0)
@@ -55,7 +56,10 @@ KeyValueStorage::KeyValueStorage(NVMController& controller, int pageNumber) : co
     else
         flashPagePtr = controller.getFlashStart() + (controller.getPageSize() * pageNumber);   
 
-    size();
+    flashPageEnd = flashPagePtr + controller.getPageSize();
+    logPtr = flashPagePtr + sizeof(KeyValueStore);
+
+    load();
 }
 
 
@@ -75,78 +79,47 @@ KeyValueStorage::KeyValueStorage(NVMController& controller, int pageNumber) : co
   */
 int KeyValueStorage::put(const char *key, uint8_t *data, int dataSize)
 {
-    KeyValuePair pair;
+    KeyValueRecord record;
     int keySize = strlen(key) + 1;
 
-    if(keySize > (int)sizeof(pair.key) || dataSize > (int)sizeof(pair.value) || dataSize < 0)
+    if(keySize > (int)sizeof(record.pair.key) || dataSize > (int)sizeof(record.pair.value) || dataSize < 0)
         return DEVICE_INVALID_PARAMETER;
 
-    KeyValuePair *currentValue = get(key);
-
-    int upToDate = currentValue && (memcmp(currentValue->value, data, dataSize) == 0);
-
-    if(currentValue)
-        delete currentValue;
-
-    if(upToDate)
-        return DEVICE_OK;
-
-    memcpy(pair.key, key, keySize);
-    memcpy(pair.value, data, dataSize);
-
-    uint32_t flashPointer = flashPagePtr;
-
-    int storeSize = size();
-
-    //our KeyValueStore struct is always at 0
-    flashPointer += sizeof(KeyValueStore);
-    int scratchPtr = sizeof(KeyValueStore) / 4;
-
-    KeyValuePair storedPair = KeyValuePair();
-    int found = 0;
+    uint16_t h = hash(key);
+    int i = lookup(key, h);
+    uint16_t version = 0;
 
-    scratchReset();
-
-    //iterate through key value pairs in flash, writing them to the scratch page.
-    for(int i = 0; i < storeSize; i++)
+    if(i >= 0)
     {
-        controller.read((uint32_t *)&storedPair, flashPointer, sizeof(KeyValuePair)/4);
+        //read the current value directly from the newest record, and skip the write if it is unchanged.
+        controller.read((uint32_t *)&record, index[i].address, sizeof(KeyValueRecord)/4);
 
-        //check if the keys match...
-        if(strcmp((char *)storedPair.key, (char *)pair.key) == 0)
-        {
-            found = 1;
-            //scratch our KeyValueStore struct so that it is preserved.
-            scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize));
-            scratchKeyValuePair(pair, scratchPtr);
-        }
-        else
-        {
-            scratchKeyValuePair(storedPair, scratchPtr);
-        }
+        if(memcmp(record.pair.value, data, dataSize) == 0)
+            return DEVICE_OK;
 
-        flashPointer += sizeof(KeyValuePair);
-        scratchPtr += sizeof(KeyValuePair) / 4;
+        version = index[i].version + 1;
     }
-
-    if(!found)
+    else if(indexSize == KEY_VALUE_STORAGE_MAX_PAIRS)
     {
-        //if we haven't got a match for the key, check we can add a new KeyValuePair
-        if(storeSize == KEY_VALUE_STORAGE_MAX_PAIRS)
-            return DEVICE_NO_RESOURCES;
+        return DEVICE_NO_RESOURCES;
+    }
 
-        storeSize += 1;
+    memset(&record, 0, sizeof(KeyValueRecord));
+    memcpy(record.pair.key, key, keySize);
+    memcpy(record.pair.value, data, dataSize);
+    record.header = KEY_VALUE_RECORD_HEADER(KEY_VALUE_RECORD_PUT, version);
 
-        //scratch our updated values.
-        scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize));
-        scratchKeyValuePair(pair, scratchPtr);
-    }
+    uint32_t address = append(&record);
 
-    //erase our storage page
-    controller.erase(flashPagePtr);
+    if(address == 0)
+        return DEVICE_NO_RESOURCES;
+
+    if(i < 0)
+        i = indexSize++;
 
-    //copy from scratch to storage.
-    controller.write(flashPagePtr, scratch, KEY_VALUE_STORAGE_SCRATCH_WORD_SIZE);
+    index[i].address = address;
+    index[i].hash = h;
+    index[i].version = version;
 
     return DEVICE_OK;
 }
@@ -181,38 +154,13 @@ int KeyValueStorage::put(ManagedString key, uint8_t* data, int dataSize)
   */
 KeyValuePair* KeyValueStorage::get(const char* key)
 {
-    //calculate our offsets for our storage page
-    int storeSize = size();
+    int i = lookup(key, hash(key));
 
-    //we haven't got anything stored, so return...
-    if(storeSize == 0)
+    if(i < 0)
         return NULL;
 
-    uint32_t flashPtr = this->flashPagePtr;
-
-    //our KeyValueStore struct is always at 0
-    flashPtr += sizeof(KeyValueStore);
-
     KeyValuePair *pair = new KeyValuePair();
-
-    int i;
-
-    //iterate through flash until we have a match, or drop out.
-    for(i = 0; i < storeSize; i++)
-    {
-        controller.read((uint32_t *)pair, flashPtr, sizeof(KeyValuePair)/4);
-        if(strcmp(key,(char *)pair->key) == 0)
-            break;
-
-        flashPtr += sizeof(KeyValuePair);
-    }
-
-    //clean up
-    if(i == storeSize)
-    {
-        delete pair;
-        return NULL;
-    }
+    controller.read((uint32_t *)pair, index[i].address + sizeof(uint32_t), sizeof(KeyValuePair)/4);
 
     return pair;
 }
@@ -242,60 +190,25 @@ KeyValuePair* KeyValueStorage::get(ManagedString key)
   */
 int KeyValueStorage::remove(const char* key)
 {
-    int storeSize = size();
+    int i = lookup(key, hash(key));
 
     //if we have no data, we have nothing to do.
-    if(storeSize == 0)
+    if(i < 0)
         return DEVICE_NO_DATA;
 
-    uint32_t flashPointer = this->flashPagePtr;
+    //drop the key from the index first, so that a compaction triggered by the append below
+    //does not carry the old value forward.
+    KeyValueRecord record;
+    uint16_t version = index[i].version + 1;
 
-    //our KeyValueStore struct is always at 0
-    flashPointer += sizeof(KeyValueStore);
-    int scratchPointer = sizeof(KeyValueStore) / 4;
+    index[i] = index[--indexSize];
 
-    KeyValuePair storedPair = KeyValuePair();
+    memset(&record, 0, sizeof(KeyValueRecord));
+    memcpy(record.pair.key, key, strlen(key) + 1);
+    record.header = KEY_VALUE_RECORD_HEADER(KEY_VALUE_RECORD_REMOVE, version);
 
-    int found = 0;
-
-    scratchReset();
+    append(&record);
 
-    // scratch the old size (it will be updated later if required).
-    scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize));
-
-    //iterate through our flash copy pairs to scratch, unless there is a key patch
-    for(int i = 0; i < storeSize; i++)
-    {
-        controller.read((uint32_t *)&storedPair, flashPointer, sizeof(KeyValuePair)/4);
-
-        //if we have a match, don't increment our scratchPointer
-        if(strcmp((char *)storedPair.key, (char *)key) == 0)
-        {
-            found = 1;
-            //write our new KeyValueStore data
-            scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize - 1));
-        }
-        else
-        {
-            //otherwise copy the KeyValuePair from our storage page.
-            scratchKeyValuePair(storedPair, scratchPointer);
-            scratchPointer += sizeof(KeyValuePair) / 4;
-        }
-
-        flashPointer += sizeof(KeyValuePair);
-    }
-
-    //if we haven't got a match, write our old KeyValueStore struct
-    if(!found)
-    {
-        scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_MAGIC, storeSize));
-        return DEVICE_NO_DATA;
-    }
-
-    //copy scratch to our storage page
-    controller.erase(flashPagePtr);
-    controller.write(flashPagePtr, scratch, (sizeof(KeyValueStore) / 4) + (storeSize * (sizeof(KeyValuePair) / 4)));
-    
     return DEVICE_OK;
 }
 
@@ -318,38 +231,229 @@ int KeyValueStorage::remove(ManagedString key)
   * @return the number of entries in the key value store
   */
 int KeyValueStorage::size()
+{
+    return indexSize;
+}
+
+/**
+ * Erase all contents of this KeyValue store
+ */
+int KeyValueStorage::wipe()
+{
+    controller.erase(flashPagePtr);
+    load();
+    return DEVICE_OK;
+}
+
+/**
+  * Scans the storage page and rebuilds the RAM index of live keys.
+  * Formats the page if it is uninitialised, and migrates pages held in the flat layout.
+  */
+void KeyValueStorage::load()
 {
     KeyValueStore store = KeyValueStore();
+    KeyValueRecord record;
+
+    indexSize = 0;
+    logPtr = flashPagePtr + sizeof(KeyValueStore);
 
     //read our data!
     controller.read((uint32_t *)&store, flashPagePtr, sizeof(KeyValueStore)/4);
 
-    //if we haven't used flash before, we need to configure it
-    if(store.magic != KEY_VALUE_STORAGE_MAGIC)
+    if(store.magic == KEY_VALUE_STORAGE_MAGIC)
     {
-        store.magic = KEY_VALUE_STORAGE_MAGIC;
-        store.size = 0;
+        //the page holds the original flat layout, rewrite its pairs as a compacted log.
+        int scratchPtr = sizeof(KeyValueStore) / 4;
+        uint32_t flashPointer = flashPagePtr + sizeof(KeyValueStore);
+
+        if(store.size > KEY_VALUE_STORAGE_MAX_PAIRS)
+            store.size = 0;
+
+        scratchReset();
+        scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_LOG_MAGIC, 0));
+
+        for(uint32_t i = 0; i < store.size; i++)
+        {
+            controller.read((uint32_t *)&record.pair, flashPointer, sizeof(KeyValuePair)/4);
+            record.header = KEY_VALUE_RECORD_HEADER(KEY_VALUE_RECORD_PUT, 0);
 
-        //erase the scratch page and write our new KeyValueStore
+            scratchKeyValueRecord(&record, scratchPtr);
+
+            flashPointer += sizeof(KeyValuePair);
+            scratchPtr += sizeof(KeyValueRecord) / 4;
+        }
+
+        commitScratch(scratchPtr);
+    }
+    else if(store.magic != KEY_VALUE_STORAGE_LOG_MAGIC)
+    {
+        //if we haven't used flash before, we need to configure it
         scratchReset();
-        scratchKeyValueStore(store);
+        scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_LOG_MAGIC, 0));
+        commitScratch(sizeof(KeyValueStore) / 4);
 
-        //erase flash, and copy the scratch page over
-        controller.erase(flashPagePtr);
-        controller.write(flashPagePtr, scratch, KEY_VALUE_STORAGE_SCRATCH_WORD_SIZE);
+        return;
     }
 
-    return store.size;
+    //replay the log, so that the index refers to the newest record of each live key.
+    for(uint32_t address = flashPagePtr + sizeof(KeyValueStore); address + sizeof(KeyValueRecord) <= flashPageEnd; address += sizeof(KeyValueRecord))
+    {
+        controller.read((uint32_t *)&record, address, sizeof(KeyValueRecord)/4);
+
+        if(record.header == KEY_VALUE_RECORD_FREE)
+        {
+            //a slot whose header was never written is either the end of the log, or a record
+            //that was interrupted before it was committed. The latter still occupies its slot.
+            uint32_t *words = (uint32_t *)&record;
+            int erased = 1;
+
+            for(uint32_t w = 0; w < sizeof(KeyValueRecord)/4; w++)
+                if(words[w] != KEY_VALUE_RECORD_FREE)
+                    erased = 0;
+
+            if(erased)
+                break;
+
+            logPtr = address + sizeof(KeyValueRecord);
+            continue;
+        }
+
+        logPtr = address + sizeof(KeyValueRecord);
+
+        record.pair.key[KEY_VALUE_STORAGE_KEY_SIZE - 1] = 0;
+
+        uint16_t h = hash((char *)record.pair.key);
+        int i = lookup((char *)record.pair.key, h);
+
+        if(KEY_VALUE_RECORD_TYPE(record.header) == KEY_VALUE_RECORD_REMOVE)
+        {
+            if(i >= 0)
+                index[i] = index[--indexSize];
+
+            continue;
+        }
+
+        if(KEY_VALUE_RECORD_TYPE(record.header) != KEY_VALUE_RECORD_PUT)
+            continue;
+
+        if(i < 0)
+        {
+            if(indexSize == KEY_VALUE_STORAGE_MAX_PAIRS)
+                continue;
+
+            i = indexSize++;
+        }
+
+        index[i].address = address;
+        index[i].hash = h;
+        index[i].version = KEY_VALUE_RECORD_VERSION(record.header);
+    }
 }
 
 /**
- * Erase all contents of this KeyValue store
- */
-int KeyValueStorage::wipe()
+  * Erases the storage page, and writes the first count words of the scratch page to it.
+  * The scratch page must begin with a valid KeyValueStore.
+  *
+  * @param count the number of words to write.
+  */
+void KeyValueStorage::commitScratch(int count)
 {
     controller.erase(flashPagePtr);
-    size();
-    return DEVICE_OK;
+    controller.write(flashPagePtr, scratch, count);
+
+    logPtr = flashPagePtr + count * 4;
+}
+
+/**
+  * Rewrites the storage page so that it contains only the newest record for each live key.
+  */
+void KeyValueStorage::compact()
+{
+    KeyValueRecord record;
+    int scratchPtr = sizeof(KeyValueStore) / 4;
+
+    scratchReset();
+    scratchKeyValueStore(KeyValueStore(KEY_VALUE_STORAGE_LOG_MAGIC, 0));
+
+    for(int i = 0; i < indexSize; i++)
+    {
+        controller.read((uint32_t *)&record, index[i].address, sizeof(KeyValueRecord)/4);
+        scratchKeyValueRecord(&record, scratchPtr);
+
+        index[i].address = flashPagePtr + scratchPtr * 4;
+        scratchPtr += sizeof(KeyValueRecord) / 4;
+    }
+
+    commitScratch(scratchPtr);
+}
+
+/**
+  * Appends a record to the end of the log, compacting the page first if it is full.
+  *
+  * @param record the KeyValueRecord to append. Its header must be set.
+  *
+  * @return the logical address the record was written to, or 0 if no space is available.
+  */
+uint32_t KeyValueStorage::append(KeyValueRecord *record)
+{
+    if(logPtr + sizeof(KeyValueRecord) > flashPageEnd)
+        compact();
+
+    if(logPtr + sizeof(KeyValueRecord) > flashPageEnd)
+        return 0;
+
+    uint32_t address = logPtr;
+
+    //write the body first, and commit it by writing the header last.
+    controller.write(address + sizeof(uint32_t), (uint32_t *)&record->pair, sizeof(KeyValuePair)/4);
+    controller.write(address, &record->header, 1);
+
+    logPtr += sizeof(KeyValueRecord);
+
+    return address;
+}
+
+/**
+  * Finds the index entry of a given key.
+  *
+  * @param key the null terminated key to look for.
+  *
+  * @param h the hash of the given key.
+  *
+  * @return the position of the entry in the index, or -1 if the key is not stored.
+  */
+int KeyValueStorage::lookup(const char *key, uint16_t h)
+{
+    uint8_t storedKey[KEY_VALUE_STORAGE_KEY_SIZE];
+
+    for(int i = 0; i < indexSize; i++)
+    {
+        if(index[i].hash != h)
+            continue;
+
+        controller.read((uint32_t *)storedKey, index[i].address + sizeof(uint32_t), KEY_VALUE_STORAGE_KEY_SIZE/4);
+
+        if(strncmp((char *)storedKey, key, KEY_VALUE_STORAGE_KEY_SIZE) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+  * Computes the 16 bit hash used by the RAM index for a given key.
+  *
+  * @param key the null terminated key to hash.
+  */
+uint16_t KeyValueStorage::hash(const char *key)
+{
+    // FNV-1a, folded to 16 bits.
+    uint32_t h = 2166136261u;
+
+    for(int i = 0; i < KEY_VALUE_STORAGE_KEY_SIZE && key[i]; i++)
+        h = (h ^ (uint8_t)key[i]) * 16777619u;
+
+    return (uint16_t)(h ^ (h >> 16));
 }
 
 /**
@@ -375,15 +479,14 @@ void KeyValueStorage::scratchKeyValueStore(KeyValueStore store)
 }
 
 /**
-  * Function for populating the scratch page with a KeyValuePair.
+  * Function for populating the scratch page with a KeyValueRecord.
   *
-  * @param pair the KeyValuePair struct to write to the scratch page.
+  * @param record the KeyValueRecord struct to write to the scratch page.
   *
-  * @param flashPointer the pointer in flash where this KeyValuePair resides. This pointer
-  * is used to determine the offset into the scratch page, where the KeyValuePair should
-  * be written.
+  * @param scratchOffset the word offset into the scratch page where the KeyValueRecord
+  * should be written.
   */
-void KeyValueStorage::scratchKeyValuePair(KeyValuePair pair, int scratchOffset)
+void KeyValueStorage::scratchKeyValueRecord(KeyValueRecord *record, int scratchOffset)
 {
-    memcpy(this->scratch + scratchOffset, &pair, sizeof(KeyValuePair));
+    memcpy(this->scratch + scratchOffset, record, sizeof(KeyValueRecord));
 }
@@ -35,6 +35,7 @@ DEALINGS IN THE SOFTWARE.
 #include "Event.h"
 #include "CodalCompat.h"
 #include "CodalFiber.h"
+#include "Timer.h"
 
 using namespace codal;
 
@@ -81,6 +82,9 @@ LSM303Accelerometer::LSM303Accelerometer(I2C& _i2c, Pin &_int1, CoordinateSpace
     // Store our identifiers.
     this->status = 0;
     this->address = address;
+    this->batchSize = LSM303_A_DEFAULT_BATCH_SIZE;
+    this->batchSink = NULL;
+    this->batchDue = 0;
 
     // Configure and enable the accelerometer.
     configure();
@@ -115,8 +119,8 @@ int LSM303Accelerometer::configure()
         return DEVICE_I2C_ERROR;
     }
 
-    // Enable the DRDY1 interrupt on INT1 pin.
-    result = i2c.writeRegister(address, LSM303_CTRL_REG3_A, 0x10);
+    // Enable the DRDY1 interrupt on INT1 pin, or the FIFO watermark interrupt when batching.
+    result = i2c.writeRegister(address, LSM303_CTRL_REG3_A, status & LSM303_A_STATUS_BATCHING ? 0x04 : 0x10);
     if (result != 0)
     {
         DMESG("LSM303 INIT: ERROR WRITING LSM303_CTRL_REG3_A");
@@ -131,15 +135,227 @@ int LSM303Accelerometer::configure()
         return DEVICE_I2C_ERROR;
     }
 
+    // Enable the FIFO when batching.
+    result = i2c.writeRegister(address, LSM303_CTRL_REG5_A, status & LSM303_A_STATUS_BATCHING ? 0x40 : 0x00);
+    if (result != 0)
+    {
+        DMESG("LSM303 INIT: ERROR WRITING LSM303_CTRL_REG5_A");
+        return DEVICE_I2C_ERROR;
+    }
+
+    // Empty the FIFO by passing through bypass mode, then let it stream with a watermark of one sample less than a batch.
+    result = i2c.writeRegister(address, LSM303_FIFO_CTRL_REG_A, 0x00);
+    if (result == 0 && (status & LSM303_A_STATUS_BATCHING))
+        result = i2c.writeRegister(address, LSM303_FIFO_CTRL_REG_A, 0x80 | (batchSize - 1));
+
+    if (result != 0)
+    {
+        DMESG("LSM303 INIT: ERROR WRITING LSM303_FIFO_CTRL_REG_A");
+        return DEVICE_I2C_ERROR;
+    }
+
+    return DEVICE_OK;
+}
+
+/**
+ * Sets the number of samples collected in the FIFO before they are read in a single burst,
+ * while a batch sink is set.
+ *
+ * @param samples The number of samples per batch, in the range 1..32.
+ *
+ * @return DEVICE_OK on success, DEVICE_INVALID_PARAMETER if the FIFO cannot hold that many samples,
+ * DEVICE_I2C_ERROR if the accelerometer could not be configured.
+ */
+int LSM303Accelerometer::setBatchSize(int samples)
+{
+    if (samples < 1 || samples > LSM303_A_FIFO_SIZE)
+        return DEVICE_INVALID_PARAMETER;
+
+    batchSize = samples;
+
+    if (status & LSM303_A_STATUS_BATCHING)
+        return configure();
+
+    return DEVICE_OK;
+}
+
+/**
+ * Starts or stops batched acquisition. While batching, the hardware FIFO collects samples, which are read
+ * in a single burst once the batch size is reached, converted to milli-g and delivered to the given sink.
+ * No events are raised for batched samples. Otherwise, sample by sample updates resume.
+ *
+ * @param sink The component to deliver batches to, or NULL to stop batching.
+ *
+ * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the accelerometer could not be configured.
+ */
+int LSM303Accelerometer::setBatchSink(DataSink *sink)
+{
+    batchSink = sink;
+
+    if (sink == NULL)
+    {
+        output = ManagedBuffer();
+        status &= ~LSM303_A_STATUS_BATCHING;
+
+        return configure();
+    }
+
+    status |= LSM303_A_STATUS_BATCHING;
+
+    // Perform on demand activation, unless we were put to sleep.
+    if ((status & LSM303_A_STATUS_SLEEPING) == 0)
+        status |= LSM303_A_STATUS_ENABLED | DEVICE_COMPONENT_STATUS_IDLE_TICK;
+
+    return configure();
+}
+
+/**
+ * Reads the latest batch of samples, if available.
+ *
+ * @return The batch, or an empty buffer if none is ready.
+ */
+ManagedBuffer LSM303Accelerometer::pullBatch()
+{
+    ManagedBuffer b = output;
+    output = ManagedBuffer();
+
+    return b;
+}
+
+/**
+ * Converts the output registers read into a sample, and indicates that it is available.
+ *
+ * @return false if the registers did not hold new data.
+ */
+bool LSM303Accelerometer::processSample()
+{
+    uint8_t *out = data;
+    int16_t *x;
+    int16_t *y;
+    int16_t *z;
+
+#if CONFIG_ENABLED(DEVICE_I2C_IRQ_SHARED)
+    // Determine if this device had all its data ready (we may be on a shared IRQ line)
+    if((data[0] & LSM303_A_STATUS_DATA_READY) != LSM303_A_STATUS_DATA_READY)
+        return false;
+
+    out++;
+#endif
+
+    // Read in each reading as a 16 bit little endian value, and scale to 10 bits.
+    x = ((int16_t *) &out[0]);
+    y = ((int16_t *) &out[2]);
+    z = ((int16_t *) &out[4]);
+
+    *x = *x / 32;
+    *y = *y / 32;
+    *z = *z / 32;
+
+    // Scale into millig (approx) and align to ENU coordinate system
+    sampleENU.x = -((int)(*y)) * sampleRange;
+    sampleENU.y = -((int)(*x)) * sampleRange;
+    sampleENU.z =  ((int)(*z)) * sampleRange;
+
+    // indicate that new data is available.
+    update();
+
+    return true;
+}
+
+/**
+ * Reads all the samples in the FIFO in a single burst, if it has reached the watermark.
+ * Called once FIFO_SRC_REG_A has been read into data[0].
+ *
+ * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the read could not be started.
+ */
+int LSM303Accelerometer::readBatch()
+{
+    int count = data[0] & LSM303_A_FIFO_OVRN ? LSM303_A_FIFO_SIZE : data[0] & LSM303_A_FIFO_FSS;
+
+    if ((status & LSM303_A_STATUS_BATCHING) == 0)
+        return DEVICE_OK;
+
+    // The interrupt may have been raised by another sensor. Work out when the watermark will be reached.
+    if ((data[0] & LSM303_A_FIFO_WTM) == 0 || count == 0)
+    {
+        batchDue = system_timer_current_time() + samplePeriod * max(batchSize - count - 1, 0);
+        return DEVICE_OK;
+    }
+
+    batchDue = system_timer_current_time() + samplePeriod * (batchSize - 1);
+
+    // With the FIFO enabled, the register address rolls over from OUT_Z_H_A back to OUT_X_L_A,
+    // so consecutive samples are read by a single transaction.
+    batch = ManagedBuffer(count * 6);
+    outputRegister = LSM303_OUT_X_L_A | 0x80;
+
+    transaction.address = address;
+    transaction.txBuffer = &outputRegister;
+    transaction.txSize = 1;
+    transaction.rxBuffer = batch.getBytes();
+    transaction.rxSize = batch.length();
+    transaction.doneHandler = transactionComplete;
+
+    if (i2c.startTransaction(transaction) != DEVICE_OK)
+        return DEVICE_I2C_ERROR;
+
+    status |= LSM303_A_STATUS_READING_BATCH;
+
     return DEVICE_OK;
 }
 
+/**
+ * Converts the samples of a batch read from the FIFO in place, and delivers it to the sink.
+ */
+void LSM303Accelerometer::processBatch()
+{
+    int16_t *s = (int16_t *) batch.getBytes();
+    int count = batch.length() / 6;
+
+    for (int i = 0; i < count; i++)
+    {
+        // As processSample(), but without gesture tracking and events.
+        sampleENU.x = -((int)(s[1] / 32)) * sampleRange;
+        sampleENU.y = -((int)(s[0] / 32)) * sampleRange;
+        sampleENU.z =  ((int)(s[2] / 32)) * sampleRange;
+
+        sample = coordinateSpace.transform(sampleENU);
+
+        *s++ = sample.x;
+        *s++ = sample.y;
+        *s++ = sample.z;
+    }
+
+    // The latest sample remains available through getSample(), but pitch and roll are now stale.
+    status &= ~ACCELEROMETER_IMU_DATA_VALID;
+
+    if (batchSink)
+    {
+        output = batch;
+        batchSink->pullRequest();
+    }
+
+    batch = ManagedBuffer();
+}
+
+/**
+ * The doneHandler of our transactions. Their completion is collected by polling their status,
+ * so there is nothing to do here, but having a handler keeps the bus from raising an event per read.
+ */
+void LSM303Accelerometer::transactionComplete(void *)
+{
+}
+
 /**
  * Poll to see if new data is available from the hardware. If so, update it.
  * n.b. it is not necessary to explicitly call this funciton to update data
  * (it normally happens in the background when the scheduler is idle), but a check is performed
  * if the user explicitly requests up to date data.
  *
+ * Samples are read with an I2C transaction that completes in the background, and are
+ * collected on the next call. Only the first sample after activation is waited for.
+ * While batching, the FIFO is read instead, once it has reached the watermark.
+ *
  * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the update fails.
  *
  * @note This method should be overidden by the hardware driver to implement the requested
@@ -161,52 +377,89 @@ int LSM303Accelerometer::requestUpdate()
         awaitSample = true;
     }    
 
-    // Poll interrupt line from device
-    do
+    // Collect the result of the read started by an earlier call, once it has completed.
+    uint16_t reading = status & (LSM303_A_STATUS_READING | LSM303_A_STATUS_READING_FIFO | LSM303_A_STATUS_READING_BATCH);
+
+    if (reading)
     {
-        if(int1.isActive())
+        if (transaction.status == I2C_TRANSACTION_PENDING)
+            return DEVICE_OK;
+
+        status &= ~reading;
+
+        if (transaction.status != DEVICE_OK)
+            return DEVICE_I2C_ERROR;
+
+        if (reading & LSM303_A_STATUS_READING)
+            processSample();
+
+        if (reading & LSM303_A_STATUS_READING_BATCH)
+            processBatch();
+
+        // The FIFO status was read: follow up with the samples themselves.
+        if (reading & LSM303_A_STATUS_READING_FIFO)
+            return readBatch();
+    }
+
+    // When batching, check the FIFO level when the interrupt line is active. As the line may be shared with
+    // other sensors, don't check again before the watermark can have been reached.
+    if (status & LSM303_A_STATUS_BATCHING)
+    {
+        if (int1.isActive() && system_timer_current_time() >= batchDue)
         {
-            uint8_t data[6];
-            int result;
-            int16_t *x;
-            int16_t *y;
-            int16_t *z;
-
-    #if CONFIG_ENABLED(DEVICE_I2C_IRQ_SHARED)
-            // Determine if this device has all its data ready (we may be on a shared IRQ line)
-            uint8_t status_reg = i2c.readRegister(address, LSM303_STATUS_REG_A);
-            if((status_reg & LSM303_A_STATUS_DATA_READY) != LSM303_A_STATUS_DATA_READY)
-            {
-                if (awaitSample)
-                    continue;
-                else
-                    return DEVICE_OK;
-            }
-    #endif
+            outputRegister = LSM303_FIFO_SRC_REG_A;
 
-            // Read the combined accelerometer and magnetometer data.
-            result = i2c.readRegister(address, LSM303_OUT_X_L_A | 0x80, data, 6);
-            awaitSample = false;
+            transaction.address = address;
+            transaction.txBuffer = &outputRegister;
+            transaction.txSize = 1;
+            transaction.rxBuffer = data;
+            transaction.rxSize = 1;
+            transaction.doneHandler = transactionComplete;
 
-            if (result !=0)
+            if (i2c.startTransaction(transaction) != DEVICE_OK)
                 return DEVICE_I2C_ERROR;
 
-            // Read in each reading as a 16 bit little endian value, and scale to 10 bits.
-            x = ((int16_t *) &data[0]);
-            y = ((int16_t *) &data[2]);
-            z = ((int16_t *) &data[4]);
+            status |= LSM303_A_STATUS_READING_FIFO;
+        }
 
-            *x = *x / 32;
-            *y = *y / 32;
-            *z = *z / 32;
+        return DEVICE_OK;
+    }
 
-            // Scale into millig (approx) and align to ENU coordinate system
-            sampleENU.x = -((int)(*y)) * sampleRange;
-            sampleENU.y = -((int)(*x)) * sampleRange;
-            sampleENU.z =  ((int)(*z)) * sampleRange;
+    // Read the combined accelerometer data (and, on a shared IRQ line, the status register before it).
+#if CONFIG_ENABLED(DEVICE_I2C_IRQ_SHARED)
+    outputRegister = LSM303_STATUS_REG_A | 0x80;
+    int length = 7;
+#else
+    outputRegister = LSM303_OUT_X_L_A | 0x80;
+    int length = 6;
+#endif
 
-            // indicate that new data is available.
-            update();
+    // Poll interrupt line from device
+    do
+    {
+        if(int1.isActive())
+        {
+            if (awaitSample)
+            {
+                if (i2c.readRegister(address, outputRegister, data, length) != DEVICE_OK)
+                    return DEVICE_I2C_ERROR;
+
+                awaitSample = !processSample();
+            }
+            else
+            {
+                transaction.address = address;
+                transaction.txBuffer = &outputRegister;
+                transaction.txSize = 1;
+                transaction.rxBuffer = data;
+                transaction.rxSize = length;
+                transaction.doneHandler = transactionComplete;
+
+                if (i2c.startTransaction(transaction) != DEVICE_OK)
+                    return DEVICE_I2C_ERROR;
+
+                status |= LSM303_A_STATUS_READING;
+            }
         }
     } while (awaitSample);
 
@@ -66,9 +66,10 @@ static uint16_t userNotifyId = DEVICE_NOTIFY_USER_EVENT_BASE;
 MessageBus::MessageBus()
 {
     this->listeners = NULL;
-    this->evt_queue_head = NULL;
-    this->evt_queue_tail = NULL;
+    this->queueHead = 0;
     this->queueLength = 0;
+    this->queuePeak = 0;
+    this->queueDropped = 0;
 
     // ANY listeners for scheduler events MUST be immediate, or else they will not be registered.
     listen(DEVICE_ID_SCHEDULER, DEVICE_SCHEDULER_EVT_IDLE, this, &MessageBus::idle, MESSAGE_BUS_LISTENER_IMMEDIATE);
@@ -157,7 +158,8 @@ void MessageBus::queueEvent(Event &evt)
 {
     int processingComplete;
 
-    EventQueueItem *prev = evt_queue_tail;
+    // Remember where the tail of the queue was when we entered.
+    int position = queueLength;
 
     // Now process all handler regsitered as URGENT.
     // These pre-empt the queue, and are useful for fast, high priority services.
@@ -168,64 +170,76 @@ void MessageBus::queueEvent(Event &evt)
     if (processingComplete)
         return;
 
+    target_disable_irq();
+
     // If we need to queue, but there is no space, then there's nothg we can do.
     if (queueLength >= MESSAGE_BUS_LISTENER_MAX_QUEUE_DEPTH)
+    {
+        queueDropped++;
+        target_enable_irq();
         return;
+    }
 
     // Otherwise, we need to queue this event for later processing...
     // We queue this event at the tail of the queue at the point where we entered queueEvent()
     // This is important as the processing above *may* have generated further events, and
-    // we want to maintain ordering of events.
-    EventQueueItem *item = new EventQueueItem(evt);
-
-    // The queue was empty when we entered this function, so queue our event at the start of the queue.
-    target_disable_irq();
+    // we want to maintain ordering of events. Those events are moved up to make room for ours.
+    if (position > queueLength)
+        position = queueLength;
 
-    if (prev == NULL)
-    {
-        item->next = evt_queue_head;
-        evt_queue_head = item;
-    }
-    else
-    {
-        item->next = prev->next;
-        prev->next = item;
-    }
+    for (int i = queueLength; i > position; i--)
+        evt_queue[(queueHead + i) % MESSAGE_BUS_LISTENER_MAX_QUEUE_DEPTH] = evt_queue[(queueHead + i - 1) % MESSAGE_BUS_LISTENER_MAX_QUEUE_DEPTH];
 
-    if (item->next == NULL)
-        evt_queue_tail = item;
+    evt_queue[(queueHead + position) % MESSAGE_BUS_LISTENER_MAX_QUEUE_DEPTH] = evt;
 
     queueLength++;
 
+    if (queueLength > queuePeak)
+        queuePeak = queueLength;
+
     target_enable_irq();
 }
 
 /**
   * Extract the next event from the front of the event queue (if present).
   *
-  * @return a pointer to the EventQueueItem that is at the head of the list.
+  * @param evt Set to the event at the front of the queue.
+  *
+  * @return true if an event was extracted, false if the queue is empty.
   */
-EventQueueItem* MessageBus::dequeueEvent()
+bool MessageBus::dequeueEvent(Event &evt)
 {
-    EventQueueItem *item = NULL;
+    bool found = false;
 
     target_disable_irq();
 
-    if (evt_queue_head != NULL)
+    if (queueLength > 0)
     {
-        item = evt_queue_head;
-        evt_queue_head = item->next;
-
-        if (evt_queue_head == NULL)
-            evt_queue_tail = NULL;
-
+        evt = evt_queue[queueHead];
+        queueHead = (queueHead + 1) % MESSAGE_BUS_LISTENER_MAX_QUEUE_DEPTH;
         queueLength--;
+        found = true;
     }
 
     target_enable_irq();
 
+    return found;
+}
+
+/**
+  * Determines how well the event queue is coping with the events sent.
+  *
+  * @param dropped Set to the number of events dropped because the queue was full.
+  *
+  * @param peak Set to the largest number of events that were waiting to be processed at once.
+  */
+void MessageBus::getQueueStatistics(uint32_t *dropped, uint16_t *peak)
+{
+    if (dropped)
+        *dropped = queueDropped;
 
-    return item;
+    if (peak)
+        *peak = queuePeak;
 }
 
 /**
@@ -279,25 +293,19 @@ void MessageBus::idle(Event)
     // Clear out any listeners marked for deletion
     this->deleteMarkedListeners();
 
-    EventQueueItem *item = this->dequeueEvent();
+    Event evt;
 
     // Whilst there are events to process and we have no useful other work to do, pull them off the queue and process them.
-    while (item)
+    while (this->dequeueEvent(evt))
     {
         // send the event to all standard event listeners.
-        this->process(item->evt);
-
-        // Free the queue item.
-        delete item;
+        this->process(evt);
 
         // If we have created some useful work to do, we stop processing.
         // This helps to minimise the number of blocked fibers we create at any point in time, therefore
         // also reducing the RAM footprint.
         if(!scheduler_runqueue_empty())
             break;
-
-        // Pull the next event to process, if there is one.
-        item = this->dequeueEvent();
     }
 }
 
@@ -0,0 +1,82 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 Lancaster University.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "AccelerometerStream.h"
+
+using namespace codal;
+
+/**
+ * Constructor.
+ *
+ * @param accelerometer The accelerometer to stream from. It must support batched acquisition.
+ */
+AccelerometerStream::AccelerometerStream(Accelerometer &accelerometer) : accelerometer(accelerometer)
+{
+    this->downstream = NULL;
+}
+
+/**
+ * Allow our downstream component to register itself with us, and start batched acquisition.
+ */
+void AccelerometerStream::connect(DataSink &sink)
+{
+    this->downstream = &sink;
+    accelerometer.setBatchSink(&sink);
+}
+
+/**
+ * Stop batched acquisition, and resume sample by sample updates.
+ */
+void AccelerometerStream::disconnect()
+{
+    if (downstream)
+    {
+        downstream = NULL;
+        accelerometer.setBatchSink(NULL);
+    }
+}
+
+/**
+ * Provide the latest batch of samples to our downstream caller, if available.
+ */
+ManagedBuffer AccelerometerStream::pull()
+{
+    return accelerometer.pullBatch();
+}
+
+/**
+ * Determine the data format of the buffers streamed out of this component.
+ */
+int AccelerometerStream::getFormat()
+{
+    return DATASTREAM_FORMAT_16BIT_SIGNED;
+}
+
+/**
+ * Destructor. Stops batched acquisition.
+ */
+AccelerometerStream::~AccelerometerStream()
+{
+    disconnect();
+}
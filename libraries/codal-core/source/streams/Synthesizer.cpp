@@ -70,7 +70,7 @@ uint16_t Synthesizer::TriangleTone(void *arg, int position) {
 
 uint16_t Synthesizer::NoiseTone(void *arg, int position) {
     // deterministic, semi-random noise
-    uint32_t mult = (uint32_t)arg;
+    uint32_t mult = (uint32_t)(uintptr_t)arg;
     if (mult == 0)
         mult = 7919;
     return (position * mult) & 1023;
@@ -81,7 +81,7 @@ uint16_t Synthesizer::SquareWaveTone(void *arg, int position) {
 }
 
 uint16_t Synthesizer::SquareWaveToneExt(void *arg, int position) {
-    uint32_t duty = (uint32_t)arg;
+    uint32_t duty = (uint32_t)(uintptr_t)arg;
     return (uint32_t)position <= duty ? 1023 : 0;
 }
 
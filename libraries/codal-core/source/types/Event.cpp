@@ -31,6 +31,7 @@ DEALINGS IN THE SOFTWARE.
 #include "Event.h"
 #include "Timer.h"
 #include "EventModel.h"
+#include "codal_target_hal.h"
 
 using namespace codal;
 
@@ -138,3 +139,57 @@ EventQueueItem::EventQueueItem(Event evt)
     this->evt = evt;
     this->next = NULL;
 }
+
+static EventQueueItem *eventPool = NULL;                                        // Unused items in the pool.
+static uint64_t eventPoolMemory[MESSAGE_BUS_EVENT_POOL_SIZE][(sizeof(EventQueueItem) + 7) / 8];
+static bool eventPoolInitialised = false;
+
+/**
+  * Allocates an EventQueueItem from a static pool, so that queueing events does not fragment the heap.
+  * Falls back to the heap if the pool is exhausted.
+  */
+void *EventQueueItem::operator new(size_t size)
+{
+    EventQueueItem *item;
+
+    target_disable_irq();
+
+    if (!eventPoolInitialised)
+    {
+        for (int i = 0; i < MESSAGE_BUS_EVENT_POOL_SIZE; i++)
+        {
+            item = (EventQueueItem *) eventPoolMemory[i];
+            item->next = eventPool;
+            eventPool = item;
+        }
+
+        eventPoolInitialised = true;
+    }
+
+    item = eventPool;
+    if (item)
+        eventPool = item->next;
+
+    target_enable_irq();
+
+    return item ? item : ::operator new(size);
+}
+
+/**
+  * Returns an EventQueueItem to the pool it was allocated from.
+  */
+void EventQueueItem::operator delete(void *p)
+{
+    if (p < (void *) eventPoolMemory || p >= (void *) &eventPoolMemory[MESSAGE_BUS_EVENT_POOL_SIZE])
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    EventQueueItem *item = (EventQueueItem *) p;
+
+    target_disable_irq();
+    item->next = eventPool;
+    eventPool = item;
+    target_enable_irq();
+}
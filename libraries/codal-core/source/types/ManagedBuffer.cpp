@@ -25,6 +25,7 @@ DEALINGS IN THE SOFTWARE.
 #include "ManagedBuffer.h"
 #include <limits.h>
 #include "CodalCompat.h"
+#include "CodalSlabAllocator.h"
 
 #define REF_TAG REF_TAG_BUFFER
 #define EMPTY_DATA ((BufferData*)(void*)emptyData)
@@ -137,7 +138,7 @@ void ManagedBuffer::init(uint8_t *data, int length)
         return;
     }
 
-    ptr = (BufferData *) malloc(sizeof(BufferData) + length);
+    ptr = (BufferData *) device_slab_alloc(sizeof(BufferData) + length);
     REF_COUNTED_INIT(ptr);
 
     ptr->length = length;
@@ -25,6 +25,7 @@ DEALINGS IN THE SOFTWARE.
 #include "CodalConfig.h"
 #include "CodalDevice.h"
 #include "RefCounted.h"
+#include "CodalSlabAllocator.h"
 
 using namespace codal;
 // These two are placed in a separate file, so that they can be overriden by user code.
@@ -34,7 +35,7 @@ using namespace codal;
   */
 void RefCounted::destroy()
 {
-    free(this);
+    device_slab_free(this);
 }
 
 /**
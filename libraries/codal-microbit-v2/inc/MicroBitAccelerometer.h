@@ -133,6 +133,33 @@ class MicroBitAccelerometer : public Accelerometer
          */
         int requestUpdate();
 
+        /**
+         * Attempts to set the number of samples the accelerometer collects before delivering them to
+         * its batch sink.
+         *
+         * @param samples The requested number of samples per batch.
+         *
+         * @return MICROBIT_OK on success, MICROBIT_INVALID_PARAMETER if the hardware cannot hold that many samples,
+         * or MICROBIT_NOT_SUPPORTED if batched acquisition is not supported.
+         */
+        int setBatchSize(int samples);
+
+        /**
+         * Starts batched acquisition, delivering samples to the given sink, or stops it if the sink is NULL.
+         *
+         * @param sink The component to deliver batches to, or NULL to resume sample by sample updates.
+         *
+         * @return MICROBIT_OK on success, or MICROBIT_NOT_SUPPORTED if batched acquisition is not supported.
+         */
+        int setBatchSink(DataSink *sink);
+
+        /**
+         * Reads the latest batch of samples, if available.
+         *
+         * @return The batch, or an empty buffer if none is ready.
+         */
+        ManagedBuffer pullBatch();
+
         /**
          * Reads the last accelerometer value stored, and provides it in the coordinate system requested.
          *
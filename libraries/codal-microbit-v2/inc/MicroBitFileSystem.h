@@ -29,6 +29,7 @@ DEALINGS IN THE SOFTWARE.
 // Configuration options.
 #define MBFS_FILENAME_LENGTH        16        
 #define MBFS_MAGIC                  "MICROBIT_FS_1_0"
+#define MBFS_INDEX_MINIMUM_SIZE     16
 
 // open() flags.
 #define MB_READ     0x01
@@ -83,6 +84,17 @@ struct Directory
     DirectoryEntry entry[0];
 };
 
+//
+// The RAM resident index of all directory entries is a hash table of these.
+// Entries are keyed on the file name, and the first block of the directory holding it.
+//
+struct DirectoryIndexEntry
+{
+    DirectoryEntry *dirent;                     // The indexed entry, or NULL if the slot is free.
+    uint16_t directory;                         // First block of the directory holding the entry.
+    uint16_t hash;                              // Hash of the key, to avoid comparing names held in FLASH.
+};
+
 //
 // A FileDescriptor holds contextual information needed for each OPEN file.
 //
@@ -100,6 +112,11 @@ struct FileDescriptor
     // the current file size. n.b. this may be different to that stored in the DirectoryEntry.
     uint32_t length;
 
+    // A cursor into the block chain: a block of this file, and the file position at which it starts.
+    // Sequential reads and writes continue from here, rather than from the first block of the file.
+    uint16_t block;
+    uint32_t blockPosition;
+
     // the directory entry of this file. 
     DirectoryEntry *dirent;
 
@@ -155,6 +172,14 @@ class MicroBitFileSystem
     // Chain of open files.
     FileDescriptor *openFiles;
 
+    // Hash table of all valid directory entries, so files can be found without scanning directories.
+    // If this could not be allocated, directories are scanned instead.
+    DirectoryIndexEntry *index;
+
+    // Number of slots in the index (a power of two), and the number of those in use.
+    uint16_t indexSize;
+    uint16_t indexCount;
+
     /**
       * Initialize the flash storage system
       *
@@ -207,6 +232,52 @@ class MicroBitFileSystem
     */
     DirectoryEntry* getDirectoryEntry(char const * filename, const DirectoryEntry *directory = NULL);
     
+    /**
+    * Rebuilds the index of directory entries from the contents of the file system.
+    *
+    * @param size The number of slots to allocate, or zero to size the index to the number of entries found.
+    * @return MICROBIT_OK on success, or MICROBIT_NO_RESOURCES if the index could not be allocated.
+    */
+    int buildIndex(int size = 0);
+
+    /**
+    * Adds the valid entries of the given directory, and those of any directories within it, to the index.
+    *
+    * @param directory The directory to add.
+    * @return The number of entries found.
+    */
+    int indexDirectory(const DirectoryEntry *directory);
+
+    /**
+    * Adds a DirectoryEntry to the index, growing the index if it is getting full.
+    *
+    * @param dirent The entry to add.
+    * @param directory The first block of the directory holding the entry.
+    */
+    void indexInsert(DirectoryEntry *dirent, uint16_t directory);
+
+    /**
+    * Removes a DirectoryEntry from the index.
+    *
+    * @param dirent The entry to remove.
+    * @param directory The first block of the directory holding the entry.
+    */
+    void indexRemove(DirectoryEntry *dirent, uint16_t directory);
+
+    /**
+    * Computes the index hash of a file name within a given directory.
+    */
+    static uint16_t indexHash(char const *file, uint16_t directory);
+
+    /**
+    * Determine the block holding the current seek position of the given file, moving its block cursor there.
+    * Sequential access only walks the blocks between the previous and the current position.
+    *
+    * @param file An open file.
+    * @return The block number holding the seek position.
+    */
+    uint16_t getSeekBlock(FileDescriptor *file);
+
     /**
     * Create a new DirectoryEntry with the given filename and flags.
     *
@@ -72,6 +72,10 @@ namespace codal
 #define MICROBIT_RADIO_MAX_PACKET_SIZE          32
 #define MICROBIT_RADIO_HEADER_SIZE              4
 #define MICROBIT_RADIO_MAXIMUM_RX_BUFFERS       4
+// Every receive buffer that can be in use at once: the DMA buffer (1), the receive ring (MAXIMUM_RX_BUFFERS), the
+// datagram queue (MAXIMUM_RX_BUFFERS + 1, as MicroBitRadioDatagram::packetReceived() only refuses a frame once that
+// many are queued) and one frame taken with recv() being handled (1).
+#define MICROBIT_RADIO_RX_POOL_SIZE             (1 + MICROBIT_RADIO_MAXIMUM_RX_BUFFERS + (MICROBIT_RADIO_MAXIMUM_RX_BUFFERS + 1) + 1)
 #define MICROBIT_RADIO_POWER_LEVELS             10
 
 // Known Protocol Numbers
@@ -100,9 +104,13 @@ namespace codal
     {
         uint8_t                 group;      // The radio group to which this micro:bit belongs.
         uint8_t                 queueDepth; // The number of packets in the receiver queue.
+        uint8_t                 rxHead;     // The index of the oldest packet in the receiver queue.
+        uint16_t                rxCount;    // The number of packets taken from the receiver queue, used to detect consumption by protocol handlers.
         int                     rssi;
-        FrameBuffer             *rxQueue;   // A linear list of incoming packets, queued awaiting processing.
+        FrameBuffer             *rxQueue[MICROBIT_RADIO_MAXIMUM_RX_BUFFERS];  // A ring of incoming packets, queued awaiting processing.
         FrameBuffer             *rxBuf;     // A pointer to the buffer being actively used by the RADIO hardware.
+        FrameBuffer             *rxPool;    // The receive buffers, allocated once when the radio is first enabled.
+        FrameBuffer             *rxFree;    // A list of the receive buffers not currently in use.
 
         public:
         MicroBitRadioDatagram   datagram;   // A simple datagram service.
@@ -218,10 +226,17 @@ namespace codal
          * @return The buffer containing the the packet. If no data is available, NULL is returned.
          *
          * @note Once recv() has been called, it is the callers responsibility to
-         *       delete the buffer when appropriate.
+         *       return the buffer with release() when appropriate. The buffer must not be deleted.
          */
         FrameBuffer* recv();
 
+        /**
+         * Returns a buffer obtained through recv() to the pool of receive buffers.
+         *
+         * @param buffer The buffer to return. NULL is ignored.
+         */
+        void release(FrameBuffer *buffer);
+
         /**
          * Transmits the given buffer onto the broadcast radio.
          * The call will wait until the transmission of the packet has completed before returning.
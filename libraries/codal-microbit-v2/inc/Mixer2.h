@@ -39,6 +39,10 @@ DEALINGS IN THE SOFTWARE.
 #define CONFIG_MIXER_DEFAULT_SAMPLERATE 44100
 #endif
 
+// Number of fractional bits in the fixed point gains, sample positions and mix accumulator.
+#define MIXER_FIXED_POINT_BITS          16
+#define MIXER_FIXED_POINT_ONE           (1 << MIXER_FIXED_POINT_BITS)
+
 
 namespace codal
 {
@@ -56,11 +60,12 @@ private:
     float           range;                      // The number of quantization levels in the input data.
     float           rate;                       // The sample rate of the input data.
     float           offset;                     // Offset applied to every sample before mixing (for unsigned samples)
-    float           gain;                       // Input gain to applied ot each sample to normalise (optimisation)
-    float           skip;                       // Number of input samples to progress for each output sample (when sub/super sampling)
-    float           position;                   // fractional position within the buffer of next sample (sub/super sampling) 
+    int32_t         gain;                       // Gain applied to each sample to normalise it and apply the volume (fixed point)
+    int32_t         bias;                       // The offset, after gain (fixed point)
+    uint32_t        skip;                       // Number of input samples to progress for each output sample (fixed point)
+    uint32_t        position;                   // Position within the buffer of the next sample, in samples (fixed point)
 
-    float           volume;                     // Volume leve of channel, in the range 0..CONFIG_MIXER_INTERNAL_RANGE
+    float           volume;                     // Volume leve of channel, in the range 0..1
     int             format;                     // Format of the data recieved on this channel (e.g. DATASTREAM_FORMAT_16BIT_UNSIGNED...)
     int             bytesPerSample;             // The number of bytes used in the input stream for each sample (optimisation)
 
@@ -81,7 +86,7 @@ class Mixer2 : public DataSource
 {
     MixerChannel    *channels;
     DataSink        *downStream;
-    float           mix[CONFIG_MIXER_BUFFER_SIZE];
+    int32_t         mix[CONFIG_MIXER_BUFFER_SIZE];  // Accumulator, in units of the internal range (fixed point)
     float           outputRange;
     float           outputRate;
     int             outputFormat;
@@ -194,6 +199,12 @@ public:
 
     private:
     void configureChannel(MixerChannel *c);
+
+    /**
+     * Mixes samples from the buffer of a channel into the accumulator, as far as the output and the buffer allow.
+     * @return the number of output samples produced.
+     */
+    int mixChannel(MixerChannel *c, int32_t *out, int len);
 };
 
 } // namespace codal
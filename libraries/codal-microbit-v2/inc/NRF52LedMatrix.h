@@ -32,6 +32,7 @@ DEALINGS IN THE SOFTWARE.
 #define NRF52_LED_MATRIX_CLOCK_FREQUENCY        16000000            // Frequency of underlying hardware clock (must b 1MHz, 2Mhz 4Mhz, 8Mhz or 16MHz)
 #define NRF52_LED_MATRIX_FREQUENCY              60                  // Frequency of the frame update for the display
 #define NRF52_LED_MATRIX_MAXIMUM_COLUMNS        5                   // The maximum number of LEDMatrix columns supported by the hardware.
+#define NRF52_LED_MATRIX_MAXIMUM_ROWS           5                   // The maximum number of LEDMatrix rows supported by the driver.
 #define NRF52_LED_MATRIX_LIGHTSENSE_STROBES     4                   // Multiple of strobe period to use for light sense
 
 
@@ -62,6 +63,17 @@ namespace codal
         int8_t              gpiote[NRF52_LED_MATRIX_MAXIMUM_COLUMNS];            // GPIOTE channels used by output columns.
         int8_t              ppi[NRF52_LED_MATRIX_MAXIMUM_COLUMNS];               // PPI channels used by output columns.
 
+        // Timer compare values and lit columns of each row, recomputed only when the image, brightness or mode change.
+        uint8_t             renderedImage[NRF52_LED_MATRIX_MAXIMUM_ROWS * NRF52_LED_MATRIX_MAXIMUM_COLUMNS];
+        uint32_t            rowCompare[NRF52_LED_MATRIX_MAXIMUM_ROWS][NRF52_LED_MATRIX_MAXIMUM_COLUMNS];
+        uint8_t             rowLit[NRF52_LED_MATRIX_MAXIMUM_ROWS];
+        bool                renderDirty;
+
+        /**
+         * Recompute the timer compare values of every row, if the image has changed since they were last computed.
+         */
+        void updateRowCompare();
+
      
         public:
         /**
@@ -30,6 +30,10 @@ DEALINGS IN THE SOFTWARE.
 #define EMOJI_SYNTHESIZER_SAMPLE_RATE         44100
 #define EMOJI_SYNTHESIZER_TONE_WIDTH          1024
 #define EMOJI_SYNTHESIZER_TONE_WIDTH_F        1024.0f
+#define EMOJI_SYNTHESIZER_TONE_WIDTH_BITS     10            // log2(EMOJI_SYNTHESIZER_TONE_WIDTH)
+
+// The position within a tone print is held in 32 bits, so it wraps around by itself at the end of the tone print.
+#define EMOJI_SYNTHESIZER_POSITION_BITS       (32 - EMOJI_SYNTHESIZER_TONE_WIDTH_BITS)
 #define EMOJI_SYNTHESIZER_BUFFER_SIZE         512
 
 #define EMOJI_SYNTHESIZER_TONE_EFFECT_PARAMETERS        2
@@ -116,6 +120,10 @@ namespace codal
         ManagedBuffer           buffer;                 // Current playout buffer.
         ManagedBuffer           effectBuffer;           // Current sound effect sequence being generated.
         ManagedBuffer           emptyBuffer;            // Zero length buffer.
+        ManagedBuffer           wavetables;             // One period of each distinct tonePrint in the effectBuffer, rendered by play().
+        ManagedBuffer           wavetableTones;         // The tonePrint each of the wavetables was rendered from.
+        ManagedBuffer           wavetableIndex;         // The wavetable each effect in the effectBuffer plays (uint16_t each).
+        const uint16_t*         wavetable;              // The wavetable of the effect being generated.
         SoundEffect*            effect;                 // The effect within the current EffectBuffer that's being generated.
 
         int                     sampleRate;             // The sample rate of our output, measure in samples per second (e.g. 44000).
@@ -127,7 +135,7 @@ namespace codal
         float                   volume;                 // The instantaneous volume currently being generated within an effect.
         int                     samplesToWrite;         // The number of samples needed from the current sound effect block.
         int                     samplesWritten;         // The number of samples written from the current sound effect block.
-        float                   position;               // Position within the tonePrint.
+        uint32_t                position;               // Position within the tonePrint (fixed point).
         float                   samplesPerStep[EMOJI_SYNTHESIZER_TONE_EFFECTS];     // The number of samples to render per step for each effect.
         /**
           * Default Constructor.
@@ -241,6 +249,17 @@ namespace codal
          */
         int determineSampleCount(float playoutTime);
 
+        /**
+         * Renders one period of every distinct tonePrint in a sequence of sound effects into our wavetables,
+         * and records which one each effect plays. This takes the calls through the tonePrint function pointer
+         * out of the audio pipeline: pull() only reads the wavetables.
+         * The wavetables of the previous sequence are reused if it had the same built in tonePrints; custom
+         * tones are rendered again every time.
+         *
+         * @param sound A buffer containing an array of one or more SoundEffects.
+         */
+        void renderWavetables(ManagedBuffer sound);
+
     };
 }
 
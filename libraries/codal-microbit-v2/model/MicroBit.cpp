@@ -314,9 +314,11 @@ void MicroBit::onListenerRegisteredEvent(Event evt)
   */
 void MicroBit::idleCallback()
 {
-#if CONFIG_ENABLED(DMESG_SERIAL_DEBUG)
 #if DEVICE_DMESG_BUFFER_SIZE > 0
+#if CONFIG_ENABLED(DMESG_SERIAL_DEBUG)
     codal_dmesg_flush();
+#else
+    codal_dmesg_encode();
 #endif
 #endif
 }
@@ -325,12 +327,14 @@ void microbit_dmesg_flush()
 {
 #if CONFIG_ENABLED(DMESG_SERIAL_DEBUG)
 #if DEVICE_DMESG_BUFFER_SIZE > 0
-    if (codalLogStore.ptr > 0 && microbit_device_instance)
+    if (microbit_device_instance)
     {
-        for (uint32_t i=0; i<codalLogStore.ptr; i++)
-            ((MicroBit *)microbit_device_instance)->serial.putc(codalLogStore.buffer[i]);
+        char buffer[32];
+        int length;
 
-        codalLogStore.ptr = 0;
+        while ((length = codal_dmesg_read(buffer, sizeof(buffer))) > 0)
+            for (int i=0; i<length; i++)
+                ((MicroBit *)microbit_device_instance)->serial.putc(buffer[i]);
     }
 #endif
 #endif
@@ -193,6 +193,42 @@ int MicroBitAccelerometer::requestUpdate()
     return MicroBitAccelerometer::detectedAccelerometer ? detectedAccelerometer->requestUpdate() : Accelerometer::requestUpdate();
 }
 
+/**
+ * Attempts to set the number of samples the accelerometer collects before delivering them to
+ * its batch sink.
+ *
+ * @param samples The requested number of samples per batch.
+ *
+ * @return MICROBIT_OK on success, MICROBIT_INVALID_PARAMETER if the hardware cannot hold that many samples,
+ * or MICROBIT_NOT_SUPPORTED if batched acquisition is not supported.
+ */
+int MicroBitAccelerometer::setBatchSize(int samples)
+{
+    return MicroBitAccelerometer::detectedAccelerometer ? detectedAccelerometer->setBatchSize(samples) : Accelerometer::setBatchSize(samples);
+}
+
+/**
+ * Starts batched acquisition, delivering samples to the given sink, or stops it if the sink is NULL.
+ *
+ * @param sink The component to deliver batches to, or NULL to resume sample by sample updates.
+ *
+ * @return MICROBIT_OK on success, or MICROBIT_NOT_SUPPORTED if batched acquisition is not supported.
+ */
+int MicroBitAccelerometer::setBatchSink(DataSink *sink)
+{
+    return MicroBitAccelerometer::detectedAccelerometer ? detectedAccelerometer->setBatchSink(sink) : Accelerometer::setBatchSink(sink);
+}
+
+/**
+ * Reads the latest batch of samples, if available.
+ *
+ * @return The batch, or an empty buffer if none is ready.
+ */
+ManagedBuffer MicroBitAccelerometer::pullBatch()
+{
+    return MicroBitAccelerometer::detectedAccelerometer ? detectedAccelerometer->pullBatch() : Accelerometer::pullBatch();
+}
+
 /**
  * Reads the last accelerometer value stored, and provides it in the coordinate system requested.
  *
@@ -178,6 +178,9 @@ int MicroBitFileSystem::init(uint32_t flashStart, int flashPages)
     lastBlockAllocated = 0;
     rootDirectory = NULL;
     openFiles = NULL;
+    index = NULL;
+    indexSize = 0;
+    indexCount = 0;
 
     // If we have a zero length, then dynamically determine our geometry.
     if (flashStart == 0)
@@ -238,6 +241,8 @@ int MicroBitFileSystem::load()
     fileSystemSize = root->length;
     fileSystemTableSize = calculateFileTableSize();
 
+    buildIndex();
+
     return MICROBIT_OK;
 }
 
@@ -272,9 +277,191 @@ int MicroBitFileSystem::format()
     rootDirectory = (DirectoryEntry *)getBlock(fileSystemTableSize);
     flash.flash_write(rootDirectory, &magic, sizeof(DirectoryEntry));
 
+    buildIndex();
+
+    return MICROBIT_OK;
+}
+
+/**
+  * Computes the index hash of a file name within a given directory.
+  */
+uint16_t MicroBitFileSystem::indexHash(char const *file, uint16_t directory)
+{
+    // FNV-1a over the name, seeded with the directory.
+    uint32_t hash = 2166136261u ^ directory;
+
+    while (*file)
+    {
+        hash ^= (uint8_t) *file++;
+        hash *= 16777619u;
+    }
+
+    return (uint16_t)(hash ^ (hash >> 16));
+}
+
+/**
+  * Rebuilds the index of directory entries from the contents of the file system.
+  *
+  * @param size The number of slots to allocate, or zero to size the index to the number of entries found.
+  * @return MICROBIT_OK on success, or MICROBIT_NO_RESOURCES if the index could not be allocated.
+  */
+int MicroBitFileSystem::buildIndex(int size)
+{
+    free(index);
+    index = NULL;
+    indexSize = 0;
+    indexCount = 0;
+
+    // If no size is given, count the entries first, and leave room for as many again.
+    if (size == 0)
+        size = 2 * indexDirectory(rootDirectory);
+
+    int slots = MBFS_INDEX_MINIMUM_SIZE;
+    while (slots < size)
+        slots <<= 1;
+
+    index = (DirectoryIndexEntry *) calloc(slots, sizeof(DirectoryIndexEntry));
+    if (index == NULL)
+        return MICROBIT_NO_RESOURCES;
+
+    indexSize = slots;
+    indexDirectory(rootDirectory);
+
     return MICROBIT_OK;
 }
 
+/**
+  * Adds the valid entries of the given directory, and those of any directories within it, to the index.
+  *
+  * @param directory The directory to add.
+  * @return The number of entries found.
+  */
+int MicroBitFileSystem::indexDirectory(const DirectoryEntry *directory)
+{
+    uint16_t block = directory->first_block;
+    int entries = 0;
+
+    while (block != MBFS_EOF)
+    {
+        DirectoryEntry *dirent = (DirectoryEntry *) getBlock(block);
+
+        for (uint16_t entry = 0; entry < MBFS_BLOCK_SIZE / sizeof(DirectoryEntry); entry++, dirent++)
+        {
+            // Skip deleted entries, and erased ones (these share their flags with newly created files).
+            if ((dirent->flags & MBFS_DIRECTORY_ENTRY_VALID) == 0 || (dirent->flags == MBFS_DIRECTORY_ENTRY_NEW && (uint8_t)dirent->file_name[0] == 0xff))
+                continue;
+
+            entries++;
+
+            if (index)
+                indexInsert(dirent, directory->first_block);
+
+            // The root directory holds the magic entry, which refers back to the root directory itself.
+            if ((dirent->flags & MBFS_DIRECTORY_ENTRY_DIRECTORY) && dirent->flags != MBFS_DIRECTORY_ENTRY_NEW && dirent->first_block != directory->first_block)
+                entries += indexDirectory(dirent);
+        }
+
+        block = getNextFileBlock(block);
+    }
+
+    return entries;
+}
+
+/**
+  * Adds a DirectoryEntry to the index, growing the index if it is getting full.
+  *
+  * @param dirent The entry to add.
+  * @param directory The first block of the directory holding the entry.
+  */
+void MicroBitFileSystem::indexInsert(DirectoryEntry *dirent, uint16_t directory)
+{
+    if (index == NULL)
+        return;
+
+    // Keep the load factor below 3/4, so probe sequences stay short.
+    if ((indexCount + 1) * 4 > indexSize * 3)
+    {
+        DirectoryIndexEntry *old = index;
+        int oldSize = indexSize;
+
+        index = (DirectoryIndexEntry *) calloc(oldSize * 2, sizeof(DirectoryIndexEntry));
+
+        // If we're out of memory, fall back to scanning directories.
+        if (index == NULL)
+        {
+            free(old);
+            indexSize = 0;
+            indexCount = 0;
+            return;
+        }
+
+        indexSize = oldSize * 2;
+        indexCount = 0;
+
+        for (int i = 0; i < oldSize; i++)
+            if (old[i].dirent)
+                indexInsert(old[i].dirent, old[i].directory);
+
+        free(old);
+    }
+
+    uint16_t hash = indexHash(dirent->file_name, directory);
+    uint16_t slot = hash & (indexSize - 1);
+
+    while (index[slot].dirent)
+        slot = (slot + 1) & (indexSize - 1);
+
+    index[slot].dirent = dirent;
+    index[slot].directory = directory;
+    index[slot].hash = hash;
+    indexCount++;
+}
+
+/**
+  * Removes a DirectoryEntry from the index.
+  *
+  * @param dirent The entry to remove.
+  * @param directory The first block of the directory holding the entry.
+  */
+void MicroBitFileSystem::indexRemove(DirectoryEntry *dirent, uint16_t directory)
+{
+    if (index == NULL)
+        return;
+
+    uint16_t mask = indexSize - 1;
+    uint16_t slot = indexHash(dirent->file_name, directory) & mask;
+
+    while (index[slot].dirent != dirent)
+    {
+        if (index[slot].dirent == NULL)
+            return;
+
+        slot = (slot + 1) & mask;
+    }
+
+    // Shift back any entries that probed past the slot we just emptied, so lookups never stop short.
+    uint16_t hole = slot;
+
+    while (1)
+    {
+        slot = (slot + 1) & mask;
+
+        if (index[slot].dirent == NULL)
+            break;
+
+        uint16_t home = index[slot].hash & mask;
+
+        if (((slot - home) & mask) >= ((slot - hole) & mask))
+        {
+            index[hole] = index[slot];
+            hole = slot;
+        }
+    }
+
+    index[hole].dirent = NULL;
+    indexCount--;
+}
+
 /**
   * Retrieve the DirectoryEntry for the given filename.
   *
@@ -300,6 +487,21 @@ DirectoryEntry* MicroBitFileSystem::getDirectoryEntry(char const * filename, con
     if (directory == NULL)
         directory = rootDirectory;
 
+    // Use the index if we have one.
+    if (index)
+    {
+        uint16_t mask = indexSize - 1;
+        uint16_t hash = indexHash(file, directory->first_block);
+
+        for (uint16_t slot = hash & mask; index[slot].dirent; slot = (slot + 1) & mask)
+        {
+            if (index[slot].hash == hash && index[slot].directory == directory->first_block && strcmp(index[slot].dirent->file_name, file) == 0)
+                return index[slot].dirent;
+        }
+
+        return NULL;
+    }
+
     block = directory->first_block;
     dir = (Directory *) getBlock(block);
     dirent = &dir->entry[0];
@@ -307,7 +509,7 @@ DirectoryEntry* MicroBitFileSystem::getDirectoryEntry(char const * filename, con
     // Iterate through the directory entries until we find our file, or run out of space.
     while (1)
     {
-        if ((uint32_t)(dirent + 1) > (uint32_t)dir + MBFS_BLOCK_SIZE)
+        if ((uintptr_t)(dirent + 1) > (uintptr_t)dir + MBFS_BLOCK_SIZE)
         {
             block = getNextFileBlock(block);
             if (block == MBFS_EOF)
@@ -351,7 +553,7 @@ uint16_t MicroBitFileSystem::calculateFileTableSize()
   */
 uint32_t *MicroBitFileSystem::getPage(uint16_t block)
 {
-    uint32_t address = (uint32_t) getBlock(block);
+    uintptr_t address = (uintptr_t) getBlock(block);
     return (uint32_t *) (address - address % MICROBIT_CODEPAGESIZE);
 }
 
@@ -364,7 +566,7 @@ uint32_t *MicroBitFileSystem::getPage(uint16_t block)
   */
 uint32_t *MicroBitFileSystem::getBlock(uint16_t block)
 {
-    return (uint32_t *)((uint32_t)fileSystemTable + block * MBFS_BLOCK_SIZE);
+    return (uint32_t *)((uintptr_t)fileSystemTable + block * MBFS_BLOCK_SIZE);
 }
 
 /**
@@ -388,7 +590,7 @@ uint16_t MicroBitFileSystem::getNextFileBlock(uint16_t block)
   */
 uint16_t MicroBitFileSystem::getBlockNumber(void *address)
 {
-    return (((uint32_t) address - (uint32_t) fileSystemTable) / MBFS_BLOCK_SIZE);
+    return (((uintptr_t) address - (uintptr_t) fileSystemTable) / MBFS_BLOCK_SIZE);
 }
 
 /**
@@ -579,7 +781,7 @@ DirectoryEntry* MicroBitFileSystem::createDirectoryEntry(DirectoryEntry *directo
     while (1)
     {
         // Scan through each of the blocks in the directory
-        if ((uint32_t)(dirent+1) > (uint32_t)dir + MBFS_BLOCK_SIZE)
+        if ((uintptr_t)(dirent+1) > (uintptr_t)dir + MBFS_BLOCK_SIZE)
         {
             block = getNextFileBlock(block);
             if (block == MBFS_EOF)
@@ -697,6 +899,8 @@ DirectoryEntry* MicroBitFileSystem::createFile(char const * filename, DirectoryE
     // Push the new data back to FLASH memory
     flash.flash_write(dirent, &d, sizeof(DirectoryEntry));
     fileTableWrite(d.first_block, MBFS_EOF);
+
+    indexInsert(dirent, directory->first_block);
     return dirent;
 }
 
@@ -864,6 +1068,8 @@ int MicroBitFileSystem::open(char const * filename, uint32_t flags)
     file->seek = (flags & MB_APPEND) ? file->length : 0;
     file->dirent = dirent;
     file->directory = directory;
+    file->block = dirent->first_block;
+    file->blockPosition = 0;
     file->cacheLength = 0;
 
     // Add the file descriptor to the chain of open files.
@@ -928,9 +1134,14 @@ int MicroBitFileSystem::flush(int fd)
             uint16_t value = MBFS_DELETED;
 
             // invalidate the old directory entry and create a new one with the updated data.
+            indexRemove(file->dirent, file->directory->first_block);
             flash.flash_write(&file->dirent->flags, &value, 2);
             newDirent = createDirectoryEntry(file->directory);
             flash.flash_write(newDirent, &d, sizeof(DirectoryEntry));
+            indexInsert(newDirent, file->directory->first_block);
+
+            // Keep referring to the live entry, so later flushes (and open()) see it.
+            file->dirent = newDirent;
         }
     }
 
@@ -1065,7 +1276,6 @@ int MicroBitFileSystem::read(int fd, uint8_t* buffer, int size)
     uint8_t *writePointer;
 
     uint32_t offset;
-    uint32_t position = 0;
     int bytesCopied = 0;
     int segmentLength;
 
@@ -1086,17 +1296,10 @@ int MicroBitFileSystem::read(int fd, uint8_t* buffer, int size)
     size = min(size, file->length - file->seek);
 
     // Find the read position.
-    block = file->dirent->first_block; 
-
-    // Walk the file table until we reach the start block
-    while (file->seek - position > MBFS_BLOCK_SIZE)
-    {
-        block = getNextFileBlock(block);
-        position += MBFS_BLOCK_SIZE;
-    }
+    block = getSeekBlock(file);
 
     // Once we have the correct start block, handle the byte offset.
-    offset = file->seek - position;
+    offset = file->seek - file->blockPosition;
 
     // Now, start copying bytes into the requested buffer.
     writePointer = buffer;
@@ -1125,6 +1328,32 @@ int MicroBitFileSystem::read(int fd, uint8_t* buffer, int size)
     return bytesCopied;
 }
 
+/**
+  * Determine the block holding the current seek position of the given file, moving its block cursor there.
+  * Sequential access only walks the blocks between the previous and the current position.
+  *
+  * @param file An open file.
+  * @return The block number holding the seek position.
+  */
+uint16_t MicroBitFileSystem::getSeekBlock(FileDescriptor *file)
+{
+    // The chain can only be walked forwards, so restart from the first block if we have moved backwards.
+    if (file->seek < file->blockPosition)
+    {
+        file->block = file->dirent->first_block;
+        file->blockPosition = 0;
+    }
+
+    // A position at the very end of a block belongs to that block, so writes there can extend the chain.
+    while (file->seek - file->blockPosition > MBFS_BLOCK_SIZE)
+    {
+        file->block = getNextFileBlock(file->block);
+        file->blockPosition += MBFS_BLOCK_SIZE;
+    }
+
+    return file->block;
+}
+
 /**
   * Flush a given file's cache back to FLASH memory.
   *
@@ -1158,22 +1387,14 @@ int MicroBitFileSystem::writeBuffer(FileDescriptor *file, uint8_t *buffer, int s
     uint8_t *writePointer;
 
     uint32_t offset;
-    uint32_t position = 0;
     int bytesCopied = 0;
     int segmentLength;
 
-    // Find the read position.
-    block = file->dirent->first_block;
-
-    // Walk the file table until we reach the start block
-    while (file->seek - position > MBFS_BLOCK_SIZE)
-    {
-        block = getNextFileBlock(block);
-        position += MBFS_BLOCK_SIZE;
-    }
+    // Find the write position.
+    block = getSeekBlock(file);
 
     // Once we have the correct start block, handle the byte offset.
-    offset = file->seek - position;
+    offset = file->seek - file->blockPosition;
     writePointer = (uint8_t *)getBlock(block) + offset;
 
     // Now, start copying bytes from the requested buffer.
@@ -1330,6 +1551,8 @@ int MicroBitFileSystem::remove(char const * filename)
 
     FileDescriptor *file = getFileDescriptor(fd, true);
 
+    indexRemove(file->dirent, file->directory->first_block);
+
     // To erase a file, all we need to do is mark its directory entry and data blocks as INVALID.
     // First mark the file table
     block = file->dirent->first_block;
@@ -111,9 +111,12 @@ MicroBitRadio::MicroBitRadio(uint16_t id) : datagram(*this), event (*this)
     this->status = 0;
 	this->group = MICROBIT_RADIO_DEFAULT_GROUP;
 	this->queueDepth = 0;
+    this->rxHead = 0;
+    this->rxCount = 0;
     this->rssi = 0;
-    this->rxQueue = NULL;
     this->rxBuf = NULL;
+    this->rxPool = NULL;
+    this->rxFree = NULL;
 
     instance = this;
 }
@@ -170,8 +173,8 @@ FrameBuffer* MicroBitRadio::getRxBuf()
 /**
   * Attempt to queue a buffer received by the radio hardware, if sufficient space is available.
   *
-  * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if a replacement receiver buffer
-  *         could not be allocated (either by policy or memory exhaustion).
+  * @return DEVICE_OK on success, or DEVICE_NO_RESOURCES if the receive queue is full, or
+  *         no replacement receiver buffer is free in the pool.
   */
 int MicroBitRadio::queueRxBuf()
 {
@@ -185,26 +188,15 @@ int MicroBitRadio::queueRxBuf()
     rxBuf->rssi = getRSSI();
 
     // Ensure that a replacement buffer is available before queuing.
-    FrameBuffer *newRxBuf = new FrameBuffer();
+    FrameBuffer *newRxBuf = rxFree;
 
     if (newRxBuf == NULL)
         return DEVICE_NO_RESOURCES;
 
-    // We add to the tail of the queue to preserve causal ordering.
-    rxBuf->next = NULL;
-
-    if (rxQueue == NULL)
-    {
-        rxQueue = rxBuf;
-    }
-    else
-    {
-        FrameBuffer *p = rxQueue;
-        while (p->next != NULL)
-            p = p->next;
+    rxFree = newRxBuf->next;
 
-        p->next = rxBuf;
-    }
+    // We add to the tail of the queue to preserve causal ordering.
+    rxQueue[(rxHead + queueDepth) % MICROBIT_RADIO_MAXIMUM_RX_BUFFERS] = rxBuf;
 
     // Increase our received packet count
     queueDepth++;
@@ -265,11 +257,22 @@ int MicroBitRadio::enable()
         return DEVICE_NOT_SUPPORTED;
 
     // If this is the first time we've been enable, allocate out receive buffers.
-    if (rxBuf == NULL)
-        rxBuf = new FrameBuffer();
+    // These are recycled through release() from then on, so reception never touches the heap.
+    if (rxPool == NULL)
+    {
+        rxPool = new FrameBuffer[MICROBIT_RADIO_RX_POOL_SIZE];
 
-    if (rxBuf == NULL)
-        return DEVICE_NO_RESOURCES;
+        if (rxPool == NULL)
+            return DEVICE_NO_RESOURCES;
+
+        // The first buffer goes to the RADIO hardware, the rest are free.
+        for (int i = 1; i < MICROBIT_RADIO_RX_POOL_SIZE - 1; i++)
+            rxPool[i].next = &rxPool[i + 1];
+
+        rxPool[MICROBIT_RADIO_RX_POOL_SIZE - 1].next = NULL;
+        rxFree = &rxPool[1];
+        rxBuf = &rxPool[0];
+    }
 
     // Enable the High Frequency clock on the processor. This is a pre-requisite for
     // the RADIO module. Without this clock, no communication is possible.
@@ -403,10 +406,11 @@ int MicroBitRadio::setGroup(uint8_t group)
   */
 void MicroBitRadio::idleCallback()
 {
-    // Walk the list of packets and process each one.
-    while(rxQueue)
+    // Walk the queue of packets and process each one.
+    while(queueDepth)
     {
-        FrameBuffer *p = rxQueue;
+        FrameBuffer *p = rxQueue[rxHead];
+        uint16_t count = rxCount;
 
         switch (p->protocol)
         {
@@ -424,11 +428,8 @@ void MicroBitRadio::idleCallback()
 
         // If the packet was processed, it will have been recv'd, and taken from the queue.
         // If this was a packet for an unknown protocol, it will still be there, so simply free it.
-        if (p == rxQueue)
-        {
-            recv();
-            delete p;
-        }
+        if (count == rxCount)
+            release(recv());
     }
 }
 
@@ -450,19 +451,21 @@ int MicroBitRadio::dataReady()
   * @return The buffer containing the the packet. If no data is available, NULL is returned.
   *
   * @note Once recv() has been called, it is the callers responsibility to
-  *       delete the buffer when appropriate.
+  *       return the buffer with release() when appropriate. The buffer must not be deleted.
   */
 FrameBuffer* MicroBitRadio::recv()
 {
-    FrameBuffer *p = rxQueue;
+    FrameBuffer *p = NULL;
 
-    if (p)
+    if (queueDepth)
     {
          // Protect shared resource from ISR activity
         NVIC_DisableIRQ(RADIO_IRQn);
 
-        rxQueue = rxQueue->next;
+        p = rxQueue[rxHead];
+        rxHead = (rxHead + 1) % MICROBIT_RADIO_MAXIMUM_RX_BUFFERS;
         queueDepth--;
+        rxCount++;
 
         // Allow ISR access to shared resource
         NVIC_EnableIRQ(RADIO_IRQn);
@@ -471,6 +474,27 @@ FrameBuffer* MicroBitRadio::recv()
     return p;
 }
 
+/**
+  * Returns a buffer obtained through recv() to the pool of receive buffers.
+  *
+  * @param buffer The buffer to return. NULL is ignored.
+  */
+void MicroBitRadio::release(FrameBuffer *buffer)
+{
+    if (buffer == NULL)
+        return;
+
+    // Protect shared resource from ISR activity
+    NVIC_DisableIRQ(RADIO_IRQn);
+
+    buffer->next = rxFree;
+    rxFree = buffer;
+
+    // Allow ISR access to shared resource, unless the radio has been disabled.
+    if (status & MICROBIT_RADIO_STATUS_INITIALISED)
+        NVIC_EnableIRQ(RADIO_IRQn);
+}
+
 /**
   * Transmits the given buffer onto the broadcast radio.
   * The call will wait until the transmission of the packet has completed before returning.
@@ -78,7 +78,7 @@ int MicroBitRadioDatagram::recv(uint8_t *buf, int len)
     // Fill in the buffer provided, if possible.
     memcpy(buf, p->payload, l);
 
-    delete p;
+    radio.release(p);
     return l;
 }
 
@@ -100,7 +100,7 @@ PacketBuffer MicroBitRadioDatagram::recv()
 
     PacketBuffer packet(p->payload, p->length - (MICROBIT_RADIO_HEADER_SIZE - 1), p->rssi);
 
-    delete p;
+    radio.release(p);
     return packet;
 }
 
@@ -193,7 +193,7 @@ void MicroBitRadioDatagram::packetReceived()
 
         if (queueDepth >= MICROBIT_RADIO_MAXIMUM_RX_BUFFERS)
         {
-            delete packet;
+            radio.release(packet);
             return;
         }
 
@@ -151,7 +151,7 @@ void MicroBitRadioEvent::packetReceived()
     e->fire();
     suppressForwarding = false;
 
-    delete p;
+    radio.release(p);
 }
 
 /**
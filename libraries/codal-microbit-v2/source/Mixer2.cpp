@@ -69,12 +69,90 @@ void Mixer2::configureChannel(MixerChannel *c)
     c->volume = 1.0f;
     c->format = c->stream->getFormat();
     c->bytesPerSample = DATASTREAM_FORMAT_BYTES_PER_SAMPLE(c->format);
-    c->gain = CONFIG_MIXER_INTERNAL_RANGE / (float) c->range;
-    c->skip = c->rate / outputRate;
+    c->skip = (uint32_t) (c->rate / outputRate * MIXER_FIXED_POINT_ONE + 0.5f);
     c->offset = 0.0f;
 
     if (c->format == DATASTREAM_FORMAT_8BIT_UNSIGNED || c->format == DATASTREAM_FORMAT_16BIT_UNSIGNED)
         c->offset = c->range * -0.5f;       
+
+    // Fold normalisation, volume and offset into a single multiply-add per sample.
+    float gain = CONFIG_MIXER_INTERNAL_RANGE / c->range * c->volume * MIXER_FIXED_POINT_ONE;
+    c->gain = (int32_t) (gain + 0.5f);
+    c->bias = (int32_t) (c->offset * gain + (c->offset < 0 ? -0.5f : 0.5f));
+}
+
+/**
+ * Mixes a block of samples at the output sample rate. This is the common case, so it gets a
+ * tight loop for each sample type, rather than a call through readSample per sample.
+ */
+template <typename T>
+static void mix_block(int32_t *out, const T *in, int len, int32_t gain, int32_t bias)
+{
+    while (len--)
+        *out++ += (int32_t) *in++ * gain + bias;
+}
+
+/**
+ * Mixes samples from the buffer of a channel into the accumulator, as far as the output and the buffer allow.
+ * @return the number of output samples produced.
+ */
+int Mixer2::mixChannel(MixerChannel *c, int32_t *out, int len)
+{
+    uint32_t samples = c->buffer.length() / c->bytesPerSample;
+    uint32_t end = samples << MIXER_FIXED_POINT_BITS;
+
+    if (c->position >= end)
+        return 0;
+
+    // The number of output samples left in this buffer.
+    int available = (end - c->position + c->skip - 1) / c->skip;
+    len = min(len, available);
+
+    if (c->skip == MIXER_FIXED_POINT_ONE)
+    {
+        uint8_t *d = c->in + (c->position >> MIXER_FIXED_POINT_BITS) * c->bytesPerSample;
+
+        switch (c->format)
+        {
+            case DATASTREAM_FORMAT_16BIT_SIGNED:
+                mix_block(out, (int16_t *) d, len, c->gain, c->bias);
+                break;
+
+            case DATASTREAM_FORMAT_16BIT_UNSIGNED:
+                mix_block(out, (uint16_t *) d, len, c->gain, c->bias);
+                break;
+
+            case DATASTREAM_FORMAT_8BIT_SIGNED:
+                mix_block(out, (int8_t *) d, len, c->gain, c->bias);
+                break;
+
+            case DATASTREAM_FORMAT_8BIT_UNSIGNED:
+                mix_block(out, (uint8_t *) d, len, c->gain, c->bias);
+                break;
+
+            default:
+                for (int i = 0; i < len; i++, d += c->bytesPerSample)
+                    out[i] += StreamNormalizer::readSample[c->format](d) * c->gain + c->bias;
+        }
+
+        c->position += len << MIXER_FIXED_POINT_BITS;
+    }
+    else
+    {
+        // Sub/super sampling: pick the nearest earlier input sample for each output sample.
+        SampleReadFn read = StreamNormalizer::readSample[c->format];
+        uint32_t position = c->position;
+
+        for (int i = 0; i < len; i++)
+        {
+            out[i] += read(c->in + (position >> MIXER_FIXED_POINT_BITS) * c->bytesPerSample) * c->gain + c->bias;
+            position += c->skip;
+        }
+
+        c->position = position;
+    }
+
+    return len;
 }
 
 /**
@@ -116,8 +194,8 @@ ManagedBuffer Mixer2::pull()
     }
 
     // Clear the accumulator buffer
-    for (int i=0; i<CONFIG_MIXER_BUFFER_SIZE/bytesPerSampleOut; i++)
-        mix[i] = 0.0f;
+    int samples = CONFIG_MIXER_BUFFER_SIZE/bytesPerSampleOut;
+    memset(mix, 0, samples * sizeof(int32_t));
 
     MixerChannel *next;
 
@@ -134,37 +212,18 @@ ManagedBuffer Mixer2::pull()
                 continue;
         }
 
-        float *out = &mix[0];
-        float *end = &mix[CONFIG_MIXER_BUFFER_SIZE/bytesPerSampleOut];
-        int inputFormat = ch->format;
+        int32_t *out = &mix[0];
+        int32_t *end = &mix[samples];
 
         while (out < end)
         {
-            // precalculate the maximum number of samples the we can process with the current buffer allocations.
-            // choose the minimum between the available samples in the input buffer and the space in the output buffer.
-            int outLen = (int) (end - out);
-            int inLen = ((ch->buffer.length() / ch->bytesPerSample) - ch->position) / ch->skip;
-            int len =  min(outLen, inLen);
-
-            uint8_t *d = ch->in;
-
-            while(len--)
-            {
-                float v = StreamNormalizer::readSample[inputFormat](d);
-                v += ch->offset;
-                v *= ch->gain;    
-                v *= ch->volume;    
-                *out += v;
- 
-                ch->position += ch->skip;
-                d = ch->in + (int)(ch->position * ch->bytesPerSample);
-
-                out++;
-            }
+            out += mixChannel(ch, out, (int) (end - out));
 
             // Check if we've completed an input buffer. If so, pull down another if available.
             // if no buffer is available, then move on to the next channel.
-            if (inLen <= outLen)
+            uint32_t bufferEnd = (ch->buffer.length() / ch->bytesPerSample) << MIXER_FIXED_POINT_BITS;
+
+            if (ch->position >= bufferEnd)
             {
                 if (ch->pullRequests == 0)
                     break;
@@ -172,11 +231,16 @@ ManagedBuffer Mixer2::pull()
                 ch->pullRequests--;
                 ch->buffer = ch->stream->pull();
                 ch->in = &ch->buffer[0];
-                ch->position = 0;
                 ch->end = ch->in + ch->buffer.length();
 
+                // Carry any fractional overshoot into the new buffer, so resampled channels stay in phase.
+                ch->position -= bufferEnd;
+
                 if (ch->buffer.length() == 0)
+                {
+                    ch->position = 0;
                     break;
+                }
             }                
         }
     }       
@@ -184,20 +248,23 @@ ManagedBuffer Mixer2::pull()
     // Scale and pack to our output format
     ManagedBuffer output = ManagedBuffer(CONFIG_MIXER_BUFFER_SIZE);
     uint8_t *w = &output[0];
-    float *r = mix;
+    int32_t *r = mix;
 
     int len = output.length() / bytesPerSampleOut;
-    float scale = volume * outputRange / CONFIG_MIXER_INTERNAL_RANGE;
-    int offset = (outputFormat == DATASTREAM_FORMAT_16BIT_UNSIGNED || outputFormat == DATASTREAM_FORMAT_8BIT_UNSIGNED) ? outputRange/2 : 0;
-    float lo = (outputFormat == DATASTREAM_FORMAT_16BIT_UNSIGNED || outputFormat == DATASTREAM_FORMAT_8BIT_UNSIGNED) ? 0 : -outputRange/2;
-    float hi = (outputFormat == DATASTREAM_FORMAT_16BIT_UNSIGNED || outputFormat == DATASTREAM_FORMAT_8BIT_UNSIGNED) ? outputRange : outputRange/2;
+    bool isUnsigned = outputFormat == DATASTREAM_FORMAT_16BIT_UNSIGNED || outputFormat == DATASTREAM_FORMAT_8BIT_UNSIGNED;
+    int32_t range = (int32_t) outputRange;
+    int32_t scale = (int32_t) (volume * outputRange / CONFIG_MIXER_INTERNAL_RANGE * MIXER_FIXED_POINT_ONE + 0.5f);
+    int32_t offset = isUnsigned ? range/2 : 0;
+    int32_t lo = isUnsigned ? 0 : -range/2;
+    int32_t hi = isUnsigned ? range : range/2;
 
     while(len--)
     {
-        float sample = *r * scale;
+        // Both the accumulator and the scale carry fractional bits. Round to the nearest level.
+        int32_t sample = (int32_t) (((int64_t) *r * scale + (1LL << (2 * MIXER_FIXED_POINT_BITS - 1))) >> (2 * MIXER_FIXED_POINT_BITS));
         sample += offset;
-        
-        // Clamp output range. Would be nice to use apply some compression here, 
+
+        // Saturate to the output range. Would be nice to use apply some compression here, 
         // but we don't really want ot use more CPU than we already do.
         if (sample < lo)
             sample = lo;
@@ -206,11 +273,14 @@ ManagedBuffer Mixer2::pull()
             sample = hi;
 
         // Apply any requested bit mask
-        int s = (int)sample;
-        s |= orMask;
+        sample |= orMask;
 
         // Write out the sample.
-        StreamNormalizer::writeSample[outputFormat](w, s);
+        if (bytesPerSampleOut == 2)
+            *(uint16_t *)w = (uint16_t) sample;
+        else
+            *w = (uint8_t) sample;
+
         w += bytesPerSampleOut;
         r++;
     }
@@ -298,7 +368,7 @@ int Mixer2::setSampleRate(int sampleRate)
 
     // Recompute the sub/super sampling constants for each channel.    
     for (MixerChannel *c = channels; c; c=c->next)
-        c->skip = c->rate / outputRate;
+        c->skip = (uint32_t) (c->rate / outputRate * MIXER_FIXED_POINT_ONE + 0.5f);
 
     return DEVICE_OK;
 }
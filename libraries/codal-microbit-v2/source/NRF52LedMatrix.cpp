@@ -59,10 +59,12 @@ NRF52LEDMatrix::NRF52LEDMatrix(NRFLowLevelTimer &displayTimer, const MatrixMap &
     strobeRow = 0;
     instance = this;
     lightLevel = 0;
+    renderDirty = true;
+    quantum = 0;
     this->mode = mode;
 
     // Validate that we can deliver the requested display.
-    if (matrixMap.columns <= NRF52_LED_MATRIX_MAXIMUM_COLUMNS)
+    if (matrixMap.columns <= NRF52_LED_MATRIX_MAXIMUM_COLUMNS && matrixMap.rows <= NRF52_LED_MATRIX_MAXIMUM_ROWS && width * height <= (int)sizeof(renderedImage))
     {
         // Configure as a fixed period timer
         timer.setMode(TimerMode::TimerModeTimer);
@@ -109,7 +111,13 @@ void NRF52LEDMatrix::setDisplayMode(DisplayMode mode)
         timeslots++;
 
     timerPeriod = NRF52_LED_MATRIX_CLOCK_FREQUENCY / (NRF52_LED_MATRIX_FREQUENCY * timeslots);
-    quantum = (timerPeriod * brightness) / (256 * 255);
+    uint32_t q = (timerPeriod * brightness) / (256 * 255);
+
+    // n.b. light sensing restores the mode on every frame, so only invalidate the rows on a real change.
+    if (q != quantum || mode != this->mode)
+        renderDirty = true;
+
+    quantum = q;
     
     timer.setCompare(0, timerPeriod);
     timer.timer->TASKS_CLEAR = 1;
@@ -191,13 +199,50 @@ void NRF52LEDMatrix::disable()
 }
 
 /**
- * Configure the next frame to be drawn.
+ * Recompute the timer compare values of every row, if the image has changed since they were last computed.
  */
-void NRF52LEDMatrix::render()
+void NRF52LEDMatrix::updateRowCompare()
 {
     uint8_t *screenBuffer = image.getBitmap();
     uint32_t value;
 
+    if (!renderDirty && memcmp(screenBuffer, renderedImage, width * height) == 0)
+        return;
+
+    memcpy(renderedImage, screenBuffer, width * height);
+    renderDirty = false;
+
+    for (int row = 0; row < matrixMap.rows; row++)
+    {
+        MatrixPoint *p = (MatrixPoint *)matrixMap.map + row;
+
+        rowLit[row] = 0;
+
+        for (int column = 0; column < matrixMap.columns; column++)
+        {
+            value = renderedImage[p->y * width + p->x];
+
+            // Clip pixels to full or zero brightness if in black and white mode.
+            if (mode == DISPLAY_MODE_BLACK_AND_WHITE || mode == DISPLAY_MODE_BLACK_AND_WHITE_LIGHT_SENSE)
+                value = value ? 255 : 0;
+
+            value = value * quantum;
+            rowCompare[row][column] = value;
+
+            if (value)
+                rowLit[row] |= 1 << column;
+
+            p += matrixMap.rows;
+        }
+    }
+}
+
+/**
+ * Configure the next frame to be drawn.
+ */
+void NRF52LEDMatrix::render()
+{
+
     if (strobeRow < matrixMap.rows)
     {
         // We just completed a normal diplay strobe. 
@@ -223,26 +268,19 @@ void NRF52LEDMatrix::render()
     if(strobeRow < matrixMap.rows)
     {
         // Common case - configure timer values.
-        MatrixPoint *p = (MatrixPoint *)matrixMap.map + strobeRow;
+        // The image is sampled once per frame, so every row of a frame shows the same image.
+        if (strobeRow == 0)
+            updateRowCompare();
 
         for (int column = 0; column < matrixMap.columns; column++)
         {
-            value = screenBuffer[p->y * width + p->x];
-
-            // Clip pixels to full or zero brightness if in black and white mode.
-            if (mode == DISPLAY_MODE_BLACK_AND_WHITE || mode == DISPLAY_MODE_BLACK_AND_WHITE_LIGHT_SENSE)
-                value = value ? 255 : 0;
-
-            value = value * quantum;
-            timer.timer->CC[column+1] = value;
+            timer.timer->CC[column+1] = rowCompare[strobeRow][column];
 
             // Set the initial polarity of the column output to HIGH if the pixel brightness is >0. LOW otherwise.
-            if (value)
+            if (rowLit[strobeRow] & (1 << column))
                 NRF_GPIOTE->CONFIG[gpiote[column]] &= ~0x00100000;
             else
                 NRF_GPIOTE->CONFIG[gpiote[column]] |= 0x00100000;
-            
-            p += matrixMap.rows;
         }
 
         // Enable the drive pin, and start the timer.
@@ -308,6 +346,7 @@ int NRF52LEDMatrix::setBrightness(int b)
 
     // Recalculate our quantum based on the new brightness setting.
     quantum = (timerPeriod * brightness) / (256 * 255);
+    renderDirty = true;
 
     return DEVICE_OK;
 }
@@ -25,6 +25,7 @@ DEALINGS IN THE SOFTWARE.
 
 #include "PacketBuffer.h"
 #include "ErrorNo.h"
+#include "CodalSlabAllocator.h"
 
 using namespace codal;
 
@@ -111,7 +112,7 @@ void PacketBuffer::init(uint8_t *data, int length, int rssi)
     if (length < 0)
         length = 0;
 
-    ptr = (PacketData *) malloc(sizeof(PacketData) + length);
+    ptr = (PacketData *) device_slab_alloc(sizeof(PacketData) + length);
     ptr->init();
 
     ptr->length = length;
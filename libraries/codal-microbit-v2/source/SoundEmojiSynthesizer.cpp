@@ -40,8 +40,9 @@ SoundEmojiSynthesizer::SoundEmojiSynthesizer(uint16_t id, int sampleRate) : Coda
 {
     this->downStream = NULL;
     this->bufferSize = EMOJI_SYNTHESIZER_BUFFER_SIZE;
-    this->position = 0.0f;
+    this->position = 0;
     this->effect = NULL;
+    this->wavetable = NULL;
 
     this->samplesToWrite = 0;
     this->samplesWritten = 0;
@@ -108,6 +109,9 @@ int SoundEmojiSynthesizer::play(ManagedBuffer sound)
     // If a playout is already in progress, block until it has been scheduled.
     lock.wait();
 
+    // Render the tones of the sequence here, rather than in the audio pipeline.
+    renderWavetables(sound);
+
     // Store the requested sequence of sound effects.
     effectBuffer = sound;
 
@@ -163,7 +167,7 @@ bool SoundEmojiSynthesizer::nextSoundEffect()
             effectBuffer = emptyBuffer;
             samplesWritten = 0;
             samplesToWrite = 0;
-            position = 0.0f;
+            position = 0;
             return hadEffect;
         }
     }
@@ -181,9 +185,76 @@ bool SoundEmojiSynthesizer::nextSoundEffect()
         effect->effects[i].steps = max(effect->effects[i].steps, 1);
         samplesPerStep[i] = (float) samplesToWrite / (float) effect->effects[i].steps;
     }
+
+    // Select the wavetable play() rendered for this effect.
+    int index = ((uint16_t *) &wavetableIndex[0])[effect - (SoundEffect *) &effectBuffer[0]];
+    wavetable = (uint16_t *) &wavetables[0] + index * EMOJI_SYNTHESIZER_TONE_WIDTH;
+
     return false;
 }
 
+/**
+ * Determines if the output of a tonePrint depends only on its parameter, so a wavetable rendered from it can be reused.
+ * This holds for the built in tonePrints, but not for CustomTone (whose parameter points to a user array that may be
+ * edited in place between effects) or any other user supplied function.
+ */
+static bool isCacheableTone(TonePrintFunction tonePrint)
+{
+    return tonePrint == Synthesizer::SineTone || tonePrint == Synthesizer::SawtoothTone || tonePrint == Synthesizer::TriangleTone ||
+           tonePrint == Synthesizer::NoiseTone || tonePrint == Synthesizer::SquareWaveTone || tonePrint == Synthesizer::SquareWaveToneExt;
+}
+
+/**
+ * Renders one period of every distinct tonePrint in a sequence of sound effects into our wavetables,
+ * and records which one each effect plays. This takes the calls through the tonePrint function pointer
+ * out of the audio pipeline: pull() only reads the wavetables.
+ * The wavetables of the previous sequence are reused if it had the same built in tonePrints; custom
+ * tones are rendered again every time.
+ *
+ * @param sound A buffer containing an array of one or more SoundEffects.
+ */
+void SoundEmojiSynthesizer::renderWavetables(ManagedBuffer sound)
+{
+    int effects = sound.length() / sizeof(SoundEffect);
+    SoundEffect *fx = (SoundEffect *) &sound[0];
+    ManagedBuffer index(effects * sizeof(uint16_t));
+    ManagedBuffer tones(effects * sizeof(TonePrint));
+    TonePrint *t = (TonePrint *) &tones[0];
+    int count = 0;
+    bool cacheable = true;
+
+    for (int i = 0; i < effects; i++)
+    {
+        int j = 0;
+        while (j < count && (t[j].tonePrint != fx[i].tone.tonePrint || t[j].parameter != fx[i].tone.parameter))
+            j++;
+
+        if (j == count)
+        {
+            t[count++] = fx[i].tone;
+            cacheable = cacheable && isCacheableTone(fx[i].tone.tonePrint);
+        }
+
+        ((uint16_t *) &index[0])[i] = j;
+    }
+
+    tones.truncate(count * sizeof(TonePrint));
+    wavetableIndex = index;
+
+    if (cacheable && tones == wavetableTones)
+        return;
+
+    ManagedBuffer tables(count * EMOJI_SYNTHESIZER_TONE_WIDTH * sizeof(uint16_t));
+    uint16_t *table = (uint16_t *) &tables[0];
+
+    for (int j = 0; j < count; j++)
+        for (int i = 0; i < EMOJI_SYNTHESIZER_TONE_WIDTH; i++)
+            *table++ = t[j].tonePrint(t[j].parameter, i);
+
+    wavetables = tables;
+    wavetableTones = tones;
+}
+
 /**
  * Provide the next available ManagedBuffer to our downstream caller, if available.
  */
@@ -227,9 +298,13 @@ ManagedBuffer SoundEmojiSynthesizer::pull()
         // Generate some samples with the current effect parameters.
         while(samplesWritten < samplesToWrite)
         {
+            // Effect parameters only change between steps, so convert them to fixed point once per step.
             float skip = ((EMOJI_SYNTHESIZER_TONE_WIDTH_F * frequency) / sampleRate);
             float gain = (sampleRange * volume) / 1024.0f;
             float offset = 512.0f - (512.0f * gain);
+            uint32_t skipFixed = (uint32_t) (int64_t) (skip * (1 << EMOJI_SYNTHESIZER_POSITION_BITS));
+            int32_t gainFixed = (int32_t) (gain * 65536.0f + 0.5f);
+            int32_t offsetFixed = (int32_t) (offset * 65536.0f + 0.5f);
 
             int effectStepEnd[EMOJI_SYNTHESIZER_TONE_EFFECTS];
 
@@ -244,7 +319,7 @@ ManagedBuffer SoundEmojiSynthesizer::pull()
             for (int i = 1; i < EMOJI_SYNTHESIZER_TONE_EFFECTS; i++)
                 stepEndPosition = min(stepEndPosition, effectStepEnd[i]);
 
-            // Write samples until the end of the next effect-step
+            // Write samples until the end of the next effect-step, or the end of the buffer.
             while (samplesWritten < stepEndPosition)
             {
                 // Stop processing when we've filled the requested buffer
@@ -254,20 +329,21 @@ ManagedBuffer SoundEmojiSynthesizer::pull()
                     return buffer;
                 }
 
-                // Synthesize a sample
-                float s = effect->tone.tonePrint(effect->tone.parameter, (int) position);
+                int len = min(stepEndPosition - samplesWritten, (int) (bufferEnd - sample));
+                const uint16_t *tone = wavetable;
+                uint32_t p = position;
 
-                // Apply volume scaling and OR mask (if specified).
-                *sample = ((uint16_t) ((s * gain) + offset)) | orMask;
+                samplesWritten += len;
 
-                // Move on our pointers.
-                sample++;
-                samplesWritten++;
-                position += skip;
+                // Synthesize samples, applying volume scaling and OR mask (if specified).
+                // The position wraps around at the end of the tonePrint by itself.
+                while (len--)
+                {
+                    *sample++ = ((uint16_t) ((tone[p >> EMOJI_SYNTHESIZER_POSITION_BITS] * gainFixed + offsetFixed) >> 16)) | orMask;
+                    p += skipFixed;
+                }
 
-                // Keep our toneprint pointer in range
-                while(position > EMOJI_SYNTHESIZER_TONE_WIDTH_F)
-                    position -= EMOJI_SYNTHESIZER_TONE_WIDTH_F;
+                position = p;
             }
 
             // Invoke the effect function for any effects that are due.
@@ -38,8 +38,22 @@ namespace codal
 class NRF52I2C : public codal::I2C
 {
     int minimumBusIdlePeriod;
+    I2CTransaction *active;                     // The transaction the hardware is performing, if any.
+    I2CTransaction *queueHead;                  // Transactions waiting for the bus, oldest first.
+    I2CTransaction *queueTail;
+    bool locked;                                // True while a blocking operation owns the bus.
+    int waiting;                                // Blocking operations waiting for the active transaction to complete.
 
     int waitForStop(int evt);
+    int writeBlocking(uint16_t address, uint8_t *data, int len, bool repeated);
+    int readBlocking(uint16_t address, uint8_t *data, int len, bool repeated);
+    bool canSleep();
+    int transfer(uint16_t address, uint8_t *txBuffer, int txSize, uint8_t *rxBuffer, int rxSize);
+    void lock();
+    void unlock(bool repeated);
+    void startNext();
+    static void _irqHandler(void *self);
+
 protected:
     NRF52Pin &sda, &scl;
     NRF_TWIM_Type *p_twim;
@@ -63,7 +77,8 @@ public:
     *  - Writing a number of raw data bytes provided
     *  - Asserting a Stop condition on the bus
     *
-    * The CPU will busy wait until the transmission is complete.
+    * The calling fiber is descheduled until the transmission is complete. Before the scheduler runs,
+    * and within a repeated START transfer, the CPU busy waits instead.
     *
     * @param address The 8bit I2C address of the device to write to
     * @param data pointer to the bytes to write
@@ -82,7 +97,8 @@ public:
       *  - reading "len" bytes of raw 8 bit data into the buffer provided
       *  - Asserting a Stop condition on the bus
       *
-      * The CPU will busy wait until the transmission is complete.
+      * The calling fiber is descheduled until the transmission is complete. Before the scheduler runs,
+      * and within a repeated START transfer, the CPU busy waits instead.
       *
       * @param address The 8bit I2C address of the device to read from
       * @param data pointer to store the the bytes read
@@ -105,7 +121,8 @@ public:
       *  - Performing an 8 bit read operation (of the requested register)
       *  - Asserting a Stop condition on the bus
       *
-      * The CPU will busy wait until the transmission is complete..
+      * The calling fiber is descheduled until the transmission is complete. Before the scheduler runs,
+      * the CPU busy waits instead.
       *
       * @param address 8bit I2C address of the device to read from
       * @param reg The 8bit register address of the to read.
@@ -117,6 +134,19 @@ public:
       */
     virtual int readRegister(uint16_t address, uint8_t reg, uint8_t *data, int length, bool repeated = true);
 
+    /**
+     * Queues a transaction, and returns without waiting for it. The TWIM peripheral performs it through
+     * EasyDMA, and its interrupt handler completes it and starts the next one queued.
+     * On completion, the doneHandler of the transaction is called in IRQ context or, if it has none,
+     * an I2C_EVT_TRANSACTION_COMPLETE event is raised. The event is also raised while a blocking
+     * operation is waiting for the bus.
+     *
+     * @param t The transaction to perform. Its buffers must be in RAM, as EasyDMA cannot read flash.
+     *
+     * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the transaction transfers no data.
+     */
+    virtual int startTransaction(I2CTransaction &t);
+
     /**
       * Clear I2C bus
       */ 
@@ -126,6 +156,7 @@ public:
      * Define the minimum bus idle period for this I2C bus.
      * Thise controls the period of time the bus will remain idle between I2C transactions, 
      * and also between subsequent write/read operations within a repeated START condition.
+     * Transactions queued with startTransaction() are not delayed.
      *
      * @param period The minimum bus idle period, in microseconds
      * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER
@@ -76,6 +76,17 @@ public:
 	 */
 	virtual void connect(DataSink &sink);
 
+    /**
+     *  Determine the data format of the buffers streamed out of this component.
+     */
+    virtual int getFormat();
+
+    /**
+     * Determine the rate at which PCM samples are generated.
+     * @return the sample rate, in Hz.
+     */
+    int getSampleRate();
+
     /**
      * Interrupt callback when playback of DMA buffer has completed
      */
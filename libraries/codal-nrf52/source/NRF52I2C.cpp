@@ -2,17 +2,32 @@
 #include "codal_target_hal.h"
 #include "CodalDmesg.h"
 #include "peripheral_alloc.h"
+#include "codal-core/inc/types/Event.h"
+#include "CodalFiber.h"
 
 using namespace codal;
 
 #define MAX_I2C_RETRIES 2 // TODO?
 
+/**
+ * Determines whether we are running in an interrupt handler, which our own interrupt may be unable to preempt.
+ */
+static inline bool inInterrupt()
+{
+    return (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0;
+}
+
 /**
  * Constructor.
  */
 NRF52I2C::NRF52I2C(NRF52Pin &sda, NRF52Pin &scl, NRF_TWIM_Type *device) : codal::I2C(sda, scl), sda(sda), scl(scl)
 {
     minimumBusIdlePeriod = 0;
+    active = NULL;
+    queueHead = NULL;
+    queueTail = NULL;
+    locked = false;
+    waiting = 0;
 
 #ifdef NRF52I2C_BUS_IDLE_PERIOD
     minimumBusIdlePeriod = NRF52I2C_BUS_IDLE_PERIOD;
@@ -43,6 +58,14 @@ NRF52I2C::NRF52I2C(NRF52Pin &sda, NRF52Pin &scl, NRF_TWIM_Type *device) : codal:
     nrf_twim_frequency_set(p_twim, NRF_TWIM_FREQ_100K);
     nrf_twim_enable(p_twim);
 
+    // Transactions queued with startTransaction() are completed by our interrupt handler.
+    IRQn_Type IRQn = get_alloc_peri_irqn(p_twim);
+    set_alloc_peri_irq(p_twim, &_irqHandler, this);
+
+    NVIC_SetPriority(IRQn, 7);
+    NVIC_ClearPendingIRQ(IRQn);
+    NVIC_EnableIRQ(IRQn);
+
     target_wait_us(10);
 }
 
@@ -155,7 +178,9 @@ int NRF52I2C::waitForStop(int evt)
  *  - Writing a number of raw data bytes provided
  *  - Asserting a Stop condition on the bus
  *
- * The CPU will busy wait until the transmission is complete.
+ * The calling fiber is descheduled until the transmission is complete. Before the scheduler runs,
+ * within a repeated START transfer, and when the caller can't sleep (see canSleep()), the CPU busy
+ * waits instead.
  *
  * @param address The 8bit I2C address of the device to write to
  * @param data pointer to the bytes to write
@@ -165,6 +190,22 @@ int NRF52I2C::waitForStop(int evt)
  * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the the write request failed.
  */
 int NRF52I2C::write(uint16_t address, uint8_t *data, int len, bool repeated)
+{
+    // A zero length write (typically a bus probe) has no completion for our interrupt handler to report.
+    if (!repeated && len > 0 && !locked && canSleep())
+        return transfer(address, data, len, NULL, 0);
+
+    lock();
+    int result = writeBlocking(address, data, len, repeated);
+    unlock(repeated && result == DEVICE_OK);
+
+    return result;
+}
+
+/**
+ * Performs a write on a bus locked by the caller, waiting for it to complete.
+ */
+int NRF52I2C::writeBlocking(uint16_t address, uint8_t *data, int len, bool repeated)
 {
     address = address >> 1;
 
@@ -203,7 +244,9 @@ int NRF52I2C::write(uint16_t address, uint8_t *data, int len, bool repeated)
  *  - reading "len" bytes of raw 8 bit data into the buffer provided
  *  - Asserting a Stop condition on the bus
  *
- * The CPU will busy wait until the transmission is complete.
+ * The calling fiber is descheduled until the transmission is complete. Before the scheduler runs,
+ * within a repeated START transfer, and when the caller can't sleep (see canSleep()), the CPU busy
+ * waits instead.
  *
  * @param address The 8bit I2C address of the device to read from
  * @param data pointer to store the the bytes read
@@ -213,6 +256,21 @@ int NRF52I2C::write(uint16_t address, uint8_t *data, int len, bool repeated)
  * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the the read request failed.
  */
 int NRF52I2C::read(uint16_t address, uint8_t *data, int len, bool repeated)
+{
+    if (!repeated && len > 0 && !locked && canSleep())
+        return transfer(address, NULL, 0, data, len);
+
+    lock();
+    int result = readBlocking(address, data, len, repeated);
+    unlock(repeated && result == DEVICE_OK);
+
+    return result;
+}
+
+/**
+ * Performs a read on a bus locked by the caller, waiting for it to complete.
+ */
+int NRF52I2C::readBlocking(uint16_t address, uint8_t *data, int len, bool repeated)
 {
     address = address >> 1;
 
@@ -264,7 +322,8 @@ int NRF52I2C::read(uint16_t address, uint8_t *data, int len, bool repeated)
  *  - Performing an 8 bit read operation (of the requested register)
  *  - Asserting a Stop condition on the bus
  *
- * The CPU will busy wait until the transmission is complete..
+ * The calling fiber is descheduled until the transmission is complete. Before the scheduler runs,
+ * and when the caller can't sleep (see canSleep()), the CPU busy waits instead.
  *
  * @param address 8bit I2C address of the device to read from
  * @param reg The 8bit register address of the to read.
@@ -277,20 +336,256 @@ int NRF52I2C::read(uint16_t address, uint8_t *data, int len, bool repeated)
  */
 int NRF52I2C::readRegister(uint16_t address, uint8_t reg, uint8_t *data, int length, bool repeated)
 {
+    if (repeated && length > 0 && !locked && canSleep())
+        return transfer(address, &reg, 1, data, length);
+
+    lock();
+
     // write followed by a read...
-    int ret = write(address, &reg, 1, repeated);
+    int ret = writeBlocking(address, &reg, 1, repeated);
 
-    if (ret)
-        return ret;
+    if (ret == DEVICE_OK)
+        ret = readBlocking(address, data, length, false);
 
-    ret = read(address, data, length, false);
+    unlock(false);
     return ret;
 }
 
+/**
+ * Determines whether the caller can be descheduled while it waits for the bus: a fiber other than the
+ * idle task (which runs idle callbacks), once the scheduler runs, and outside of interrupt context.
+ */
+bool NRF52I2C::canSleep()
+{
+    return fiber_can_block() && !inInterrupt();
+}
+
+/**
+ * Performs a transfer as a transaction, after those already queued, and sleeps until it completes.
+ *
+ * @return DEVICE_OK on success, DEVICE_I2C_ERROR if the transfer failed.
+ */
+int NRF52I2C::transfer(uint16_t address, uint8_t *txBuffer, int txSize, uint8_t *rxBuffer, int rxSize)
+{
+    I2CTransaction t;
+
+    t.address = address;
+    t.txBuffer = txBuffer;
+    t.txSize = txSize;
+    t.rxBuffer = rxBuffer;
+    t.rxSize = rxSize;
+    t.doneHandler = NULL;
+
+    startTransaction(t);
+
+    // Without a doneHandler, the transaction raises I2C_EVT_TRANSACTION_COMPLETE. We register for it
+    // before enabling interrupts again, so it can't be missed.
+    target_disable_irq();
+
+    while (t.status == I2C_TRANSACTION_PENDING)
+    {
+        fiber_wake_on_event(DEVICE_ID_I2C, I2C_EVT_TRANSACTION_COMPLETE);
+        target_enable_irq();
+        schedule();
+        target_disable_irq();
+    }
+
+    target_enable_irq();
+
+    if (minimumBusIdlePeriod)
+        target_wait_us(minimumBusIdlePeriod);
+
+    return t.status;
+}
+
+/**
+ * Queues a transaction, and returns without waiting for it. The TWIM peripheral performs it through
+ * EasyDMA, and its interrupt handler completes it and starts the next one queued.
+ * On completion, the doneHandler of the transaction is called in IRQ context or, if it has none,
+ * an I2C_EVT_TRANSACTION_COMPLETE event is raised. The event is also raised while a blocking
+ * operation is waiting for the bus.
+ *
+ * @param t The transaction to perform. Its buffers must be in RAM, as EasyDMA cannot read flash.
+ *
+ * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the transaction transfers no data.
+ */
+int NRF52I2C::startTransaction(I2CTransaction &t)
+{
+    if (t.txSize == 0 && t.rxSize == 0)
+        return DEVICE_INVALID_PARAMETER;
+
+    t.next = NULL;
+    t.status = I2C_TRANSACTION_PENDING;
+
+    target_disable_irq();
+
+    if (queueTail)
+        queueTail->next = &t;
+    else
+        queueHead = &t;
+
+    queueTail = &t;
+
+    startNext();
+
+    target_enable_irq();
+
+    return DEVICE_OK;
+}
+
+/**
+ * Hands the oldest queued transaction to the hardware, unless the bus is busy.
+ * Called with interrupts disabled, or from our interrupt handler.
+ */
+void NRF52I2C::startNext()
+{
+    if (active || locked || queueHead == NULL)
+        return;
+
+    I2CTransaction *t = queueHead;
+
+    queueHead = t->next;
+    if (queueHead == NULL)
+        queueTail = NULL;
+
+    active = t;
+
+    nrf_twim_address_set(p_twim, t->address >> 1);
+
+    nrf_twim_event_clear(p_twim, NRF_TWIM_EVENT_STOPPED);
+    nrf_twim_event_clear(p_twim, NRF_TWIM_EVENT_ERROR);
+    nrf_twim_event_clear(p_twim, NRF_TWIM_EVENT_SUSPENDED);
+    nrf_twim_event_clear(p_twim, NRF_TWIM_EVENT_LASTTX);
+    nrf_twim_event_clear(p_twim, NRF_TWIM_EVENT_LASTRX);
+    nrf_twim_event_clear(p_twim, NRF_TWIM_EVENT_TXSTARTED);
+    nrf_twim_event_clear(p_twim, NRF_TWIM_EVENT_RXSTARTED);
+
+    nrf_twim_tx_buffer_set(p_twim, t->txBuffer, t->txSize);
+    nrf_twim_rx_buffer_set(p_twim, t->rxBuffer, t->rxSize);
+
+    // Let the hardware chain the write, the repeated START, the read and the STOP by itself.
+    if (t->txSize && t->rxSize)
+        nrf_twim_shorts_set(p_twim, NRF_TWIM_SHORT_LASTTX_STARTRX_MASK | NRF_TWIM_SHORT_LASTRX_STOP_MASK);
+    else if (t->txSize)
+        nrf_twim_shorts_set(p_twim, NRF_TWIM_SHORT_LASTTX_STOP_MASK);
+    else
+        nrf_twim_shorts_set(p_twim, NRF_TWIM_SHORT_LASTRX_STOP_MASK);
+
+    nrf_twim_int_enable(p_twim, NRF_TWIM_INT_STOPPED_MASK | NRF_TWIM_INT_ERROR_MASK);
+    nrf_twim_task_trigger(p_twim, t->txSize ? NRF_TWIM_TASK_STARTTX : NRF_TWIM_TASK_STARTRX);
+}
+
+/**
+ * Completes the active transaction once the hardware has stopped, and starts the next one.
+ */
+void NRF52I2C::_irqHandler(void *self_)
+{
+    NRF52I2C *self = (NRF52I2C *)self_;
+    NRF_TWIM_Type *p_twim = self->p_twim;
+    I2CTransaction *t = self->active;
+
+    if (nrf_twim_event_check(p_twim, NRF_TWIM_EVENT_ERROR))
+    {
+        auto err = p_twim->ERRORSRC;
+        p_twim->ERRORSRC = err;
+
+        // As in waitForStop(), release the bus. We complete the transaction once STOPPED is reported.
+        nrf_twim_event_clear(p_twim, NRF_TWIM_EVENT_ERROR);
+        nrf_twim_task_trigger(p_twim, NRF_TWIM_TASK_RESUME);
+        nrf_twim_task_trigger(p_twim, NRF_TWIM_TASK_STOP);
+
+        if (t)
+            t->status = DEVICE_I2C_ERROR;
+    }
+
+    if (nrf_twim_event_check(p_twim, NRF_TWIM_EVENT_STOPPED))
+    {
+        nrf_twim_event_clear(p_twim, NRF_TWIM_EVENT_STOPPED);
+
+        // Leave the peripheral as the blocking operations expect to find it.
+        nrf_twim_int_disable(p_twim, NRF_TWIM_INT_STOPPED_MASK | NRF_TWIM_INT_ERROR_MASK);
+        nrf_twim_shorts_set(p_twim, 0);
+
+        self->active = NULL;
+        self->startNext();
+
+        if (t)
+        {
+            if (t->status == I2C_TRANSACTION_PENDING)
+                t->status = DEVICE_OK;
+
+            if (t->doneHandler)
+                t->doneHandler(t);
+
+            // Drivers that poll the status of their transactions give them a handler that does nothing,
+            // so the event is only raised when somebody is listening for it.
+            if (t->doneHandler == NULL || self->waiting)
+                Event(DEVICE_ID_I2C, I2C_EVT_TRANSACTION_COMPLETE);
+        }
+    }
+}
+
+/**
+ * Waits for any transaction in progress to complete, and keeps further ones from starting.
+ */
+void NRF52I2C::lock()
+{
+    // A repeated START transfer keeps the bus locked between calls.
+    if (locked)
+        return;
+
+    target_disable_irq();
+
+    while (active)
+    {
+        // Sleep until our interrupt handler reports the transaction complete. We register for the event
+        // before enabling interrupts again, so it can't be missed. When the caller can't sleep, wait for
+        // the interrupt itself; in interrupt context, complete the transaction ourselves once the
+        // hardware has stopped, as our interrupt may not preempt the caller.
+        bool blocked = canSleep() && fiber_wake_on_event(DEVICE_ID_I2C, I2C_EVT_TRANSACTION_COMPLETE) == DEVICE_OK;
+        bool polling = !blocked && inInterrupt();
+        waiting++;
+
+        if (polling && (nrf_twim_event_check(p_twim, NRF_TWIM_EVENT_STOPPED) || nrf_twim_event_check(p_twim, NRF_TWIM_EVENT_ERROR)))
+            _irqHandler(this);
+
+        target_enable_irq();
+
+        if (blocked)
+            schedule();
+        else if (polling)
+            target_wait_us(1);
+        else
+            target_wait_for_event();
+
+        target_disable_irq();
+        waiting--;
+    }
+
+    locked = true;
+
+    target_enable_irq();
+}
+
+/**
+ * Releases the bus to queued transactions, unless a repeated START transfer is still open.
+ */
+void NRF52I2C::unlock(bool repeated)
+{
+    if (repeated)
+        return;
+
+    target_disable_irq();
+    locked = false;
+    startNext();
+    target_enable_irq();
+}
+
 /**
  * Define the minimum bus idle period for this I2C bus.
  * Thise controls the period of time the bus will remain idle between I2C transactions,
  * and also between subsequent write/read operations within a repeated START condition.
+ * Transactions queued with startTransaction() are not delayed.
  *
  * @param period The minimum bus idle period, in microseconds
  * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER
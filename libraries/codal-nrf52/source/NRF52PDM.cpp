@@ -119,6 +119,23 @@ ManagedBuffer NRF52PDM::pull()
     return outputBuffer;
 }
 
+/**
+ *  Determine the data format of the buffers streamed out of this component.
+ */
+int NRF52PDM::getFormat()
+{
+    return DATASTREAM_FORMAT_16BIT_SIGNED;
+}
+
+/**
+ * Determine the rate at which PCM samples are generated.
+ * @return the sample rate, in Hz.
+ */
+int NRF52PDM::getSampleRate()
+{
+    return sampleRate;
+}
+
 void NRF52PDM::irq()
 {
     if (NRF_PDM->EVENTS_STARTED) {
@@ -1,5 +1,7 @@
 #include "MicroBit.h"
 #include "Tests.h"
+#include "MotionWindow.h"
+#include "AccelerometerStream.h"
 
 void
 onCompassData(MicroBitEvent)
@@ -146,3 +148,38 @@ shake_test()
     }
 
 }
+
+void
+accelerometer_batch_test()
+{
+    // Half second slices at 50Hz, read from the FIFO 16 samples at a time.
+    uBit.accelerometer.setPeriod(20);
+    uBit.accelerometer.setBatchSize(16);
+
+    AccelerometerStream stream(uBit.accelerometer);
+    MotionWindow window(stream, 25, 4);
+    window.setScale(1.0f);
+
+    while(1)
+    {
+        while (window.getSlicesAvailable())
+        {
+            float sample[MOTION_WINDOW_AXES];
+            float sum[MOTION_WINDOW_AXES] = {0.0f, 0.0f, 0.0f};
+
+            for (int i = 0; i < window.getSliceSize(); i += MOTION_WINDOW_AXES)
+            {
+                window.getSliceData(i, MOTION_WINDOW_AXES, sample);
+                for (int a = 0; a < MOTION_WINDOW_AXES; a++)
+                    sum[a] += sample[a];
+            }
+
+            int n = window.getSliceSize() / MOTION_WINDOW_AXES;
+            DMESG("Slice mean [X:%d][Y:%d][Z:%d] overruns %d", (int)(sum[0] / n), (int)(sum[1] / n), (int)(sum[2] / n), (int)window.overruns);
+
+            window.releaseSlice();
+        }
+
+        uBit.sleep(100);
+    }
+}
@@ -0,0 +1,314 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdio.h>
+#include "ClipRecorder.h"
+#include "StreamNormalizer.h"
+
+/**
+ * Determines the file name of the clip with the given index.
+ */
+static void clip_name(char *name, int index)
+{
+    sprintf(name, "clip%d.raw", index);
+}
+
+/**
+ * Creates a clip recorder. Audio is passed downstream unchanged, while the most recent samples are kept
+ * in a ring. When frozen, the ring is written to the file system by a low priority fiber,
+ * so storing a clip never delays the components downstream.
+ *
+ * @param source a DataSource of 8 or 16 bit signed samples. 16 bit samples are stored as their top 8 bits.
+ * @param fileSystem the file system to store clips in.
+ * @param samples the number of samples to keep, i.e. the length of a clip.
+ * @param sampleRate the sample rate of the source, recorded in each clip.
+ */
+ClipRecorder::ClipRecorder(DataSource &source, MicroBitFileSystem &fileSystem, int samples, int sampleRate) : upstream(source), fileSystem(fileSystem), output(*this)
+{
+    this->ring = (int8_t *)malloc(samples);
+    this->ringSize = ring ? samples : 0;
+    this->ringHead = 0;
+    this->ringLength = 0;
+    this->frozen = false;
+    this->writeEvent = allocateNotifyEvent();
+    this->sampleRate = sampleRate;
+    this->clipsWritten = 0;
+
+    // Continue after the clips already stored, if there is space for more.
+    char name[MBFS_FILENAME_LENGTH];
+    this->nextClip = 0;
+
+    for (int i = 0; i < CLIP_RECORDER_MAX_CLIPS; i++)
+    {
+        clip_name(name, i);
+        int fd = fileSystem.open(name, MB_READ);
+
+        if (fd < 0)
+        {
+            nextClip = i;
+            break;
+        }
+
+        fileSystem.close(fd);
+    }
+
+    // Flash writes are slow: do them on a fiber that only runs when nothing else is runnable.
+    Fiber *f = create_fiber(ClipRecorder::writer, this);
+
+    if (f)
+        fiber_set_priority(f, DEVICE_FIBER_PRIORITY_LOW);
+
+    // Register with our upstream component
+    source.connect(*this);
+}
+
+/**
+ * Provide the next available ManagedBuffer to our downstream caller, if available.
+ */
+ManagedBuffer ClipRecorder::pull()
+{
+    return buffer;
+}
+
+/**
+ *  Determine the data format of the buffers streamed out of this component.
+ */
+int ClipRecorder::getFormat()
+{
+    return upstream.getFormat();
+}
+
+/**
+ * Callback provided when data is ready.
+ */
+int ClipRecorder::pullRequest()
+{
+    buffer = upstream.pull();
+
+    // Keep a copy of the samples, unless the ring is held for writing.
+    if (!frozen && ringSize)
+    {
+        int format = upstream.getFormat();
+        int bytesPerSample = DATASTREAM_FORMAT_BYTES_PER_SAMPLE(format);
+        int samples = buffer.length() / bytesPerSample;
+        uint8_t *data = &buffer[0];
+
+        if (bytesPerSample == 1)
+        {
+            // Only the most recent ringSize samples can be kept.
+            if (samples > ringSize)
+            {
+                data += samples - ringSize;
+                samples = ringSize;
+            }
+
+            int first = min(samples, ringSize - ringHead);
+
+            memcpy(ring + ringHead, data, first);
+            memcpy(ring, data + first, samples - first);
+
+            ringHead = (ringHead + samples) % ringSize;
+        }
+        else
+        {
+            for (int i = 0; i < samples; i++)
+            {
+                ring[ringHead] = StreamNormalizer::readSample[format](data) >> (8 * (bytesPerSample - 1));
+                ringHead = ringHead + 1 == ringSize ? 0 : ringHead + 1;
+                data += bytesPerSample;
+            }
+        }
+
+        ringLength = min(ringLength + samples, ringSize);
+    }
+
+    // Pass the buffer on, untouched.
+    output.pullRequest();
+
+    return DEVICE_OK;
+}
+
+/**
+ * Stops recording, and schedules the content of the ring to be written as a new clip.
+ * Recording resumes once the clip has been written.
+ *
+ * @param timestamp the time of the detection, in milliseconds.
+ * @param scores classifier scores in the range 0..1 to store with the clip.
+ * @param count the number of scores; only the first CLIP_RECORDER_MAX_SCORES are kept.
+ * @return DEVICE_OK on success, DEVICE_BUSY if the previous clip is still being written,
+ *         or DEVICE_NO_RESOURCES if no audio has been recorded.
+ */
+int ClipRecorder::freeze(uint32_t timestamp, const float *scores, int count)
+{
+    if (frozen)
+        return DEVICE_BUSY;
+
+    if (ringLength == 0)
+        return DEVICE_NO_RESOURCES;
+
+    frozen = true;
+
+    count = min(max(count, 0), CLIP_RECORDER_MAX_SCORES);
+
+    memset(&header, 0, sizeof(ClipHeader));
+    header.magic = CLIP_RECORDER_MAGIC;
+    header.version = CLIP_RECORDER_VERSION;
+    header.scoreCount = count;
+    header.sampleRate = sampleRate;
+    header.timestamp = timestamp;
+    header.sampleCount = ringLength;
+
+    for (int i = 0; i < count; i++)
+        header.scores[i] = (uint8_t)(min(max(scores[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+
+    Event(DEVICE_ID_NOTIFY, writeEvent);
+
+    return DEVICE_OK;
+}
+
+/**
+ * Determines whether a clip is waiting to be, or being, written.
+ */
+bool ClipRecorder::isWriting()
+{
+    return frozen;
+}
+
+/**
+ * Entry point of the writer fiber.
+ */
+void ClipRecorder::writer(void *recorder)
+{
+    ClipRecorder *r = (ClipRecorder *)recorder;
+
+    while (1)
+    {
+        // freeze() runs on another fiber, so there's no window between this test and the wait.
+        if (!r->frozen)
+            fiber_wait_for_event(DEVICE_ID_NOTIFY, r->writeEvent);
+
+        if (r->frozen)
+            r->writeClip();
+    }
+}
+
+/**
+ * Writes the frozen ring to the next clip file, a block at a time, yielding in between.
+ */
+void ClipRecorder::writeClip()
+{
+    char name[MBFS_FILENAME_LENGTH];
+    uint8_t chunk[CLIP_RECORDER_CHUNK_SIZE];
+
+    clip_name(name, nextClip);
+    fileSystem.remove(name);
+
+    int fd = fileSystem.open(name, MB_WRITE | MB_CREAT);
+
+    if (fd >= 0)
+    {
+        int start = (ringHead - ringLength + ringSize) % ringSize;
+        int remaining = ringLength;
+        int length = sizeof(ClipHeader);
+
+        // The header shares the first chunk with the oldest samples, so every write fills a whole, fresh block.
+        memcpy(chunk, &header, sizeof(ClipHeader));
+
+        while (length > 0 || remaining > 0)
+        {
+            while (length < CLIP_RECORDER_CHUNK_SIZE && remaining > 0)
+            {
+                int n = min(min(CLIP_RECORDER_CHUNK_SIZE - length, remaining), ringSize - start);
+
+                memcpy(chunk + length, ring + start, n);
+                start = (start + n) % ringSize;
+                remaining -= n;
+                length += n;
+            }
+
+            if (fileSystem.write(fd, chunk, length) != length)
+                break;
+
+            length = 0;
+
+            // Let anything more important run between blocks.
+            schedule();
+        }
+
+        fileSystem.close(fd);
+
+        nextClip = (nextClip + 1) % CLIP_RECORDER_MAX_CLIPS;
+        clipsWritten++;
+    }
+
+    // Start over with an empty ring, so the next clip doesn't repeat audio from this one.
+    ringLength = 0;
+    frozen = false;
+}
+
+/**
+ * Prints every stored clip over serial, as lines of "clip:<index>:<hex>".
+ * utils/clip2wav.py converts a log of these lines into WAV files.
+ *
+ * @param serial the serial port to print to.
+ * @return the number of clips printed.
+ */
+int ClipRecorder::dump(Serial &serial)
+{
+    char name[MBFS_FILENAME_LENGTH];
+    uint8_t data[CLIP_RECORDER_DUMP_LINE];
+    char line[2 * CLIP_RECORDER_DUMP_LINE + 1];
+    int clips = 0;
+
+    for (int i = 0; i < CLIP_RECORDER_MAX_CLIPS; i++)
+    {
+        clip_name(name, i);
+        int fd = fileSystem.open(name, MB_READ);
+
+        if (fd < 0)
+            continue;
+
+        int n;
+        while ((n = fileSystem.read(fd, data, CLIP_RECORDER_DUMP_LINE)) > 0)
+        {
+            for (int j = 0; j < n; j++)
+                sprintf(&line[2 * j], "%02x", data[j]);
+
+            serial.printf("clip:%d:%s\r\n", i, line);
+        }
+
+        fileSystem.close(fd);
+        clips++;
+    }
+
+    return clips;
+}
+
+/**
+ * Destructor.
+ */
+ClipRecorder::~ClipRecorder()
+{
+    free(ring);
+}
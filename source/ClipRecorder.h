@@ -0,0 +1,147 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "MicroBit.h"
+#include "CodalConfig.h"
+#include "DataStream.h"
+#include "MicroBitFileSystem.h"
+
+#ifndef CLIP_RECORDER_H_
+#define CLIP_RECORDER_H_
+
+/**
+ * Default configuration values
+ */
+#define CLIP_RECORDER_MAGIC             0x50494C43  // "CLIP", as stored little endian at the start of each clip.
+#define CLIP_RECORDER_VERSION           1
+#define CLIP_RECORDER_MAX_CLIPS         4           // Clips are stored as clip0.raw ... clip3.raw, overwriting the oldest.
+#define CLIP_RECORDER_MAX_SCORES        8           // Number of classifier scores kept in the header of a clip.
+#define CLIP_RECORDER_CHUNK_SIZE        MBFS_BLOCK_SIZE // Clips are written a file system block at a time.
+#define CLIP_RECORDER_DUMP_LINE         32          // Number of bytes per line when dumping clips over serial.
+
+/**
+ * The header stored at the start of every clip. It is followed by sampleCount signed 8 bit samples, oldest first.
+ */
+struct ClipHeader
+{
+    uint32_t        magic;                          // CLIP_RECORDER_MAGIC.
+    uint8_t         version;                        // CLIP_RECORDER_VERSION.
+    uint8_t         scoreCount;                     // Number of valid entries in scores.
+    uint16_t        sampleRate;                     // Sample rate of the audio, in Hz.
+    uint32_t        timestamp;                      // Time the clip was frozen, in milliseconds since power up.
+    uint32_t        sampleCount;                    // Number of samples following the header.
+    uint8_t         scores[CLIP_RECORDER_MAX_SCORES];   // Classifier scores at the time of the detection, quantized to 0..255.
+};
+
+class ClipRecorder : public DataSink, public DataSource
+{
+    DataSource          &upstream;          // The component producing data to process.
+    MicroBitFileSystem  &fileSystem;        // Where clips are stored.
+    ManagedBuffer       buffer;             // The buffer currently offered downstream.
+    int8_t              *ring;              // Ring of the most recent samples seen.
+    int                 ringSize;           // Capacity of the ring, in samples.
+    int                 ringHead;           // Next write position in the ring.
+    int                 ringLength;         // Number of valid samples in the ring.
+    volatile bool       frozen;             // True while the ring is held for writing.
+    ClipHeader          header;             // Header of the clip being written.
+    uint16_t            writeEvent;         // Notify event code used to wake up the writer fiber.
+    int                 nextClip;           // Index of the next clip file to write.
+
+    public:
+    uint16_t            sampleRate;         // Sample rate recorded in the header of each clip.
+    uint32_t            clipsWritten;       // Number of clips written since power up.
+    DataStream          output;             // The downstream output stream of this recorder.
+
+    /**
+     * Creates a clip recorder. Audio is passed downstream unchanged, while the most recent samples are kept
+     * in a ring. When frozen, the ring is written to the file system by a low priority fiber,
+     * so storing a clip never delays the components downstream.
+     *
+     * @param source a DataSource of 8 or 16 bit signed samples. 16 bit samples are stored as their top 8 bits.
+     * @param fileSystem the file system to store clips in.
+     * @param samples the number of samples to keep, i.e. the length of a clip.
+     * @param sampleRate the sample rate of the source, recorded in each clip.
+     */
+    ClipRecorder(DataSource &source, MicroBitFileSystem &fileSystem, int samples, int sampleRate);
+
+    /**
+     * Callback provided when data is ready.
+     */
+    virtual int pullRequest();
+
+    /**
+     * Provide the next available ManagedBuffer to our downstream caller, if available.
+     */
+    virtual ManagedBuffer pull();
+
+    /**
+     *  Determine the data format of the buffers streamed out of this component.
+     */
+    virtual int getFormat();
+
+    /**
+     * Stops recording, and schedules the content of the ring to be written as a new clip.
+     * Recording resumes once the clip has been written.
+     *
+     * @param timestamp the time of the detection, in milliseconds.
+     * @param scores classifier scores in the range 0..1 to store with the clip.
+     * @param count the number of scores; only the first CLIP_RECORDER_MAX_SCORES are kept.
+     * @return DEVICE_OK on success, DEVICE_BUSY if the previous clip is still being written,
+     *         or DEVICE_NO_RESOURCES if no audio has been recorded.
+     */
+    int freeze(uint32_t timestamp, const float *scores, int count);
+
+    /**
+     * Determines whether a clip is waiting to be, or being, written.
+     */
+    bool isWriting();
+
+    /**
+     * Prints every stored clip over serial, as lines of "clip:<index>:<hex>".
+     * utils/clip2wav.py converts a log of these lines into WAV files.
+     *
+     * @param serial the serial port to print to.
+     * @return the number of clips printed.
+     */
+    int dump(Serial &serial);
+
+    /**
+     * Destructor.
+     */
+    ~ClipRecorder();
+
+    private:
+
+    /**
+     * Writes the frozen ring to the next clip file, a block at a time, yielding in between.
+     */
+    void writeClip();
+
+    /**
+     * Entry point of the writer fiber.
+     */
+    static void writer(void *recorder);
+};
+
+#endif
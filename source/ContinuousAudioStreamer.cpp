@@ -71,6 +71,43 @@ ManagedBuffer ContinuousAudioStreamer::getLastBuffer()
     return lastBuffer;
 }
 
+/**
+ * Determines the number of complete slices that were not released yet.
+ */
+int ContinuousAudioStreamer::getSlicesAvailable()
+{
+    return _inference->buf_ready;
+}
+
+/**
+ * Provides the oldest slice that was not released, to run through the classifier.
+ * @return the n_samples of the slice, or NULL if no slice is available.
+ */
+int8_t *ContinuousAudioStreamer::getSlice()
+{
+    if (_inference->buf_ready == 0)
+        return NULL;
+
+    return _inference->buffers[_inference->buf_read];
+}
+
+/**
+ * Releases the oldest slice, once it has been classified.
+ */
+void ContinuousAudioStreamer::releaseSlice()
+{
+    // Slices are queued from the audio interrupt.
+    target_disable_irq();
+
+    if (_inference->buf_ready > 0)
+    {
+        _inference->buf_read = (_inference->buf_read + 1) % _inference->n_buffers;
+        _inference->buf_ready--;
+    }
+
+    target_enable_irq();
+}
+
 /**
  * Callback provided when data is ready.
  */
@@ -93,15 +130,19 @@ void ContinuousAudioStreamer::streamBuffer(ManagedBuffer buffer)
         _inference->buffers[_inference->buf_select][_inference->buf_count++] = data;
 
         if (_inference->buf_count >= _inference->n_samples) {
-            if (_inference->buf_ready == 1) {
-                // uBit.serial.printf(
-                //     "Error sample buffer overrun. Decrease the number of slices per model window "
-                //     "(EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW)\n");
-            }
-
-            _inference->buf_select ^= 1;
+            // The slice is complete. Queue it, and move on to the next slot. A burst of audio (such as the
+            // pre-roll of a VoiceActivityGate) is kept in order, rather than overwriting the slice before the
+            // classifier got to it. When the ring is full, the next slot is the one being classified, so this
+            // slice is dropped instead, and its slot filled again.
             _inference->buf_count = 0;
-            _inference->buf_ready = 1;
+
+            if (_inference->buf_ready >= _inference->n_buffers - 1) {
+                _inference->overruns++;
+            }
+            else {
+                _inference->buf_select = (_inference->buf_select + 1) % _inference->n_buffers;
+                _inference->buf_ready++;
+            }
 
             // uBit.serial.printf("IRQ Counter: %d (buf length = %d), %d\n", irq_counter,
             //     static_cast<int>(buffer.length()), system_timer_current_time() - last_print);
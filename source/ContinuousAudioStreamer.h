@@ -30,11 +30,14 @@ DEALINGS IN THE SOFTWARE.
 #define CONTINUOUS_AUDIO_STREAMER_H_
 
 typedef struct {
-    int8_t *buffers[2];
-    int8_t buf_select;
-    bool buf_ready;
-    unsigned int buf_count;
-    unsigned int n_samples;
+    int8_t **buffers;                   // Ring of n_buffers slices.
+    unsigned int n_buffers;             // Number of slots in the ring, at least 2.
+    unsigned int buf_select;            // Slot of the slice being filled.
+    unsigned int buf_read;              // Slot of the oldest complete slice that was not released.
+    volatile unsigned int buf_ready;    // Number of complete slices that were not released.
+    unsigned int buf_count;             // Number of samples already stored in the slice being filled.
+    unsigned int n_samples;             // Number of samples in a slice.
+    unsigned int overruns;              // Number of new slices dropped because the ring was full.
 } inference_t;
 
 class ContinuousAudioStreamer : public DataSink
@@ -67,6 +70,22 @@ class ContinuousAudioStreamer : public DataSink
      * returns the last buffer processed by this component
      */
     ManagedBuffer getLastBuffer();
+
+    /**
+     * Determines the number of complete slices that were not released yet.
+     */
+    int getSlicesAvailable();
+
+    /**
+     * Provides the oldest slice that was not released, to run through the classifier.
+     * @return the n_samples of the slice, or NULL if no slice is available.
+     */
+    int8_t *getSlice();
+
+    /**
+     * Releases the oldest slice, once it has been classified.
+     */
+    void releaseSlice();
 };
 
 #endif
@@ -0,0 +1,151 @@
+#include "MicroBit.h"
+#include "Tests.h"
+
+// Number of times each fiber yields, and the stack each fiber keeps live while it does
+#define FIBER_SWITCH_COUNT          1000
+#define FIBER_SWITCH_STACK_DEPTH    1024
+#define FIBER_SWITCH_STACK_SIZE     (FIBER_SWITCH_STACK_DEPTH + 1024)
+
+static volatile int fiber_switch_done = 0;
+static CODAL_TIMESTAMP fiber_switch_time = 0;
+static int fiber_switch_high_water = 0;
+
+static void fiber_switch_worker()
+{
+    volatile uint8_t stack[FIBER_SWITCH_STACK_DEPTH];
+
+    for (int i = 0; i < FIBER_SWITCH_STACK_DEPTH; i++)
+        stack[i] = i;
+
+    CODAL_TIMESTAMP start = system_timer_current_time_us();
+
+    for (int i = 0; i < FIBER_SWITCH_COUNT; i++)
+        schedule();
+
+    fiber_switch_time += system_timer_current_time_us() - start;
+    fiber_switch_high_water = max(fiber_switch_high_water, fiber_stack_high_water(currentFiber));
+    fiber_switch_done++;
+}
+
+static void fiber_switch_run(int dedicated)
+{
+    fiber_switch_done = 0;
+    fiber_switch_time = 0;
+    fiber_switch_high_water = 0;
+
+    for (int i = 0; i < 2; i++)
+    {
+        Fiber *f = dedicated ? create_dedicated_fiber(fiber_switch_worker, FIBER_SWITCH_STACK_SIZE) : create_fiber(fiber_switch_worker);
+
+        // Don't wait for a worker that couldn't be created.
+        if (f == NULL)
+            fiber_switch_done++;
+    }
+
+    // Let the workers run to completion, yielding to each other.
+    while (fiber_switch_done < 2)
+        uBit.sleep(10);
+
+    // Each worker measures the time it takes for both fibers to run FIBER_SWITCH_COUNT times.
+    DMESG("%s stacks: %d ns per context switch, high water %d bytes",
+        dedicated ? "dedicated" : "paged",
+        (int)(fiber_switch_time * 1000 / (4 * FIBER_SWITCH_COUNT)),
+        fiber_switch_high_water);
+}
+
+/**
+ * Measures the cost of a context switch between two fibers with a deep stack,
+ * with and without dedicated stacks.
+ */
+void fiber_switch_test()
+{
+    fiber_switch_run(0);
+    fiber_switch_run(1);
+}
+
+/**
+ * Reports how often the processor wakes up from idle, and for how long it sleeps,
+ * while the only fiber sleeps for increasingly long periods.
+ */
+void scheduler_idle_test()
+{
+    uint32_t wakeups;
+    CODAL_TIMESTAMP sleepTime;
+    CODAL_TIMESTAMP period;
+
+    for (int t = 1; t <= 1000; t *= 10)
+    {
+        scheduler_get_idle_statistics(&wakeups, &sleepTime, &period);
+
+        for (int i = 0; i < 2000 / t; i++)
+            uBit.sleep(t);
+
+        scheduler_get_idle_statistics(&wakeups, &sleepTime, &period);
+
+        DMESG("sleep(%d): %d wakeups/s, %d us average sleep", t,
+            (int)((CODAL_TIMESTAMP)wakeups * 1000000 / period),
+            wakeups ? (int)(sleepTime / wakeups) : 0);
+    }
+}
+
+// Background load: fibers that compute for a while, then yield
+#define FIBER_LOAD_FIBERS           4
+#define FIBER_LOAD_CHUNK_US         2000
+#define FIBER_LATENCY_SAMPLES       200
+#define FIBER_LATENCY_PERIOD_MS     10
+
+static volatile int fiber_load_running = 0;
+
+static void fiber_load_worker()
+{
+    while (fiber_load_running)
+    {
+        target_wait_us(FIBER_LOAD_CHUNK_US);
+        schedule();
+    }
+}
+
+static void fiber_latency_run(int priority)
+{
+    CODAL_TIMESTAMP worst = 0;
+    CODAL_TIMESTAMP total = 0;
+
+    fiber_load_running = 1;
+
+    for (int i = 0; i < FIBER_LOAD_FIBERS; i++)
+        create_fiber(fiber_load_worker);
+
+    fiber_set_priority(currentFiber, priority);
+
+    for (int i = 0; i < FIBER_LATENCY_SAMPLES; i++)
+    {
+        uBit.sleep(FIBER_LATENCY_PERIOD_MS);
+
+        // The fiber was due back on the millisecond held in its context (as a wrapping 32 bit time), and the
+        // scheduler arms its wake up for exactly that time, so anything past it is latency.
+        CODAL_TIMESTAMP now = system_timer_current_time_us();
+        CODAL_TIMESTAMP nowMs = now / 1000;
+        CODAL_TIMESTAMP deadline = (nowMs - (int32_t)((uint32_t)nowMs - currentFiber->context)) * 1000;
+        CODAL_TIMESTAMP late = now > deadline ? now - deadline : 0;
+
+        worst = max(worst, late);
+        total += late;
+    }
+
+    fiber_set_priority(currentFiber, DEVICE_FIBER_PRIORITY_NORMAL);
+    fiber_load_running = 0;
+    uBit.sleep(100);
+
+    DMESG("priority %d: %d us average, %d us worst wake up latency", priority,
+        (int)(total / FIBER_LATENCY_SAMPLES), (int)worst);
+}
+
+/**
+ * Measures how late a periodic fiber wakes up under background load, when it runs at the same
+ * priority as the load and when it runs at a higher priority.
+ */
+void fiber_priority_test()
+{
+    fiber_latency_run(DEVICE_FIBER_PRIORITY_NORMAL);
+    fiber_latency_run(DEVICE_FIBER_PRIORITY_HIGH);
+}
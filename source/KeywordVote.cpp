@@ -0,0 +1,393 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string.h>
+#include "KeywordVote.h"
+
+/**
+ * Creates a loopback transport that is not connected to any other.
+ */
+LoopbackVoteTransport::LoopbackVoteTransport()
+{
+    this->peer = this;
+    this->head = 0;
+    this->count = 0;
+    this->dropped = 0;
+    this->connected = true;
+}
+
+/**
+ * Connects this transport to the bus another transport is on.
+ */
+void LoopbackVoteTransport::join(LoopbackVoteTransport &other)
+{
+    // Splice ourselves into the circular list, just after the other transport.
+    LoopbackVoteTransport *p = this;
+    while (p->peer != this)
+        p = p->peer;
+
+    p->peer = peer;
+    peer = other.peer;
+    other.peer = this;
+}
+
+/**
+ * Broadcasts a packet to all other transports on the bus.
+ */
+int LoopbackVoteTransport::send(const uint8_t *data, int length)
+{
+    if (data == NULL || length < 0 || length > KEYWORD_VOTE_PACKET_SIZE)
+        return -1;
+
+    if (!connected)
+        return length;
+
+    for (LoopbackVoteTransport *p = peer; p != this; p = p->peer)
+    {
+        if (!p->connected)
+            continue;
+
+        if (p->count >= KEYWORD_VOTE_LOOPBACK_DEPTH)
+        {
+            p->dropped++;
+            continue;
+        }
+
+        uint8_t *slot = p->inbox[(p->head + p->count) % KEYWORD_VOTE_LOOPBACK_DEPTH];
+        memset(slot, 0, KEYWORD_VOTE_PACKET_SIZE);
+        memcpy(slot, data, length);
+        p->count++;
+    }
+
+    return length;
+}
+
+/**
+ * Retrieves the oldest packet delivered to this transport.
+ */
+int LoopbackVoteTransport::recv(uint8_t *data, int length)
+{
+    if (count == 0 || data == NULL)
+        return 0;
+
+    int l = length < KEYWORD_VOTE_PACKET_SIZE ? length : KEYWORD_VOTE_PACKET_SIZE;
+    memcpy(data, inbox[head], l);
+
+    head = (head + 1) % KEYWORD_VOTE_LOOPBACK_DEPTH;
+    count--;
+
+    return l;
+}
+
+/**
+ * Creates a fusion component.
+ * @param transport the medium to exchange votes over.
+ * @param id an identifier of this node, unique amongst its neighbours.
+ */
+KeywordVote::KeywordVote(KeywordVoteTransport &transport, uint16_t id) : transport(transport)
+{
+    this->window = KEYWORD_VOTE_DEFAULT_WINDOW;
+    this->quorum = KEYWORD_VOTE_DEFAULT_QUORUM;
+    this->threshold = KEYWORD_VOTE_DEFAULT_THRESHOLD;
+    this->lifetime = KEYWORD_VOTE_DEFAULT_LIFETIME;
+    this->heartbeatPeriod = KEYWORD_VOTE_DEFAULT_HEARTBEAT;
+
+    memset(nodes, 0, sizeof(nodes));
+    nodes[0].id = id;
+
+    reset();
+}
+
+/**
+ * Converts a score in the range 0..1 to the representation used on the air.
+ */
+uint8_t KeywordVote::quantize(float score)
+{
+    if (!(score > 0.0f))
+        return 0;
+
+    if (score >= 1.0f)
+        return 255;
+
+    return (uint8_t)(score * 255.0f + 0.5f);
+}
+
+/**
+ * Encodes a vote into a buffer of at least KEYWORD_VOTE_PACKET_SIZE bytes.
+ */
+void KeywordVote::encode(const KeywordVotePacket &packet, uint8_t *data)
+{
+    data[0] = KEYWORD_VOTE_PACKET_MAGIC;
+    data[1] = packet.node & 0xff;
+    data[2] = packet.node >> 8;
+    data[3] = packet.timestamp & 0xff;
+    data[4] = (packet.timestamp >> 8) & 0xff;
+    data[5] = (packet.timestamp >> 16) & 0xff;
+    data[6] = packet.timestamp >> 24;
+    data[7] = packet.score;
+}
+
+/**
+ * Decodes a vote.
+ * @return false if the data is not a vote packet.
+ */
+bool KeywordVote::decode(const uint8_t *data, int length, KeywordVotePacket &packet)
+{
+    if (length != KEYWORD_VOTE_PACKET_SIZE || data[0] != KEYWORD_VOTE_PACKET_MAGIC)
+        return false;
+
+    packet.node = data[1] | (data[2] << 8);
+    packet.timestamp = (uint32_t)data[3] | ((uint32_t)data[4] << 8) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 24);
+    packet.score = data[7];
+
+    return true;
+}
+
+/**
+ * Records the score of a slice we classified, and broadcasts it to our neighbours.
+ * @param now the local time the slice was classified, in milliseconds.
+ * @param score the keyword score in the range 0..1.
+ * @return the result of the transport's send().
+ */
+int KeywordVote::publish(uint32_t now, float score)
+{
+    uint8_t q = quantize(score);
+
+    nodes[0].lastTimestamp = now;
+    nodes[0].lastSeen = now;
+    record(nodes[0], now, q);
+
+    return broadcast(now, q);
+}
+
+/**
+ * Tells our neighbours we are still there, if we haven't broadcast anything for heartbeatPeriod.
+ * @param now the local time, in milliseconds.
+ * @return the result of the transport's send(), or 0 if no heartbeat was due.
+ */
+int KeywordVote::heartbeat(uint32_t now)
+{
+    if (sent && now - lastSent < heartbeatPeriod)
+        return 0;
+
+    // A zero score keeps us alive on our neighbours without ever counting as a vote.
+    nodes[0].lastSeen = now;
+
+    return broadcast(now, 0);
+}
+
+/**
+ * Broadcasts a packet with our identifier and the given time and score.
+ */
+int KeywordVote::broadcast(uint32_t now, uint8_t score)
+{
+    KeywordVotePacket packet;
+    uint8_t data[KEYWORD_VOTE_PACKET_SIZE];
+
+    packet.node = nodes[0].id;
+    packet.timestamp = now;
+    packet.score = score;
+
+    sent = true;
+    lastSent = now;
+
+    encode(packet, data);
+    return transport.send(data, KEYWORD_VOTE_PACKET_SIZE);
+}
+
+/**
+ * Takes all pending votes from the transport.
+ * @param now the local time, in milliseconds.
+ * @return the number of votes accepted.
+ */
+int KeywordVote::poll(uint32_t now)
+{
+    uint8_t data[KEYWORD_VOTE_PACKET_SIZE];
+    KeywordVotePacket packet;
+    int accepted = 0;
+    int length;
+
+    while ((length = transport.recv(data, KEYWORD_VOTE_PACKET_SIZE)) > 0)
+    {
+        if (!decode(data, length, packet) || packet.node == nodes[0].id)
+            continue;
+
+        Node &n = lookup(packet.node, now);
+        int32_t sample = (int32_t)(now - packet.timestamp);
+
+        if (!n.used)
+        {
+            n.used = true;
+            n.offset = sample;
+        }
+        else
+        {
+            // Drop duplicated and reordered packets.
+            if ((int32_t)(packet.timestamp - n.lastTimestamp) <= 0)
+                continue;
+
+            // The smallest difference has the least transmission delay in it. Let the estimate
+            // creep up by a millisecond per packet, so it follows a clock slower than ours.
+            if (sample < n.offset)
+                n.offset = sample;
+            else if (n.offset < sample)
+                n.offset++;
+        }
+
+        n.lastTimestamp = packet.timestamp;
+        n.lastSeen = now;
+        record(n, packet.timestamp + n.offset, packet.score);
+
+        accepted++;
+    }
+
+    return accepted;
+}
+
+/**
+ * Records a vote of a node, whose clock was converted to ours.
+ */
+void KeywordVote::record(Node &n, uint32_t localTime, uint8_t score)
+{
+    n.score = score;
+
+    if (score >= threshold)
+    {
+        n.lastVote = localTime;
+        n.voted = true;
+    }
+}
+
+/**
+ * Determines the number of nodes (including ourselves) that heard the keyword within a window of the given time.
+ */
+int KeywordVote::getVotes(uint32_t now)
+{
+    int votes = 0;
+
+    for (int i = 0; i < KEYWORD_VOTE_MAX_NODES; i++)
+    {
+        if (!nodes[i].used || !nodes[i].voted)
+            continue;
+
+        int32_t age = (int32_t)(now - nodes[i].lastVote);
+
+        // Clock offset estimates may place a vote slightly in our future.
+        if (age < 0)
+            age = -age;
+
+        if ((uint32_t)age <= window)
+            votes++;
+    }
+
+    return votes;
+}
+
+/**
+ * Determines the number of nodes (including ourselves) that were heard from recently.
+ */
+int KeywordVote::getAliveNodes(uint32_t now)
+{
+    int alive = 1;
+
+    for (int i = 1; i < KEYWORD_VOTE_MAX_NODES; i++)
+        if (nodes[i].used && now - nodes[i].lastSeen <= lifetime)
+            alive++;
+
+    return alive;
+}
+
+/**
+ * Determines whether enough nodes heard the keyword around the given time. Each utterance is
+ * reported once: the next one is only reported after the number of agreeing nodes dropped below the quorum.
+ * @param now the local time, in milliseconds.
+ * @return true if a quorum was reached for a new utterance.
+ */
+bool KeywordVote::decide(uint32_t now)
+{
+    // Don't wait for neighbours that are out of range; a node on its own decides by itself.
+    int required = getAliveNodes(now);
+
+    if (quorum < required)
+        required = quorum;
+
+    if (getVotes(now) < required)
+    {
+        armed = true;
+        return false;
+    }
+
+    if (!armed)
+        return false;
+
+    armed = false;
+    return true;
+}
+
+/**
+ * Forgets about all neighbours and votes.
+ */
+void KeywordVote::reset()
+{
+    uint16_t id = nodes[0].id;
+
+    memset(nodes, 0, sizeof(nodes));
+    nodes[0].id = id;
+    nodes[0].used = true;
+
+    armed = true;
+    sent = false;
+    lastSent = 0;
+}
+
+/**
+ * Finds the entry of a neighbour, allocating one (and evicting the longest silent neighbour if needed).
+ */
+KeywordVote::Node &KeywordVote::lookup(uint16_t id, uint32_t now)
+{
+    Node *victim = NULL;
+
+    for (int i = 1; i < KEYWORD_VOTE_MAX_NODES; i++)
+    {
+        Node &n = nodes[i];
+
+        if (n.used && n.id == id)
+            return n;
+
+        if (!n.used)
+        {
+            if (victim == NULL || victim->used)
+                victim = &n;
+        }
+        else if (victim == NULL || (victim->used && now - n.lastSeen > now - victim->lastSeen))
+        {
+            victim = &n;
+        }
+    }
+
+    memset(victim, 0, sizeof(Node));
+    victim->id = id;
+
+    return *victim;
+}
@@ -0,0 +1,231 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdint.h>
+
+#ifndef KEYWORD_VOTE_H_
+#define KEYWORD_VOTE_H_
+
+/**
+ * Default configuration values
+ */
+#define KEYWORD_VOTE_MAX_NODES          8       // Number of nodes (including ourselves) we keep track of.
+#define KEYWORD_VOTE_DEFAULT_WINDOW     600     // Detections this many milliseconds apart belong to the same utterance...
+#define KEYWORD_VOTE_DEFAULT_QUORUM     2       // ...and this many nodes have to agree on it...
+#define KEYWORD_VOTE_DEFAULT_THRESHOLD  179     // ...each with at least this quantized score (0.7).
+#define KEYWORD_VOTE_DEFAULT_LIFETIME   5000    // Nodes not heard from for this many milliseconds don't count towards the quorum.
+#define KEYWORD_VOTE_DEFAULT_HEARTBEAT  1000    // Nodes that haven't voted for this many milliseconds announce they are still there.
+
+#define KEYWORD_VOTE_PACKET_MAGIC       0x4B    // First byte of every vote packet, to ignore unrelated datagrams.
+#define KEYWORD_VOTE_PACKET_SIZE        8       // Size of an encoded vote packet, in bytes.
+#define KEYWORD_VOTE_LOOPBACK_DEPTH     16      // Number of packets a loopback transport can hold before dropping.
+
+/**
+ * A vote, as broadcast by every node after classifying a slice.
+ * On the air this is encoded as: magic (1), node (2), timestamp (4), score (1), all little endian.
+ */
+struct KeywordVotePacket
+{
+    uint16_t        node;               // Identifier of the sending node.
+    uint32_t        timestamp;          // Time the slice was classified, in milliseconds of the sender's clock.
+    uint8_t         score;              // Keyword score, quantized to 0..255.
+};
+
+/**
+ * The medium votes are exchanged over. Implementations exist for the radio and for a host loopback,
+ * so the fusion logic can be exercised without hardware.
+ */
+class KeywordVoteTransport
+{
+    public:
+
+    /**
+     * Broadcasts a packet to all other nodes.
+     * @return the number of bytes sent, or a negative value on error.
+     */
+    virtual int send(const uint8_t *data, int length) = 0;
+
+    /**
+     * Retrieves the next packet received, if any.
+     * @return the number of bytes stored in data, or a value <= 0 if nothing is pending.
+     */
+    virtual int recv(uint8_t *data, int length) = 0;
+
+    virtual ~KeywordVoteTransport() {}
+};
+
+/**
+ * An in-memory transport. Every packet sent is delivered to all other loopback transports
+ * joined to the same bus, which lets a single process simulate a room full of nodes.
+ */
+class LoopbackVoteTransport : public KeywordVoteTransport
+{
+    LoopbackVoteTransport   *peer;      // Next transport on the bus; the bus is a circular list.
+    uint8_t                 inbox[KEYWORD_VOTE_LOOPBACK_DEPTH][KEYWORD_VOTE_PACKET_SIZE];
+    int                     head;       // Index of the oldest pending packet.
+    int                     count;      // Number of pending packets.
+
+    public:
+    uint32_t                dropped;    // Number of packets lost because the inbox was full.
+    bool                    connected;  // Packets are neither sent nor received while false, to simulate a node out of range.
+
+    /**
+     * Creates a loopback transport that is not connected to any other.
+     */
+    LoopbackVoteTransport();
+
+    /**
+     * Connects this transport to the bus another transport is on.
+     */
+    void join(LoopbackVoteTransport &other);
+
+    virtual int send(const uint8_t *data, int length);
+    virtual int recv(uint8_t *data, int length);
+};
+
+/**
+ * Fuses the keyword scores of neighbouring nodes. A detection is only reported when a quorum of the
+ * nodes that are currently alive heard the keyword within one time window, which rejects most of the
+ * false accepts a single node makes on its own.
+ *
+ * Nodes don't share a clock. The offset of every neighbour's clock against ours is estimated from the
+ * smallest (arrival - timestamp) difference seen, so slice timestamps can be compared to our own.
+ */
+class KeywordVote
+{
+    struct Node
+    {
+        uint16_t    id;                 // Node identifier.
+        bool        used;               // True if this entry is in use.
+        bool        voted;              // True if the node has ever reached the threshold.
+        int32_t     offset;             // Estimated offset to convert the node's timestamps to our clock.
+        uint32_t    lastTimestamp;      // Latest slice timestamp of the node, on its own clock.
+        uint32_t    lastSeen;           // Local time of the latest packet from the node.
+        uint32_t    lastVote;           // Local time of the latest slice at or above the threshold.
+        uint8_t     score;              // Latest score of the node.
+    };
+
+    KeywordVoteTransport    &transport;
+    Node                    nodes[KEYWORD_VOTE_MAX_NODES];  // Entry 0 holds our own votes.
+    bool                    armed;      // True if the next quorum may be reported.
+    bool                    sent;       // True if we broadcast a packet since the last reset.
+    uint32_t                lastSent;   // Local time of the latest packet we broadcast.
+
+    public:
+    uint32_t    window;                 // See KEYWORD_VOTE_DEFAULT_WINDOW.
+    int         quorum;                 // See KEYWORD_VOTE_DEFAULT_QUORUM.
+    uint8_t     threshold;              // See KEYWORD_VOTE_DEFAULT_THRESHOLD.
+    uint32_t    lifetime;               // See KEYWORD_VOTE_DEFAULT_LIFETIME.
+    uint32_t    heartbeatPeriod;        // See KEYWORD_VOTE_DEFAULT_HEARTBEAT.
+
+    /**
+     * Creates a fusion component.
+     * @param transport the medium to exchange votes over.
+     * @param id an identifier of this node, unique amongst its neighbours.
+     */
+    KeywordVote(KeywordVoteTransport &transport, uint16_t id);
+
+    /**
+     * Records the score of a slice we classified, and broadcasts it to our neighbours.
+     * @param now the local time the slice was classified, in milliseconds.
+     * @param score the keyword score in the range 0..1.
+     * @return the result of the transport's send().
+     */
+    int publish(uint32_t now, float score);
+
+    /**
+     * Tells our neighbours we are still there, if we haven't broadcast anything for heartbeatPeriod.
+     * Call this regularly, whether or not slices are being classified: while a voice activity gate
+     * holds the classifier back, no votes are published, and neighbours would otherwise expire us
+     * and lower the quorum they require.
+     * @param now the local time, in milliseconds.
+     * @return the result of the transport's send(), or 0 if no heartbeat was due.
+     */
+    int heartbeat(uint32_t now);
+
+    /**
+     * Takes all pending votes from the transport.
+     * @param now the local time, in milliseconds.
+     * @return the number of votes accepted.
+     */
+    int poll(uint32_t now);
+
+    /**
+     * Determines whether enough nodes heard the keyword around the given time. Each utterance is
+     * reported once: the next one is only reported after the number of agreeing nodes dropped below the quorum.
+     * @param now the local time, in milliseconds.
+     * @return true if a quorum was reached for a new utterance.
+     */
+    bool decide(uint32_t now);
+
+    /**
+     * Determines the number of nodes (including ourselves) that heard the keyword within a window of the given time.
+     */
+    int getVotes(uint32_t now);
+
+    /**
+     * Determines the number of nodes (including ourselves) that were heard from recently.
+     */
+    int getAliveNodes(uint32_t now);
+
+    /**
+     * Forgets about all neighbours and votes.
+     */
+    void reset();
+
+    /**
+     * Converts a score in the range 0..1 to the representation used on the air.
+     */
+    static uint8_t quantize(float score);
+
+    /**
+     * Encodes a vote into a buffer of at least KEYWORD_VOTE_PACKET_SIZE bytes.
+     */
+    static void encode(const KeywordVotePacket &packet, uint8_t *data);
+
+    /**
+     * Decodes a vote.
+     * @return false if the data is not a vote packet.
+     */
+    static bool decode(const uint8_t *data, int length, KeywordVotePacket &packet);
+
+    private:
+
+    /**
+     * Broadcasts a packet with our identifier and the given time and score.
+     */
+    int broadcast(uint32_t now, uint8_t score);
+
+    /**
+     * Records a vote of a node, whose clock was converted to ours.
+     */
+    void record(Node &n, uint32_t localTime, uint8_t score);
+
+    /**
+     * Finds the entry of a neighbour, allocating one (and evicting the longest silent neighbour if needed).
+     */
+    Node &lookup(uint16_t id, uint32_t now);
+};
+
+#endif
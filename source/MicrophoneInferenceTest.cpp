@@ -25,17 +25,82 @@ DEALINGS IN THE SOFTWARE.
 #include "MicroBit.h"
 #include "ContinuousAudioStreamer.h"
 #include "StreamNormalizer.h"
+#include "NRF52PDM.h"
+#include "PDMDecimator.h"
+#include "VoiceActivityGate.h"
+#include "RadioVoteTransport.h"
+#include "ClipRecorder.h"
 #include "Tests.h"
 #include "edge-impulse-sdk/classifier/ei_run_classifier.h"
 #include "edge-impulse-sdk/dsp/numpy.hpp"
+#include "ei_float_format.h"
 
 #define INFERENCING_KEYWORD     "microbit"
 
+// Posterior smoothing and trigger parameters for the keyword
+#define KEYWORD_SMOOTHING           EI_CLASSIFIER_DECISION_SMOOTH_NONE
+#define KEYWORD_EMA_ALPHA           0.5f
+#define KEYWORD_WINDOW              2
+#define KEYWORD_TRIGGER_THRESHOLD   0.7f
+#define KEYWORD_RELEASE_THRESHOLD   0.5f
+#define KEYWORD_REFRACTORY_SLICES   0
+
+// Number of slices the happy face stays up after a detection
+#define KEYWORD_DISPLAY_SLICES      4
+
+// Only wake the classifier when speech-like audio is present. The gate keeps all but one slice
+// of the model window as pre-roll, and stays open for a full window after activity stops.
+#define KEYWORD_VAD_ENABLED         1
+#define KEYWORD_VAD_PRE_ROLL        (EI_CLASSIFIER_SLICE_SIZE * (EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW - 1))
+#define KEYWORD_VAD_HANGOVER        EI_CLASSIFIER_RAW_SAMPLE_COUNT
+
+// Slices queued for the classifier: the whole pre-roll, the slice being filled, and one to spare
+#define KEYWORD_SLICE_BUFFERS       (EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW + 1)
+
+// Run inference on its own stack, so yielding to the audio pipeline doesn't page the (deep) DSP stack.
+// The stack also has to hold interrupt handlers; its high water mark is printed with every prediction.
+#define KEYWORD_DEDICATED_STACK     1
+#define KEYWORD_STACK_SIZE          6144
+
+// Share scores with other micro:bits in the room over the radio, and only report the keyword
+// when a quorum of them heard it. A micro:bit without neighbours still decides on its own.
+#define KEYWORD_VOTE_ENABLED        0
+#define KEYWORD_VOTE_GROUP          42
+
+// Keep the audio the classifier saw (the model window plus as much pre-roll), and store it to flash
+// whenever the keyword fires, so false accepts can be listened to later. Stored clips are printed
+// over serial on start up; convert a log of them with utils/clip2wav.py.
+#define KEYWORD_CLIP_CAPTURE        0
+#define KEYWORD_CLIP_SAMPLES        (2 * EI_CLASSIFIER_RAW_SAMPLE_COUNT)
+
+// Capture from a PDM microphone on the edge connector instead of the on-board analog microphone. The PDM
+// peripheral decimates the bitstream in hardware, and PDMDecimator resamples its PCM to the model's rate
+// in fixed point, straight into the 8 bit format the streamer expects. This leaves the SAADC free.
+#define KEYWORD_PDM_SOURCE          0
+#define KEYWORD_PDM_DATA_PIN        uBit.io.P1
+#define KEYWORD_PDM_CLOCK_PIN       uBit.io.P2
+
+#if KEYWORD_PDM_SOURCE
+static NRF52PDM *pdm = NULL;
+static PDMDecimator *decimator = NULL;
+#else
 static NRF52ADCChannel *mic = NULL;
-static ContinuousAudioStreamer *streamer = NULL;
 static StreamNormalizer *processor = NULL;
+#endif
+static ContinuousAudioStreamer *streamer = NULL;
+static VoiceActivityGate *gate = NULL;
+#if KEYWORD_CLIP_CAPTURE
+static MicroBitFileSystem *clip_fs = NULL;
+static ClipRecorder *clip = NULL;
+#endif
+#if KEYWORD_VOTE_ENABLED
+static RadioVoteTransport *vote_transport = NULL;
+static KeywordVote *vote = NULL;
+#endif
 
 static inference_t inference;
+static int8_t *inference_slice;     // The slice being classified, as taken from the streamer
+static ei_classifier_decision_t keyword_decision;
 
 /**
     * Convert an int8_t buffer into a float buffer, maps to -1..1
@@ -60,148 +125,254 @@ static int int8_to_float(const EIDSP_i8 *input, float *output, size_t length) {
  */
 static int microphone_audio_signal_get_data(size_t offset, size_t length, float *out_ptr)
 {
-    int8_to_float(&inference.buffers[inference.buf_select ^ 1][offset], out_ptr, length);
+    int8_to_float(&inference_slice[offset], out_ptr, length);
     return 0;
 }
 
+static void mic_inference_loop();
+
+static constexpr ImageLiteral<5, 5> happy_image(
+      0, 255,   0, 255,   0,
+      0,   0,   0,   0,   0,
+    255,   0,   0,   0, 255,
+      0, 255, 255, 255,   0,
+      0,   0,   0,   0,   0);
+
+static constexpr ImageLiteral<5, 5> dot_image(
+      0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,
+      0,   0, 255,   0,   0,
+      0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0);
+
+/**
+ * Show an image, unless it is already on the display
+ */
+static void show_image(ImageData *data) {
+    MicroBitImage img(data);
+
+    if (!(uBit.display.image == img)) {
+        uBit.display.print(img);
+    }
+}
+
 /**
  * Invoked when we hear the keyword !
  */
 static void heard_keyword() {
-    const char * happy_emoji ="\
-        000,255,000,255,000\n\
-        000,000,000,000,000\n\
-        255,000,000,000,255\n\
-        000,255,255,255,000\n\
-        000,000,000,000,000\n";
-    MicroBitImage img(happy_emoji);
-    uBit.display.print(img);
+    show_image(happy_image);
 }
 
 /**
  * Invoked when we hear something else
  */
 static void heard_other() {
-    const char * empty_emoji ="\
-        000,000,000,000,000\n\
-        000,000,000,000,000\n\
-        000,000,255,000,000\n\
-        000,000,000,000,000\n\
-        000,000,000,000,000\n";
-    MicroBitImage img(empty_emoji);
-    uBit.display.print(img);
+    show_image(dot_image);
 }
 
 void
 mic_inference_test()
 {
+#if KEYWORD_PDM_SOURCE
+    if (pdm == NULL)
+        pdm = new NRF52PDM(KEYWORD_PDM_DATA_PIN, KEYWORD_PDM_CLOCK_PIN);
+#else
     if (mic == NULL){
         mic = uBit.adc.getChannel(uBit.io.microphone);
         mic->setGain(7,0);          // Uncomment for v1.47.2
         //mic->setGain(7,1);        // Uncomment for v1.46.2
     }
+#endif
 
-    // alloc inferencing buffers
-    inference.buffers[0] = (int8_t *)malloc(EI_CLASSIFIER_SLICE_SIZE * sizeof(int8_t));
+    // alloc inferencing buffers: the pre-roll of the gate arrives as a burst of slices, followed by the
+    // slice being filled, and they are all queued until classified
+    static int8_t *slice_buffers[KEYWORD_SLICE_BUFFERS];
+    int8_t *slice_storage = (int8_t *)malloc(KEYWORD_SLICE_BUFFERS * EI_CLASSIFIER_SLICE_SIZE * sizeof(int8_t));
 
-    if (inference.buffers[0] == NULL) {
-        uBit.serial.printf("Failed to alloc buffer 1\n");
+    if (slice_storage == NULL) {
+        uBit.serial.printf("Failed to alloc buffers\n");
         return;
     }
 
-    inference.buffers[1] = (int8_t *)malloc(EI_CLASSIFIER_SLICE_SIZE * sizeof(int8_t));
-
-    if (inference.buffers[0] == NULL) {
-        uBit.serial.printf("Failed to alloc buffer 2\n");
-        free(inference.buffers[0]);
-        return;
+    for (int ix = 0; ix < KEYWORD_SLICE_BUFFERS; ix++) {
+        slice_buffers[ix] = slice_storage + ix * EI_CLASSIFIER_SLICE_SIZE;
     }
 
     uBit.serial.printf("Allocated buffers\n");
 
+    inference.buffers = slice_buffers;
+    inference.n_buffers = KEYWORD_SLICE_BUFFERS;
     inference.buf_select = 0;
+    inference.buf_read = 0;
     inference.buf_count = 0;
     inference.n_samples = EI_CLASSIFIER_SLICE_SIZE;
     inference.buf_ready = 0;
+    inference.overruns = 0;
 
+#if KEYWORD_PDM_SOURCE
+    // Decimate in the PDM interrupt, as the ADC path does, rather than deferring every buffer to a fiber
+    // that competes with inference.
+    pdm->output.setBlocking(true);
+
+    if (decimator == NULL)
+        decimator = new PDMDecimator(pdm->output, pdm->getSampleRate(), EI_CLASSIFIER_FREQUENCY, DATASTREAM_FORMAT_8BIT_SIGNED);
+
+    DataSource *source = &decimator->output;
+#else
     mic->output.setBlocking(true);
 
     if (processor == NULL)
         processor = new StreamNormalizer(mic->output, 0.15f, true, DATASTREAM_FORMAT_8BIT_SIGNED);
 
+    DataSource *source = &processor->output;
+#endif
+
+#if KEYWORD_VAD_ENABLED
+    if (gate == NULL) {
+        gate = new VoiceActivityGate(*source, KEYWORD_VAD_PRE_ROLL, KEYWORD_VAD_HANGOVER);
+        gate->frameSize = EI_CLASSIFIER_SLICE_SIZE;
+    }
+
+    source = &gate->output;
+#endif
+
+#if KEYWORD_CLIP_CAPTURE
+    if (clip == NULL) {
+        clip_fs = new MicroBitFileSystem();
+        clip = new ClipRecorder(*source, *clip_fs, KEYWORD_CLIP_SAMPLES, EI_CLASSIFIER_FREQUENCY);
+        uBit.serial.printf("Dumped %d stored clips\n", clip->dump(uBit.serial));
+    }
+
+    source = &clip->output;
+#endif
+
     if (streamer == NULL)
-        streamer = new ContinuousAudioStreamer(processor->output, &inference);
+        streamer = new ContinuousAudioStreamer(*source, &inference);
 
+#if KEYWORD_PDM_SOURCE
+    pdm->enable();
+#else
     uBit.io.runmic.setDigitalValue(1);
     uBit.io.runmic.setHighDrive(true);
+#endif
 
     uBit.serial.printf("Allocated everything else\n");
 
-    // number of frames since we heard 'microbit'
-    uint8_t last_keywords = 0b0;
+    ei_classifier_decision_config_t decision_config;
+    decision_config.smoothing = KEYWORD_SMOOTHING;
+    decision_config.ema_alpha = KEYWORD_EMA_ALPHA;
+    decision_config.window = KEYWORD_WINDOW;
+    decision_config.trigger_threshold = KEYWORD_TRIGGER_THRESHOLD;
+    decision_config.release_threshold = KEYWORD_RELEASE_THRESHOLD;
+    decision_config.refractory_slices = KEYWORD_REFRACTORY_SLICES;
+
+    if (!ei_classifier_decision_init(&keyword_decision, &decision_config, INFERENCING_KEYWORD)) {
+        uBit.serial.printf("Keyword '%s' is not a label of this model\n", INFERENCING_KEYWORD);
+        return;
+    }
 
+#if KEYWORD_VOTE_ENABLED
+    if (vote == NULL) {
+        vote_transport = new RadioVoteTransport(uBit.radio, KEYWORD_VOTE_GROUP);
+        vote = new KeywordVote(*vote_transport, (uint16_t)microbit_serial_number());
+        vote->threshold = KeywordVote::quantize(KEYWORD_TRIGGER_THRESHOLD);
+    }
+#endif
+
+#if KEYWORD_DEDICATED_STACK
+    Fiber *f = create_dedicated_fiber(mic_inference_loop, KEYWORD_STACK_SIZE);
+
+    if (f != NULL) {
+        // Keep up with the audio ahead of display animations, serial and event handlers.
+        fiber_set_priority(f, DEVICE_FIBER_PRIORITY_HIGH);
+        release_fiber();
+    }
+
+    uBit.serial.printf("Failed to alloc inference stack, running on the main fiber\n");
+#endif
+
+    fiber_set_priority(currentFiber, DEVICE_FIBER_PRIORITY_HIGH);
+    mic_inference_loop();
+}
+
+/**
+ * Classify every slice the streamer completes, and show whether the keyword was heard
+ */
+static void mic_inference_loop()
+{
+    // number of slices since we heard 'microbit'
     int heard_keyword_x_ago = 100;
 
     while(1) {
         uBit.sleep(1);
 
-        if (inference.buf_ready) {
-            inference.buf_ready = 0;
+        // Classify every queued slice in order, so a burst of pre-roll rebuilds the whole model window
+        int8_t *slice = streamer->getSlice();
 
+        if (slice != NULL) {
+            inference_slice = slice;
             static int print_results = -(EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW);
 
-            signal_t signal;
-            signal.total_length = EI_CLASSIFIER_SLICE_SIZE;
-            signal.get_data = &microphone_audio_signal_get_data;
+            // preemphasis reads the slice in place; the other blocks through get_data
+            signal_i8_t slice_signal(slice, EI_CLASSIFIER_SLICE_SIZE, 1.0f / 128.0f);
+            slice_signal.signal.get_data = &microphone_audio_signal_get_data;
             ei_impulse_result_t result = { 0 };
 
-            EI_IMPULSE_ERROR r = run_classifier_continuous(&signal, &result, false);
+            EI_IMPULSE_ERROR r = run_classifier_continuous(&slice_signal.signal, &result, false);
+            streamer->releaseSlice();
+
             if (r != EI_IMPULSE_OK) {
                 ei_printf("ERR: Failed to run classifier (%d)\n", r);
                 return;
             }
 
-            bool heard_keyword_this_window = false;
-
             if (++print_results >= 0) {
                 // print the predictions
                 ei_printf("Predictions (DSP: %d ms., Classification: %d ms.): \n",
                     result.timing.dsp, result.timing.classification);
+#if KEYWORD_VAD_ENABLED
+                ei_printf("    (%d%% of slices skipped by VAD)\n", gate->getSkippedPercentage());
+#endif
+#if KEYWORD_DEDICATED_STACK
+                if (currentFiber->flags & DEVICE_FIBER_FLAG_DEDICATED_STACK) {
+                    ei_printf("    (stack high water: %d of %d bytes)\n", fiber_stack_high_water(currentFiber), KEYWORD_STACK_SIZE);
+                }
+#endif
                 for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
-                    ei_printf("    %s: ", result.classification[ix].label);
-                    ei_printf_float(result.classification[ix].value);
-                    ei_printf("\n");
-
-                    if (strcmp(result.classification[ix].label, INFERENCING_KEYWORD) == 0 && result.classification[ix].value > 0.7) {
-                        heard_keyword_this_window = true;
-                    }
+                    char value[EI_FLOAT_FORMAT_MAX_LENGTH];
+                    ei_format_float(result.classification[ix].value, value);
+                    ei_printf("    %s: %s\n", result.classification[ix].label, value);
                 }
 
-                last_keywords = last_keywords << 1 & 0x1f;
+                bool detected = ei_classifier_decision_update(&keyword_decision, &result);
 
-                if (heard_keyword_this_window) {
-                    last_keywords += 1;
-                }
+#if KEYWORD_VOTE_ENABLED
+                uint32_t now = (uint32_t)uBit.systemTime();
 
-                uint8_t keyword_count = 0;
-                for (size_t ix = 0; ix < 5; ix++) {
-                    keyword_count += (last_keywords >> ix) & 0x1;
-                }
+                vote->publish(now, ei_classifier_decision_score(&keyword_decision));
+                vote->poll(now);
+                detected = vote->decide(now);
 
-                if (heard_keyword_this_window) {
-                    ei_printf("\nHeard keyword: %s (%d times, needs 5)\n", INFERENCING_KEYWORD, keyword_count);
-                }
+                ei_printf("    (%d of %d nodes voted)\n", vote->getVotes(now), vote->getAliveNodes(now));
+#endif
 
-                if (keyword_count >= 1) {
+                if (detected) {
                     ei_printf("\n\n\nDefinitely heard keyword: \u001b[32m%s\u001b[0m\n\n\n", INFERENCING_KEYWORD);
-                    last_keywords = 0;
                     heard_keyword_x_ago = 0;
+
+#if KEYWORD_CLIP_CAPTURE
+                    float scores[EI_CLASSIFIER_LABEL_COUNT];
+                    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+                        scores[ix] = result.classification[ix].value;
+                    }
+                    clip->freeze((uint32_t)uBit.systemTime(), scores, EI_CLASSIFIER_LABEL_COUNT);
+#endif
                 }
                 else {
                     heard_keyword_x_ago++;
                 }
 
-                if (heard_keyword_x_ago <= 4) {
+                if (heard_keyword_x_ago <= KEYWORD_DISPLAY_SLICES) {
                     heard_keyword();
                 }
                 else {
@@ -209,6 +380,16 @@ mic_inference_test()
                 }
             }
         }
+#if KEYWORD_VOTE_ENABLED
+        else {
+            // Nothing to classify while the VAD holds the classifier back, but our neighbours still need to
+            // know we're here, or they'd lower their quorum after a few seconds of silence.
+            uint32_t now = (uint32_t)uBit.systemTime();
+
+            vote->heartbeat(now);
+            vote->poll(now);
+        }
+#endif
     }
 }
 
@@ -221,12 +402,36 @@ EI_IMPULSE_ERROR ei_sleep(int32_t time_ms) {
 }
 
 void ei_printf(const char *format, ...) {
-    char print_buf[1024] = { 0 };
+    char print_buf[128];
+    char *buf = print_buf;
 
     va_list args;
     va_start(args, format);
     int r = vsnprintf(print_buf, sizeof(print_buf), format, args);
     va_end(args);
 
-    uBit.serial.printf("%s", print_buf);
+    // Only the rare long lines go through the heap, the common ones stay on the fiber stack
+    if (r >= (int)sizeof(print_buf)) {
+        buf = (char *)malloc(r + 1);
+        if (buf == NULL) {
+            buf = print_buf;
+            r = sizeof(print_buf) - 1;
+        }
+        else {
+            va_start(args, format);
+            vsnprintf(buf, r + 1, format, args);
+            va_end(args);
+        }
+    }
+
+    // Hand the whole line to the interrupt driven TX buffer, rather than spinning on every character.
+    // If another fiber is sending, it is waiting for the buffer to drain: wait with it, then try again,
+    // so that lines never interleave.
+    while (r > 0 && uBit.serial.send((uint8_t *)buf, r) == DEVICE_SERIAL_IN_USE) {
+        fiber_wait_for_event(DEVICE_ID_NOTIFY, CODAL_SERIAL_EVT_TX_EMPTY);
+    }
+
+    if (buf != print_buf) {
+        free(buf);
+    }
 }
@@ -0,0 +1,204 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string.h>
+#include "MotionWindow.h"
+
+/**
+ * Creates a window, and connects it to an accelerometer. This starts batched acquisition.
+ *
+ * @param source a stream of accelerometer batches, such as an AccelerometerStream.
+ * @param sliceSamples the number of (x, y, z) samples in a slice, e.g. EI_CLASSIFIER_SLICE_SIZE.
+ * @param slices the number of slices in a window, e.g. EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW.
+ */
+MotionWindow::MotionWindow(DataSource &source, int sliceSamples, int slices) : upstream(source)
+{
+    this->window = (float *)malloc((slices + 1) * sliceSamples * MOTION_WINDOW_AXES * sizeof(float));
+    this->sliceSize = window ? sliceSamples * MOTION_WINDOW_AXES : 0;
+    this->slices = slices;
+    this->scale = MOTION_WINDOW_DEFAULT_SCALE;
+
+    reset();
+
+    // Register with our upstream component
+    source.connect(*this);
+}
+
+/**
+ * Disconnects from the accelerometer, and releases the window.
+ */
+MotionWindow::~MotionWindow()
+{
+    upstream.disconnect();
+    free(window);
+}
+
+/**
+ * Callback provided when data is ready.
+ */
+int MotionWindow::pullRequest()
+{
+    ManagedBuffer b = upstream.pull();
+
+    if (sliceSize == 0)
+        return DEVICE_NO_RESOURCES;
+
+    int16_t *in = (int16_t *) b.getBytes();
+    int remaining = b.length() / sizeof(int16_t);
+
+    while (remaining > 0)
+    {
+        float *out = window + writeSlot * sliceSize + writePosition;
+        int length = min(remaining, sliceSize - writePosition);
+
+        for (int i = 0; i < length; i++)
+            out[i] = (float)in[i] * scale;
+
+        in += length;
+        remaining -= length;
+        writePosition += length;
+
+        if (writePosition < sliceSize)
+            break;
+
+        // The slice is complete. Move on to the next slot, dropping the oldest slice if it was not released.
+        writeSlot = (writeSlot + 1) % (slices + 1);
+        writePosition = 0;
+        completed++;
+        pending++;
+
+        if (pending > slices)
+        {
+            readSlot = (readSlot + 1) % (slices + 1);
+            pending--;
+            overruns++;
+        }
+    }
+
+    return DEVICE_OK;
+}
+
+/**
+ * Determines the number of floats in a slice, i.e. the total_length of its signal.
+ */
+int MotionWindow::getSliceSize()
+{
+    return sliceSize;
+}
+
+/**
+ * Determines the number of complete slices that were not released yet.
+ */
+int MotionWindow::getSlicesAvailable()
+{
+    return pending;
+}
+
+/**
+ * Reads from the oldest slice that was not released. Suitable as the get_data callback of a signal_t.
+ *
+ * @param offset the index of the first float to read.
+ * @param length the number of floats to read.
+ * @param out storage for the floats.
+ * @return 0 on success, or -1 if no slice is available or the range is outside the slice.
+ */
+int MotionWindow::getSliceData(size_t offset, size_t length, float *out)
+{
+    if (pending == 0 || offset + length > (size_t)sliceSize)
+        return -1;
+
+    memcpy(out, window + readSlot * sliceSize + offset, length * sizeof(float));
+    return 0;
+}
+
+/**
+ * Releases the oldest slice, once it has been classified.
+ */
+void MotionWindow::releaseSlice()
+{
+    if (pending == 0)
+        return;
+
+    readSlot = (readSlot + 1) % (slices + 1);
+    pending--;
+}
+
+/**
+ * Determines if enough slices were collected to fill a window.
+ */
+bool MotionWindow::isWindowFull()
+{
+    return sliceSize > 0 && completed >= (uint32_t)slices;
+}
+
+/**
+ * Reads from the window made of the most recent complete slices. Suitable as the get_data callback of a signal_t.
+ *
+ * @param offset the index of the first float to read.
+ * @param length the number of floats to read.
+ * @param out storage for the floats.
+ * @return 0 on success, or -1 if the window is not full or the range is outside the window.
+ */
+int MotionWindow::getWindowData(size_t offset, size_t length, float *out)
+{
+    if (!isWindowFull() || offset + length > (size_t)(slices * sliceSize))
+        return -1;
+
+    // The window starts with the slot after the one being filled, and wraps around the ring.
+    while (length > 0)
+    {
+        int slot = (writeSlot + 1 + offset / sliceSize) % (slices + 1);
+        int position = offset % sliceSize;
+        int l = min((int)length, sliceSize - position);
+
+        memcpy(out, window + slot * sliceSize + position, l * sizeof(float));
+
+        out += l;
+        offset += l;
+        length -= l;
+    }
+
+    return 0;
+}
+
+/**
+ * Defines the scale applied to every sample, in units per milli-g.
+ */
+void MotionWindow::setScale(float scale)
+{
+    this->scale = scale;
+}
+
+/**
+ * Forgets all collected samples, e.g. after a gap in acquisition.
+ */
+void MotionWindow::reset()
+{
+    writeSlot = 0;
+    writePosition = 0;
+    readSlot = 0;
+    pending = 0;
+    completed = 0;
+    overruns = 0;
+}
@@ -0,0 +1,131 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "MicroBit.h"
+#include "CodalConfig.h"
+#include "DataStream.h"
+
+#ifndef MOTION_WINDOW_H_
+#define MOTION_WINDOW_H_
+
+/**
+ * Default configuration values
+ */
+#define MOTION_WINDOW_AXES              3               // Samples are (x, y, z) triplets.
+#define MOTION_WINDOW_DEFAULT_SCALE     0.00980665f     // Converts milli-g to m/s2, the unit motion impulses are usually trained in.
+
+/**
+ * Collects the batches of an accelerometer into a window of interleaved (x, y, z) floats, as the classifier expects them.
+ *
+ * The window is allocated once, as a ring of slices plus the slice being filled. Complete slices are queued for
+ * run_classifier_continuous(), in order, until released; the most recent full window can be read at any time for
+ * run_classifier(). If slices are not released in time, the oldest ones are dropped.
+ */
+class MotionWindow : public DataSink
+{
+    DataSource      &upstream;          // The accelerometer delivering batches of 16 bit (x, y, z) triplets, in milli-g.
+    float           *window;            // Storage for (slices + 1) slices.
+    int             sliceSize;          // Number of floats in a slice.
+    int             slices;             // Number of slices in a window.
+    int             writeSlot;          // Slot of the slice being filled.
+    int             writePosition;      // Number of floats already stored in that slice.
+    int             readSlot;           // Slot of the oldest slice that was not released.
+    int             pending;            // Number of complete slices that were not released.
+    uint32_t        completed;          // Number of slices completed since the last reset.
+    float           scale;              // Applied to every sample as it is stored.
+
+    public:
+    uint32_t        overruns;           // Number of slices dropped because they were not released in time.
+
+    /**
+     * Creates a window, and connects it to an accelerometer. This starts batched acquisition.
+     *
+     * @param source a stream of accelerometer batches, such as an AccelerometerStream.
+     * @param sliceSamples the number of (x, y, z) samples in a slice, e.g. EI_CLASSIFIER_SLICE_SIZE.
+     * @param slices the number of slices in a window, e.g. EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW.
+     */
+    MotionWindow(DataSource &source, int sliceSamples, int slices);
+
+    /**
+     * Disconnects from the accelerometer, and releases the window.
+     */
+    ~MotionWindow();
+
+    /**
+     * Callback provided when data is ready.
+     */
+    virtual int pullRequest();
+
+    /**
+     * Determines the number of floats in a slice, i.e. the total_length of its signal.
+     */
+    int getSliceSize();
+
+    /**
+     * Determines the number of complete slices that were not released yet.
+     */
+    int getSlicesAvailable();
+
+    /**
+     * Reads from the oldest slice that was not released. Suitable as the get_data callback of a signal_t.
+     *
+     * @param offset the index of the first float to read.
+     * @param length the number of floats to read.
+     * @param out storage for the floats.
+     * @return 0 on success, or -1 if no slice is available or the range is outside the slice.
+     */
+    int getSliceData(size_t offset, size_t length, float *out);
+
+    /**
+     * Releases the oldest slice, once it has been classified.
+     */
+    void releaseSlice();
+
+    /**
+     * Determines if enough slices were collected to fill a window.
+     */
+    bool isWindowFull();
+
+    /**
+     * Reads from the window made of the most recent complete slices. Suitable as the get_data callback of a signal_t.
+     *
+     * @param offset the index of the first float to read.
+     * @param length the number of floats to read.
+     * @param out storage for the floats.
+     * @return 0 on success, or -1 if the window is not full or the range is outside the window.
+     */
+    int getWindowData(size_t offset, size_t length, float *out);
+
+    /**
+     * Defines the scale applied to every sample, in units per milli-g.
+     */
+    void setScale(float scale);
+
+    /**
+     * Forgets all collected samples, e.g. after a gap in acquisition.
+     */
+    void reset();
+};
+
+#endif
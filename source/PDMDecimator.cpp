@@ -0,0 +1,252 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include <math.h>
+#include "PDMDecimator.h"
+
+/**
+ * Creates a decimator.
+ *
+ * @param source a DataSource of 16 bit signed PCM, typically an NRF52PDM.
+ * @param inputRate the sample rate of the source, in Hz.
+ * @param outputRate the sample rate to produce, in Hz.
+ * @param format the format of the output: DATASTREAM_FORMAT_8BIT_SIGNED (default) or DATASTREAM_FORMAT_16BIT_SIGNED.
+ */
+PDMDecimator::PDMDecimator(DataSource &source, int inputRate, int outputRate, int format) : upstream(source), output(*this)
+{
+    this->inputRate = inputRate;
+    this->outputRate = outputRate;
+    this->step = (uint32_t)(((uint64_t)inputRate * PDM_DECIMATOR_POSITION_ONE + outputRate / 2) / outputRate);
+    this->outputFormat = DATASTREAM_FORMAT_8BIT_SIGNED;
+
+    setFormat(format);
+    setGain(PDM_DECIMATOR_DEFAULT_GAIN);
+    design();
+    reset();
+
+    // Register with our upstream component
+    source.connect(*this);
+}
+
+/**
+ * Tabulates a Blackman windowed sinc low pass filter for every fractional delay.
+ */
+void PDMDecimator::design()
+{
+    const float pi = (float)PI;
+    float cutoff = 2.0f * PDM_DECIMATOR_CUTOFF * (float)min(inputRate, outputRate) / (float)inputRate;
+    float taps[PDM_DECIMATOR_TAPS];
+
+    for (int p = 0; p <= PDM_DECIMATOR_PHASES; p++)
+    {
+        float sum = 0.0f;
+
+        // Tap i weighs the input sample (TAPS - 1 - i) periods older than the newest, for an output
+        // sample p / PHASES of a period past the centre of the history.
+        for (int i = 0; i < PDM_DECIMATOR_TAPS; i++)
+        {
+            float t = (float)(i + 1 - PDM_DECIMATOR_TAPS / 2) - (float)p / PDM_DECIMATOR_PHASES;
+            float x = pi * cutoff * t;
+            float w = 2.0f * pi * t / PDM_DECIMATOR_TAPS;
+
+            taps[i] = (x == 0.0f ? 1.0f : sinf(x) / x) * (0.42f + 0.5f * cosf(w) + 0.08f * cosf(2.0f * w));
+            sum += taps[i];
+        }
+
+        // Normalise every phase to unity gain at DC, so a constant input doesn't ripple as the phase moves.
+        int total = 0;
+        int centre = 0;
+
+        for (int i = 0; i < PDM_DECIMATOR_TAPS; i++)
+        {
+            coefficients[p][i] = (int16_t)lroundf(taps[i] * 32768.0f / sum);
+            total += coefficients[p][i];
+
+            if (taps[i] > taps[centre])
+                centre = i;
+        }
+
+        coefficients[p][centre] += 32768 - total;
+    }
+}
+
+/**
+ * Clears the filter history and DC estimate, e.g. after the microphone was restarted.
+ */
+void PDMDecimator::reset()
+{
+    memset(history, 0, sizeof(history));
+    head = 0;
+    position = 0;
+    dcLevel = 0;
+}
+
+/**
+ * Provide the next available ManagedBuffer to our downstream caller, if available.
+ */
+ManagedBuffer PDMDecimator::pull()
+{
+    return buffer;
+}
+
+/**
+ *  Determine the data format of the buffers streamed out of this component.
+ */
+int PDMDecimator::getFormat()
+{
+    return outputFormat;
+}
+
+/**
+ * Defines the data format of the buffers streamed out of this component.
+ * @param format DATASTREAM_FORMAT_8BIT_SIGNED or DATASTREAM_FORMAT_16BIT_SIGNED.
+ * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER for any other format.
+ */
+int PDMDecimator::setFormat(int format)
+{
+    if (format != DATASTREAM_FORMAT_8BIT_SIGNED && format != DATASTREAM_FORMAT_16BIT_SIGNED)
+        return DEVICE_INVALID_PARAMETER;
+
+    outputFormat = format;
+    return DEVICE_OK;
+}
+
+/**
+ * Defines the gain applied to the filtered signal, as a floating point multiple.
+ * @param gain the gain to apply, in the range 0..127.
+ * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the gain is out of range.
+ */
+int PDMDecimator::setGain(float gain)
+{
+    if (!(gain >= 0.0f && gain < 128.0f))
+        return DEVICE_INVALID_PARAMETER;
+
+    this->gain = (int)(gain * 256.0f + 0.5f);
+    return DEVICE_OK;
+}
+
+/**
+ * Determines the gain applied to the filtered signal, as a floating point multiple.
+ */
+float PDMDecimator::getGain()
+{
+    return (float)gain / 256.0f;
+}
+
+/**
+ * Determines the sample rate of the output.
+ * @return the sample rate, in Hz.
+ */
+int PDMDecimator::getSampleRate()
+{
+    return outputRate;
+}
+
+/**
+ * Callback provided when data is ready.
+ */
+int PDMDecimator::pullRequest()
+{
+    ManagedBuffer b = upstream.pull();
+    int samples = b.length() / 2;
+
+    if (samples == 0)
+        return DEVICE_OK;
+
+    // Size the output for the most samples this buffer can yield, and trim it afterwards.
+    int bytesPerSample = DATASTREAM_FORMAT_BYTES_PER_SAMPLE(outputFormat);
+    int capacity = (int)(((uint32_t)samples * PDM_DECIMATOR_POSITION_ONE) / step) + 1;
+    int shift = outputFormat == DATASTREAM_FORMAT_8BIT_SIGNED ? 16 : 8;
+    int limit = outputFormat == DATASTREAM_FORMAT_8BIT_SIGNED ? 127 : 32767;
+
+    ManagedBuffer out(capacity * bytesPerSample);
+
+    int16_t *in = (int16_t *)&b[0];
+    uint8_t *result = &out[0];
+    int produced = 0;
+
+    for (int i = 0; i < samples; i++)
+    {
+        history[head] = in[i];
+        history[head + PDM_DECIMATOR_TAPS] = in[i];
+
+        if (++head == PDM_DECIMATOR_TAPS)
+            head = 0;
+
+        // Emit every output sample that falls between the two newest input samples (delayed by the filter).
+        while (position < PDM_DECIMATOR_POSITION_ONE)
+        {
+            // Interpolate between the two tabulated delays either side of the output sample.
+            const int phaseSize = PDM_DECIMATOR_POSITION_ONE / PDM_DECIMATOR_PHASES;
+            const int16_t *x = &history[head];
+            const int16_t *h0 = coefficients[position / phaseSize];
+            const int16_t *h1 = h0 + PDM_DECIMATOR_TAPS;
+            int32_t acc0 = 0;
+            int32_t acc1 = 0;
+
+            for (int k = 0; k < PDM_DECIMATOR_TAPS; k++)
+            {
+                acc0 += x[k] * h0[k];
+                acc1 += x[k] * h1[k];
+            }
+
+            int32_t s0 = (acc0 + (1 << 14)) >> 15;
+            int32_t s1 = (acc1 + (1 << 14)) >> 15;
+            int32_t s = s0 + (((s1 - s0) * (int32_t)(position % phaseSize)) / phaseSize);
+
+            dcLevel += ((s << 8) - dcLevel) >> PDM_DECIMATOR_DC_SHIFT;
+            s = ((s - (dcLevel >> 8)) * gain) >> shift;
+
+            if (s > limit)
+                s = limit;
+            else if (s < -limit - 1)
+                s = -limit - 1;
+
+            if (outputFormat == DATASTREAM_FORMAT_8BIT_SIGNED)
+            {
+                *result++ = (uint8_t)(int8_t)s;
+            }
+            else
+            {
+                *(int16_t *)result = (int16_t)s;
+                result += 2;
+            }
+
+            produced++;
+            position += step;
+        }
+
+        position -= PDM_DECIMATOR_POSITION_ONE;
+    }
+
+    if (produced == 0)
+        return DEVICE_OK;
+
+    out.truncate(produced * bytesPerSample);
+
+    buffer = out;
+    output.pullRequest();
+
+    return DEVICE_OK;
+}
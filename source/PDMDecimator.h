@@ -0,0 +1,132 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "MicroBit.h"
+#include "CodalConfig.h"
+#include "DataStream.h"
+
+#ifndef PDM_DECIMATOR_H_
+#define PDM_DECIMATOR_H_
+
+/**
+ * Default configuration values
+ */
+#define PDM_DECIMATOR_TAPS              16      // Length of the anti-aliasing filter, in input samples.
+#define PDM_DECIMATOR_PHASES            32      // Number of fractional delays the filter is tabulated for; delays in between are interpolated.
+#define PDM_DECIMATOR_CUTOFF            0.45f   // Passband edge, as a fraction of the lower of the two sample rates.
+#define PDM_DECIMATOR_DEFAULT_GAIN      8.0f    // PDM microphones are quiet at 0dB; bring speech up to a useful 8 bit level.
+#define PDM_DECIMATOR_DC_SHIFT          10      // Time constant of the DC blocker, as a power of two of output samples.
+
+#define PDM_DECIMATOR_POSITION_ONE      65536   // Fixed point representation of one input sample period.
+
+/**
+ * Converts the PCM stream of a PDM microphone to the rate and format the classifier expects.
+ *
+ * The nRF52 PDM peripheral already runs the CIC decimation stage in hardware, delivering 16 bit PCM at
+ * 1/64th of the PDM clock. This component performs the remaining stages in fixed point: a polyphase FIR
+ * filter that band limits and resamples to the output rate, a DC blocker and a gain stage that saturates
+ * into the output format. It replaces the ADC and StreamNormalizer in the audio pipeline.
+ */
+class PDMDecimator : public DataSink, public DataSource
+{
+    DataSource      &upstream;          // The component producing data to process.
+    ManagedBuffer   buffer;             // The buffer currently offered downstream.
+    int             outputFormat;       // DATASTREAM_FORMAT_8BIT_SIGNED or DATASTREAM_FORMAT_16BIT_SIGNED.
+    int             inputRate;          // Sample rate of the upstream PCM, in Hz.
+    int             outputRate;         // Sample rate of the output, in Hz.
+    uint32_t        step;               // Input samples per output sample (Q16).
+    uint32_t        position;           // Offset of the next output sample past the newest-but-one input sample (Q16).
+    int             gain;               // Gain applied to the filtered samples (Q8).
+    int32_t         dcLevel;            // Running estimate of the DC offset of the filtered signal (Q8).
+    int             head;               // Next write position in the history.
+    int16_t         history[2 * PDM_DECIMATOR_TAPS];    // The latest input samples, stored twice so the filter reads them linearly.
+    int16_t         coefficients[PDM_DECIMATOR_PHASES + 1][PDM_DECIMATOR_TAPS];    // Filter taps for every fractional delay (Q15).
+
+    public:
+    DataStream      output;             // The downstream output stream of this decimator.
+
+    /**
+     * Creates a decimator.
+     *
+     * @param source a DataSource of 16 bit signed PCM, typically an NRF52PDM.
+     * @param inputRate the sample rate of the source, in Hz.
+     * @param outputRate the sample rate to produce, in Hz.
+     * @param format the format of the output: DATASTREAM_FORMAT_8BIT_SIGNED (default) or DATASTREAM_FORMAT_16BIT_SIGNED.
+     */
+    PDMDecimator(DataSource &source, int inputRate, int outputRate, int format = DATASTREAM_FORMAT_8BIT_SIGNED);
+
+    /**
+     * Callback provided when data is ready.
+     */
+    virtual int pullRequest();
+
+    /**
+     * Provide the next available ManagedBuffer to our downstream caller, if available.
+     */
+    virtual ManagedBuffer pull();
+
+    /**
+     *  Determine the data format of the buffers streamed out of this component.
+     */
+    virtual int getFormat();
+
+    /**
+     * Defines the data format of the buffers streamed out of this component.
+     * @param format DATASTREAM_FORMAT_8BIT_SIGNED or DATASTREAM_FORMAT_16BIT_SIGNED.
+     * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER for any other format.
+     */
+    int setFormat(int format);
+
+    /**
+     * Defines the gain applied to the filtered signal, as a floating point multiple.
+     * @param gain the gain to apply, in the range 0..127.
+     * @return DEVICE_OK on success, or DEVICE_INVALID_PARAMETER if the gain is out of range.
+     */
+    int setGain(float gain);
+
+    /**
+     * Determines the gain applied to the filtered signal, as a floating point multiple.
+     */
+    float getGain();
+
+    /**
+     * Determines the sample rate of the output.
+     * @return the sample rate, in Hz.
+     */
+    int getSampleRate();
+
+    /**
+     * Clears the filter history and DC estimate, e.g. after the microphone was restarted.
+     */
+    void reset();
+
+    private:
+
+    /**
+     * Tabulates a Blackman windowed sinc low pass filter for every fractional delay.
+     */
+    void design();
+};
+
+#endif
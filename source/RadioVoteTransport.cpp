@@ -0,0 +1,55 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "RadioVoteTransport.h"
+
+/**
+ * Creates a transport over the given radio, and enables it.
+ * @param radio the radio to send and receive datagrams with.
+ * @param group the radio group shared by all voting nodes.
+ */
+RadioVoteTransport::RadioVoteTransport(MicroBitRadio &radio, uint8_t group) : radio(radio)
+{
+    radio.enable();
+    radio.setGroup(group);
+}
+
+/**
+ * Broadcasts a vote as a single datagram.
+ */
+int RadioVoteTransport::send(const uint8_t *data, int length)
+{
+    int r = radio.datagram.send((uint8_t *)data, length);
+
+    return r == DEVICE_OK ? length : r;
+}
+
+/**
+ * Retrieves the next datagram received, if any. Received frames are recycled by the radio
+ * as soon as they are copied out, so this never allocates.
+ */
+int RadioVoteTransport::recv(uint8_t *data, int length)
+{
+    return radio.datagram.recv(data, length);
+}
@@ -0,0 +1,52 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "MicroBit.h"
+#include "KeywordVote.h"
+
+#ifndef RADIO_VOTE_TRANSPORT_H_
+#define RADIO_VOTE_TRANSPORT_H_
+
+/**
+ * Exchanges keyword votes as MicroBitRadio datagrams. Datagrams that are not votes are consumed
+ * and ignored, so other datagram users should pick a different radio group.
+ */
+class RadioVoteTransport : public KeywordVoteTransport
+{
+    MicroBitRadio   &radio;
+
+    public:
+
+    /**
+     * Creates a transport over the given radio, and enables it.
+     * @param radio the radio to send and receive datagrams with.
+     * @param group the radio group shared by all voting nodes.
+     */
+    RadioVoteTransport(MicroBitRadio &radio, uint8_t group);
+
+    virtual int send(const uint8_t *data, int length);
+    virtual int recv(uint8_t *data, int length);
+};
+
+#endif
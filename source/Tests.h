@@ -20,6 +20,9 @@ void button_test4();
 void display_test1();
 void display_test2();
 void concurrent_display_test();
+void fiber_switch_test();
+void scheduler_idle_test();
+void fiber_priority_test();
 void fade_test();
 void mems_mic_test();
 void piezo_mic_test();
@@ -32,6 +35,7 @@ void radio_rx_test2();
 void radio_tx_test();
 void temperature_test();
 void accelerometer_test1();
+void accelerometer_batch_test();
 void compass_test1();
 void compass_test2();
 void button_blinky_test();
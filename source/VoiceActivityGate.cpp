@@ -0,0 +1,267 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "VoiceActivityGate.h"
+#include "StreamNormalizer.h"
+
+/**
+ * Creates a voice activity gate. Buffers are only passed downstream while speech-like activity is present,
+ * so the components behind it (and the classifier behind those) stay idle during silence.
+ *
+ * @param source a DataSource of 8 or 16 bit signed samples to gate.
+ * @param preRollSize the number of bytes of audio to keep while the gate is closed. These are delivered
+ *                    ahead of the first speech-like buffer, so the downstream window is filled with history.
+ *                    When frameSize is set, this should be a multiple of it.
+ * @param hangover the number of samples to keep the gate open after activity was last detected.
+ */
+VoiceActivityGate::VoiceActivityGate(DataSource &source, int preRollSize, int hangover) : upstream(source), output(*this)
+{
+    this->preRoll = (uint8_t *)malloc(preRollSize);
+    this->preRollSize = preRoll ? preRollSize : 0;
+    this->preRollHead = 0;
+    this->preRollLength = 0;
+    this->noiseFloor = 0;
+    this->hangover = hangover;
+    this->hangoverRemaining = 0;
+    this->active = false;
+    this->bytesForwarded = 0;
+    this->energyRatio = VAD_DEFAULT_ENERGY_RATIO;
+    this->minEnergy = VAD_DEFAULT_MIN_ENERGY;
+    this->maxZeroCrossings = VAD_DEFAULT_MAX_ZCR;
+    this->frameSize = 0;
+
+    resetStatistics();
+
+    // Register with our upstream component
+    source.connect(*this);
+}
+
+/**
+ * Provide the next available ManagedBuffer to our downstream caller, if available.
+ */
+ManagedBuffer VoiceActivityGate::pull()
+{
+    return buffer;
+}
+
+/**
+ *  Determine the data format of the buffers streamed out of this component.
+ */
+int VoiceActivityGate::getFormat()
+{
+    return upstream.getFormat();
+}
+
+/**
+ * Callback provided when data is ready.
+ */
+int VoiceActivityGate::pullRequest()
+{
+    ManagedBuffer b = upstream.pull();
+
+    int format = upstream.getFormat();
+    int bytesPerSample = DATASTREAM_FORMAT_BYTES_PER_SAMPLE(format);
+    int samples = b.length() / bytesPerSample;
+
+    if (samples == 0)
+        return DEVICE_OK;
+
+    // Measure the mean absolute level and the number of zero crossings of this buffer.
+    uint8_t *data = &b[0];
+    int energy = 0;
+    int crossings = 0;
+    int last = 0;
+
+    for (int i = 0; i < samples; i++)
+    {
+        int s = StreamNormalizer::readSample[format](data);
+        data += bytesPerSample;
+
+        energy += abs(s);
+
+        if ((s < 0) != (last < 0))
+            crossings++;
+
+        last = s;
+    }
+
+    energy = energy / samples;
+    crossings = (crossings << 8) / samples;
+
+    // Seed the noise floor from the first buffer we see.
+    if (samplesIn == 0 && noiseFloor == 0)
+        noiseFloor = energy << VAD_NOISE_FLOOR_SHIFT;
+
+    // Broadband noise crosses zero far more often than voiced speech, so only loud, low ZCR buffers count as speech.
+    int threshold = max(minEnergy, (noiseFloor * energyRatio) >> VAD_NOISE_FLOOR_SHIFT);
+    bool speech = energy >= threshold && crossings <= maxZeroCrossings;
+
+    // Track the noise floor while nothing speech-like is present: follow drops quickly, and rises slowly.
+    if (!speech)
+    {
+        int e = energy << VAD_NOISE_FLOOR_SHIFT;
+
+        if (e < noiseFloor)
+            noiseFloor -= (noiseFloor - e) >> 2;
+        else
+            noiseFloor += (e - noiseFloor) >> 6;
+    }
+
+    samplesIn += samples;
+
+    if (speech)
+    {
+        hangoverRemaining = hangover;
+
+        if (!active)
+        {
+            active = true;
+            flushPreRoll();
+        }
+    }
+    else if (active)
+    {
+        hangoverRemaining -= samples;
+
+        if (hangoverRemaining <= 0)
+            active = false;
+    }
+
+    if (active)
+    {
+        forward(b);
+    }
+    else
+    {
+        // Complete the frame downstream is filling before withholding audio, so that after a gap, the pre-roll
+        // starts a new frame rather than being appended to stale audio.
+        int tail = 0;
+
+        if (frameSize > 0)
+            tail = min((int)b.length(), (int)((frameSize - bytesForwarded % frameSize) % frameSize));
+
+        if (tail > 0)
+            forward(b.slice(0, tail));
+
+        storePreRoll(&b[0] + tail, b.length() - tail);
+        samplesSkipped += (b.length() - tail) / bytesPerSample;
+    }
+
+    return DEVICE_OK;
+}
+
+/**
+ * Copies the given bytes to the pre-roll ring, overwriting the oldest data when full.
+ */
+void VoiceActivityGate::storePreRoll(uint8_t *data, int length)
+{
+    if (preRollSize == 0)
+        return;
+
+    // Only the most recent preRollSize bytes can be kept.
+    if (length > preRollSize)
+    {
+        data += length - preRollSize;
+        length = preRollSize;
+    }
+
+    int first = min(length, preRollSize - preRollHead);
+
+    memcpy(preRoll + preRollHead, data, first);
+    memcpy(preRoll, data + first, length - first);
+
+    preRollHead = (preRollHead + length) % preRollSize;
+    preRollLength = min(preRollLength + length, preRollSize);
+}
+
+/**
+ * Forwards the content of the pre-roll ring downstream, oldest data first, and empties it.
+ */
+void VoiceActivityGate::flushPreRoll()
+{
+    int bytesPerSample = DATASTREAM_FORMAT_BYTES_PER_SAMPLE(upstream.getFormat());
+    int start = (preRollHead - preRollLength + preRollSize) % max(preRollSize, 1);
+    int first = min(preRollLength, preRollSize - start);
+
+    if (first > 0)
+        forward(ManagedBuffer(preRoll + start, first));
+
+    if (preRollLength - first > 0)
+        forward(ManagedBuffer(preRoll, preRollLength - first));
+
+    // These samples were counted as skipped when they arrived, but have now been delivered after all.
+    uint32_t delivered = preRollLength / bytesPerSample;
+    samplesSkipped = delivered < samplesSkipped ? samplesSkipped - delivered : 0;
+
+    preRollHead = 0;
+    preRollLength = 0;
+}
+
+/**
+ * Forwards the given buffer downstream.
+ */
+void VoiceActivityGate::forward(ManagedBuffer b)
+{
+    buffer = b;
+    bytesForwarded += b.length();
+    output.pullRequest();
+}
+
+/**
+ * Determines whether audio is currently passing through the gate.
+ * @return true if the gate is open, false otherwise.
+ */
+bool VoiceActivityGate::isActive()
+{
+    return active;
+}
+
+/**
+ * Determines the share of the input that was withheld from downstream since the last reset.
+ * @return the percentage of samples (and hence classifier slices) skipped.
+ */
+int VoiceActivityGate::getSkippedPercentage()
+{
+    if (samplesIn == 0)
+        return 0;
+
+    return (int)(((uint64_t)samplesSkipped * 100) / samplesIn);
+}
+
+/**
+ * Resets the skipped sample statistics.
+ */
+void VoiceActivityGate::resetStatistics()
+{
+    samplesIn = 0;
+    samplesSkipped = 0;
+}
+
+/**
+ * Destructor.
+ */
+VoiceActivityGate::~VoiceActivityGate()
+{
+    free(preRoll);
+}
@@ -0,0 +1,131 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020 EdgeImpulse Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+*/
+
+#include "MicroBit.h"
+#include "CodalConfig.h"
+#include "DataStream.h"
+
+#ifndef VOICE_ACTIVITY_GATE_H_
+#define VOICE_ACTIVITY_GATE_H_
+
+/**
+ * Default configuration values
+ */
+#define VAD_DEFAULT_ENERGY_RATIO        3       // A buffer must be this many times louder than the noise floor...
+#define VAD_DEFAULT_MIN_ENERGY          2       // ...and at least this loud (mean absolute sample value)...
+#define VAD_DEFAULT_MAX_ZCR             96      // ...with at most this many zero crossings per 256 samples.
+
+#define VAD_NOISE_FLOOR_SHIFT           4       // Fixed point precision of the noise floor estimate.
+
+class VoiceActivityGate : public DataSink, public DataSource
+{
+    DataSource      &upstream;          // The component producing data to process.
+    ManagedBuffer   buffer;             // The buffer currently offered downstream.
+    uint8_t         *preRoll;           // Ring of the most recent audio seen while the gate was closed.
+    int             preRollSize;        // Capacity of the pre-roll ring, in bytes.
+    int             preRollHead;        // Next write position in the pre-roll ring.
+    int             preRollLength;      // Number of valid bytes in the pre-roll ring.
+    int             noiseFloor;         // Adaptive estimate of the background level (fixed point).
+    int             hangover;           // Number of samples the gate stays open after the last speech-like buffer.
+    int             hangoverRemaining;  // Samples left before the gate closes.
+    bool            active;             // True while audio is being forwarded downstream.
+    uint32_t        bytesForwarded;     // Total number of bytes delivered downstream.
+
+    public:
+    int             energyRatio;        // See VAD_DEFAULT_ENERGY_RATIO.
+    int             minEnergy;          // See VAD_DEFAULT_MIN_ENERGY.
+    int             maxZeroCrossings;   // See VAD_DEFAULT_MAX_ZCR.
+    int             frameSize;          // If set, the gate only closes once a whole number of frames of this many bytes was forwarded.
+    uint32_t        samplesIn;          // Total number of samples received.
+    uint32_t        samplesSkipped;     // Number of samples withheld from downstream.
+    DataStream      output;             // The downstream output stream of this gate.
+
+    /**
+     * Creates a voice activity gate. Buffers are only passed downstream while speech-like activity is present,
+     * so the components behind it (and the classifier behind those) stay idle during silence.
+     *
+     * @param source a DataSource of 8 or 16 bit signed samples to gate.
+     * @param preRollSize the number of bytes of audio to keep while the gate is closed. These are delivered
+     *                    ahead of the first speech-like buffer, so the downstream window is filled with history.
+     *                    When frameSize is set, this should be a multiple of it.
+     * @param hangover the number of samples to keep the gate open after activity was last detected.
+     */
+    VoiceActivityGate(DataSource &source, int preRollSize, int hangover);
+
+    /**
+     * Callback provided when data is ready.
+     */
+    virtual int pullRequest();
+
+    /**
+     * Provide the next available ManagedBuffer to our downstream caller, if available.
+     */
+    virtual ManagedBuffer pull();
+
+    /**
+     *  Determine the data format of the buffers streamed out of this component.
+     */
+    virtual int getFormat();
+
+    /**
+     * Determines whether audio is currently passing through the gate.
+     * @return true if the gate is open, false otherwise.
+     */
+    bool isActive();
+
+    /**
+     * Determines the share of the input that was withheld from downstream since the last reset.
+     * @return the percentage of samples (and hence classifier slices) skipped.
+     */
+    int getSkippedPercentage();
+
+    /**
+     * Resets the skipped sample statistics.
+     */
+    void resetStatistics();
+
+    /**
+     * Destructor.
+     */
+    ~VoiceActivityGate();
+
+    private:
+
+    /**
+     * Copies the given bytes to the pre-roll ring, overwriting the oldest data when full.
+     */
+    void storePreRoll(uint8_t *data, int length);
+
+    /**
+     * Forwards the content of the pre-roll ring downstream, oldest data first, and empties it.
+     */
+    void flushPreRoll();
+
+    /**
+     * Forwards the given buffer downstream.
+     */
+    void forward(ManagedBuffer b);
+};
+
+#endif
@@ -27,6 +27,15 @@
 #include <math.h>
 #include <stdint.h>
 #include "model-parameters/anomaly_types.h"
+#include "edge-impulse-sdk/dsp/config.hpp"
+#if EIDSP_USE_CMSIS_DSP
+#include "edge-impulse-sdk/CMSIS/DSP/Include/arm_math.h"
+#endif
+
+// Number of features accumulated between early termination checks
+#ifndef EI_CLASSIFIER_ANOM_BLOCK_SIZE
+#define EI_CLASSIFIER_ANOM_BLOCK_SIZE   8
+#endif
 
 #ifdef __cplusplus
 namespace {
@@ -46,6 +55,74 @@ void standard_scaler(float *input, const float *scale, const float *mean, size_t
     }
 }
 
+/**
+ * Standard scaler using precomputed reciprocals of the scale values, so no divisions
+ * are needed per inference (see standard_scaler_reciprocals).
+ * Note that this *modifies* the array in place!
+ * @param input Array of input values
+ * @param inv_scale Array of 1 / scale values
+ * @param mean Array of mean values (obtain from StandardScaler in Python)
+ * @param input_size Size of input, inv_scale and mean arrays
+ */
+void standard_scaler_inv(float *input, const float *inv_scale, const float *mean, size_t input_size) {
+#if EIDSP_USE_CMSIS_DSP
+    arm_sub_f32(input, (float *)mean, input, input_size);
+    arm_mult_f32(input, (float *)inv_scale, input, input_size);
+#else
+    for (size_t ix = 0; ix < input_size; ix++) {
+        input[ix] = (input[ix] - mean[ix]) * inv_scale[ix];
+    }
+#endif
+}
+
+/**
+ * Calculate the reciprocals of the scale values, for use with standard_scaler_inv
+ * @param scale Array of scale values (obtain from StandardScaler in Python)
+ * @param inv_scale Output array of 1 / scale values
+ * @param input_size Size of the scale and inv_scale arrays
+ */
+void standard_scaler_reciprocals(const float *scale, float *inv_scale, size_t input_size) {
+    for (size_t ix = 0; ix < input_size; ix++) {
+        inv_scale[ix] = 1.0f / scale[ix];
+    }
+}
+
+/**
+ * Calculate the squared distance between input vector and a centroid. Stops early
+ * (returning a value >= limit) once the partial distance reaches limit.
+ * @param input Array of input values (already scaled by standard_scaler)
+ * @param centroid Array of centroid values
+ * @param input_size Size of the input and centroid arrays
+ * @param limit Squared distance beyond which the exact result is not needed
+ */
+float calculate_squared_distance(const float *input, const float *centroid, size_t input_size, float limit) {
+    float dist = 0.0f;
+
+    for (size_t ix = 0; ix < input_size; ix += EI_CLASSIFIER_ANOM_BLOCK_SIZE) {
+        size_t block_size = input_size - ix < EI_CLASSIFIER_ANOM_BLOCK_SIZE ?
+            input_size - ix : EI_CLASSIFIER_ANOM_BLOCK_SIZE;
+
+#if EIDSP_USE_CMSIS_DSP
+        float diff[EI_CLASSIFIER_ANOM_BLOCK_SIZE];
+        float block_dist;
+        arm_sub_f32((float *)input + ix, (float *)centroid + ix, diff, block_size);
+        arm_dot_prod_f32(diff, diff, block_size, &block_dist);
+        dist += block_dist;
+#else
+        for (size_t bx = ix; bx < ix + block_size; bx++) {
+            float diff = input[bx] - centroid[bx];
+            dist += diff * diff;
+        }
+#endif
+
+        if (dist >= limit) {
+            break;
+        }
+    }
+
+    return dist;
+}
+
 /**
  * Calculate the distance between input vector and the cluster
  * @param input Array of input values (already scaled by standard_scaler)
@@ -55,15 +132,13 @@ void standard_scaler(float *input, const float *scale, const float *mean, size_t
 float calculate_cluster_distance(float *input, size_t input_size, const ei_classifier_anom_cluster_t *cluster) {
     // todo: check input_size and centroid size?
 
-    float dist = 0.0f;
-    for (size_t ix = 0; ix < input_size; ix++) {
-        dist += pow(input[ix] - cluster->centroid[ix], 2);
-    }
-    return sqrt(dist) - cluster->max_error;
+    float dist = calculate_squared_distance(input, cluster->centroid, input_size, INFINITY);
+    return sqrtf(dist) - cluster->max_error;
 }
 
 /**
- * Get minimum distance to a cluster
+ * Get minimum distance to a cluster. Clusters are compared on their squared distance,
+ * and abandoned as soon as they can no longer beat the best cluster found so far.
  * @param input Array of input values (already scaled by standard_scaler)
  * @param input_size Size of the input array
  * @param clusters Array of clusters
@@ -72,9 +147,16 @@ float calculate_cluster_distance(float *input, size_t input_size, const ei_class
 float get_min_distance_to_cluster(float *input, size_t input_size, const ei_classifier_anom_cluster_t *clusters, size_t cluster_size) {
     float min = 1000.0f;
     for (size_t ix = 0; ix < cluster_size; ix++) {
-        float dist = calculate_cluster_distance(input, input_size, &clusters[ix]);
-        if (dist < min) {
-            min = dist;
+        // sqrt(dist) - max_error < min  <=>  dist < (min + max_error)^2
+        float bound = min + clusters[ix].max_error;
+        if (bound <= 0.0f) {
+            continue;
+        }
+
+        float limit = bound * bound;
+        float dist = calculate_squared_distance(input, clusters[ix].centroid, input_size, limit);
+        if (dist < limit) {
+            min = sqrtf(dist) - clusters[ix].max_error;
         }
     }
     return min;
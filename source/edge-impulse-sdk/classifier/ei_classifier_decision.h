@@ -0,0 +1,176 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2021 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _EI_CLASSIFIER_DECISION_H_
+#define _EI_CLASSIFIER_DECISION_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "ei_classifier_types.h"
+
+#ifndef EI_CLASSIFIER_DECISION_MAX_WINDOW
+#define EI_CLASSIFIER_DECISION_MAX_WINDOW       8
+#endif
+
+typedef enum {
+    EI_CLASSIFIER_DECISION_SMOOTH_NONE = 0,     // use the posterior of the current slice
+    EI_CLASSIFIER_DECISION_SMOOTH_EMA,          // exponential moving average
+    EI_CLASSIFIER_DECISION_SMOOTH_MOVING_AVG    // mean over the last `window` slices
+} ei_classifier_decision_smoothing_t;
+
+typedef struct {
+    ei_classifier_decision_smoothing_t smoothing;
+    float ema_alpha;                // weight of the newest posterior (EMA only)
+    uint8_t window;                 // number of slices to average (moving average only)
+    float trigger_threshold;        // smoothed score at which the label fires
+    float release_threshold;        // smoothed score the label must drop below before it can fire again
+    uint16_t refractory_slices;     // slices after a trigger during which no new trigger is reported
+} ei_classifier_decision_config_t;
+
+typedef struct {
+    ei_classifier_decision_config_t config;
+    int label_ix;
+    float score[EI_CLASSIFIER_LABEL_COUNT];
+    float sum[EI_CLASSIFIER_LABEL_COUNT];
+    float history[EI_CLASSIFIER_DECISION_MAX_WINDOW][EI_CLASSIFIER_LABEL_COUNT];
+    uint8_t history_ix;
+    uint8_t history_count;
+    bool armed;
+    uint16_t refractory;
+} ei_classifier_decision_t;
+
+/**
+ * Initialize a decision structure. Unlike ei_classifier_smooth_t this does not
+ * allocate; all state lives in the structure itself. The trigger label is
+ * resolved to its index here, so updates don't need to compare strings.
+ * @param decision Pointer to an uninitialized ei_classifier_decision_t struct
+ * @param config Smoothing and trigger parameters (copied)
+ * @param label Label that fires the trigger (e.g. the keyword)
+ * @returns false if the label is not part of the model, or the config is invalid
+ */
+bool ei_classifier_decision_init(ei_classifier_decision_t *decision,
+                                 const ei_classifier_decision_config_t *config,
+                                 const char *label) {
+    memset(decision, 0, sizeof(ei_classifier_decision_t));
+    decision->config = *config;
+    decision->label_ix = -1;
+    decision->armed = true;
+
+    if (config->smoothing == EI_CLASSIFIER_DECISION_SMOOTH_MOVING_AVG &&
+        (config->window == 0 || config->window > EI_CLASSIFIER_DECISION_MAX_WINDOW)) {
+        return false;
+    }
+
+    for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+        if (strcmp(ei_classifier_inferencing_categories[ix], label) == 0) {
+            decision->label_ix = (int)ix;
+            break;
+        }
+    }
+
+    return decision->label_ix >= 0;
+}
+
+/**
+ * Call when a new reading comes in. Updates the smoothed score of every label,
+ * then applies hysteresis and the refractory period to the trigger label.
+ * @param decision Pointer to an initialized ei_classifier_decision_t struct
+ * @param result Pointer to a result structure (after calling run_classifier_continuous)
+ * @returns true if the trigger label fired on this reading
+ */
+bool ei_classifier_decision_update(ei_classifier_decision_t *decision, ei_impulse_result_t *result) {
+    const ei_classifier_decision_config_t *config = &decision->config;
+
+    switch (config->smoothing) {
+    case EI_CLASSIFIER_DECISION_SMOOTH_EMA:
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            decision->score[ix] += config->ema_alpha * (result->classification[ix].value - decision->score[ix]);
+        }
+        break;
+
+    case EI_CLASSIFIER_DECISION_SMOOTH_MOVING_AVG: {
+        float *oldest = decision->history[decision->history_ix];
+
+        if (decision->history_count < config->window) {
+            decision->history_count++;
+        }
+
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            // oldest[] is zero until the window has filled up once
+            decision->sum[ix] += result->classification[ix].value - oldest[ix];
+            oldest[ix] = result->classification[ix].value;
+            decision->score[ix] = decision->sum[ix] / (float)decision->history_count;
+        }
+
+        if (++decision->history_ix >= config->window) {
+            decision->history_ix = 0;
+        }
+        break;
+    }
+
+    default:
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            decision->score[ix] = result->classification[ix].value;
+        }
+        break;
+    }
+
+    float score = decision->score[decision->label_ix];
+
+    if (decision->refractory > 0) {
+        decision->refractory--;
+    }
+
+    if (score < config->release_threshold) {
+        decision->armed = true;
+    }
+
+    if (decision->armed && decision->refractory == 0 && score >= config->trigger_threshold) {
+        decision->armed = false;
+        decision->refractory = config->refractory_slices;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Smoothed score of the trigger label after the last update
+ */
+float ei_classifier_decision_score(ei_classifier_decision_t *decision) {
+    return decision->score[decision->label_ix];
+}
+
+/**
+ * Forget all readings, e.g. after the audio stream was interrupted
+ */
+void ei_classifier_decision_reset(ei_classifier_decision_t *decision) {
+    ei_classifier_decision_config_t config = decision->config;
+    int label_ix = decision->label_ix;
+
+    memset(decision, 0, sizeof(ei_classifier_decision_t));
+    decision->config = config;
+    decision->label_ix = label_ix;
+    decision->armed = true;
+}
+
+#endif // _EI_CLASSIFIER_DECISION_H_
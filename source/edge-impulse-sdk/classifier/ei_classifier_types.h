@@ -24,6 +24,7 @@
 #define _EDGE_IMPULSE_RUN_CLASSIFIER_TYPES_H_
 
 #include <stdint.h>
+#include <stddef.h>
 #include "model-parameters/model_metadata.h"
 
 typedef struct {
@@ -54,4 +55,23 @@ typedef struct {
 #endif
 }ei_impulse_maf;
 
+/**
+ * State of one continuous classification stream (see run_classifier_continuous_ctx).
+ * Every stream owns one of these, so several streams can run side by side;
+ * the model itself is shared between them. run_classifier_ctx uses one for
+ * its spectral analysis engine only.
+ */
+typedef struct {
+    ei_impulse_maf maf[EI_CLASSIFIER_LABEL_COUNT > 0 ? EI_CLASSIFIER_LABEL_COUNT : 1];
+    float *features;                // feature buffer of the model window, filled a slice at a time
+    size_t slice_offset;            // where the next slice goes in the feature buffer
+    bool feature_buffer_full;       // true once a full window of slices was extracted
+    uint32_t dsp_slice_started;     // bit n set once DSP block n extracted its first slice
+    void *spectral_engine;          // ei::spectral::engine of this context, built on first use
+    const void *spectral_config;    // spectral analysis block config the engine was built for
+    float spectral_frequency;       // sampling frequency the engine was built for
+    size_t spectral_length;         // samples per axis the engine was built for
+    size_t memory_used;             // bytes allocated on behalf of this context
+} ei_impulse_context_t;
+
 #endif // _EDGE_IMPULSE_RUN_CLASSIFIER_TYPES_H_
@@ -30,6 +30,7 @@
 #include "ei_run_dsp.h"
 #include "ei_classifier_types.h"
 #include "ei_classifier_smooth.h"
+#include "ei_classifier_decision.h"
 #if defined(EI_CLASSIFIER_HAS_SAMPLER) && EI_CLASSIFIER_HAS_SAMPLER == 1
 #include "ei_sampler.h"
 #endif
@@ -121,16 +122,31 @@ static void calc_cepstral_mean_and_var_normalization_mfe(ei_matrix *matrix, void
 static void calc_cepstral_mean_and_var_normalization_spectrogram(ei_matrix *matrix, void *config_ptr);
 
 /* Private variables ------------------------------------------------------- */
-#if EI_CLASSIFIER_LABEL_COUNT > 0
-ei_impulse_maf classifier_maf[EI_CLASSIFIER_LABEL_COUNT] = {{0}};
-#else
-ei_impulse_maf classifier_maf[0];
-#endif
-static size_t slice_offset = 0;
-static bool feature_buffer_full = false;
+// stream used by run_classifier_init / run_classifier_continuous / run_classifier
+static ei_impulse_context_t default_impulse_context;
 
 /* Private functions ------------------------------------------------------- */
 
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+/**
+ * @brief      Reciprocals of the anomaly scaler, computed on first use
+ *
+ * @return     Array of 1 / ei_classifier_anom_scale
+ */
+static const float *get_anomaly_inv_scale()
+{
+    static float inv_scale[EI_CLASSIFIER_ANOM_AXIS_SIZE];
+    static bool inv_scale_valid = false;
+
+    if (!inv_scale_valid) {
+        standard_scaler_reciprocals(ei_classifier_anom_scale, inv_scale, EI_CLASSIFIER_ANOM_AXIS_SIZE);
+        inv_scale_valid = true;
+    }
+
+    return inv_scale;
+}
+#endif
+
 /**
  * @brief      Run a moving average filter over the classification result.
  *             The size of the filter determines the response of the filter.
@@ -172,34 +188,86 @@ static void clear_moving_average_filter(ei_impulse_maf *maf)
 }
 
 /**
- * @brief      Init static vars
+ * @brief      Forget all slices of a stream, the next slice starts a new window
+ *
+ * @param      ctx   Pointer to the stream context
  */
-extern "C" void run_classifier_init(void)
+extern "C" void ei_impulse_context_reset(ei_impulse_context_t *ctx)
 {
-    slice_offset = 0;
-    feature_buffer_full = false;
+    ctx->slice_offset = 0;
+    ctx->feature_buffer_full = false;
+    ctx->dsp_slice_started = 0;
 
     for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
-        clear_moving_average_filter(&classifier_maf[ix]);
+        ctx->maf[ix].buf_idx = 0;
+        clear_moving_average_filter(&ctx->maf[ix]);
     }
 }
 
 /**
- * @brief      Fill the complete matrix with sample slices. From there, run inference
- *             on the matrix.
+ * @brief      Set up a context for a new continuous classification stream
+ *
+ * @param      ctx   Pointer to an uninitialized context
+ *
+ * @return     EI_IMPULSE_ALLOC_FAILED if the feature buffer could not be allocated
+ */
+extern "C" EI_IMPULSE_ERROR ei_impulse_context_init(ei_impulse_context_t *ctx)
+{
+    memset(ctx, 0, sizeof(ei_impulse_context_t));
+
+    ctx->features = (float *)ei_calloc(EI_CLASSIFIER_NN_INPUT_FRAME_SIZE, sizeof(float));
+    if (!ctx->features) {
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+    ctx->memory_used = EI_CLASSIFIER_NN_INPUT_FRAME_SIZE * sizeof(float);
+
+    ei_impulse_context_reset(ctx);
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Release the memory held by a context
+ *
+ * @param      ctx   Pointer to the stream context
+ */
+extern "C" void ei_impulse_context_free(ei_impulse_context_t *ctx)
+{
+    if (ctx->features) {
+        ei_free(ctx->features);
+    }
+    free_spectral_engine(ctx);
+    memset(ctx, 0, sizeof(ei_impulse_context_t));
+}
+
+/**
+ * @brief      Init static vars
+ */
+extern "C" void run_classifier_init(void)
+{
+    ei_impulse_context_reset(&default_impulse_context);
+}
+
+/**
+ * @brief      Fill the complete matrix with sample slices of one stream. From there, run
+ *             inference on the matrix. Streams with their own context can be interleaved.
  *
+ * @param      ctx     Stream context, see ei_impulse_context_init
  * @param      signal  Sample data
  * @param      result  Classification output
  * @param[in]  debug   Debug output enable boot
  *
  * @return     The ei impulse error.
  */
-extern "C" EI_IMPULSE_ERROR run_classifier_continuous(signal_t *signal, ei_impulse_result_t *result,
-                                                      bool debug = false)
+extern "C" EI_IMPULSE_ERROR run_classifier_continuous_ctx(ei_impulse_context_t *ctx, signal_t *signal,
+                                                          ei_impulse_result_t *result, bool debug = false)
 {
-    static ei::matrix_t static_features_matrix(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
-    if (!static_features_matrix.buffer) {
-        return EI_IMPULSE_ALLOC_FAILED;
+    if (!ctx->features) {
+        // a zero initialized context allocates on first use
+        ctx->features = (float *)ei_calloc(EI_CLASSIFIER_NN_INPUT_FRAME_SIZE, sizeof(float));
+        if (!ctx->features) {
+            return EI_IMPULSE_ALLOC_FAILED;
+        }
+        ctx->memory_used += EI_CLASSIFIER_NN_INPUT_FRAME_SIZE * sizeof(float);
     }
 
     EI_IMPULSE_ERROR ei_impulse_error = EI_IMPULSE_OK;
@@ -221,19 +289,22 @@ extern "C" EI_IMPULSE_ERROR run_classifier_continuous(signal_t *signal, ei_impul
         }
 
         ei::matrix_t fm(1, block.n_output_features,
-                        static_features_matrix.buffer + out_features_index + slice_offset);
+                        ctx->features + out_features_index + ctx->slice_offset);
+
+        bool first_slice = (ctx->dsp_slice_started & (1UL << ix)) == 0;
+        int ret;
 
         /* Switch to the slice version of the mfcc feature extract function */
         if (block.extract_fn == extract_mfcc_features) {
-            block.extract_fn = &extract_mfcc_per_slice_features;
+            ret = extract_mfcc_per_slice_features(signal, &fm, block.config, EI_CLASSIFIER_FREQUENCY, first_slice);
             is_mfcc = true;
         }
         else if (block.extract_fn == extract_spectrogram_features) {
-            block.extract_fn = &extract_spectrogram_per_slice_features;
+            ret = extract_spectrogram_per_slice_features(signal, &fm, block.config, EI_CLASSIFIER_FREQUENCY, first_slice);
             is_spectrogram = true;
         }
         else if (block.extract_fn == extract_mfe_features) {
-            block.extract_fn = &extract_mfe_per_slice_features;
+            ret = extract_mfe_per_slice_features(signal, &fm, block.config, EI_CLASSIFIER_FREQUENCY, first_slice);
             is_mfe = true;
         }
         else {
@@ -241,7 +312,8 @@ extern "C" EI_IMPULSE_ERROR run_classifier_continuous(signal_t *signal, ei_impul
             return EI_IMPULSE_DSP_ERROR;
         }
 
-        int ret = block.extract_fn(signal, &fm, block.config, EI_CLASSIFIER_FREQUENCY);
+        ctx->dsp_slice_started |= (1UL << ix);
+
         if (ret != EIDSP_OK) {
             ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
             return EI_IMPULSE_DSP_ERROR;
@@ -257,12 +329,12 @@ extern "C" EI_IMPULSE_ERROR run_classifier_continuous(signal_t *signal, ei_impul
     }
 
     /* For as long as the feature buffer isn't completely full, keep moving the slice offset */
-    if (feature_buffer_full == false) {
-        slice_offset += feature_size;
+    if (ctx->feature_buffer_full == false) {
+        ctx->slice_offset += feature_size;
 
-        if (slice_offset > (EI_CLASSIFIER_NN_INPUT_FRAME_SIZE - feature_size)) {
-            feature_buffer_full = true;
-            slice_offset -= feature_size;
+        if (ctx->slice_offset > (EI_CLASSIFIER_NN_INPUT_FRAME_SIZE - feature_size)) {
+            ctx->feature_buffer_full = true;
+            ctx->slice_offset -= feature_size;
         }
     }
 
@@ -270,8 +342,8 @@ extern "C" EI_IMPULSE_ERROR run_classifier_continuous(signal_t *signal, ei_impul
 
     if (debug) {
         ei_printf("\r\nFeatures (%d ms.): ", result->timing.dsp);
-        for (size_t ix = 0; ix < static_features_matrix.cols; ix++) {
-            ei_printf_float(static_features_matrix.buffer[ix]);
+        for (size_t ix = 0; ix < EI_CLASSIFIER_NN_INPUT_FRAME_SIZE; ix++) {
+            ei_printf_float(ctx->features[ix]);
             ei_printf(" ");
         }
         ei_printf("\n");
@@ -283,13 +355,13 @@ extern "C" EI_IMPULSE_ERROR run_classifier_continuous(signal_t *signal, ei_impul
     }
 #endif
 
-    if (feature_buffer_full == true) {
+    if (ctx->feature_buffer_full == true) {
         dsp_start_ms = ei_read_timer_ms();
         ei::matrix_t classify_matrix(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
 
         /* Create a copy of the matrix for normalization */
         for (size_t m_ix = 0; m_ix < EI_CLASSIFIER_NN_INPUT_FRAME_SIZE; m_ix++) {
-            classify_matrix.buffer[m_ix] = static_features_matrix.buffer[m_ix];
+            classify_matrix.buffer[m_ix] = ctx->features[m_ix];
         }
 
         if (is_mfcc) {
@@ -307,17 +379,33 @@ extern "C" EI_IMPULSE_ERROR run_classifier_continuous(signal_t *signal, ei_impul
 
         // for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
         //     result->classification[ix].value =
-        //         run_moving_average_filter(&classifier_maf[ix], result->classification[ix].value);
+        //         run_moving_average_filter(&ctx->maf[ix], result->classification[ix].value);
         // }
 
         /* Shift the feature buffer for new data */
         for (size_t i = 0; i < (EI_CLASSIFIER_NN_INPUT_FRAME_SIZE - feature_size); i++) {
-            static_features_matrix.buffer[i] = static_features_matrix.buffer[i + feature_size];
+            ctx->features[i] = ctx->features[i + feature_size];
         }
     }
     return ei_impulse_error;
 }
 
+/**
+ * @brief      Fill the complete matrix with sample slices. From there, run inference
+ *             on the matrix.
+ *
+ * @param      signal  Sample data
+ * @param      result  Classification output
+ * @param[in]  debug   Debug output enable boot
+ *
+ * @return     The ei impulse error.
+ */
+extern "C" EI_IMPULSE_ERROR run_classifier_continuous(signal_t *signal, ei_impulse_result_t *result,
+                                                      bool debug = false)
+{
+    return run_classifier_continuous_ctx(&default_impulse_context, signal, result, debug);
+}
+
 #if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE)
 /**
  * Setup the TFLite runtime
@@ -417,11 +505,11 @@ static EI_IMPULSE_ERROR inference_tflite_setup(uint64_t *ctx_start_ms, TfLiteTen
         assert((*output)->type == EI_CLASSIFIER_TFLITE_OUTPUT_DATATYPE);
 #if defined(EI_CLASSIFIER_TFLITE_INPUT_QUANTIZED)
         if (EI_CLASSIFIER_TFLITE_INPUT_QUANTIZED) {
-            assert((*input)->params.scale == EI_CLASSIFIER_TFLITE_INPUT_SCALE);
+            assert((*input)->params.scale == (float)EI_CLASSIFIER_TFLITE_INPUT_SCALE);
             assert((*input)->params.zero_point == EI_CLASSIFIER_TFLITE_INPUT_ZEROPOINT);
         }
         if (EI_CLASSIFIER_TFLITE_INPUT_QUANTIZED) {
-            assert((*output)->params.scale == EI_CLASSIFIER_TFLITE_OUTPUT_SCALE);
+            assert((*output)->params.scale == (float)EI_CLASSIFIER_TFLITE_OUTPUT_SCALE);
             assert((*output)->params.zero_point == EI_CLASSIFIER_TFLITE_OUTPUT_ZEROPOINT);
         }
 #endif
@@ -539,7 +627,7 @@ extern "C" EI_IMPULSE_ERROR run_inference(
         for (size_t ix = 0; ix < fmatrix->rows * fmatrix->cols; ix++) {
             // Quantize the input if it is int8
             if (int8_input) {
-                input->data.int8[ix] = static_cast<int8_t>(round(fmatrix->buffer[ix] / input->params.scale) + input->params.zero_point);
+                input->data.int8[ix] = static_cast<int8_t>(roundf(fmatrix->buffer[ix] / input->params.scale) + input->params.zero_point);
                 // printf("float %ld : %d\r\n", ix, input->data.int8[ix]);
             } else {
                 input->data.f[ix] = fmatrix->buffer[ix];
@@ -616,7 +704,7 @@ extern "C" EI_IMPULSE_ERROR run_inference(
     HAL_Delay(1);
 
     for (int ix = 0; ix < fmatrix->rows * fmatrix->cols; ix++) {
-        in_data[ix] = static_cast<int8_t>(round(fmatrix->buffer[ix] / input_scale) + input_zero_point);
+        in_data[ix] = static_cast<int8_t>(roundf(fmatrix->buffer[ix] / input_scale) + input_zero_point);
     }
 #else
     // fmatrix->buffer <-- input data
@@ -701,7 +789,7 @@ extern "C" EI_IMPULSE_ERROR run_inference(
     #endif
         for (uint16_t ix = 0; ix < fmatrix->rows * fmatrix->cols; ix++) {
     #if EI_CLASSIFIER_TFLITE_INPUT_QUANTIZED == 1
-            input[ix] = static_cast<int8_t>(round(fmatrix->buffer[ix] / EI_CLASSIFIER_TFLITE_INPUT_SCALE) + EI_CLASSIFIER_TFLITE_INPUT_ZEROPOINT);
+            input[ix] = static_cast<int8_t>(roundf(fmatrix->buffer[ix] / (float)EI_CLASSIFIER_TFLITE_INPUT_SCALE) + EI_CLASSIFIER_TFLITE_INPUT_ZEROPOINT);
     #else
             input[ix] = fmatrix->buffer[ix];
     #endif
@@ -753,7 +841,7 @@ extern "C" EI_IMPULSE_ERROR run_inference(
         for (size_t ix = 0; ix < EI_CLASSIFIER_ANOM_AXIS_SIZE; ix++) {
             input[ix] = fmatrix->buffer[EI_CLASSIFIER_ANOM_AXIS[ix]];
         }
-        standard_scaler(input, ei_classifier_anom_scale, ei_classifier_anom_mean, EI_CLASSIFIER_ANOM_AXIS_SIZE);
+        standard_scaler_inv(input, get_anomaly_inv_scale(), ei_classifier_anom_mean, EI_CLASSIFIER_ANOM_AXIS_SIZE);
         float anomaly = get_min_distance_to_cluster(
             input, EI_CLASSIFIER_ANOM_AXIS_SIZE, ei_classifier_anom_clusters, EI_CLASSIFIER_ANOM_CLUSTER_COUNT);
 
@@ -889,7 +977,7 @@ extern "C" EI_IMPULSE_ERROR run_inference_i16(
     HAL_Delay(1);
 
     for (int ix = 0; ix < fmatrix->rows * fmatrix->cols; ix++) {
-        in_data[ix] = static_cast<int8_t>(round(fmatrix->buffer[ix] / input_scale) + input_zero_point);
+        in_data[ix] = static_cast<int8_t>(roundf(fmatrix->buffer[ix] / input_scale) + input_zero_point);
     }
 #else
     // fmatrix->buffer <-- input data
@@ -962,7 +1050,7 @@ extern "C" EI_IMPULSE_ERROR run_inference_i16(
             // numpy::int16_to_float(&fmatrix->buffer[EI_CLASSIFIER_ANOM_AXIS[ix]], &input[ix], 1);
             input[ix] = (float)fmatrix->buffer[EI_CLASSIFIER_ANOM_AXIS[ix]] / 32768.f;
         }
-        standard_scaler(input, ei_classifier_anom_scale, ei_classifier_anom_mean, EI_CLASSIFIER_ANOM_AXIS_SIZE);
+        standard_scaler_inv(input, get_anomaly_inv_scale(), ei_classifier_anom_mean, EI_CLASSIFIER_ANOM_AXIS_SIZE);
         float anomaly = get_min_distance_to_cluster(
             input, EI_CLASSIFIER_ANOM_AXIS_SIZE, ei_classifier_anom_clusters, EI_CLASSIFIER_ANOM_CLUSTER_COUNT);
 
@@ -989,13 +1077,16 @@ extern "C" EI_IMPULSE_ERROR run_inference_i16(
 }
 
 /**
- * Run the classifier over a raw features array
+ * Run the classifier over a raw features array, keeping the DSP state that can be reused
+ * between windows (the spectral analysis engine) in a context
+ * @param ctx Context to keep the DSP state in, see ei_impulse_context_init
  * @param raw_features Raw features array
  * @param raw_features_size Size of the features array
  * @param result Object to store the results in
  * @param debug Whether to show debug messages (default: false)
  */
-extern "C" EI_IMPULSE_ERROR run_classifier(
+extern "C" EI_IMPULSE_ERROR run_classifier_ctx(
+    ei_impulse_context_t *ctx,
     signal_t *signal,
     ei_impulse_result_t *result,
     bool debug = false)
@@ -1035,7 +1126,14 @@ extern "C" EI_IMPULSE_ERROR run_classifier(
 
         ei::matrix_t fm(1, block.n_output_features, features_matrix.buffer + out_features_index);
 
-        int ret = block.extract_fn(signal, &fm, block.config, EI_CLASSIFIER_FREQUENCY);
+        // extract_spectral_analysis_features is overloaded for the i16 blocks, pick the float one
+        int ret;
+        if (block.extract_fn == static_cast<decltype(block.extract_fn)>(extract_spectral_analysis_features)) {
+            ret = extract_spectral_analysis_features_ctx(ctx, signal, &fm, block.config, EI_CLASSIFIER_FREQUENCY);
+        }
+        else {
+            ret = block.extract_fn(signal, &fm, block.config, EI_CLASSIFIER_FREQUENCY);
+        }
         if (ret != EIDSP_OK) {
             ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
             return EI_IMPULSE_DSP_ERROR;
@@ -1068,6 +1166,21 @@ extern "C" EI_IMPULSE_ERROR run_classifier(
     return run_inference(&features_matrix, result, debug);
 }
 
+/**
+ * Run the classifier over a raw features array
+ * @param raw_features Raw features array
+ * @param raw_features_size Size of the features array
+ * @param result Object to store the results in
+ * @param debug Whether to show debug messages (default: false)
+ */
+extern "C" EI_IMPULSE_ERROR run_classifier(
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    bool debug = false)
+{
+    return run_classifier_ctx(&default_impulse_context, signal, result, debug);
+}
+
 #if defined(EI_CLASSIFIER_USE_QUANTIZED_DSP_BLOCK) && EI_CLASSIFIER_USE_QUANTIZED_DSP_BLOCK == 1
 
 extern "C" EI_IMPULSE_ERROR run_classifier_i16(
@@ -24,6 +24,7 @@
 #define _EDGE_IMPULSE_RUN_DSP_H_
 
 #include "model-parameters/model_metadata.h"
+#include "ei_classifier_types.h"
 #include "edge-impulse-sdk/dsp/spectral/spectral.hpp"
 #include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
 
@@ -45,7 +46,24 @@ using namespace ei;
 float ei_dsp_image_buffer[EI_DSP_IMAGE_BUFFER_STATIC_SIZE];
 #endif
 
-__attribute__((unused)) int extract_spectral_analysis_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
+/**
+ * Release the spectral analysis engine of a context
+ */
+__attribute__((unused)) static void free_spectral_engine(ei_impulse_context_t *ctx) {
+    if (ctx->spectral_engine) {
+        delete static_cast<spectral::engine*>(ctx->spectral_engine);
+        ctx->memory_used -= sizeof(spectral::engine);
+    }
+    ctx->spectral_engine = NULL;
+    ctx->spectral_config = NULL;
+}
+
+/**
+ * Spectral analysis on the engine of a context. The FFT plan and spectral power edges only
+ * depend on the block config, so the engine is only rebuilt when a different block (or signal
+ * length) comes along; streams with their own context do not rebuild each other's engine.
+ */
+__attribute__((unused)) int extract_spectral_analysis_features_ctx(ei_impulse_context_t *ctx, signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
     ei_dsp_config_spectral_analysis_t config = *((ei_dsp_config_spectral_analysis_t*)config_ptr);
 
     int ret;
@@ -74,40 +92,45 @@ __attribute__((unused)) int extract_spectral_analysis_features(signal_t *signal,
         EIDSP_ERR(ret);
     }
 
-    // the spectral edges that we want to calculate
-    matrix_t edges_matrix_in(64, 1);
-    size_t edge_matrix_ix = 0;
+    spectral::filter_t filter_type;
+    if (strcmp(config.filter_type, "low") == 0) {
+        filter_type = spectral::filter_lowpass;
+    }
+    else if (strcmp(config.filter_type, "high") == 0) {
+        filter_type = spectral::filter_highpass;
+    }
+    else {
+        filter_type = spectral::filter_none;
+    }
 
-    char spectral_str[128] = { 0 };
-    if (strlen(config.spectral_power_edges) > sizeof(spectral_str) - 1) {
-        EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+    if (!ctx->spectral_engine) {
+        ctx->spectral_engine = new spectral::engine();
+        if (!ctx->spectral_engine) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        ctx->memory_used += sizeof(spectral::engine);
     }
-    memcpy(spectral_str, config.spectral_power_edges, strlen(config.spectral_power_edges));
 
-    // convert spectral_power_edges (string) into float array
-    char *spectral_ptr = spectral_str;
-    while (spectral_ptr != NULL) {
-        edges_matrix_in.buffer[edge_matrix_ix++] = atof(spectral_ptr);
+    spectral::engine &engine = *static_cast<spectral::engine*>(ctx->spectral_engine);
 
-        // find next (spectral) delimiter (or '\0' character)
-        while((*spectral_ptr != ',')) {
-            spectral_ptr++;
-            if (*spectral_ptr == '\0') break;
-        }
+    if (config_ptr != ctx->spectral_config || frequency != ctx->spectral_frequency || input_matrix.cols != ctx->spectral_length) {
+        ctx->spectral_config = NULL;
 
-        if (*spectral_ptr == '\0') {
-            spectral_ptr = NULL;
-        }
-        else  {
-            spectral_ptr++;
+        ret = engine.init(sampling_freq, input_matrix.cols, filter_type, config.filter_cutoff,
+            config.filter_order, config.fft_length, config.spectral_peaks_count,
+            config.spectral_peaks_threshold, config.spectral_power_edges);
+        if (ret != EIDSP_OK) {
+            ei_printf("ERR: Failed to initialize spectral analysis (%d)\n", ret);
+            EIDSP_ERR(ret);
         }
+
+        ctx->spectral_config = config_ptr;
+        ctx->spectral_frequency = frequency;
+        ctx->spectral_length = input_matrix.cols;
     }
-    edges_matrix_in.rows = edge_matrix_ix;
 
     // calculate how much room we need for the output matrix
-    size_t output_matrix_cols = spectral::feature::calculate_spectral_buffer_size(
-        true, config.spectral_peaks_count, edges_matrix_in.rows
-    );
+    size_t output_matrix_cols = engine.get_feature_count();
     // ei_printf("output_matrix_size %hux%zu\n", input_matrix.rows, output_matrix_cols);
     if (output_matrix->cols * output_matrix->rows != static_cast<uint32_t>(output_matrix_cols * config.axes)) {
         EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
@@ -116,20 +139,7 @@ __attribute__((unused)) int extract_spectral_analysis_features(signal_t *signal,
     output_matrix->cols = output_matrix_cols;
     output_matrix->rows = config.axes;
 
-    spectral::filter_t filter_type;
-    if (strcmp(config.filter_type, "low") == 0) {
-        filter_type = spectral::filter_lowpass;
-    }
-    else if (strcmp(config.filter_type, "high") == 0) {
-        filter_type = spectral::filter_highpass;
-    }
-    else {
-        filter_type = spectral::filter_none;
-    }
-
-    ret = spectral::feature::spectral_analysis(output_matrix, &input_matrix,
-        sampling_freq, filter_type, config.filter_cutoff, config.filter_order,
-        config.fft_length, config.spectral_peaks_count, config.spectral_peaks_threshold, &edges_matrix_in);
+    ret = engine.extract(output_matrix, &input_matrix);
     if (ret != EIDSP_OK) {
         ei_printf("ERR: Failed to calculate spectral features (%d)\n", ret);
         EIDSP_ERR(ret);
@@ -142,6 +152,16 @@ __attribute__((unused)) int extract_spectral_analysis_features(signal_t *signal,
     return EIDSP_OK;
 }
 
+__attribute__((unused)) int extract_spectral_analysis_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
+    // without a context to keep it in, the engine only lives for this window
+    ei_impulse_context_t ctx;
+    memset(&ctx, 0, sizeof(ei_impulse_context_t));
+
+    int ret = extract_spectral_analysis_features_ctx(&ctx, signal, output_matrix, config_ptr, frequency);
+    free_spectral_engine(&ctx);
+    return ret;
+}
+
 matrix_i16_t *create_edges_matrix(ei_dsp_config_spectral_analysis_t config, const float sampling_freq)
 {
     // the spectral edges that we want to calculate
@@ -160,7 +180,7 @@ matrix_i16_t *create_edges_matrix(ei_dsp_config_spectral_analysis_t config, cons
         // convert spectral_power_edges (string) into float array
         char *spectral_ptr = spectral_str;
         while (spectral_ptr != NULL) {
-            float edge = (atof(spectral_ptr) / (float)(sampling_freq/2.f));
+            float edge = (strtof(spectral_ptr, NULL) / (float)(sampling_freq/2.f));
             numpy::float_to_int16(&edge, &edges_matrix_in.buffer[edge_matrix_ix++], 1);
 
             // find next (spectral) delimiter (or '\0' character)
@@ -440,7 +460,11 @@ __attribute__((unused)) int extract_mfcc_features(signal_t *signal, matrix_t *ou
     return EIDSP_OK;
 }
 
-__attribute__((unused)) int extract_mfcc_per_slice_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float sampling_frequency) {
+/**
+ * Extract the features of one slice of a continuous stream. first_slice is true for the
+ * first slice of a stream, which isn't preceded by a frame of the previous slice.
+ */
+__attribute__((unused)) int extract_mfcc_per_slice_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float sampling_frequency, bool first_slice) {
 
     ei_dsp_config_mfcc_t config = *((ei_dsp_config_mfcc_t*)config_ptr);
 
@@ -461,15 +485,11 @@ __attribute__((unused)) int extract_mfcc_per_slice_features(signal_t *signal, ma
     /* Fake an extra frame_length for stack frames calculations. There, 1 frame_length is always
     subtracted and there for never used. But skip the first slice to fit the feature_matrix
     buffer */
-    static bool first_run = false;
-
     if(config.implementation_version < 2) {
 
-        if (first_run == true) {
+        if (!first_slice) {
             signal->total_length += (size_t)(config.frame_length * (float)frequency);
         }
-
-        first_run = true;
     }
 
     signal_t preemphasized_audio_signal;
@@ -503,7 +523,7 @@ __attribute__((unused)) int extract_mfcc_per_slice_features(signal_t *signal, ma
     output_matrix->rows = 1;
 
     if(config.implementation_version < 2) {
-        if (first_run == true) {
+        if (!first_slice) {
             signal->total_length -= (size_t)(config.frame_length * (float)frequency);
         }
     }
@@ -561,11 +581,13 @@ __attribute__((unused)) int extract_spectrogram_features(signal_t *signal, matri
     return EIDSP_OK;
 }
 
-__attribute__((unused)) int extract_spectrogram_per_slice_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float sampling_frequency) {
+/**
+ * Extract the features of one slice of a continuous stream. first_slice is true for the
+ * first slice of a stream, which isn't preceded by a frame of the previous slice.
+ */
+__attribute__((unused)) int extract_spectrogram_per_slice_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float sampling_frequency, bool first_slice) {
     ei_dsp_config_spectrogram_t config = *((ei_dsp_config_spectrogram_t*)config_ptr);
 
-    static bool first_run = false;
-
     if (config.axes != 1) {
         EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
     }
@@ -575,12 +597,10 @@ __attribute__((unused)) int extract_spectrogram_per_slice_features(signal_t *sig
     /* Fake an extra frame_length for stack frames calculations. There, 1 frame_length is always
     subtracted and there for never used. But skip the first slice to fit the feature_matrix
     buffer */
-    if (first_run == true) {
+    if (!first_slice) {
         signal->total_length += (size_t)(config.frame_length * (float)frequency);
     }
 
-    first_run = true;
-
     // calculate the size of the MFE matrix
     matrix_size_t out_matrix_size =
         speechpy::feature::calculate_mfe_buffer_size(
@@ -666,11 +686,13 @@ __attribute__((unused)) int extract_mfe_features(signal_t *signal, matrix_t *out
     return EIDSP_OK;
 }
 
-__attribute__((unused)) int extract_mfe_per_slice_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float sampling_frequency) {
+/**
+ * Extract the features of one slice of a continuous stream. first_slice is true for the
+ * first slice of a stream, which isn't preceded by a frame of the previous slice.
+ */
+__attribute__((unused)) int extract_mfe_per_slice_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float sampling_frequency, bool first_slice) {
     ei_dsp_config_mfe_t config = *((ei_dsp_config_mfe_t*)config_ptr);
 
-    static bool first_run = false;
-
     if (config.axes != 1) {
         EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
     }
@@ -680,12 +702,10 @@ __attribute__((unused)) int extract_mfe_per_slice_features(signal_t *signal, mat
     /* Fake an extra frame_length for stack frames calculations. There, 1 frame_length is always
     subtracted and there for never used. But skip the first slice to fit the feature_matrix
     buffer */
-    if (first_run == true) {
+    if (!first_slice) {
         signal->total_length += (size_t)(config.frame_length * (float)frequency);
     }
 
-    first_run = true;
-
     // calculate the size of the MFE matrix
     matrix_size_t out_matrix_size =
         speechpy::feature::calculate_mfe_buffer_size(
@@ -98,5 +98,19 @@
 #define EIDSP_SIGNAL_C_FN_POINTER    0
 #endif // EIDSP_SIGNAL_C_FN_POINTER
 
+// The per-frame paths are always computed in single precision. Designing filters,
+// window spectra and FFT twiddles is done in double, unless this is set:
+// on a single precision FPU (Cortex-M4F) double math is emulated in software,
+// and pulls in the double precision math library
+#ifndef EIDSP_FLOAT_ONLY
+#define EIDSP_FLOAT_ONLY             0
+#endif // EIDSP_FLOAT_ONLY
+
+#if EIDSP_FLOAT_ONLY == 1
+typedef float EIDSP_design_t;
+#else
+typedef double EIDSP_design_t;
+#endif // EIDSP_FLOAT_ONLY
+
 // clang-format on
 #endif // _EIDSP_CPP_CONFIG_H_
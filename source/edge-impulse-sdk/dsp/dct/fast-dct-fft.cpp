@@ -69,8 +69,8 @@ int ei::dct::transform(float vector[], size_t len) {
 	}
 
 	for (size_t i = 0; i < len / 2 + 1; i++) {
-		float temp = i * M_PI / (len * 2);
-		vector[i] = fft_data_out[i].r * cos(temp) + fft_data_out[i].i * sin(temp);
+		float temp = static_cast<float>(i) * static_cast<float>(M_PI) / static_cast<float>(len * 2);
+		vector[i] = fft_data_out[i].r * cosf(temp) + fft_data_out[i].i * sinf(temp);
 	}
 
 	ei_dsp_free(fft_data_in, fft_data_in_size);
@@ -114,9 +114,9 @@ int ei::dct::inverse_transform(float vector[], size_t len) {
 	}
 
 	for (size_t i = 0; i < len; i++) {
-		float temp = i * M_PI / (len * 2);
-		fft_data_in[i].r = vector[i] * cos(temp);
-		fft_data_in[i].i *= -sin(temp);
+		float temp = static_cast<float>(i) * static_cast<float>(M_PI) / static_cast<float>(len * 2);
+		fft_data_in[i].r = vector[i] * cosf(temp);
+		fft_data_in[i].i *= -sinf(temp);
 	}
 
 	kiss_fft(cfg, fft_data_in, fft_data_out);
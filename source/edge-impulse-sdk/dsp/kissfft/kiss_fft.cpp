@@ -303,8 +303,8 @@ static
 void kf_factor(int n,int * facbuf)
 {
     int p=4;
-    double floor_sqrt;
-    floor_sqrt = floor( sqrt((double)n) );
+    EIDSP_design_t floor_sqrt;
+    floor_sqrt = floor( sqrt((EIDSP_design_t)n) );
 
     /*factor out powers of 4, powers of 2, then any remaining primes */
     do {
@@ -350,14 +350,14 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem,
         if (inverse_fft)
         {
             for (i=0;i<nfft;++i) {
-                const double pi=3.141592653589793238462643383279502884197169399375105820974944;
-                double phase = 2*pi*i / nfft;
+                const EIDSP_design_t pi=(EIDSP_design_t)3.141592653589793238462643383279502884197169399375105820974944;
+                EIDSP_design_t phase = 2*pi*i / nfft;
                 kf_cexp(st->twiddles+i, phase );
             }
         } else {
             for (i=0;i<nfft;++i) {
-                const double pi=3.141592653589793238462643383279502884197169399375105820974944;
-                double phase = -2*pi*i / nfft;
+                const EIDSP_design_t pi=(EIDSP_design_t)3.141592653589793238462643383279502884197169399375105820974944;
+                EIDSP_design_t phase = -2*pi*i / nfft;
                 kf_cexp(st->twiddles+i, phase );
             }
         }
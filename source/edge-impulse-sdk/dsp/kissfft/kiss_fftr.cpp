@@ -50,14 +50,14 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
 
     if (inverse_fft) {
         for (i = 0; i < nfft/2; ++i) {
-            double phase =
-                3.14159265358979323846264338327 * ((double) (i+1) / nfft + .5);
+            EIDSP_design_t phase =
+                (EIDSP_design_t)3.14159265358979323846264338327 * ((EIDSP_design_t) (i+1) / nfft + (EIDSP_design_t).5);
             kf_cexp (st->super_twiddles+i,phase);
         }
     } else  {
         for (i = 0; i < nfft/2; ++i) {
-            double phase =
-                -3.14159265358979323846264338327 * ((double) (i+1) / nfft + .5);
+            EIDSP_design_t phase =
+                -(EIDSP_design_t)3.14159265358979323846264338327 * ((EIDSP_design_t) (i+1) / nfft + (EIDSP_design_t).5);
             kf_cexp (st->super_twiddles+i,phase);
         }
     }
@@ -262,7 +262,7 @@ public:
         }
 
         for (uint16_t j = 0; j < matrix2->cols; j++) {
-            float tmp = 0.0;
+            float tmp = 0.0f;
             for (uint16_t k = 0; k < matrix1_cols; k++) {
                 uint8_t u8 = matrix2->buffer[k * matrix2->cols + j];
                 if (u8) { // this matrix appears to be very sparsely populated
@@ -462,9 +462,9 @@ public:
         }
 
         if (normalization == DCT_NORMALIZATION_ORTHO) {
-            input[0] = input[0] * sqrt(1.0f / static_cast<float>(4 * N));
+            input[0] = input[0] * sqrtf(1.0f / static_cast<float>(4 * N));
             for (size_t ix = 1; ix < N; ix++) {
-                input[ix] = input[ix] * sqrt(1.0f / static_cast<float>(2 * N));
+                input[ix] = input[ix] * sqrtf(1.0f / static_cast<float>(2 * N));
             }
         }
 
@@ -863,12 +863,12 @@ public:
             arm_rms_f32(matrix->buffer + (row * matrix->cols), matrix->cols, &rms_result);
             output_matrix->buffer[row] = rms_result;
 #else
-            float sum = 0.0;
+            float sum = 0.0f;
             for(size_t ix = 0; ix < matrix->cols; ix++) {
                 float v = matrix->buffer[(row * matrix->cols) + ix];
                 sum += v * v;
             }
-            output_matrix->buffer[row] = sqrt(sum / static_cast<float>(matrix->cols));
+            output_matrix->buffer[row] = sqrtf(sum / static_cast<float>(matrix->cols));
 #endif
         }
 
@@ -1041,7 +1041,7 @@ public:
                 std += tmp * tmp;
             }
 
-            output_matrix->buffer[col] = sqrt(std / input_matrix->rows);
+            output_matrix->buffer[col] = sqrtf(std / input_matrix->rows);
         }
 
         return EIDSP_OK;
@@ -1157,7 +1157,7 @@ public:
                 std += diff * diff;
             }
 
-            output_matrix->buffer[row] = sqrt(std / input_matrix->cols);
+            output_matrix->buffer[row] = sqrtf(std / input_matrix->cols);
 #endif
         }
 
@@ -1219,7 +1219,7 @@ public:
             m_2 = m_2 / input_matrix->cols;
 
             // Calculate (m_2)^(3/2)
-            m_2 = sqrt(m_2 * m_2 * m_2);
+            m_2 = sqrtf(m_2 * m_2 * m_2);
 
             // Calculate skew = (m_3) / (m_2)^(3/2)
             output_matrix->buffer[row] = m_3 / m_2;
@@ -1353,7 +1353,7 @@ public:
             for (size_t ix = 1; ix < n_fft_out_features - 1; ix += 1) {
                 float rms_result;
                 arm_rms_f32(fft_output.buffer + fft_output_buffer_ix, 2, &rms_result);
-                output[ix] = rms_result * sqrt(2);
+                output[ix] = rms_result * 1.414213562f; /* sqrt(2) */
 
                 fft_output_buffer_ix += 2;
             }
@@ -2066,7 +2066,7 @@ private:
 
         // and write back to the output
         for (size_t ix = 0; ix < n_fft_out_features; ix++) {
-            output[ix] = sqrt(pow(fft_output[ix].r, 2) + pow(fft_output[ix].i, 2));
+            output[ix] = sqrtf(fft_output[ix].r * fft_output[ix].r + fft_output[ix].i * fft_output[ix].i);
         }
 
         ei_dsp_free(cfg, kiss_fftr_mem_length);
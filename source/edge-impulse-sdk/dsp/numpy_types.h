@@ -510,6 +510,59 @@ typedef struct ei_signal_i16_t {
     size_t total_length;
 } signal_i16_t;
 
+/**
+ * A signal held in one contiguous int8 buffer. Pass `&signal` to the classifier:
+ * blocks that support it (preemphasis) find the buffer through signal_i8_t::of()
+ * and read the samples in place, multiplied by `scale`, rather than staging them
+ * through get_data. Every other block uses `signal` as usual, so its get_data
+ * has to be set by the caller too.
+ * Keep the wrapper alive (and in place) while the signal is in use; wrappers
+ * may be nested, but are released in the reverse order they were created in.
+ */
+typedef struct ei_signal_i8_t {
+    signal_t signal;
+    const EIDSP_i8 *buffer;
+    float scale;
+
+    ei_signal_i8_t(const EIDSP_i8 *buffer, size_t length, float scale = 1.0f)
+        : buffer(buffer), scale(scale), previous(last())
+    {
+        signal.total_length = length;
+        last() = this;
+    }
+
+    ~ei_signal_i8_t()
+    {
+        last() = previous;
+    }
+
+    /**
+     * Find the int8 buffer behind a signal.
+     * @returns the wrapper holding `signal`, or NULL if it isn't held by one
+     */
+    static const ei_signal_i8_t *of(const signal_t *signal)
+    {
+        for (const ei_signal_i8_t *s = last(); s != NULL; s = s->previous) {
+            if (&s->signal == signal) {
+                return s;
+            }
+        }
+        return NULL;
+    }
+
+private:
+    ei_signal_i8_t(const ei_signal_i8_t &);
+    ei_signal_i8_t &operator=(const ei_signal_i8_t &);
+
+    static ei_signal_i8_t *&last()
+    {
+        static ei_signal_i8_t *wrapper = NULL;
+        return wrapper;
+    }
+
+    ei_signal_i8_t *previous;
+} signal_i8_t;
+
 #ifdef __cplusplus
 } // namespace ei {
 #endif // __cplusplus
@@ -0,0 +1,438 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2021 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _EIDSP_SPECTRAL_ENGINE_H_
+#define _EIDSP_SPECTRAL_ENGINE_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../numpy.hpp"
+#include "processing.hpp"
+#include "feature.hpp"
+
+#ifndef EIDSP_SPECTRAL_ENGINE_MAX_EDGES
+#define EIDSP_SPECTRAL_ENGINE_MAX_EDGES     64
+#endif
+
+namespace ei {
+namespace spectral {
+
+/**
+ * Spectral analysis with the per-configuration work done once.
+ *
+ * `feature::spectral_analysis` runs two FFTs per axis (one for the peaks, one for the
+ * Welch periodogram) and finds its band of every bin by walking the edge list. Both
+ * spectra are transforms of the same first min(cols, fft_length) samples; the
+ * periodogram only subtracts their mean first. Since the FFT is linear that is
+ * X[k] - mean * W[k], with W the spectrum of the (zero padded) rectangular window,
+ * so one FFT per axis is enough. The FFT plan, W and the band of every bin are
+ * built in `init`, and `extract` gives the same features as `spectral_analysis`.
+ */
+class engine {
+public:
+    engine() :
+        _sampling_freq(0.0f), _fft_length(0), _signal_length(0), _segment_length(0),
+        _fft_peaks(0), _fft_peaks_threshold(0.0f), _filter_type(filter_none),
+        _band_count(0), _bins(0),
+        _fft_input(NULL), _spectrum(NULL), _window(NULL), _magnitude(NULL), _band(NULL),
+        _band_scale(NULL), _band_power(NULL)
+#if EIDSP_USE_CMSIS_DSP
+        , _use_rfft_fast(false)
+#endif
+        , _kiss_cfg(NULL), _kiss_mem_length(0)
+    {
+    }
+
+    ~engine() {
+        release();
+    }
+
+    /**
+     * Build the FFT plan, window spectrum and band table for a configuration.
+     * @param sampling_freq Sampling frequency of the signal
+     * @param signal_length Number of samples per axis
+     * @param filter_type Filter type
+     * @param filter_cutoff Filter cutoff frequency
+     * @param filter_order Filter order
+     * @param fft_length Length of the FFT signal
+     * @param fft_peaks Number of FFT peaks to find
+     * @param fft_peaks_threshold Minimum threshold
+     * @param edges Spectral power edges, comma separated (e.g. "0.1, 0.5, 1.0, 2.0, 5.0")
+     * @returns 0 if OK
+     */
+    int init(
+        float sampling_freq,
+        size_t signal_length,
+        filter_t filter_type,
+        float filter_cutoff,
+        uint8_t filter_order,
+        uint16_t fft_length,
+        uint8_t fft_peaks,
+        float fft_peaks_threshold,
+        const char *edges)
+    {
+        release();
+
+        if (fft_length < 4 || signal_length == 0) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        float edge_freq[EIDSP_SPECTRAL_ENGINE_MAX_EDGES];
+        size_t edge_count = 0;
+
+        // same parsing as before: strtof on every comma separated field
+        const char *edge_ptr = edges;
+        while (edge_ptr != NULL) {
+            if (edge_count == EIDSP_SPECTRAL_ENGINE_MAX_EDGES) {
+                EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+            }
+            edge_freq[edge_count++] = strtof(edge_ptr, NULL);
+
+            edge_ptr = strchr(edge_ptr, ',');
+            if (edge_ptr != NULL) {
+                edge_ptr++;
+            }
+        }
+
+        _sampling_freq = sampling_freq;
+        _fft_length = fft_length;
+        _signal_length = signal_length;
+        _segment_length = signal_length < fft_length ? signal_length : fft_length;
+        _fft_peaks = fft_peaks;
+        _fft_peaks_threshold = fft_peaks_threshold;
+        _filter_type = filter_type;
+        _band_count = edge_count - 1;
+        _bins = fft_length / 2 + 1;
+
+        int ret = EIDSP_OK;
+        if (filter_type == filter_lowpass) {
+            ret = _filter.init_lowpass(filter_order, sampling_freq, filter_cutoff);
+        }
+        else if (filter_type == filter_highpass) {
+            ret = _filter.init_highpass(filter_order, sampling_freq, filter_cutoff);
+        }
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        _fft_input = (float*)ei_dsp_calloc(fft_length * sizeof(float), 1);
+        _spectrum = (fft_complex_t*)ei_dsp_calloc(_bins * sizeof(fft_complex_t), 1);
+        _magnitude = (float*)ei_dsp_calloc(_bins * sizeof(float), 1);
+        _band = (uint8_t*)ei_dsp_calloc(_bins * sizeof(uint8_t), 1);
+        if (_band_count > 0) {
+            _band_scale = (float*)ei_dsp_calloc(_band_count * sizeof(float), 1);
+            _band_power = (float*)ei_dsp_calloc(_band_count * sizeof(float), 1);
+        }
+        if (!_fft_input || !_spectrum || !_magnitude || !_band ||
+                (_band_count > 0 && (!_band_scale || !_band_power))) {
+            release();
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        // the band every bin falls in, and 1 / (number of bins in the band)
+        uint16_t band_bins[EIDSP_SPECTRAL_ENGINE_MAX_EDGES] = { 0 };
+        for (size_t ix = 0; ix < _bins; ix++) {
+            float t = static_cast<float>(ix) * (1.0f / (fft_length * (1.0f / sampling_freq)));
+
+            _band[ix] = no_band;
+            for (size_t ex = 0; ex < _band_count; ex++) {
+                if (t >= edge_freq[ex] && t < edge_freq[ex + 1]) {
+                    _band[ix] = ex;
+                    band_bins[ex]++;
+                    break;
+                }
+            }
+        }
+        for (size_t ex = 0; ex < _band_count; ex++) {
+            _band_scale[ex] = band_bins[ex] == 0 ? 0.0f : 1.0f / static_cast<float>(band_bins[ex]);
+        }
+
+        // with a full segment the window spectrum is just N at DC, no need to store it
+        if (_segment_length < fft_length) {
+            _window = (fft_complex_t*)ei_dsp_calloc(_bins * sizeof(fft_complex_t), 1);
+            if (!_window) {
+                release();
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
+
+            // W[k] = sum(n < L) e^(-2 pi i k n / N), in EIDSP_design_t as this only runs once
+            const EIDSP_design_t pi = static_cast<EIDSP_design_t>(3.14159265358979323846);
+            const EIDSP_design_t L = static_cast<EIDSP_design_t>(_segment_length);
+            for (size_t k = 0; k < _bins; k++) {
+                if (k == 0) {
+                    _window[k].r = static_cast<float>(L);
+                    _window[k].i = 0.0f;
+                    continue;
+                }
+                EIDSP_design_t a = pi * static_cast<EIDSP_design_t>(k) / static_cast<EIDSP_design_t>(fft_length);
+                EIDSP_design_t amplitude = std::sin(a * L) / std::sin(a);
+                _window[k].r = static_cast<float>(amplitude * std::cos(a * (L - 1)));
+                _window[k].i = static_cast<float>(-amplitude * std::sin(a * (L - 1)));
+            }
+        }
+
+#if EIDSP_USE_CMSIS_DSP
+        if (fft_length == 32 || fft_length == 64 || fft_length == 128 || fft_length == 256 ||
+                fft_length == 512 || fft_length == 1024 || fft_length == 2048 || fft_length == 4096) {
+            if (arm_rfft_fast_init_f32(&_rfft_instance, fft_length) != ARM_MATH_SUCCESS) {
+                release();
+                EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+            }
+            _use_rfft_fast = true;
+            return EIDSP_OK;
+        }
+#endif
+
+        _kiss_cfg = kiss_fftr_alloc(fft_length, 0, NULL, NULL, &_kiss_mem_length);
+        if (!_kiss_cfg) {
+            release();
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        ei_dsp_register_alloc(_kiss_mem_length);
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Number of features `extract` writes per axis
+     */
+    size_t get_feature_count() {
+        return feature::calculate_spectral_buffer_size(true, _fft_peaks, _band_count + 1);
+    }
+
+    /**
+     * Calculate the spectral features over a signal. The signal is modified in place
+     * (mean removed, filtered), just like `feature::spectral_analysis` does.
+     * @param out_features Output matrix, one row per axis of `get_feature_count()` features
+     * @param input_matrix Signal, with one row per axis of the length passed to `init`
+     * @returns 0 if OK
+     */
+    int extract(matrix_t *out_features, matrix_t *input_matrix) {
+        if (!_spectrum) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        if (out_features->rows != input_matrix->rows || out_features->cols != get_feature_count()) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        if (input_matrix->cols != _signal_length) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        int ret;
+
+        // remove the mean of every axis, then filter
+        EI_DSP_MATRIX(mean_matrix, input_matrix->rows, 1);
+        ret = numpy::mean(input_matrix, &mean_matrix);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        ret = numpy::subtract(input_matrix, &mean_matrix);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        if (_filter_type != filter_none) {
+            for (size_t row = 0; row < input_matrix->rows; row++) {
+                float *axis = input_matrix->buffer + (row * input_matrix->cols);
+                _filter.reset();
+                _filter.process(axis, axis, input_matrix->cols);
+            }
+        }
+
+        EI_DSP_MATRIX(rms_matrix, input_matrix->rows, 1);
+        ret = numpy::rms(input_matrix, &rms_matrix);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        EI_DSP_MATRIX_B(magnitude_matrix, 1, _bins, _magnitude);
+        EI_DSP_MATRIX(peaks_matrix, _fft_peaks, 2);
+
+        const float magnitude_scale = 2.0f / static_cast<float>(_fft_length);
+        const float power_scale = 1.0f / (_sampling_freq * _segment_length);
+
+        for (size_t row = 0; row < input_matrix->rows; row++) {
+            const float *axis = input_matrix->buffer + (row * input_matrix->cols);
+
+            memcpy(_fft_input, axis, _segment_length * sizeof(float));
+            memset(_fft_input + _segment_length, 0, (_fft_length - _segment_length) * sizeof(float));
+
+            float segment_mean = 0.0f;
+            for (size_t ix = 0; ix < _segment_length; ix++) {
+                segment_mean += axis[ix];
+            }
+            segment_mean /= static_cast<float>(_segment_length);
+
+            ret = transform();
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+
+            // peaks are taken from the magnitude spectrum, scaled by 2/N
+            for (size_t ix = 0; ix < _bins; ix++) {
+                _magnitude[ix] = sqrtf(_spectrum[ix].r * _spectrum[ix].r +
+                    _spectrum[ix].i * _spectrum[ix].i) * magnitude_scale;
+            }
+#if EIDSP_USE_CMSIS_DSP
+            if (_use_rfft_fast) {
+                // numpy::rfft hands out the signed real parts of DC and Nyquist here
+                _magnitude[0] = _spectrum[0].r * magnitude_scale;
+                _magnitude[_bins - 1] = _spectrum[_bins - 1].r * magnitude_scale;
+            }
+#endif
+
+            ret = processing::find_fft_peaks(&magnitude_matrix, &peaks_matrix,
+                _sampling_freq, _fft_peaks_threshold, _fft_length);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+
+            // band powers from the periodogram of the segment with its mean removed
+            for (size_t ex = 0; ex < _band_count; ex++) {
+                _band_power[ex] = 0.0f;
+            }
+            for (size_t ix = 0; ix < _bins; ix++) {
+                if (_band[ix] == no_band) {
+                    continue;
+                }
+
+                float r = _spectrum[ix].r;
+                float i = _spectrum[ix].i;
+                if (_window) {
+                    r -= segment_mean * _window[ix].r;
+                    i -= segment_mean * _window[ix].i;
+                }
+                else if (ix == 0) {
+                    r -= segment_mean * static_cast<float>(_fft_length);
+                }
+
+                float power = (r * r + i * i) * power_scale;
+                if (ix != _bins - 1) {
+                    power *= 2;
+                }
+                _band_power[_band[ix]] += power;
+            }
+
+            float *features_row = out_features->buffer + (row * out_features->cols);
+
+            size_t fx = 0;
+
+            features_row[fx++] = rms_matrix.buffer[row];
+            for (size_t peak_row = 0; peak_row < peaks_matrix.rows; peak_row++) {
+                features_row[fx++] = peaks_matrix.buffer[peak_row * peaks_matrix.cols + 0];
+                features_row[fx++] = peaks_matrix.buffer[peak_row * peaks_matrix.cols + 1];
+            }
+            for (size_t ex = 0; ex < _band_count; ex++) {
+                features_row[fx++] = _band_power[ex] * _band_scale[ex] / 10.0f;
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+private:
+    static const uint8_t no_band = 0xff;
+
+    /**
+     * FFT of _fft_input into _spectrum, with the plan built in `init`
+     */
+    int transform() {
+#if EIDSP_USE_CMSIS_DSP
+        if (_use_rfft_fast) {
+            // the packed output (DC, Nyquist, then complex bins) fits in the spectrum buffer
+            float *packed = (float*)_spectrum;
+            arm_rfft_fast_f32(&_rfft_instance, _fft_input, packed, 0);
+
+            _spectrum[_bins - 1].r = packed[1];
+            _spectrum[_bins - 1].i = 0.0f;
+            _spectrum[0].i = 0.0f;
+            return EIDSP_OK;
+        }
+#endif
+        kiss_fftr(_kiss_cfg, _fft_input, (kiss_fft_cpx*)_spectrum);
+        return EIDSP_OK;
+    }
+
+    void release() {
+        if (_kiss_cfg) {
+            ei_dsp_free(_kiss_cfg, _kiss_mem_length);
+            _kiss_cfg = NULL;
+        }
+#if EIDSP_USE_CMSIS_DSP
+        _use_rfft_fast = false;
+#endif
+        if (_fft_input) ei_dsp_free(_fft_input, _fft_length * sizeof(float));
+        if (_spectrum) ei_dsp_free(_spectrum, _bins * sizeof(fft_complex_t));
+        if (_window) ei_dsp_free(_window, _bins * sizeof(fft_complex_t));
+        if (_magnitude) ei_dsp_free(_magnitude, _bins * sizeof(float));
+        if (_band) ei_dsp_free(_band, _bins * sizeof(uint8_t));
+        if (_band_scale) ei_dsp_free(_band_scale, _band_count * sizeof(float));
+        if (_band_power) ei_dsp_free(_band_power, _band_count * sizeof(float));
+
+        _fft_input = NULL;
+        _spectrum = NULL;
+        _window = NULL;
+        _magnitude = NULL;
+        _band = NULL;
+        _band_scale = NULL;
+        _band_power = NULL;
+    }
+
+    float _sampling_freq;
+    uint16_t _fft_length;
+    size_t _signal_length;
+    size_t _segment_length;
+    uint8_t _fft_peaks;
+    float _fft_peaks_threshold;
+    filter_t _filter_type;
+    filters::butterworth _filter;
+    size_t _band_count;
+    size_t _bins;
+
+    float *_fft_input;
+    fft_complex_t *_spectrum;
+    fft_complex_t *_window;
+    float *_magnitude;
+    uint8_t *_band;
+    float *_band_scale;
+    float *_band_power;
+
+#if EIDSP_USE_CMSIS_DSP
+    bool _use_rfft_fast;
+    arm_rfft_fast_instance_f32 _rfft_instance;
+#endif
+    kiss_fftr_cfg _kiss_cfg;
+    size_t _kiss_mem_length;
+
+    // not copyable, it owns its buffers
+    engine(const engine&);
+    engine& operator=(const engine&);
+};
+
+} // namespace spectral
+} // namespace ei
+
+#endif // _EIDSP_SPECTRAL_ENGINE_H_
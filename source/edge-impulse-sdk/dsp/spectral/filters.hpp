@@ -30,9 +30,139 @@
 #define M_PI 3.14159265358979323846264338327950288
 #endif // M_PI
 
+#ifndef EIDSP_BUTTERWORTH_MAX_ORDER
+#define EIDSP_BUTTERWORTH_MAX_ORDER 8
+#endif // EIDSP_BUTTERWORTH_MAX_ORDER
+
 namespace ei {
 namespace spectral {
 namespace filters {
+
+    /**
+     * Butterworth filter as a cascade of second order sections (one per two orders).
+     * The coefficients are designed once, and the state is kept between calls to `process`,
+     * so a signal that arrives in pieces is filtered as if it came in one go.
+     * The sections run in transposed direct form II, on the CMSIS-DSP biquad routine if available.
+     */
+    class butterworth {
+    public:
+        butterworth() : _stages(0) {
+            reset();
+        }
+
+        /**
+         * Design a lowpass filter.
+         * @param filter_order Even filter order (between 2..EIDSP_BUTTERWORTH_MAX_ORDER)
+         * @param sampling_freq Sample frequency of the signal
+         * @param cutoff_freq Cut-off frequency of the signal
+         * @returns 0 if OK
+         */
+        int init_lowpass(int filter_order, float sampling_freq, float cutoff_freq) {
+            return design(false, filter_order, sampling_freq, cutoff_freq);
+        }
+
+        /**
+         * Design a highpass filter.
+         * @param filter_order Even filter order (between 2..EIDSP_BUTTERWORTH_MAX_ORDER)
+         * @param sampling_freq Sample frequency of the signal
+         * @param cutoff_freq Cut-off frequency of the signal
+         * @returns 0 if OK
+         */
+        int init_highpass(int filter_order, float sampling_freq, float cutoff_freq) {
+            return design(true, filter_order, sampling_freq, cutoff_freq);
+        }
+
+        /**
+         * Forget the signal seen so far, the next sample filtered starts from rest.
+         */
+        void reset() {
+            memset(_state, 0, sizeof(_state));
+        }
+
+        /**
+         * Filter the next part of the signal.
+         * @param src Source array
+         * @param dest Destination array (may be the same as src)
+         * @param size Size of both source and destination arrays
+         */
+        void process(const float *src, float *dest, size_t size) {
+            if (_stages == 0) {
+                if (dest != src) {
+                    memcpy(dest, src, size * sizeof(float));
+                }
+                return;
+            }
+
+#if EIDSP_USE_CMSIS_DSP
+            arm_biquad_cascade_df2T_f32(&_instance, (float*)src, dest, size);
+#else
+            for (size_t sx = 0; sx < size; sx++) {
+                float x = src[sx];
+
+                for (int ix = 0; ix < _stages; ix++) {
+                    const float *c = _coeffs + (ix * 5);
+                    float *s = _state + (ix * 2);
+
+                    // c = { b0, b1, b2, a1, a2 }, with the feedback signs folded into a1 and a2
+                    float y = c[0] * x + s[0];
+                    s[0] = c[1] * x + c[3] * y + s[1];
+                    s[1] = c[2] * x + c[4] * y;
+                    x = y;
+                }
+
+                dest[sx] = x;
+            }
+#endif
+        }
+
+    private:
+        int design(bool highpass, int filter_order, float sampling_freq, float cutoff_freq) {
+            if (filter_order < 0 || filter_order > EIDSP_BUTTERWORTH_MAX_ORDER) {
+                _stages = 0;
+                EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+            }
+
+            _stages = filter_order / 2;
+
+            // designed in EIDSP_design_t, only the coefficients are rounded to float
+            const EIDSP_design_t pi = static_cast<EIDSP_design_t>(M_PI);
+            EIDSP_design_t a = std::tan(pi * static_cast<EIDSP_design_t>(cutoff_freq) / static_cast<EIDSP_design_t>(sampling_freq));
+            EIDSP_design_t a2 = a * a;
+
+            for (int ix = 0; ix < _stages; ix++) {
+                EIDSP_design_t r = std::sin(pi * static_cast<EIDSP_design_t>((2 * ix) + 1) / static_cast<EIDSP_design_t>(2 * filter_order));
+                EIDSP_design_t norm = 1 / (a2 + (2 * a * r) + 1);
+                EIDSP_design_t gain = highpass ? norm : a2 * norm;
+                float *c = _coeffs + (ix * 5);
+
+                c[0] = static_cast<float>(gain);
+                c[1] = static_cast<float>(highpass ? -2 * gain : 2 * gain);
+                c[2] = static_cast<float>(gain);
+                c[3] = static_cast<float>(2 * (1 - a2) * norm);
+                c[4] = static_cast<float>(-(a2 - (2 * a * r) + 1) * norm);
+            }
+
+            reset();
+
+#if EIDSP_USE_CMSIS_DSP
+            arm_biquad_cascade_df2T_init_f32(&_instance, _stages, _coeffs, _state);
+#endif
+
+            return EIDSP_OK;
+        }
+
+        int _stages;
+        float _coeffs[EIDSP_BUTTERWORTH_MAX_ORDER / 2 * 5];
+        float _state[EIDSP_BUTTERWORTH_MAX_ORDER / 2 * 2];
+#if EIDSP_USE_CMSIS_DSP
+        arm_biquad_cascade_df2T_instance_f32 _instance;
+#endif
+
+        // the CMSIS instance points into this object
+        butterworth(const butterworth&);
+        butterworth& operator=(const butterworth&);
+    };
+
     /**
      * The Butterworth filter has maximally flat frequency response in the passband.
      * @param filter_order Even filter order (between 2..8)
@@ -41,8 +171,9 @@ namespace filters {
      * @param src Source array
      * @param dest Destination array
      * @param size Size of both source and destination arrays
+     * @returns 0 if OK
      */
-    static void butterworth_lowpass(
+    static int butterworth_lowpass(
         int filter_order,
         float sampling_freq,
         float cutoff_freq,
@@ -50,43 +181,14 @@ namespace filters {
         float *dest,
         size_t size)
     {
-        int n_steps = filter_order / 2;
-        float a = tan(M_PI * cutoff_freq / sampling_freq);
-        float a2 = pow(a, 2);
-        float *A = (float*)ei_calloc(n_steps, sizeof(float));
-        float *d1 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *d2 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w0 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w1 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w2 = (float*)ei_calloc(n_steps, sizeof(float));
-
-        // Calculate the filter parameters
-        for(int ix = 0; ix < n_steps; ix++) {
-            float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
-            sampling_freq = a2 + (2.0 * a * r) + 1.0;
-            A[ix] = a2 / sampling_freq;
-            d1[ix] = 2.0 * (1 - a2) / sampling_freq;
-            d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
-        }
-
-        // Apply the filter
-        for (size_t sx = 0; sx < size; sx++) {
-            dest[sx] = src[sx];
-
-            for (int i = 0; i < n_steps; i++) {
-                w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + dest[sx];
-                dest[sx] = A[i] * (w0[i] + (2.0 * w1[i]) + w2[i]);
-                w2[i] = w1[i];
-                w1[i] = w0[i];
-            }
+        butterworth filter;
+        int ret = filter.init_lowpass(filter_order, sampling_freq, cutoff_freq);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
         }
 
-        ei_free(A);
-        ei_free(d1);
-        ei_free(d2);
-        ei_free(w0);
-        ei_free(w1);
-        ei_free(w2);
+        filter.process(src, dest, size);
+        return EIDSP_OK;
     }
 
     /**
@@ -97,8 +199,9 @@ namespace filters {
      * @param src Source array
      * @param dest Destination array
      * @param size Size of both source and destination arrays
+     * @returns 0 if OK
      */
-    static void butterworth_highpass(
+    static int butterworth_highpass(
         int filter_order,
         float sampling_freq,
         float cutoff_freq,
@@ -106,43 +209,14 @@ namespace filters {
         float *dest,
         size_t size)
     {
-        int n_steps = filter_order / 2;
-        float a = tan(M_PI * cutoff_freq / sampling_freq);
-        float a2 = pow(a, 2);
-        float *A = (float*)ei_calloc(n_steps, sizeof(float));
-        float *d1 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *d2 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w0 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w1 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w2 = (float*)ei_calloc(n_steps, sizeof(float));
-
-        // Calculate the filter parameters
-        for (int ix = 0; ix < n_steps; ix++) {
-            float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
-            sampling_freq = a2 + (2.0 * a * r) + 1.0;
-            A[ix] = 1.0f / sampling_freq;
-            d1[ix] = 2.0 * (1 - a2) / sampling_freq;
-            d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
-        }
-
-        // Apply the filter
-        for (size_t sx = 0; sx < size; sx++) {
-            dest[sx] = src[sx];
-
-            for (int i = 0; i < n_steps; i++) {
-                w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + dest[sx];
-                dest[sx] = A[i] * (w0[i] - (2.0 * w1[i]) + w2[i]);
-                w2[i] = w1[i];
-                w1[i] = w0[i];
-            }
+        butterworth filter;
+        int ret = filter.init_highpass(filter_order, sampling_freq, cutoff_freq);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
         }
 
-        ei_free(A);
-        ei_free(d1);
-        ei_free(d2);
-        ei_free(w0);
-        ei_free(w1);
-        ei_free(w2);
+        filter.process(src, dest, size);
+        return EIDSP_OK;
     }
 
 } // namespace filters
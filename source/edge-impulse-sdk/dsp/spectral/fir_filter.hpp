@@ -43,17 +43,18 @@ private:
     void set_taps_lowpass(float cutoff_normalized, std::vector<float> &f_taps)
     {
         //http://www.dspguide.com/ch16/2.htm
-        float sine_scale = 2 * M_PI * cutoff_normalized;
+        float sine_scale = static_cast<float>(
+            2 * static_cast<EIDSP_design_t>(M_PI) * static_cast<EIDSP_design_t>(cutoff_normalized));
         // offset is M/2...M is filter order -1. so truncation is desired
         int offset = filter_size / 2;
         for (int i = 0; i < filter_size / 2; i++)
         {
-            f_taps[i] = sin(sine_scale * (i - offset)) / (i - offset);
+            f_taps[i] = sinf(sine_scale * (i - offset)) / (i - offset);
         }
         f_taps[filter_size / 2] = sine_scale;
         for (int i = filter_size / 2 + 1; i < filter_size; i++)
         {
-            f_taps[i] = sin(sine_scale * (i - offset)) / (i - offset);
+            f_taps[i] = sinf(sine_scale * (i - offset)) / (i - offset);
         }
     }
 
@@ -61,7 +62,9 @@ private:
     {
         for (int i = 0; i < filter_size; i++)
         {
-            f_taps[i] *= 0.54 - 0.46 * cos(2 * M_PI * i / (filter_size - 1));
+            EIDSP_design_t window = static_cast<EIDSP_design_t>(0.54) - static_cast<EIDSP_design_t>(0.46) *
+                std::cos(2 * static_cast<EIDSP_design_t>(M_PI) * i / (filter_size - 1));
+            f_taps[i] = static_cast<float>(static_cast<EIDSP_design_t>(f_taps[i]) * window);
         }
     }
 
@@ -118,11 +118,16 @@ namespace processing {
         float filter_cutoff,
         uint8_t filter_order)
     {
+        filters::butterworth filter;
+        int ret = filter.init_lowpass(filter_order, sampling_frequency, filter_cutoff);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
         for (size_t row = 0; row < matrix->rows; row++) {
-            filters::butterworth_lowpass(
-                filter_order,
-                sampling_frequency,
-                filter_cutoff,
+            // every axis is filtered from rest
+            filter.reset();
+            filter.process(
                 matrix->buffer + (row * matrix->cols),
                 matrix->buffer + (row * matrix->cols),
                 matrix->cols);
@@ -147,11 +152,16 @@ namespace processing {
         float filter_cutoff,
         uint8_t filter_order)
     {
+        filters::butterworth filter;
+        int ret = filter.init_highpass(filter_order, sampling_frequency, filter_cutoff);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
         for (size_t row = 0; row < matrix->rows; row++) {
-            filters::butterworth_highpass(
-                filter_order,
-                sampling_frequency,
-                filter_cutoff,
+            // every axis is filtered from rest
+            filter.reset();
+            filter.process(
                 matrix->buffer + (row * matrix->cols),
                 matrix->buffer + (row * matrix->cols),
                 matrix->cols);
@@ -378,7 +388,7 @@ namespace processing {
         float T = 1.0f / sampling_freq;
 
         EI_DSP_MATRIX(freq_space, 1, fft_matrix->cols);
-        ret = numpy::linspace(0.0f, 1.0f / (2.0f * T), floor(N / 2), freq_space.buffer);
+        ret = numpy::linspace(0.0f, 1.0f / (2.0f * T), N / 2, freq_space.buffer);
         if (ret != EIDSP_OK) {
             EIDSP_ERR(ret);
         }
@@ -798,7 +808,7 @@ namespace processing {
         // conjugate and then multiply with itself and scale
         for (uint16_t ix = 0; ix < n_fft / 2 + 1; ix++) {
             fft_output[ix].r = (fft_output[ix].r * fft_output[ix].r) +
-                (abs(fft_output[ix].i * fft_output[ix].i));
+                (fabsf(fft_output[ix].i * fft_output[ix].i));
             fft_output[ix].i = 0.0f;
 
             fft_output[ix].r *= scale;
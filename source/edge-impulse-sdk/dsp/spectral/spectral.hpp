@@ -26,5 +26,6 @@
 #include "../config.hpp"
 #include "processing.hpp"
 #include "feature.hpp"
+#include "engine.hpp"
 
 #endif // _EIDSP_SPECTRAL_SPECTRAL_H_
@@ -111,7 +111,7 @@ public:
             // thus calculating the bucket to 64, not 65.
             // we're adjusting this here a tiny bit to ensure we have the same result
             if (ix == num_filter + 2 - 1) {
-                hertz[ix] -= 0.001;
+                hertz[ix] -= 0.001f;
             }
         }
         ei_dsp_free(mels, mels_mem_size);
@@ -125,7 +125,7 @@ public:
             EIDSP_ERR(EIDSP_OUT_OF_MEM);
         }
         for (uint16_t ix = 0; ix < num_filter + 2; ix++) {
-            freq_index[ix] = static_cast<int>(floor((coefficients + 1) * hertz[ix] / sampling_freq));
+            freq_index[ix] = static_cast<int>(floorf((coefficients + 1) * hertz[ix] / sampling_freq));
         }
         ei_dsp_free(hertz, hertz_mem_size);
 
@@ -39,7 +39,7 @@ public:
      * @returns The mel scale values(or a single mel).
      */
     static float frequency_to_mel(float f) {
-        return 1127.0 * numpy::log(1 + f / 700.0f);
+        return 1127.0f * numpy::log(1 + f / 700.0f);
     }
 
     /**
@@ -49,7 +49,7 @@ public:
      * @returns The frequency values(or a single frequency) in Hz.
      */
     static float mel_to_frequency(float mel) {
-        return 700.0f * (exp(mel / 1127.0f) - 1.0f);
+        return 700.0f * (expf(mel / 1127.0f) - 1.0f);
     }
 
     /**
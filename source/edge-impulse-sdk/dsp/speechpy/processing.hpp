@@ -52,7 +52,7 @@ namespace processing {
     class preemphasis {
 public:
         preemphasis(ei_signal_t *signal, int shift = 1, float cof = 0.98f)
-            : _signal(signal), _shift(shift), _cof(cof)
+            : _signal(signal), _i8(ei_signal_i8_t::of(signal)), _shift(shift), _cof(cof)
         {
             _prev_buffer = (float*)ei_dsp_calloc(shift * sizeof(float), 1);
             _end_of_signal_buffer = (float*)ei_dsp_calloc(shift * sizeof(float), 1);
@@ -65,7 +65,15 @@ public:
             if (!_prev_buffer || !_end_of_signal_buffer) return;
 
             // we need to get the shift bytes from the end of the buffer...
-            signal->get_data(signal->total_length - shift, shift, _end_of_signal_buffer);
+            if (_i8) {
+                for (int ix = 0; ix < _shift; ix++) {
+                    _end_of_signal_buffer[ix] =
+                        (float)_i8->buffer[signal->total_length - _shift + ix] * _i8->scale;
+                }
+            }
+            else {
+                signal->get_data(signal->total_length - shift, shift, _end_of_signal_buffer);
+            }
         }
 
         /**
@@ -82,6 +90,10 @@ public:
                 EIDSP_ERR(EIDSP_OUT_OF_BOUNDS);
             }
 
+            if (_i8) {
+                return get_data_i8(offset, length, out_buffer);
+            }
+
             int ret;
             if (static_cast<int32_t>(offset) - _shift >= 0) {
                 ret = _signal->get_data(offset - _shift, _shift, _prev_buffer);
@@ -121,6 +133,41 @@ public:
             return EIDSP_OK;
         }
 
+        /**
+         * Preemphasize straight from a contiguous int8 signal. Every sample is read
+         * and converted once, with the conversion fused into the filter, and no
+         * history needs to be fetched as the previous samples are in place.
+         */
+        int get_data_i8(size_t offset, size_t length, float *out_buffer) {
+            const EIDSP_i8 *in = _i8->buffer;
+            const float scale = _i8->scale;
+            const float cof = _cof * scale;
+            size_t ix = 0;
+
+            // the first `shift` samples of the signal wrap around to its end
+            for (; ix < length && offset + ix < static_cast<uint32_t>(_shift); ix++) {
+                out_buffer[ix] = (float)in[offset + ix] * scale - (_cof * _end_of_signal_buffer[offset + ix]);
+            }
+
+            if (_shift == 1 && ix < length) {
+                float prev = (float)in[offset + ix - 1];
+                for (; ix < length; ix++) {
+                    float now = (float)in[offset + ix];
+                    out_buffer[ix] = now * scale - cof * prev;
+                    prev = now;
+                }
+            }
+            else {
+                for (; ix < length; ix++) {
+                    out_buffer[ix] = (float)in[offset + ix] * scale - cof * (float)in[offset + ix - _shift];
+                }
+            }
+
+            _next_offset_should_be += length;
+
+            return EIDSP_OK;
+        }
+
         ~preemphasis() {
             if (_prev_buffer) {
                 ei_dsp_free(_prev_buffer, _shift * sizeof(float));
@@ -132,6 +179,7 @@ public:
 
 private:
         ei_signal_t *_signal;
+        const ei_signal_i8_t *_i8;
         int _shift;
         float _cof;
         float *_prev_buffer;
@@ -208,14 +256,14 @@ namespace processing {
         int frame_sample_length;
         int length;
         if (version == 1) {
-            frame_sample_length = static_cast<int>(round(static_cast<float>(sampling_frequency) * frame_length));
-            frame_stride = round(static_cast<float>(sampling_frequency) * frame_stride);
+            frame_sample_length = static_cast<int>(roundf(static_cast<float>(sampling_frequency) * frame_length));
+            frame_stride = roundf(static_cast<float>(sampling_frequency) * frame_stride);
             length = frame_sample_length;
         }
         else {
-            frame_sample_length = static_cast<int>(ceil(static_cast<float>(sampling_frequency) * frame_length));
+            frame_sample_length = static_cast<int>(ceilf(static_cast<float>(sampling_frequency) * frame_length));
             float frame_stride_arg = frame_stride;
-            frame_stride = ceil(static_cast<float>(sampling_frequency) * frame_stride_arg);
+            frame_stride = ceilf(static_cast<float>(sampling_frequency) * frame_stride_arg);
             length = (frame_sample_length - (int)frame_stride);
         }
 
@@ -225,7 +273,7 @@ namespace processing {
         if (zero_padding) {
             // Calculation of number of frames
             numframes = static_cast<int>(
-                ceil(static_cast<float>(length_signal - length) / frame_stride));
+                ceilf(static_cast<float>(length_signal - length) / frame_stride));
 
             // Zero padding
             len_sig = static_cast<int>(static_cast<float>(numframes) * frame_stride) + frame_sample_length;
@@ -234,7 +282,7 @@ namespace processing {
         }
         else {
             numframes = static_cast<int>(
-                floor(static_cast<float>(length_signal - length) / frame_stride));
+                floorf(static_cast<float>(length_signal - length) / frame_stride));
             len_sig = static_cast<int>(
                 (static_cast<float>(numframes - 1) * frame_stride + frame_sample_length));
 
@@ -282,14 +330,14 @@ namespace processing {
         int frame_sample_length;
         int length;
         if (version == 1) {
-            frame_sample_length = static_cast<int>(round(static_cast<float>(sampling_frequency) * frame_length));
-            frame_stride = round(static_cast<float>(sampling_frequency) * frame_stride);
+            frame_sample_length = static_cast<int>(roundf(static_cast<float>(sampling_frequency) * frame_length));
+            frame_stride = roundf(static_cast<float>(sampling_frequency) * frame_stride);
             length = frame_sample_length;
         }
         else {
-            frame_sample_length = static_cast<int>(ceil(static_cast<float>(sampling_frequency) * frame_length));
+            frame_sample_length = static_cast<int>(ceilf(static_cast<float>(sampling_frequency) * frame_length));
             float frame_stride_arg = frame_stride;
-            frame_stride = ceil(static_cast<float>(sampling_frequency) * frame_stride_arg);
+            frame_stride = ceilf(static_cast<float>(sampling_frequency) * frame_stride_arg);
             length = (frame_sample_length - (int)frame_stride);
         }
 
@@ -298,11 +346,11 @@ namespace processing {
         if (zero_padding) {
             // Calculation of number of frames
             numframes = static_cast<int>(
-                ceil(static_cast<float>(signal_size - length) / frame_stride));
+                ceilf(static_cast<float>(signal_size - length) / frame_stride));
         }
         else {
             numframes = static_cast<int>(
-                floor(static_cast<float>(signal_size - length) / frame_stride));
+                floorf(static_cast<float>(signal_size - length) / frame_stride));
         }
 
         return numframes;
@@ -329,7 +377,7 @@ namespace processing {
         }
 
         for (size_t ix = 0; ix < out_buffer_size; ix++) {
-            out_buffer[ix] = (1.0 / static_cast<float>(fft_points)) *
+            out_buffer[ix] = (1.0f / static_cast<float>(fft_points)) *
                 (out_buffer[ix] * out_buffer[ix]);
         }
 
@@ -57,12 +57,16 @@ main()
     // mems_mic_test();
     //while(1) {
         //concurrent_display_test();
+        //fiber_switch_test();
+        //scheduler_idle_test();
+        //fiber_priority_test();
         // button_test3();
 	    //display_test1();
         //button_blinky_test2();
 	    //speaker_test2(2);
 	    //mems_clap_test(3);
 	    //spirit_level();
+	    //accelerometer_batch_test();
 	    //edge_connector_test();
 	    // analog_test();
 	    //piezo_mic_test();
@@ -0,0 +1,117 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "ei_float_format.h"
+
+#define EI_FLOAT_FORMAT_DECIMALS_SCALE  100000
+
+size_t ei_format_float(float f, char *buf) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+
+    char *c = buf;
+    if (bits >> 31) {
+        *(c++) = '-';
+    }
+
+    int32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent == 0xff) {
+        strcpy(c, mantissa ? "nan" : "inf");
+        return (c - buf) + 3;
+    }
+
+    // f = mantissa * 2^exponent, with a 24 bit mantissa
+    if (exponent == 0) {
+        exponent = -149;
+    }
+    else {
+        mantissa |= 0x800000;
+        exponent -= 150;
+    }
+
+    // the integer part, as a 128 bit number (little endian words), and the decimals
+    uint32_t integer[4] = { 0, 0, 0, 0 };
+    uint32_t decimals = 0;
+
+    if (exponent >= 0) {
+        // an integer, of up to 128 bits
+        uint64_t shifted = (uint64_t)mantissa << (exponent % 32);
+        integer[exponent / 32] = (uint32_t)shifted;
+        if (exponent / 32 < 3) {
+            integer[exponent / 32 + 1] = (uint32_t)(shifted >> 32);
+        }
+    }
+    else if (exponent > -63) {
+        // round mantissa * 10^5 / 2^-exponent to nearest, ties to even (as printf does)
+        uint32_t shift = -exponent;
+        uint64_t scaled = (uint64_t)mantissa * EI_FLOAT_FORMAT_DECIMALS_SCALE;
+        uint64_t fixed = scaled >> shift;
+        uint64_t remainder = scaled & ((1ULL << shift) - 1);
+        uint64_t half = 1ULL << (shift - 1);
+
+        if (remainder > half || (remainder == half && (fixed & 1))) {
+            fixed++;
+        }
+
+        integer[0] = (uint32_t)(fixed / EI_FLOAT_FORMAT_DECIMALS_SCALE);
+        decimals = (uint32_t)(fixed % EI_FLOAT_FORMAT_DECIMALS_SCALE);
+    }
+    // else below 2^-39, which is less than half of the last decimal, so it prints as 0.00000
+
+    // integer digits, least significant first, by long division of the 128 bit number
+    char digits[40];
+    size_t count = 0;
+    int top = 3;
+    while (top > 0 && integer[top] == 0) {
+        top--;
+    }
+    do {
+        uint32_t remainder = 0;
+        for (int ix = top; ix >= 0; ix--) {
+            uint64_t word = ((uint64_t)remainder << 32) | integer[ix];
+            integer[ix] = (uint32_t)(word / 10);
+            remainder = (uint32_t)(word % 10);
+        }
+        digits[count++] = '0' + remainder;
+        while (top > 0 && integer[top] == 0) {
+            top--;
+        }
+    } while (integer[top] != 0);
+
+    while (count > 0) {
+        *(c++) = digits[--count];
+    }
+
+    *(c++) = '.';
+    for (int ix = 4; ix >= 0; ix--) {
+        c[ix] = '0' + (decimals % 10);
+        decimals /= 10;
+    }
+    c += 5;
+    *c = '\0';
+
+    return c - buf;
+}
@@ -0,0 +1,41 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _EI_FLOAT_FORMAT_H_
+#define _EI_FLOAT_FORMAT_H_
+
+#include <stddef.h>
+
+// Sign, the 39 integer digits of FLT_MAX, the point, 5 decimals and the terminator
+#define EI_FLOAT_FORMAT_MAX_LENGTH      48
+
+/**
+ * Formats a float exactly as printf("%.5f") does, with integer arithmetic only
+ * (no double precision, no log10/pow, no vsnprintf).
+ *
+ * @param f The value to format
+ * @param buf Storage for at least EI_FLOAT_FORMAT_MAX_LENGTH characters
+ * @returns The number of characters written, excluding the terminator
+ */
+size_t ei_format_float(float f, char *buf);
+
+#endif // _EI_FLOAT_FORMAT_H_
@@ -0,0 +1,111 @@
+// Scores random inputs against 32 clusters of 33 features, with the anomaly block and with the reference
+// implementation it replaced (a square root per cluster, and a division per feature in the scaler).
+// Checks both agree, and reports the time per score.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "edge-impulse-sdk/anomaly/anomaly.h"
+#include "HostTest.h"
+
+#define FEATURES    33
+#define CLUSTERS    32
+#define INPUTS      1000
+#define SCORES      200000
+
+static float reference_score(float *input, const float *scale, const float *mean, const ei_classifier_anom_cluster_t *clusters)
+{
+    for (size_t ix = 0; ix < FEATURES; ix++) {
+        input[ix] = (input[ix] - mean[ix]) / scale[ix];
+    }
+
+    float min = 1000.0f;
+    for (size_t c = 0; c < CLUSTERS; c++) {
+        float dist = 0.0f;
+        for (size_t ix = 0; ix < FEATURES; ix++) {
+            dist += pow(input[ix] - clusters[c].centroid[ix], 2);
+        }
+        dist = sqrt(dist) - clusters[c].max_error;
+        if (dist < min) {
+            min = dist;
+        }
+    }
+    return min;
+}
+
+static float score(float *input, const float *inv_scale, const float *mean, const ei_classifier_anom_cluster_t *clusters)
+{
+    standard_scaler_inv(input, inv_scale, mean, FEATURES);
+    return get_min_distance_to_cluster(input, FEATURES, clusters, CLUSTERS);
+}
+
+static float uniform(float lo, float hi)
+{
+    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+int main()
+{
+    static ei_classifier_anom_cluster_t clusters[CLUSTERS];
+    static float inputs[INPUTS][FEATURES];
+    float scale[FEATURES], mean[FEATURES], inv_scale[FEATURES];
+
+    srand(1);
+    for (int c = 0; c < CLUSTERS; c++) {
+        clusters[c].index = c;
+        for (int i = 0; i < FEATURES; i++) {
+            clusters[c].centroid[i] = uniform(-2, 2);
+        }
+        clusters[c].max_error = uniform(0, 1);
+    }
+    for (int i = 0; i < FEATURES; i++) {
+        scale[i] = uniform(0.5f, 1.5f);
+        mean[i] = uniform(0, 1);
+    }
+    for (int n = 0; n < INPUTS; n++) {
+        for (int i = 0; i < FEATURES; i++) {
+            inputs[n][i] = uniform(0, 3);
+        }
+    }
+    standard_scaler_reciprocals(scale, inv_scale, FEATURES);
+
+    double max_error = 0;
+    for (int n = 0; n < INPUTS; n++) {
+        float a[FEATURES], b[FEATURES];
+        memcpy(a, inputs[n], sizeof(a));
+        memcpy(b, inputs[n], sizeof(b));
+        double e = fabs(reference_score(a, scale, mean, clusters) - score(b, inv_scale, mean, clusters));
+        if (e > max_error) {
+            max_error = e;
+        }
+    }
+    CHECK(max_error < 1e-4);
+
+    volatile float sink = 0;
+    double best_reference = 1e30, best = 1e30;
+
+    for (int pass = 0; pass < 3; pass++) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int n = 0; n < SCORES; n++) {
+            float in[FEATURES];
+            memcpy(in, inputs[n % INPUTS], sizeof(in));
+            sink += reference_score(in, scale, mean, clusters);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int n = 0; n < SCORES; n++) {
+            float in[FEATURES];
+            memcpy(in, inputs[n % INPUTS], sizeof(in));
+            sink += score(in, inv_scale, mean, clusters);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        best_reference = fmin(best_reference, std::chrono::duration<double, std::micro>(t1 - t0).count() / SCORES);
+        best = fmin(best, std::chrono::duration<double, std::micro>(t2 - t1).count() / SCORES);
+    }
+
+    printf("%d clusters x %d features: reference %.2f us, anomaly.h %.2f us per score, max difference %g\n",
+        CLUSTERS, FEATURES, best_reference, best, max_error);
+
+    return host_test_summary("AnomalyBenchmark");
+}
@@ -0,0 +1,218 @@
+// Times DMESG("ADC: sample %d at %x") calls into the ring buffer, in the configuration CodalDmesg.cpp is built
+// with, against the implementation it replaced (codal_vdmesg before the ring buffer, formatting straight into the
+// log with interrupts off, and moving the log down by a quarter of its size whenever it filled), on the same calls.
+// DmesgDeferredBenchmark is the same file built with the deferred queue: the encoder runs every 8 calls, as the
+// idle loop would, outside the timed calls.
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "CodalConfig.h"
+#include "CodalDmesg.h"
+#include "CodalCompat.h"
+#include "codal_target_hal.h"
+#include "HostTest.h"
+
+#define CALLS           1000000
+#define ROUNDS          20
+
+typedef std::chrono::steady_clock timer;
+
+using namespace codal;
+
+// The previous implementation, as it was in CodalDmesg.cpp, writing to a store of its own
+static struct
+{
+    uint32_t ptr;
+    char buffer[DEVICE_DMESG_BUFFER_SIZE];
+} previousLogStore;
+
+static void previous_logwrite(const char *msg);
+
+static void previous_logwriten(const char *msg, int l)
+{
+    if (previousLogStore.ptr + l >= sizeof(previousLogStore.buffer))
+    {
+        const int jump = sizeof(previousLogStore.buffer) / 4;
+        previousLogStore.ptr -= jump;
+        memmove(previousLogStore.buffer, previousLogStore.buffer + jump, previousLogStore.ptr);
+        // zero-out the rest so it looks OK in the debugger
+        memset(previousLogStore.buffer + previousLogStore.ptr, 0, sizeof(previousLogStore.buffer) - previousLogStore.ptr);
+    }
+    if (l + previousLogStore.ptr >= sizeof(previousLogStore.buffer))
+    {
+        previous_logwrite("DMESG line too long!\n");
+        return;
+    }
+    memcpy(previousLogStore.buffer + previousLogStore.ptr, msg, l);
+    previousLogStore.ptr += l;
+    previousLogStore.buffer[previousLogStore.ptr] = 0;
+}
+
+static void previous_logwrite(const char *msg)
+{
+    previous_logwriten(msg, strlen(msg));
+}
+
+static void previous_writeNum(char *buf, uint32_t n, bool full)
+{
+    int i = 0;
+    int sh = 28;
+    while (sh >= 0)
+    {
+        int d = (n >> sh) & 0xf;
+        if (full || d || sh == 0 || i)
+        {
+            buf[i++] = d > 9 ? 'A' + d - 10 : '0' + d;
+        }
+        sh -= 4;
+    }
+    buf[i] = 0;
+}
+
+static void previous_logwritenum(uint32_t n, bool full, bool hex)
+{
+    char buff[20];
+
+    if (hex)
+    {
+        previous_writeNum(buff, n, full);
+        previous_logwrite("0x");
+    }
+    else
+    {
+        itoa(n, buff);
+    }
+
+    previous_logwrite(buff);
+}
+
+static void previous_vdmesg(const char *format, bool crlf, va_list ap)
+{
+    const char *end = format;
+
+    target_disable_irq();
+    while (*end)
+    {
+        if (*end++ == '%')
+        {
+            previous_logwriten(format, end - format - 1);
+            uint32_t val = va_arg(ap, uint32_t);
+            switch (*end++)
+            {
+            case 'c':
+                previous_logwriten((const char *)&val, 1);
+                break;
+            case 'u': // should be printed as unsigned, but will do for now
+            case 'd':
+                previous_logwritenum(val, false, false);
+                break;
+            case 'x':
+                previous_logwritenum(val, false, true);
+                break;
+            case 'p':
+            case 'X':
+                previous_logwritenum(val, true, true);
+                break;
+            case 's':
+                // pointers are 32 bits on the device; nothing here logs a string
+                previous_logwrite((char *)(uintptr_t)val);
+                break;
+            case '%':
+                previous_logwrite("%");
+                break;
+            default:
+                previous_logwrite("???");
+                break;
+            }
+            format = end;
+        }
+    }
+    previous_logwriten(format, end - format);
+
+    if (crlf)
+        previous_logwrite("\r\n");
+
+    target_enable_irq();
+}
+
+static void previous_dmesg(const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    previous_vdmesg(format, true, arg);
+    va_end(arg);
+}
+
+struct Timing
+{
+    std::vector<double> t;
+    double sum;
+};
+
+static double overhead;
+
+template <typename F> static void time(Timing &timing, int first, int calls, F log)
+{
+    for (int i = first; i < first + calls; i++) {
+        timer::time_point start = timer::now();
+        log(i);
+        double t = std::chrono::duration<double, std::nano>(timer::now() - start).count() - overhead;
+
+        timing.t.push_back(t);
+        timing.sum += t;
+
+        if (i % 8 == 7)
+            codal_dmesg_encode();
+    }
+}
+
+static void print(const char *name, Timing &timing)
+{
+    size_t n = timing.t.size();
+
+    std::sort(timing.t.begin(), timing.t.end());
+    printf("%-10s mean %6.1f ns, median %6.1f ns, p99 %6.1f ns, p99.9 %6.1f ns per call\n", name, timing.sum / n,
+        timing.t[n / 2], timing.t[n - n / 100], timing.t[n - n / 1000]);
+}
+
+int main()
+{
+    std::vector<double> clock(CALLS);
+    Timing previous = {}, ring = {};
+
+    // the cost of reading the clock around nothing
+    for (int i = 0; i < CALLS; i++) {
+        timer::time_point start = timer::now();
+        clock[i] = std::chrono::duration<double, std::nano>(timer::now() - start).count();
+    }
+    std::sort(clock.begin(), clock.end());
+    overhead = clock[CALLS / 2];
+
+    // interleaved, so both see the same state of the host
+    for (int r = 0; r < ROUNDS; r++) {
+        int first = r * (CALLS / ROUNDS);
+
+        time(previous, first, CALLS / ROUNDS, [](int i) { previous_dmesg("ADC: sample %d at %x", i, i * 7); });
+        time(ring, first, CALLS / ROUNDS, [](int i) { DMESG("ADC: sample %d at %x", i, i * 7); });
+    }
+
+    // both logs end with the same text
+    char text[DEVICE_DMESG_BUFFER_SIZE / 2];
+    int n = codal_dmesg_peek(text, DEVICE_DMESG_BUFFER_SIZE / 2, sizeof(text));
+    const char *p = previousLogStore.buffer + previousLogStore.ptr - n;
+
+    CHECK_EQUAL((int)sizeof(text), n);
+    CHECK(memcmp(text, p, n) == 0);
+    CHECK(codalLogStore.dropped == 0);
+
+    printf("%d byte log, %s\n", DEVICE_DMESG_BUFFER_SIZE, DEVICE_DMESG_DEFERRED_RECORDS > 0 ?
+        "deferred (the encoder untimed)" : "immediate");
+    print("previous", previous);
+    print("ring", ring);
+
+    return host_test_summary(DEVICE_DMESG_DEFERRED_RECORDS > 0 ? "DmesgDeferredBenchmark" : "DmesgBenchmark");
+}
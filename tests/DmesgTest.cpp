@@ -0,0 +1,176 @@
+// Checks the DMESG ring buffer (CodalDmesg.cpp, in its default configuration, and with the deferred queue as
+// DmesgDeferredTest): messages are formatted as before and read back in order, on overflow the log keeps the
+// newest bytes and counts the rest, the deferred queue drops (and counts) what doesn't fit, and writers
+// interrupted by other writers (a SIGALRM handler logging every 20 us, against a main loop that logs and reads)
+// never tear or reorder each other's lines.
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <string>
+#include "CodalConfig.h"
+#include "CodalDmesg.h"
+#include "HostTest.h"
+
+static volatile int handler_sequence = 0;
+
+static void handler(int)
+{
+    DMESG("I %d", handler_sequence++);
+}
+
+static std::string drain()
+{
+    std::string s;
+    char b[37];
+    int n;
+
+    while ((n = codal_dmesg_read(b, sizeof(b))) > 0)
+        s.append(b, n);
+
+    return s;
+}
+
+static void check_format()
+{
+    drain();
+
+    DMESG("hello %d %x %s %c%%", 42, 0xBEEF, "world", 'Z');
+    DMESGN("no crlf %X", 0x12);
+    codal_dmesg_flush();
+
+    CHECK(drain() == "hello 42 0xBEEF world Z%\r\nno crlf 0x00000012");
+    CHECK(drain() == "");
+
+    DMESG("%d %d %u %x %x %X", -17, 0, 4000000000u, 0, 0xFFFFFFFF, 0xABCDEF);
+    CHECK(drain() == "-17 0 -294967296 0x0 0xFFFFFFFF 0x00ABCDEF\r\n");
+
+    // a string that changes after the call, and a line longer than a record or a line
+    char transient[16];
+    strcpy(transient, "transient");
+    DMESG("s=%s", transient);
+    strcpy(transient, "XXXXXXXX");
+
+    std::string big(300, 'a');
+    DMESG("%s", big.c_str());
+
+    std::string s = drain();
+    CHECK(s.substr(0, 13) == "s=transient\r\n");
+#if DEVICE_DMESG_DEFERRED_RECORDS > 0
+    CHECK(s.size() == 13 + 23 + 2);
+#else
+    CHECK(s.size() == 13 + DEVICE_DMESG_LINE_SIZE);
+#endif
+}
+
+static void check_overflow()
+{
+    uint32_t overwritten = codalLogStore.overwritten;
+    std::string all;
+
+    for (int i = 0; i < 1000; i++) {
+        char b[32];
+        sprintf(b, "line %d\r\n", i);
+        all += b;
+        DMESG("line %d", i);
+        codal_dmesg_encode();
+    }
+
+    std::string peek(DEVICE_DMESG_BUFFER_SIZE, 0);
+    peek.resize(codal_dmesg_peek(&peek[0], 0, DEVICE_DMESG_BUFFER_SIZE));
+    std::string s = drain();
+
+    CHECK(s == all.substr(all.size() - DEVICE_DMESG_BUFFER_SIZE));
+    CHECK(peek == s);
+    CHECK_EQUAL(all.size() - DEVICE_DMESG_BUFFER_SIZE, codalLogStore.overwritten - overwritten);
+
+#if DEVICE_DMESG_DEFERRED_RECORDS > 0
+    uint32_t dropped = codalLogStore.dropped;
+    std::string expected;
+
+    for (int i = 0; i < DEVICE_DMESG_DEFERRED_RECORDS + 5; i++) {
+        char b[16];
+        sprintf(b, "q %d\r\n", i);
+        if (i < DEVICE_DMESG_DEFERRED_RECORDS)
+            expected += b;
+        DMESG("q %d", i);
+    }
+
+    CHECK_EQUAL(5u, codalLogStore.dropped - dropped);
+    CHECK(drain() == expected);
+
+    // more arguments than a record holds
+    DMESG("%d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8);
+    CHECK(drain() == "1 2 3 4 5 6 ...\r\n");
+#endif
+}
+
+static void check_interrupted()
+{
+    struct itimerval on = { { 0, 20 }, { 0, 20 } };
+    struct itimerval off = { { 0, 0 }, { 0, 0 } };
+    std::string log;
+    int main_sequence = 0;
+
+    signal(SIGALRM, handler);
+    setitimer(ITIMER_REAL, &on, NULL);
+
+    for (int i = 0; i < 400000; i++) {
+        DMESG("M %d", main_sequence++);
+
+        if (i % 4 == 0) {
+            char b[64];
+            int n = codal_dmesg_read(b, sizeof(b));
+            log.append(b, n);
+        }
+    }
+
+    setitimer(ITIMER_REAL, &off, NULL);
+    log += drain();
+
+    // every line whole, and the lines of each writer in order
+    int last_main = -1, last_handler = -1, lines = 0, handler_lines = 0, bad = 0;
+    size_t p = 0;
+
+    while (p < log.size()) {
+        size_t e = log.find("\r\n", p);
+        if (e == std::string::npos) {
+            bad++;
+            break;
+        }
+
+        std::string l = log.substr(p, e - p);
+        int v;
+        p = e + 2;
+        lines++;
+
+        if (sscanf(l.c_str(), "M %d", &v) == 1 && l == "M " + std::to_string(v)) {
+            bad += v <= last_main;
+            last_main = v;
+        }
+        else if (sscanf(l.c_str(), "I %d", &v) == 1 && l == "I " + std::to_string(v)) {
+            bad += v <= last_handler;
+            last_handler = v;
+            handler_lines++;
+        }
+        else {
+            bad++;
+        }
+    }
+
+    printf("interrupted writers: %d lines (%d from the handler), %u bytes overwritten, %u messages dropped\n", lines,
+        handler_lines, codalLogStore.overwritten, codalLogStore.dropped);
+
+    CHECK_EQUAL(0, bad);
+    CHECK(handler_lines > 100);
+    CHECK(lines > 1000);
+}
+
+int main()
+{
+    check_format();
+    check_overflow();
+    check_interrupted();
+
+    return host_test_summary(DEVICE_DMESG_DEFERRED_RECORDS > 0 ? "DmesgDeferredTest" : "DmesgTest");
+}
@@ -0,0 +1,330 @@
+// Runs the MFCC, MFE, spectrogram and spectral analysis blocks with EIDSP_FLOAT_ONLY on fixed signals (an 11 kHz
+// chirp with noise, and 3 axis motion at 62.5 Hz), and checks their features against those of the DSP before it went
+// single precision (dsp/baseline.bin). So does the same tree designing its filters, windows and twiddles in double
+// (build/DspPrecisionReference, this file built with EIDSP_FLOAT_ONLY=0). Also checks that no double precision libm
+// function is called, on the first call (which designs) or after, and reports for each block and each of the three
+// builds its double precision libm calls, the cycles of a call, and its code size (the growth of this file linked
+// with that block alone, see the Makefile; dsp/baseline-sizes.txt for the DSP before).
+//
+// The baseline cycles were recorded on the host that generated dsp/baseline.bin, along with its features. On x86,
+// double precision is not emulated, so the cycles only show what the host saves.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include "edge-impulse-sdk/classifier/ei_run_dsp.h"
+#include "HostTest.h"
+
+#define AUDIO_SAMPLES   11000
+#define MOTION_SAMPLES  125
+#define MAX_FEATURES    (99 * 129)
+#define REPEATS         10
+
+// The keyword model's input quantization
+#define MFCC_SCALE      0.044383645057678223f
+#define MFCC_ZERO_POINT 9
+
+static float audio[AUDIO_SAMPLES];
+static float motion[MOTION_SAMPLES * 3];
+
+static ei_dsp_config_mfcc_t mfccConfig = { 1, 1, 13, 0.02f, 0.02f, 32, 256, 101, 300, 0, 0.98f, 1 };
+static ei_dsp_config_mfe_t mfeConfig = { 3, 1, 0.02f, 0.01f, 40, 256, 300, 0, 101 };
+static ei_dsp_config_spectrogram_t spectrogramConfig = { 2, 1, 0.02f, 0.01f, 256, true };
+static ei_dsp_config_spectral_analysis_t lowpassConfig = { 1, 3, 1.0f, "low", 3.0f, 6, 128, 3, 0.1f,
+    "0.1, 0.5, 1.0, 2.0, 5.0" };
+static ei_dsp_config_spectral_analysis_t highpassConfig = { 1, 3, 1.0f, "high", 1.5f, 4, 64, 3, 0.1f,
+    "0.1, 0.5, 1.0, 2.0, 5.0" };
+
+struct Block
+{
+    const char *name;
+    int features;
+    float tolerance;                    // Largest deviation from the reference, as a share of its peak
+};
+
+static const Block blocks[] = {
+    { "mfcc", 637, 1e-5f },
+    { "mfe", 99 * 40, 1e-5f },
+    { "spectrogram", 99 * 129, 1e-5f },
+    { "spectral, low pass", 3 * 11, 1e-5f },
+    { "spectral, high pass", 3 * 11, 1e-5f },
+};
+
+#define BLOCKS          (int)(sizeof(blocks) / sizeof(blocks[0]))
+
+// The size probes link one block alone (see the Makefile), or none
+#ifdef DSP_PRECISION_BLOCK
+#define BLOCK_LINKED(b)     (DSP_PRECISION_BLOCK == (b))
+#else
+#define BLOCK_LINKED(b)     1
+#endif
+
+static int run(int block, float *out)
+{
+    signal_t signal;
+    matrix_t features(1, blocks[block < 0 ? 0 : block].features, out);
+
+    if (block < 3)
+        numpy::signal_from_buffer(audio, AUDIO_SAMPLES, &signal);
+    else
+        numpy::signal_from_buffer(motion, MOTION_SAMPLES * 3, &signal);
+
+    switch (block) {
+#if BLOCK_LINKED(0)
+    case 0:
+        return extract_mfcc_features(&signal, &features, &mfccConfig, AUDIO_SAMPLES);
+#endif
+#if BLOCK_LINKED(1)
+    case 1:
+        return extract_mfe_features(&signal, &features, &mfeConfig, AUDIO_SAMPLES);
+#endif
+#if BLOCK_LINKED(2)
+    case 2:
+        return extract_spectrogram_features(&signal, &features, &spectrogramConfig, AUDIO_SAMPLES);
+#endif
+#if BLOCK_LINKED(3)
+    case 3:
+        return extract_spectral_analysis_features(&signal, &features, &lowpassConfig, 62.5f);
+#endif
+#if BLOCK_LINKED(4)
+    case 4:
+        return extract_spectral_analysis_features(&signal, &features, &highpassConfig, 62.5f);
+#endif
+    default:
+        return -1;
+    }
+}
+
+static void generate()
+{
+    srand(1234);
+
+    for (int i = 0; i < AUDIO_SAMPLES; i++) {
+        double t = i / (double)AUDIO_SAMPLES;
+        double f = 200.0 + 3000.0 * t;
+        audio[i] = (float)(8000.0 * sin(2 * M_PI * f * t) + 2000.0 * sin(6 * M_PI * f * t) + (rand() % 2001 - 1000));
+    }
+
+    for (int i = 0; i < MOTION_SAMPLES; i++) {
+        double t = i / 62.5;
+        for (int a = 0; a < 3; a++)
+            motion[i * 3 + a] = (float)(9.81 * (a == 2) + (2.0 + a) * sin(2 * M_PI * (1.3 + a) * t) +
+                0.5 * cos(2 * M_PI * 7.0 * t) + (rand() % 201 - 100) / 100.0);
+    }
+}
+
+#ifdef DSP_PRECISION_BLOCK
+
+int main()
+{
+    static float out[MAX_FEATURES];
+
+    generate();
+
+    return run(DSP_PRECISION_BLOCK, out) != 0;
+}
+
+#else
+
+// The double precision libm entry points, counted (the test links with --wrap for each of them)
+static unsigned long doubleCalls;
+
+#define WRAP1(f) \
+    extern "C" double __real_##f(double); \
+    extern "C" double __wrap_##f(double x) { doubleCalls++; return __real_##f(x); }
+#define WRAP2(f) \
+    extern "C" double __real_##f(double, double); \
+    extern "C" double __wrap_##f(double x, double y) { doubleCalls++; return __real_##f(x, y); }
+
+WRAP1(sin) WRAP1(cos) WRAP1(tan) WRAP1(sqrt) WRAP1(floor) WRAP1(ceil) WRAP1(round) WRAP1(log) WRAP1(log10)
+WRAP1(exp) WRAP2(pow)
+
+extern "C" void __real_sincos(double, double *, double *);
+extern "C" void __wrap_sincos(double x, double *s, double *c)
+{
+    doubleCalls++;
+    __real_sincos(x, s, c);
+}
+
+extern "C" double __real_atof(const char *);
+extern "C" double __wrap_atof(const char *s)
+{
+    doubleCalls++;
+    return __real_atof(s);
+}
+
+// What a build of the blocks writes after the features of each
+struct Measure
+{
+    uint32_t firstCalls;                // Double precision libm calls of the first call, which designs
+    uint32_t calls;                     // Double precision libm calls of every call after it
+    uint64_t cycles;                    // Fewest cycles of a call after the first
+};
+
+static int measure(int block, float *out, Measure &m)
+{
+    doubleCalls = 0;
+    if (run(block, out) != 0)
+        return -1;
+    m.firstCalls = doubleCalls;
+
+    doubleCalls = 0;
+    m.cycles = UINT64_MAX;
+    for (int r = 0; r < REPEATS; r++) {
+        uint64_t start = host_cycles();
+        if (run(block, out) != 0)
+            return -1;
+        uint64_t cycles = host_cycles() - start;
+        if (cycles < m.cycles)
+            m.cycles = cycles;
+    }
+    m.calls = doubleCalls / REPEATS;
+
+    return 0;
+}
+
+#if DSP_PRECISION_GENERATOR
+
+// The reference, or the baseline: writes the features and the measures of every block to stdout
+int main()
+{
+    static float out[MAX_FEATURES];
+
+    generate();
+
+    for (int b = 0; b < BLOCKS; b++) {
+        Measure m;
+
+        if (measure(b, out, m) != 0)
+            return 1;
+        fwrite(out, sizeof(float), blocks[b].features, stdout);
+        fwrite(&m, sizeof(m), 1, stdout);
+    }
+
+    return 0;
+}
+
+#else
+
+static int quantize(float v)
+{
+    return (int)roundf(v / MFCC_SCALE) + MFCC_ZERO_POINT;
+}
+
+// The code size of each block, as the Makefile measured it: the size of the probe linked with that block, less that
+// of the probe linked with none
+static bool read_sizes(const char *path, long *sizes)
+{
+    FILE *f = fopen(path, "r");
+    long none = -1, size;
+    int block;
+
+    if (f == NULL) {
+        printf("cannot read %s\n", path);
+        return false;
+    }
+
+    for (int b = 0; b < BLOCKS; b++)
+        sizes[b] = -1;
+
+    while (fscanf(f, "%d %ld", &block, &size) == 2) {
+        if (block < 0)
+            none = size;
+        else if (block < BLOCKS)
+            sizes[block] = size;
+    }
+
+    fclose(f);
+
+    for (int b = 0; b < BLOCKS; b++)
+        sizes[b] = sizes[b] < 0 || none < 0 ? -1 : sizes[b] - none;
+
+    return true;
+}
+
+struct Deviation
+{
+    float peak, deviation;
+    int identical, changed;
+};
+
+static Deviation compare(int block, const float *out, const float *baseline)
+{
+    Deviation d = { 0, 0, 0, 0 };
+
+    for (int i = 0; i < blocks[block].features; i++) {
+        d.peak = fmaxf(d.peak, fabsf(baseline[i]));
+        d.deviation = fmaxf(d.deviation, fabsf(out[i] - baseline[i]));
+        d.identical += out[i] == baseline[i];
+        d.changed += block == 0 && quantize(out[i]) != quantize(baseline[i]);
+    }
+
+    return d;
+}
+
+static void check(int block, const char *build, const Deviation &d)
+{
+    printf("  %-16s max deviation %.2g (%.2g of peak), %d/%d identical", build, d.deviation, d.deviation / d.peak,
+        d.identical, blocks[block].features);
+    if (block == 0)
+        printf(", %d int8 model inputs changed", d.changed);
+    printf("\n");
+
+    CHECK(d.deviation <= blocks[block].tolerance * d.peak);
+    CHECK_EQUAL(0, d.changed);
+}
+
+int main()
+{
+    static float out[MAX_FEATURES], baseline[MAX_FEATURES], reference[MAX_FEATURES];
+    long baselineSizes[BLOCKS], referenceSizes[BLOCKS], sizes[BLOCKS];
+    FILE *b = fopen("dsp/baseline.bin", "rb");
+    FILE *r = popen("./build/DspPrecisionReference", "r");
+
+    if (b == NULL || r == NULL) {
+        printf("cannot read dsp/baseline.bin, or run build/DspPrecisionReference\n");
+        return 1;
+    }
+
+    if (!read_sizes("dsp/baseline-sizes.txt", baselineSizes) ||
+        !read_sizes("build/DspPrecisionSizes-double.txt", referenceSizes) ||
+        !read_sizes("build/DspPrecisionSizes-float.txt", sizes))
+        return 1;
+
+    generate();
+
+    for (int k = 0; k < BLOCKS; k++) {
+        int n = blocks[k].features;
+        Measure before, design, after;
+
+        CHECK_EQUAL((size_t)n, fread(baseline, sizeof(float), n, b));
+        CHECK_EQUAL(1, fread(&before, sizeof(before), 1, b));
+        CHECK_EQUAL((size_t)n, fread(reference, sizeof(float), n, r));
+        CHECK_EQUAL(1, fread(&design, sizeof(design), 1, r));
+        CHECK_EQUAL(0, measure(k, out, after));
+
+        printf("%s, against the baseline:\n", blocks[k].name);
+        check(k, "design in double", compare(k, reference, baseline));
+        check(k, "float only", compare(k, out, baseline));
+
+        printf("  %-16s %8s %8s %8s\n", "", "baseline", "double", "float");
+        printf("  %-16s %8lu %8lu %8lu\n", "cycles", (unsigned long)before.cycles, (unsigned long)design.cycles,
+            (unsigned long)after.cycles);
+        printf("  %-16s %8u %8u %8u\n", "libm double, 1st", before.firstCalls, design.firstCalls, after.firstCalls);
+        printf("  %-16s %8u %8u %8u\n", "libm double", before.calls, design.calls, after.calls);
+        printf("  %-16s %8ld %8ld %8ld\n", "code bytes", baselineSizes[k], referenceSizes[k], sizes[k]);
+
+        CHECK_EQUAL(0u, after.firstCalls);
+        CHECK_EQUAL(0u, after.calls);
+    }
+
+    fclose(b);
+    pclose(r);
+
+    return host_test_summary("DspPrecisionTest");
+}
+
+#endif // DSP_PRECISION_GENERATOR
+
+#endif // DSP_PRECISION_BLOCK
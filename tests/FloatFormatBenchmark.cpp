@@ -0,0 +1,95 @@
+// Times ei_format_float against snprintf("%.5f") and the formatter it replaced (ei_printf_float's log10f and powf
+// digit loop, writing to a buffer instead of ei_printf), on what the classifier prints: mostly probabilities in
+// [0, 1], and every fourth value an anomaly score in [-1000, 1000].
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "ei_float_format.h"
+#include "HostTest.h"
+
+#define VALUES          4096
+#define REPEATS         200
+
+typedef std::chrono::steady_clock timer;
+
+static void previous_format_float(float f, char *s)
+{
+    float n = f;
+
+    static float PRECISION = 0.00001f;
+
+    if (n == 0.0f) {
+        strcpy(s, "0");
+    }
+    else {
+        int digit, m;
+        char *c = s;
+        int neg = (n < 0);
+        if (neg) {
+            n = -n;
+        }
+        // calculate magnitude
+        m = log10f(n);
+        if (neg) {
+            *(c++) = '-';
+        }
+        if (m < 1) {
+            m = 0;
+        }
+        // convert the number
+        while (n > PRECISION || m >= 0) {
+            float weight = powf(10.0f, m);
+            if (weight > 0 && !isinf(weight)) {
+                digit = floorf(n / weight);
+                n -= (digit * weight);
+                *(c++) = '0' + digit;
+            }
+            if (m == 0 && n > 0) {
+                *(c++) = '.';
+            }
+            m--;
+        }
+        *(c) = '\0';
+    }
+}
+
+static float values[VALUES];
+static volatile unsigned sink;
+
+template <typename F> static double time(F format)
+{
+    char buf[128];
+    timer::time_point start = timer::now();
+
+    for (int r = 0; r < REPEATS; r++)
+        for (int i = 0; i < VALUES; i++)
+            sink += format(values[i], buf);
+
+    return std::chrono::duration<double, std::nano>(timer::now() - start).count() / (REPEATS * VALUES);
+}
+
+int main()
+{
+    srand(1);
+    for (int i = 0; i < VALUES; i++)
+        values[i] = i % 4 == 3 ? (rand() % 2000000 - 1000000) / 1000.0f : rand() / (float)RAND_MAX;
+
+    double previous = 0, libc = 0, formatted = 0;
+
+    // the first pass warms the caches and the branch predictors
+    for (int pass = 0; pass < 2; pass++) {
+        previous = time([](float f, char *buf) { previous_format_float(f, buf); return (unsigned)buf[0]; });
+        libc = time([](float f, char *buf) { return (unsigned)snprintf(buf, 128, "%.5f", (double)f); });
+        formatted = time([](float f, char *buf) { return (unsigned)ei_format_float(f, buf); });
+    }
+
+    CHECK(formatted < libc);
+    CHECK(formatted < previous);
+
+    printf("log10f/powf: %.1f ns, snprintf %%.5f: %.1f ns, ei_format_float: %.1f ns per value\n", previous, libc,
+        formatted);
+
+    return host_test_summary("FloatFormatBenchmark");
+}
@@ -0,0 +1,66 @@
+// Checks ei_format_float against the C library's printf("%.5f"): on a sweep across every exponent, on random bit
+// patterns, on a denser sweep of [0, 2) where the probabilities (and most rounding ties) are, and on the special
+// values: zeros, ties, subnormals, FLT_MAX, infinities and NaNs.
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <random>
+#include "ei_float_format.h"
+#include "HostTest.h"
+
+#define SWEEP_STEP      4093
+#define RANDOM_VALUES   2000000
+#define UNIT_STEP       509
+
+static unsigned long checked, mismatches;
+
+static void check(float f)
+{
+    char a[EI_FLOAT_FORMAT_MAX_LENGTH], b[128];
+    size_t n = ei_format_float(f, a);
+
+    snprintf(b, sizeof(b), "%.5f", (double)f);
+    checked++;
+
+    if (strcmp(a, b) != 0 || n != strlen(b)) {
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        if (mismatches++ < 10)
+            printf("%08x: '%s', printf gives '%s'\n", u, a, b);
+    }
+}
+
+static void checkBits(uint32_t u)
+{
+    float f;
+
+    memcpy(&f, &u, sizeof(f));
+    check(f);
+}
+
+int main()
+{
+    std::mt19937 random(42);
+
+    for (uint64_t u = 0; u <= 0xffffffffull; u += SWEEP_STEP)
+        checkBits((uint32_t)u);
+
+    for (int i = 0; i < RANDOM_VALUES; i++)
+        checkBits(random());
+
+    for (uint32_t u = 0; u < 0x40000000u; u += UNIT_STEP)
+        checkBits(u);
+
+    const float special[] = { 0.0f, -0.0f, 0.015625f, -0.015625f, 0.000005f, 0.0000050000002f, 0.999995f, 0.99999f,
+        0.5f, 1e-6f, 1e38f, FLT_MAX, -FLT_MAX, FLT_MIN, 1.401298e-45f, -1.401298e-45f, INFINITY, -INFINITY, NAN, -NAN };
+
+    for (size_t i = 0; i < sizeof(special) / sizeof(special[0]); i++)
+        check(special[i]);
+
+    printf("%lu values checked, %lu mismatches\n", checked, mismatches);
+    CHECK_EQUAL(0, mismatches);
+
+    return host_test_summary("FloatFormatTest");
+}
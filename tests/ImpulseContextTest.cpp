@@ -0,0 +1,195 @@
+// Runs the keyword model (EON compiled) on two audio streams, each with its own ei_impulse_context_t, and checks
+// that interleaving their slices gives exactly the results of running each stream alone, and that the classic API
+// gives the results of its own context. Also checks that two spectral analysis blocks with their own context keep
+// their own engine when their windows are interleaved, and give the features of the context free extractor, and
+// that preemphasis reads an int8 slice in place only when it is wrapped in a signal_i8_t.
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include "HostTest.h"
+
+#define SLICES          24
+#define STREAMS         2
+#define AXES            3
+#define COLS            125
+
+static float audio[STREAMS][SLICES * EI_CLASSIFIER_SLICE_SIZE];
+static float alone[STREAMS][SLICES][EI_CLASSIFIER_LABEL_COUNT];
+static float mixed[STREAMS][SLICES][EI_CLASSIFIER_LABEL_COUNT];
+static float classic[SLICES][EI_CLASSIFIER_LABEL_COUNT];
+
+static const ei_dsp_config_spectral_analysis_t spectral_configs[STREAMS] = {
+    { 1, AXES, 1.0f, "low", 3.0f, 6, 128, 3, 0.1f, "0.1, 0.5, 1.0, 2.0, 5.0, 10, 20" },
+    { 1, AXES, 1.0f, "high", 1.5f, 4, 64, 2, 0.2f, "0.5, 2.0, 8.0, 20" },
+};
+
+// A gated tone and a warbling tone, both over noise
+static void make_audio()
+{
+    uint32_t seed = 12345;
+
+    for (int s = 0; s < STREAMS; s++) {
+        for (int i = 0; i < SLICES * EI_CLASSIFIER_SLICE_SIZE; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            float noise = ((int)(seed >> 16) % 2000 - 1000) * 0.5f;
+            float tone = s == 0 ? 3000.0f * sinf(i * 0.21f) * (((i / 3000) & 1) ? 1.0f : 0.1f)
+                                : 1500.0f * sinf(i * 0.05f + sinf(i * 0.001f) * 20.0f);
+            audio[s][i] = tone + noise;
+        }
+    }
+}
+
+static signal_t buffer_signal(const float *p, size_t length)
+{
+    signal_t signal;
+
+    signal.total_length = length;
+    signal.get_data = [p](size_t offset, size_t length, float *out) {
+        memcpy(out, p + offset, length * sizeof(float));
+        return 0;
+    };
+
+    return signal;
+}
+
+// Classify the given slice of a stream, on a context or through the classic API
+static void run(ei_impulse_context_t *ctx, int stream, int slice, float *out)
+{
+    signal_t signal = buffer_signal(audio[stream] + slice * EI_CLASSIFIER_SLICE_SIZE, EI_CLASSIFIER_SLICE_SIZE);
+    ei_impulse_result_t result;
+
+    memset(&result, 0, sizeof(result));
+    EI_IMPULSE_ERROR r = ctx ? run_classifier_continuous_ctx(ctx, &signal, &result, false)
+                             : run_classifier_continuous(&signal, &result, false);
+    CHECK_EQUAL(EI_IMPULSE_OK, r);
+
+    for (int l = 0; l < EI_CLASSIFIER_LABEL_COUNT; l++)
+        out[l] = result.classification[l].value;
+}
+
+static void check_continuous()
+{
+    ei_impulse_context_t a, b;
+
+    for (int s = 0; s < STREAMS; s++) {
+        CHECK_EQUAL(EI_IMPULSE_OK, ei_impulse_context_init(&a));
+        for (int i = 0; i < SLICES; i++)
+            run(&a, s, i, alone[s][i]);
+        ei_impulse_context_free(&a);
+    }
+
+    CHECK_EQUAL(EI_IMPULSE_OK, ei_impulse_context_init(&a));
+    CHECK_EQUAL(EI_IMPULSE_OK, ei_impulse_context_init(&b));
+    for (int i = 0; i < SLICES; i++) {
+        run(&a, 0, i, mixed[0][i]);
+        run(&b, 1, i, mixed[1][i]);
+    }
+    printf("context memory: %zu bytes\n", a.memory_used);
+    ei_impulse_context_free(&a);
+    ei_impulse_context_free(&b);
+
+    run_classifier_init();
+    for (int i = 0; i < SLICES; i++)
+        run(NULL, 0, i, classic[i]);
+
+    CHECK(memcmp(alone, mixed, sizeof(alone)) == 0);
+    CHECK(memcmp(alone[0], classic, sizeof(classic)) == 0);
+    CHECK(memcmp(alone[0], alone[1], sizeof(alone[0])) != 0);
+}
+
+static size_t edge_count(const char *edges)
+{
+    size_t n = 1;
+
+    for (const char *p = edges; *p; p++)
+        n += *p == ',';
+
+    return n;
+}
+
+static void check_spectral()
+{
+    static float window[STREAMS][AXES * COLS];
+    ei_impulse_context_t ctx[STREAMS];
+    void *engine[STREAMS];
+
+    for (int s = 0; s < STREAMS; s++) {
+        memset(&ctx[s], 0, sizeof(ei_impulse_context_t));
+        engine[s] = NULL;
+    }
+
+    for (int w = 0; w < 10; w++) {
+        for (int s = 0; s < STREAMS; s++) {
+            void *config = (void *)&spectral_configs[s];
+
+            // the axes interleaved, as the sensor data comes in
+            for (int i = 0; i < AXES * COLS; i++)
+                window[s][i] = audio[s][w * AXES * COLS + i] / 1000.0f;
+
+            signal_t signal = buffer_signal(window[s], AXES * COLS);
+            size_t features = AXES * spectral::feature::calculate_spectral_buffer_size(true,
+                spectral_configs[s].spectral_peaks_count, edge_count(spectral_configs[s].spectral_power_edges));
+            matrix_t with_ctx(1, features), without_ctx(1, features);
+
+            CHECK_EQUAL(EIDSP_OK, extract_spectral_analysis_features(&signal, &without_ctx, config, 62.5f));
+            CHECK_EQUAL(EIDSP_OK, extract_spectral_analysis_features_ctx(&ctx[s], &signal, &with_ctx, config, 62.5f));
+            CHECK(memcmp(with_ctx.buffer, without_ctx.buffer, with_ctx.cols * sizeof(float)) == 0);
+
+            // built on the first window, and never rebuilt by the other stream
+            if (w == 0)
+                engine[s] = ctx[s].spectral_engine;
+            CHECK(ctx[s].spectral_engine != NULL && ctx[s].spectral_engine == engine[s]);
+            CHECK(ctx[s].spectral_config == config);
+        }
+    }
+
+    for (int s = 0; s < STREAMS; s++) {
+        ei_impulse_context_free(&ctx[s]);
+        CHECK(ctx[s].spectral_engine == NULL);
+    }
+}
+
+// A slice of int8 audio, read in place through a signal_i8_t or as floats through get_data, gives the same MFCC
+static void check_int8_signal()
+{
+    static int8_t slice[EI_CLASSIFIER_SLICE_SIZE];
+    static float samples[EI_CLASSIFIER_SLICE_SIZE];
+    matrix_t in_place(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE), staged(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
+
+    for (int i = 0; i < EI_CLASSIFIER_SLICE_SIZE; i++) {
+        float v = audio[0][i] / 32.0f;
+        slice[i] = (int8_t)(v > 127.0f ? 127.0f : v < -128.0f ? -128.0f : v);
+        samples[i] = slice[i] / 128.0f;
+    }
+
+    signal_t signal = buffer_signal(samples, EI_CLASSIFIER_SLICE_SIZE);
+    CHECK(signal_i8_t::of(&signal) == NULL);
+    CHECK_EQUAL(EIDSP_OK, extract_mfcc_features(&signal, &staged, &ei_dsp_config_3, EI_CLASSIFIER_FREQUENCY));
+
+    {
+        signal_i8_t wrapped(slice, EI_CLASSIFIER_SLICE_SIZE, 1.0f / 128.0f);
+        wrapped.signal.get_data = [](size_t offset, size_t length, float *out) {
+            printf("int8 samples staged through get_data\n");
+            return -1;
+        };
+
+        CHECK(signal_i8_t::of(&wrapped.signal) == &wrapped);
+        CHECK(signal_i8_t::of(&signal) == NULL);
+        CHECK_EQUAL(EIDSP_OK, extract_mfcc_features(&wrapped.signal, &in_place, &ei_dsp_config_3,
+            EI_CLASSIFIER_FREQUENCY));
+        CHECK_EQUAL(staged.cols, in_place.cols);
+        CHECK(memcmp(staged.buffer, in_place.buffer, staged.cols * sizeof(float)) == 0);
+    }
+}
+
+int main()
+{
+    make_audio();
+
+    check_continuous();
+    check_spectral();
+    check_int8_signal();
+
+    return host_test_summary("ImpulseContextTest");
+}
@@ -0,0 +1,205 @@
+// Simulates a room of nodes running KeywordVote over loopback transports, with unrelated clocks, and checks
+// that a quorum is required for a detection, including after a long silence in which the voice activity gate
+// kept every classifier (and so every vote) back and only heartbeats were exchanged.
+#include <stdio.h>
+#include "KeywordVote.h"
+#include "HostTest.h"
+
+#define NODES       4
+#define SLICE_MS    250         // Time between two classified slices
+#define LOOP_MS     10          // Time between two iterations of an idle inference loop
+
+static LoopbackVoteTransport transports[NODES];
+static KeywordVote *votes[NODES];
+static const int32_t skew[NODES] = { 0, 12345, -700, 99999 };
+
+// Local time of a node, slightly out of phase with the others
+static uint32_t local(int node, uint32_t t)
+{
+    return t + skew[node] + (node * 37) % SLICE_MS;
+}
+
+// The nodes in the mask classify a slice with the given score, then poll and decide, while the others sit idle
+// as the inference loop does while the gate is closed. Returns a bit per node that fired.
+static int classify(uint32_t t, const float *scores, int active = (1 << NODES) - 1, bool heartbeats = true)
+{
+    int fired = 0;
+
+    for (int i = 0; i < NODES; i++) {
+        if (active & (1 << i))
+            votes[i]->publish(local(i, t), scores[i]);
+        else if (heartbeats)
+            votes[i]->heartbeat(local(i, t));
+    }
+
+    for (int i = 0; i < NODES; i++) {
+        votes[i]->poll(local(i, t));
+
+        if ((active & (1 << i)) && votes[i]->decide(local(i, t)))
+            fired |= 1 << i;
+    }
+
+    return fired;
+}
+
+// Every node sits idle for the given time
+static uint32_t idle(uint32_t t, uint32_t duration, bool heartbeats)
+{
+    static const float none[NODES] = { 0 };
+
+    for (uint32_t end = t + duration; t < end; t += LOOP_MS)
+        classify(t, none, 0, heartbeats);
+
+    return t;
+}
+
+static uint32_t background(uint32_t t, int slices, int *fired)
+{
+    static const float quiet[NODES] = { 0.05f, 0.05f, 0.05f, 0.05f };
+
+    for (int s = 0; s < slices; s++, t += SLICE_MS)
+        *fired |= classify(t, quiet);
+
+    return t;
+}
+
+static void test_quorum(bool heartbeats)
+{
+    static const float utterance[NODES] = { 0.9f, 0.9f, 0.9f, 0.3f };
+    static const float false_accept[NODES] = { 0.95f, 0.1f, 0.1f, 0.1f };
+
+    for (int i = 0; i < NODES; i++) {
+        votes[i]->reset();
+        votes[i]->quorum = 2;
+    }
+
+    int fired = 0;
+    uint32_t t = 1000;
+
+    t = background(t, 20, &fired);
+    CHECK_EQUAL(0, fired);
+
+    for (int i = 0; i < NODES; i++)
+        CHECK_EQUAL(NODES, votes[i]->getAliveNodes(local(i, t)));
+
+    // Three nodes hear the keyword over two slices: everyone reports it, once
+    fired = classify(t, utterance);
+    t += SLICE_MS;
+    fired |= classify(t, utterance);
+    t += SLICE_MS;
+    t = background(t, 10, &fired);
+    CHECK_EQUAL((1 << NODES) - 1, fired);
+
+    // A false accept on a single node is rejected
+    fired = classify(t, false_accept);
+    t += SLICE_MS;
+    t = background(t, 10, &fired);
+    CHECK_EQUAL(0, fired);
+
+    // A long silence, in which nobody classifies anything, then a noise close to node 0 only opens its gate
+    t = idle(t, 4 * KEYWORD_VOTE_DEFAULT_LIFETIME, heartbeats);
+
+    fired = 0;
+    for (int s = 0; s < 4; s++, t += SLICE_MS)
+        fired |= classify(t, false_accept, 1, heartbeats);
+
+    if (heartbeats) {
+        // Neighbours are still known to be there, so the false accept is still rejected
+        for (int i = 0; i < NODES; i++)
+            CHECK_EQUAL(NODES, votes[i]->getAliveNodes(local(i, t)));
+
+        CHECK_EQUAL(0, fired);
+    } else {
+        // Without heartbeats, node 0 thought it was on its own when it heard the keyword
+        CHECK(fired & 1);
+    }
+}
+
+static void test_out_of_range()
+{
+    static const float single[NODES] = { 0.1f, 0.1f, 0.95f, 0.1f };
+
+    for (int i = 0; i < NODES; i++)
+        votes[i]->reset();
+
+    int fired = 0;
+    uint32_t t = 1000000;
+
+    t = background(t, 4, &fired);
+
+    // Everyone but node 2 leaves: it doesn't wait for nodes it can no longer hear, and decides by itself
+    for (int i = 0; i < NODES; i++)
+        transports[i].connected = i == 2;
+
+    t = idle(t, 2 * KEYWORD_VOTE_DEFAULT_LIFETIME, true);
+    CHECK_EQUAL(1, votes[2]->getAliveNodes(local(2, t)));
+
+    fired = classify(t, single);
+    CHECK_EQUAL(1 << 2, fired);
+
+    for (int i = 0; i < NODES; i++)
+        transports[i].connected = true;
+}
+
+static void test_packets()
+{
+    KeywordVotePacket p, q;
+    uint8_t data[KEYWORD_VOTE_PACKET_SIZE];
+
+    p.node = 0xBEEF;
+    p.timestamp = 0xFFFFFFF0;
+    p.score = 200;
+
+    KeywordVote::encode(p, data);
+    CHECK(KeywordVote::decode(data, KEYWORD_VOTE_PACKET_SIZE, q));
+    CHECK_EQUAL(p.node, q.node);
+    CHECK_EQUAL(p.timestamp, q.timestamp);
+    CHECK_EQUAL(p.score, q.score);
+
+    data[0] ^= 1;
+    CHECK(!KeywordVote::decode(data, KEYWORD_VOTE_PACKET_SIZE, q));
+    CHECK(!KeywordVote::decode(data, KEYWORD_VOTE_PACKET_SIZE - 1, q));
+
+    CHECK_EQUAL(0, KeywordVote::quantize(-1.0f));
+    CHECK_EQUAL(255, KeywordVote::quantize(2.0f));
+    CHECK_EQUAL(KEYWORD_VOTE_DEFAULT_THRESHOLD, KeywordVote::quantize(0.7f));
+}
+
+static void test_solo()
+{
+    LoopbackVoteTransport transport;
+    KeywordVote vote(transport, 7);
+    int fired = 0;
+
+    for (int s = 0; s < 50; s++) {
+        uint32_t now = s * SLICE_MS;
+
+        vote.publish(now, (s == 10 || s == 11) ? 0.9f : 0.1f);
+        vote.poll(now);
+
+        if (vote.decide(now))
+            fired++;
+    }
+
+    CHECK_EQUAL(1, fired);
+}
+
+int main()
+{
+    for (int i = 1; i < NODES; i++)
+        transports[i].join(transports[0]);
+
+    for (int i = 0; i < NODES; i++)
+        votes[i] = new KeywordVote(transports[i], 100 + i);
+
+    test_quorum(false);
+    test_quorum(true);
+    test_out_of_range();
+    test_packets();
+    test_solo();
+
+    for (int i = 0; i < NODES; i++)
+        CHECK_EQUAL(0, transports[i].dropped);
+
+    return host_test_summary("KeywordVoteTest");
+}
@@ -0,0 +1,193 @@
+// Runs MicroBitFileSystem on a simulated flash: creates many files and a long, sequentially written log in a
+// subdirectory, removes some files, then reloads the file system as after a reset and reads everything back.
+// Exercises the directory index, the per-descriptor block cursor (sequential reads, backwards seeks, appends)
+// and flush() moving a descriptor onto its replacement directory entry.
+#include <stdio.h>
+#include <sys/mman.h>
+#include <chrono>
+#include "MicroBitCompat.h"
+#include "MicroBitFileSystem.h"
+#include "HostTest.h"
+
+#define FILES           60
+#define FILE_SIZE       300
+#define LOG_CHUNK       64
+#define LOG_CHUNKS      1500
+
+// The file system API takes 32 bit flash addresses, so the simulated flash has to be mapped below 4 GB.
+uint8_t *host_flash;
+
+static uint8_t log_byte(int offset)
+{
+    return (uint8_t)((offset / LOG_CHUNK) * 7 + offset % LOG_CHUNK);
+}
+
+static void write_files(MicroBitFileSystem &fs)
+{
+    char name[16];
+    uint8_t data[FILE_SIZE];
+
+    for (int i = 0; i < FILES; i++) {
+        sprintf(name, "f%d.txt", i);
+        memset(data, i, sizeof(data));
+
+        int fd = fs.open(name, MB_WRITE | MB_CREAT);
+        CHECK(fd >= 0);
+        CHECK_EQUAL(FILE_SIZE, fs.write(fd, data, FILE_SIZE));
+        CHECK_EQUAL(MICROBIT_OK, fs.close(fd));
+    }
+
+    CHECK_EQUAL(MICROBIT_OK, fs.createDirectory("logs"));
+
+    int fd = fs.open("logs/audio.raw", MB_WRITE | MB_CREAT);
+    CHECK(fd >= 0);
+
+    for (int c = 0; c < LOG_CHUNKS; c++) {
+        uint8_t chunk[LOG_CHUNK];
+
+        for (int j = 0; j < LOG_CHUNK; j++)
+            chunk[j] = log_byte(c * LOG_CHUNK + j);
+
+        CHECK_EQUAL(LOG_CHUNK, fs.write(fd, chunk, LOG_CHUNK));
+    }
+
+    CHECK_EQUAL(MICROBIT_OK, fs.close(fd));
+
+    for (int i = 0; i < FILES; i += 3) {
+        sprintf(name, "f%d.txt", i);
+        CHECK_EQUAL(MICROBIT_OK, fs.remove(name));
+    }
+}
+
+static void check_files(MicroBitFileSystem &fs)
+{
+    char name[16];
+    uint8_t data[FILE_SIZE];
+
+    for (int i = 0; i < FILES; i++) {
+        sprintf(name, "f%d.txt", i);
+
+        int fd = fs.open(name, MB_READ);
+
+        if (i % 3 == 0) {
+            CHECK(fd < 0);
+            continue;
+        }
+
+        CHECK(fd >= 0);
+        CHECK_EQUAL(FILE_SIZE, fs.read(fd, data, FILE_SIZE));
+        CHECK_EQUAL(i, data[0]);
+        CHECK_EQUAL(i, data[FILE_SIZE - 1]);
+        CHECK_EQUAL(MICROBIT_OK, fs.close(fd));
+    }
+}
+
+static void check_log(MicroBitFileSystem &fs)
+{
+    uint8_t chunk[LOG_CHUNK];
+    int offset = 0;
+    int errors = 0;
+    int n;
+
+    auto start = std::chrono::steady_clock::now();
+
+    int fd = fs.open("logs/audio.raw", MB_READ);
+    CHECK(fd >= 0);
+
+    while ((n = fs.read(fd, chunk, LOG_CHUNK)) > 0) {
+        for (int j = 0; j < n; j++)
+            if (chunk[j] != log_byte(offset + j))
+                errors++;
+
+        offset += n;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    CHECK_EQUAL(0, errors);
+    CHECK_EQUAL(LOG_CHUNKS * LOG_CHUNK, offset);
+
+    // A backwards seek, then reads on both sides of a block boundary
+    CHECK_EQUAL(1000, fs.seek(fd, 1000, MB_SEEK_SET));
+    CHECK_EQUAL(1, fs.read(fd, chunk, 1));
+    CHECK_EQUAL(log_byte(1000), chunk[0]);
+
+    CHECK_EQUAL(MBFS_BLOCK_SIZE - 2, fs.seek(fd, MBFS_BLOCK_SIZE - 2, MB_SEEK_SET));
+    CHECK_EQUAL(4, fs.read(fd, chunk, 4));
+    for (int j = 0; j < 4; j++)
+        CHECK_EQUAL(log_byte(MBFS_BLOCK_SIZE - 2 + j), chunk[j]);
+
+    CHECK_EQUAL(MICROBIT_OK, fs.close(fd));
+
+    printf("read %d bytes sequentially in %ld us\n", offset,
+        (long)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+}
+
+static void check_append(MicroBitFileSystem &fs)
+{
+    uint8_t chunk[LOG_CHUNK];
+
+    int fd = fs.open("logs/audio.raw", MB_READ);
+    CHECK(fd >= 0);
+    int length = fs.seek(fd, 0, MB_SEEK_END);
+    CHECK_EQUAL(MICROBIT_OK, fs.close(fd));
+
+    // Append, flushing in between, so the descriptor has to follow the directory entry flush() replaces
+    fd = fs.open("logs/audio.raw", MB_WRITE | MB_APPEND);
+    CHECK(fd >= 0);
+
+    memset(chunk, 0xAB, sizeof(chunk));
+    CHECK_EQUAL(LOG_CHUNK, fs.write(fd, chunk, LOG_CHUNK));
+    CHECK_EQUAL(MICROBIT_OK, fs.flush(fd));
+
+    memset(chunk, 0xCD, sizeof(chunk));
+    CHECK_EQUAL(LOG_CHUNK, fs.write(fd, chunk, LOG_CHUNK));
+    CHECK_EQUAL(MICROBIT_OK, fs.close(fd));
+
+    fd = fs.open("logs/audio.raw", MB_READ);
+    CHECK(fd >= 0);
+    CHECK_EQUAL(length + 2 * LOG_CHUNK, fs.seek(fd, 0, MB_SEEK_END));
+
+    CHECK_EQUAL(length, fs.seek(fd, -2 * LOG_CHUNK, MB_SEEK_END));
+    CHECK_EQUAL(LOG_CHUNK, fs.read(fd, chunk, LOG_CHUNK));
+    CHECK_EQUAL(0xAB, chunk[0]);
+    CHECK_EQUAL(LOG_CHUNK, fs.read(fd, chunk, LOG_CHUNK));
+    CHECK_EQUAL(0xCD, chunk[LOG_CHUNK - 1]);
+    CHECK_EQUAL(0, fs.read(fd, chunk, LOG_CHUNK));
+    CHECK_EQUAL(MICROBIT_OK, fs.close(fd));
+}
+
+int main()
+{
+    host_flash = (uint8_t *)mmap(NULL, HOST_FLASH_PAGES * MICROBIT_CODEPAGESIZE, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+    CHECK(host_flash != MAP_FAILED);
+    memset(host_flash, 0xff, HOST_FLASH_PAGES * MICROBIT_CODEPAGESIZE);
+
+    {
+        MicroBitFileSystem fs(FLASH_PROGRAM_END, HOST_FLASH_PAGES - 4);
+
+        write_files(fs);
+        check_files(fs);
+        check_log(fs);
+    }
+
+    // Load the file system from flash again, as after a reset
+    {
+        MicroBitFileSystem fs(FLASH_PROGRAM_END, HOST_FLASH_PAGES - 4);
+
+        check_files(fs);
+        check_log(fs);
+        check_append(fs);
+    }
+
+    {
+        MicroBitFileSystem fs(FLASH_PROGRAM_END, HOST_FLASH_PAGES - 4);
+
+        check_files(fs);
+        check_append(fs);
+    }
+
+    return host_test_summary("MicroBitFileSystemTest");
+}
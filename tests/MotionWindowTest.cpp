@@ -0,0 +1,276 @@
+// Replays recorded accelerometer data (i2c/motion.csv: milli-g at 50 Hz) through the simulated LSM303 (see
+// i2c/TwimSimulator.h), and checks it reaches a MotionWindow through the FIFO and an AccelerometerStream unchanged,
+// in order, with no events and a fraction of the bus transfers of sample by sample updates. Also checks that with
+// INT1 shared with another sensor nothing changes, that when the scheduler stalls only the samples the FIFO could not
+// hold are lost, and that when the classifier stalls only the oldest slices are dropped.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "NRF52I2C.h"
+#include "LSM303Accelerometer.h"
+#include "AccelerometerStream.h"
+#include "MotionWindow.h"
+#include "TwimSimulator.h"
+#include "HostTest.h"
+
+#define RANGE           4               // In g, which is also (approximately) milli-g per 10 bit count
+#define BATCH_SIZE      16
+#define SLICE_SAMPLES   25
+#define SLICES          4
+
+struct Record
+{
+    int v[3];
+};
+
+static std::vector<Record> raw;         // The 10 bit counts the sensor reports for each record, on its own axes
+static std::vector<Record> expected;    // What the driver should deliver for each record
+
+static NRF52Pin sda(0, (PinNumber)0), scl(2, (PinNumber)2);
+static SimulatedInterruptPin int1;
+static CoordinateSpace space(SIMPLE_CARTESIAN, true, COORDINATE_SPACE_ROTATED_0);
+
+class TestAccelerometer : public LSM303Accelerometer
+{
+    public:
+    TestAccelerometer(I2C &i2c) : LSM303Accelerometer(i2c, ::int1, ::space, LSM303_SIM_ADDRESS)
+    {
+    }
+
+    // The flags CodalComponent owns, that the driver never sets
+    uint16_t componentFlags()
+    {
+        return status & (DEVICE_COMPONENT_RUNNING | DEVICE_COMPONENT_STATUS_SYSTEM_TICK);
+    }
+};
+
+static int16_t recorded(int k, int axis)
+{
+    return raw[k - 1].v[axis] * 32;
+}
+
+static bool loadRecords(const char *name)
+{
+    FILE *f = fopen(name, "r");
+    char line[128];
+
+    if (f == NULL || fgets(line, sizeof(line), f) == NULL) {
+        printf("cannot read %s\n", name);
+        return false;
+    }
+
+    // The coordinate space only swaps and negates axes: its matrix is orthogonal, and its transpose converts
+    // records back to ENU
+    Sample3D ex = space.transform(Sample3D(1, 0, 0)), ey = space.transform(Sample3D(0, 1, 0)),
+        ez = space.transform(Sample3D(0, 0, 1));
+    int t, x, y, z;
+
+    while (fscanf(f, "%d,%d,%d,%d", &t, &x, &y, &z) == 4) {
+        // quantize to what the sensor can report
+        int q[3] = { (int)lround(x / (double)RANGE), (int)lround(y / (double)RANGE), (int)lround(z / (double)RANGE) };
+        int e = ex.x * q[0] + ex.y * q[1] + ex.z * q[2];
+        int n = ey.x * q[0] + ey.y * q[1] + ey.z * q[2];
+        int u = ez.x * q[0] + ez.y * q[1] + ez.z * q[2];
+        Record r = { { -n, -e, u } }, out = { { q[0] * RANGE, q[1] * RANGE, q[2] * RANGE } };
+
+        raw.push_back(r);
+        expected.push_back(out);
+    }
+
+    fclose(f);
+    return !raw.empty();
+}
+
+static bool holds(const float *s, int k)
+{
+    for (int i = 0; i < SLICE_SAMPLES; i++)
+        for (int a = 0; a < 3; a++)
+            if (s[i * 3 + a] != expected[k + i].v[a])
+                return false;
+
+    return true;
+}
+
+struct Run
+{
+    const char *name;
+    bool batched;
+    bool sharedIrq;
+    int stallFrom, stallMs;             // The scheduler runs no idle callbacks
+    int holdFrom, holdMs;               // The classifier releases no slices
+
+    // results
+    int delivered, slices, gaps, skipped, mismatched, lost, transfers, events, windowErrors, componentFlags;
+    uint32_t dropped;
+    uint64_t busy;
+};
+
+static void replay(Run &run)
+{
+    lsm303_reset();
+    lsm303_source = recorded;
+    lsm303_sample_limit = raw.size();
+
+    NRF52I2C i2c(sda, scl, NRF_TWIM0);
+    i2c.setFrequency(400000);
+
+    TestAccelerometer acc(i2c);
+    acc.setRange(RANGE);
+    acc.setPeriod(20);
+
+    AccelerometerStream *stream = NULL;
+    MotionWindow *window = NULL;
+
+    if (run.batched) {
+        acc.setBatchSize(BATCH_SIZE);
+        stream = new AccelerometerStream(acc);
+        window = new MotionWindow(*stream, SLICE_SAMPLES, SLICES);
+        window->setScale(1.0f);
+    }
+    else {
+        acc.getSample();
+    }
+
+    int transfers = twim_transfers, events = twim_events.accelerometerUpdates, next = 0;
+    uint64_t busy = twim_busy_wait_us;
+    int duration = raw.size() * 20 + 200;
+
+    for (int ms = 0; ms < duration; ms++) {
+        twim_run_us(1000);
+
+        // another sensor holds INT1 30% of the time
+        if (run.sharedIrq)
+            lsm303_shared_irq = ms % 10 < 3;
+        if (ms >= run.stallFrom && ms < run.stallFrom + run.stallMs)
+            continue;
+
+        acc.idleCallback();
+        run.componentFlags |= acc.componentFlags();
+
+        if (window == NULL || (ms >= run.holdFrom && ms < run.holdFrom + run.holdMs))
+            continue;
+
+        // slices hold consecutive records; after samples or slices were dropped, they pick up again further on
+        while (window->getSlicesAvailable()) {
+            float s[SLICE_SAMPLES * 3];
+            int start = -1;
+
+            window->getSliceData(0, SLICE_SAMPLES * 3, s);
+
+            for (int k = next; k + SLICE_SAMPLES <= (int)expected.size() && start < 0; k++)
+                if (holds(s, k))
+                    start = k;
+
+            if (start < 0) {
+                run.mismatched++;
+            }
+            else {
+                if (start != next) {
+                    run.gaps++;
+                    run.skipped += start - next;
+                }
+                next = start + SLICE_SAMPLES;
+            }
+
+            run.slices++;
+            window->releaseSlice();
+        }
+    }
+
+    run.transfers = twim_transfers - transfers;
+    run.events = twim_events.accelerometerUpdates - events;
+    run.busy = twim_busy_wait_us - busy;
+    run.delivered = window ? next : run.events;
+    run.lost = lsm303_fifo_lost;
+
+    if (window) {
+        // the full window is the most recent complete slices, oldest first
+        static float w[SLICES * SLICE_SAMPLES * 3];
+        int first = next - SLICES * SLICE_SAMPLES;
+
+        CHECK(window->isWindowFull());
+        CHECK_EQUAL(0, window->getWindowData(0, SLICES * SLICE_SAMPLES * 3, w));
+
+        for (int i = 0; i < SLICES * SLICE_SAMPLES; i++)
+            for (int a = 0; a < 3; a++)
+                run.windowErrors += w[i * 3 + a] != expected[first + i].v[a];
+
+        run.dropped = window->overruns;
+    }
+
+    printf("%-32s %d of %d samples delivered, %d slices (%d gaps, %d samples skipped, %d lost by the FIFO, "
+        "%u slices dropped), %d mismatched\n", run.name, run.delivered, (int)raw.size(), run.slices, run.gaps,
+        run.skipped, run.lost, run.dropped, run.mismatched);
+    printf("%-32s %d transfers, %d FIFO_SRC reads, %d events, busy waited %d us\n", "", run.transfers,
+        lsm303_fifo_src_reads, run.events, (int)run.busy);
+
+    // let the transfer in progress complete
+    twim_run_us(2000);
+
+    delete window;
+    delete stream;
+}
+
+static int test()
+{
+    if (!loadRecords("i2c/motion.csv"))
+        return 1;
+
+    Run sampled = { "sample by sample:", false, false, -1, 0, -1, 0 };
+    Run batched = { "batched:", true, false, -1, 0, -1, 0 };
+    Run shared = { "batched, shared INT1:", true, true, -1, 0, -1, 0 };
+    Run stalled = { "batched, scheduler stalled 1s:", true, false, 5000, 1000, -1, 0 };
+    Run held = { "batched, classifier stalled 3s:", true, false, -1, 0, 8000, 3000 };
+    // the samples that make whole slices, once the last incomplete batch is left in the FIFO
+    int records = raw.size(), whole = records / BATCH_SIZE * BATCH_SIZE / SLICE_SAMPLES * SLICE_SAMPLES;
+
+    replay(sampled);
+    replay(batched);
+    replay(shared);
+    replay(stalled);
+    replay(held);
+
+    CHECK(sampled.delivered >= records - 1);
+
+    // reading a sample or a batch leaves the component's own flags alone
+    CHECK_EQUAL(0, sampled.componentFlags | batched.componentFlags | shared.componentFlags |
+        stalled.componentFlags | held.componentFlags);
+
+    // every record arrives, in whole slices, without an event, and in a fraction of the transfers
+    CHECK_EQUAL(whole, batched.delivered);
+    CHECK_EQUAL(0, batched.gaps);
+    CHECK_EQUAL(0, batched.mismatched);
+    CHECK_EQUAL(0, batched.windowErrors);
+    CHECK_EQUAL(0, batched.events);
+    CHECK_EQUAL(0, (int)batched.busy);
+    CHECK(batched.transfers * 4 < sampled.transfers);
+
+    CHECK_EQUAL(whole, shared.delivered);
+    CHECK_EQUAL(0, shared.gaps);
+    CHECK_EQUAL(0, shared.mismatched);
+    CHECK_EQUAL(0, shared.windowErrors);
+
+    // a stalled scheduler loses what the FIFO could not hold, and no more: the slice across the loss mixes samples
+    // from before and after it
+    CHECK(stalled.lost > 0);
+    CHECK_EQUAL(1, stalled.gaps);
+    CHECK_EQUAL(1, stalled.mismatched);
+    CHECK_EQUAL(SLICE_SAMPLES + stalled.lost, stalled.skipped);
+    CHECK_EQUAL(0, stalled.windowErrors);
+
+    // a stalled classifier loses the oldest slices, and no more
+    CHECK_EQUAL(1, held.gaps);
+    CHECK(held.dropped > 0);
+    CHECK_EQUAL((int)held.dropped * SLICE_SAMPLES, held.skipped);
+    CHECK_EQUAL(0, held.mismatched);
+    CHECK_EQUAL(0, held.windowErrors);
+
+    return host_test_summary("MotionWindowTest");
+}
+
+int main()
+{
+    return twim_main(test);
+}
@@ -0,0 +1,157 @@
+// Runs NRF52I2C on a simulated TWIM peripheral (see i2c/TwimSimulator.h) under the CODAL scheduler itself, switching
+// fibers with host contexts (see host/HostFiber.cpp). Checks that a blocking read from a fiber sleeps while the bus is
+// busy, letting the idle task run; that a blocking read from an idle callback, whose context the scheduler discards
+// whenever it switches away, waits for the bus instead of sleeping; and that so does one from the interrupt handler
+// completing a transaction, which has to complete the transactions ahead of it itself. Either way, nothing is left
+// on the bus's queue or on the scheduler's queues.
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "NRF52I2C.h"
+#include "LSM303Accelerometer.h"
+#include "MessageBus.h"
+#include "CodalFiber.h"
+#include "TwimSimulator.h"
+#include "HostTest.h"
+
+#define TIMEOUT_S       10
+
+static NRF52Pin sda(0, (PinNumber)0), scl(2, (PinNumber)2);
+static NRF52I2C *bus;
+
+static char order[8];
+static int completed;
+
+static void record(void *t)
+{
+    order[completed++] = (char)((I2CTransaction *)t)->rxBuffer[1];
+}
+
+// Reads WHO_AM_I once from the idle task, when asked to. CodalComponent's idle callbacks run from this event too; the
+// components constructed before the scheduler's message bus register for it on the simulator's.
+static bool idleArmed;
+static int idleValue, idleCanBlock;
+
+static void readFromIdle(Event)
+{
+    if (!idleArmed)
+        return;
+
+    idleArmed = false;
+    idleCanBlock = fiber_can_block();
+    idleValue = ((I2C *)bus)->readRegister(LSM303_SIM_ADDRESS, LSM303_WHO_AM_I_A);
+    order[completed++] = 'i';
+}
+
+// Reads WHO_AM_I from the interrupt handler, once the transaction it is given completes
+static int irqValue;
+
+static void readFromIrq(void *t)
+{
+    irqValue = ((I2C *)bus)->readRegister(LSM303_SIM_ADDRESS, LSM303_WHO_AM_I_A);
+    record(t);
+}
+
+static void prepare(I2CTransaction &t, uint8_t *reg, uint8_t *out, char name, PVoidCallback done)
+{
+    memset(&t, 0, sizeof(t));
+    *reg = LSM303_WHO_AM_I_A;
+    out[1] = name;
+    t.address = LSM303_SIM_ADDRESS;
+    t.txBuffer = reg;
+    t.txSize = 1;
+    t.rxBuffer = out;
+    t.rxSize = 1;
+    t.doneHandler = done;
+}
+
+// Only the running fiber is on a queue: the idle task never is
+static bool queuesClean()
+{
+    for (Fiber *f = get_fiber_list(); f != NULL; f = f->next)
+        if (f != currentFiber && f->queue != NULL)
+            return false;
+
+    return true;
+}
+
+static void check_idle_callback()
+{
+    uint8_t reg, out[2];
+    I2CTransaction t;
+
+    // a transaction holds the bus, so the fiber's read sleeps behind it, and the idle task runs meanwhile
+    prepare(t, &reg, out, 'q', record);
+    completed = 0;
+    idleCanBlock = -1;
+    idleArmed = true;
+
+    CHECK_EQUAL(DEVICE_OK, bus->startTransaction(t));
+    CHECK_EQUAL(1, fiber_can_block());
+    CHECK_EQUAL(LSM303_A_WHOAMI_VAL, ((I2C *)bus)->readRegister(LSM303_SIM_ADDRESS, LSM303_WHO_AM_I_A));
+    order[completed++] = 'm';
+
+    printf("idle callback: order %.*s, can block %d\n", completed, order, idleCanBlock);
+
+    CHECK_EQUAL(3, completed);
+    CHECK(memcmp(order, "qim", 3) == 0);
+    CHECK_EQUAL(DEVICE_OK, t.status);
+    CHECK_EQUAL(0, idleCanBlock);
+    CHECK_EQUAL(LSM303_A_WHOAMI_VAL, idleValue);
+    CHECK(queuesClean());
+}
+
+static void check_interrupt()
+{
+    uint8_t reg[2], out[2][2];
+    I2CTransaction t[2];
+    uint64_t busy = twim_busy_wait_us;
+
+    // the first transaction's handler reads while the second holds the bus, and the fiber's read is queued behind
+    prepare(t[0], &reg[0], out[0], 'a', readFromIrq);
+    prepare(t[1], &reg[1], out[1], 'b', record);
+    completed = 0;
+    irqValue = 0;
+
+    CHECK_EQUAL(DEVICE_OK, bus->startTransaction(t[0]));
+    CHECK_EQUAL(DEVICE_OK, bus->startTransaction(t[1]));
+    CHECK_EQUAL(LSM303_A_WHOAMI_VAL, ((I2C *)bus)->readRegister(LSM303_SIM_ADDRESS, LSM303_WHO_AM_I_A));
+    order[completed++] = 'm';
+
+    printf("interrupt: order %.*s, busy waited %d us\n", completed, order, (int)(twim_busy_wait_us - busy));
+
+    CHECK_EQUAL(3, completed);
+    CHECK(memcmp(order, "bam", 3) == 0);
+    CHECK_EQUAL(DEVICE_OK, t[0].status);
+    CHECK_EQUAL(DEVICE_OK, t[1].status);
+    CHECK_EQUAL(LSM303_A_WHOAMI_VAL, irqValue);
+    CHECK(twim_busy_wait_us > busy);
+    CHECK(queuesClean());
+}
+
+static int test()
+{
+    static MessageBus messageBus;
+
+    lsm303_reset();
+    EventModel::defaultEventBus = &messageBus;
+    scheduler_init(messageBus);
+    messageBus.listen(DEVICE_ID_SCHEDULER, DEVICE_SCHEDULER_EVT_IDLE, readFromIdle, MESSAGE_BUS_LISTENER_IMMEDIATE);
+
+    NRF52I2C i2c(sda, scl, NRF_TWIM0);
+    i2c.setFrequency(400000);
+    bus = &i2c;
+
+    check_idle_callback();
+    check_interrupt();
+
+    return host_test_summary("NRF52I2CSchedulerTest");
+}
+
+int main()
+{
+    // A fiber left waiting keeps the idle task spinning: fail rather than hang
+    alarm(TIMEOUT_S);
+
+    return twim_main(test);
+}
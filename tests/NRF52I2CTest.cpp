@@ -0,0 +1,204 @@
+// Runs NRF52I2C and LSM303Accelerometer against a simulated TWIM peripheral and LSM303 (see i2c/TwimSimulator.h).
+// Checks that once the scheduler runs, the accelerometer is sampled in the background without the CPU ever waiting
+// for the bus, and without an event per sample; that queued transactions complete in order, with their own status;
+// and that blocking operations, including those that must wait for the bus, sleep rather than busy wait. Before the
+// scheduler runs, blocking operations still work, waiting for the hardware.
+#include <stdio.h>
+#include <string.h>
+#include "NRF52I2C.h"
+#include "LSM303Accelerometer.h"
+#include "TwimSimulator.h"
+#include "HostTest.h"
+
+static NRF52Pin sda(0, (PinNumber)0), scl(2, (PinNumber)2);
+static SimulatedInterruptPin int1;
+static CoordinateSpace space(SIMPLE_CARTESIAN, true, COORDINATE_SPACE_ROTATED_0);
+
+static int order[3], completed;
+
+static void record(void *t)
+{
+    order[completed++] = ((I2CTransaction *)t)->txBuffer[0];
+}
+
+// Tells whether the last sample read is the k-th the sensor produced, without reading a new one
+class TestAccelerometer : public LSM303Accelerometer
+{
+    public:
+    TestAccelerometer(I2C &i2c, Pin &int1, CoordinateSpace &space)
+        : LSM303Accelerometer(i2c, int1, space, LSM303_SIM_ADDRESS)
+    {
+    }
+
+    bool holds(int k)
+    {
+        return sampleENU.x == -(lsm303_sample(k, 1) / 32) * sampleRange &&
+               sampleENU.y == -(lsm303_sample(k, 0) / 32) * sampleRange &&
+               sampleENU.z == (lsm303_sample(k, 2) / 32) * sampleRange;
+    }
+};
+
+static void check_before_scheduler(NRF52I2C &i2c)
+{
+    uint8_t reg = LSM303_WHO_AM_I_A, who = 0;
+    I2CTransaction t;
+
+    memset(&t, 0, sizeof(t));
+    t.address = LSM303_SIM_ADDRESS;
+    t.txBuffer = &reg;
+    t.txSize = 1;
+    t.rxBuffer = &who;
+    t.rxSize = 1;
+
+    // a blocking read has to wait for the transaction in progress, which it does by waiting for its interrupt
+    twim_scheduler_running = false;
+    CHECK_EQUAL(DEVICE_OK, i2c.startTransaction(t));
+    CHECK_EQUAL(LSM303_A_WHOAMI_VAL, ((I2C &)i2c).readRegister(LSM303_SIM_ADDRESS, LSM303_WHO_AM_I_A));
+    CHECK_EQUAL(DEVICE_OK, t.status);
+    CHECK_EQUAL(LSM303_A_WHOAMI_VAL, who);
+    twim_scheduler_running = true;
+}
+
+static void check_sampling(TestAccelerometer &acc)
+{
+    uint64_t busy = twim_busy_wait_us;
+    int updates = twim_events.accelerometerUpdates, produced, last = 0, mismatched = 0, waits = 0;
+
+    // activation configures the sensor, and polls INT1 for a first sample
+    acc.getSample();
+    CHECK(lsm303_samples > 0 && acc.holds(lsm303_samples));
+    CHECK_EQUAL(0, twim_busy_wait_us - busy);
+
+    // 1 ms of other work between idle ticks, for 2 s
+    produced = lsm303_samples;
+    busy = twim_busy_wait_us;
+    int events = twim_events.i2cCompletions;
+
+    for (int tick = 0; tick < 2000; tick++) {
+        int before = twim_events.accelerometerUpdates;
+        uint64_t t = twim_time_us;
+
+        twim_run_us(1000);
+        acc.idleCallback();
+        // polling INT1 takes a microsecond; anything longer is a wait for the bus
+        waits += twim_time_us > t + 1001;
+
+        // every sample delivered is one the sensor produced, newer than the last one delivered
+        if (twim_events.accelerometerUpdates != before) {
+            int found = 0;
+            for (int k = lsm303_samples; k > last && !found; k--)
+                if (acc.holds(k))
+                    found = k;
+            mismatched += !found;
+            last = found ? found : last;
+        }
+    }
+
+    produced = lsm303_samples - produced;
+    int delivered = twim_events.accelerometerUpdates - updates;
+
+    printf("sampling: %d samples produced, %d delivered, %d mismatched, %d idle ticks waited on the bus, "
+        "%d I2C events\n", produced, delivered, mismatched, waits, twim_events.i2cCompletions - events);
+
+    CHECK(delivered >= produced - 2);
+    CHECK_EQUAL(0, mismatched);
+    CHECK_EQUAL(0, waits);
+    CHECK_EQUAL(0, twim_busy_wait_us - busy);
+    CHECK_EQUAL(0, twim_events.i2cCompletions - events);
+}
+
+static void check_queue(NRF52I2C &i2c)
+{
+    uint8_t reg[3] = { LSM303_CTRL_REG1_A, LSM303_WHO_AM_I_A, LSM303_CTRL_REG4_A };
+    uint8_t out[3] = { 0 };
+    I2CTransaction t[3];
+
+    twim_run_us(2000);
+    memset(t, 0, sizeof(t));
+    completed = 0;
+
+    for (int i = 0; i < 3; i++) {
+        t[i].address = LSM303_SIM_ADDRESS;
+        t[i].txBuffer = &reg[i];
+        t[i].txSize = 1;
+        t[i].rxBuffer = &out[i];
+        t[i].rxSize = 1;
+        t[i].doneHandler = record;
+    }
+
+    // the first one is NACKed
+    twim_nack = 1;
+    for (int i = 0; i < 3; i++)
+        CHECK_EQUAL(DEVICE_OK, i2c.startTransaction(t[i]));
+    for (int i = 0; i < 3; i++)
+        CHECK_EQUAL(I2C_TRANSACTION_PENDING, t[i].status);
+
+    // a blocking read issued meanwhile sleeps until they have completed, and then runs
+    uint64_t busy = twim_busy_wait_us, descheduled = twim_descheduled_us;
+    CHECK_EQUAL(LSM303_A_WHOAMI_VAL, ((I2C &)i2c).readRegister(LSM303_SIM_ADDRESS, LSM303_WHO_AM_I_A));
+
+    printf("queue: blocking read slept %d us, busy waited %d us\n", (int)(twim_descheduled_us - descheduled),
+        (int)(twim_busy_wait_us - busy));
+
+    CHECK(twim_descheduled_us - descheduled > 3 * 45);
+    CHECK_EQUAL(0, twim_busy_wait_us - busy);
+    CHECK_EQUAL(3, completed);
+    for (int i = 0; i < 3; i++)
+        CHECK_EQUAL(reg[i], order[i]);
+    CHECK_EQUAL(DEVICE_I2C_ERROR, t[0].status);
+    CHECK_EQUAL(DEVICE_OK, t[1].status);
+    CHECK_EQUAL(DEVICE_OK, t[2].status);
+    CHECK_EQUAL(LSM303_A_WHOAMI_VAL, out[1]);
+}
+
+// A repeated START transfer locks the bus itself: it waits for the transaction in progress on the completion event
+static void check_repeated_start(NRF52I2C &i2c)
+{
+    uint8_t reg = LSM303_CTRL_REG4_A, value = 0, who = 0, whoRegister = LSM303_WHO_AM_I_A;
+    I2CTransaction t;
+
+    memset(&t, 0, sizeof(t));
+    t.address = LSM303_SIM_ADDRESS;
+    t.txBuffer = &whoRegister;
+    t.txSize = 1;
+    t.rxBuffer = &who;
+    t.rxSize = 1;
+    t.doneHandler = record;
+    completed = 0;
+
+    uint64_t descheduled = twim_descheduled_us;
+    int events = twim_events.i2cCompletions;
+
+    CHECK_EQUAL(DEVICE_OK, i2c.startTransaction(t));
+    CHECK_EQUAL(DEVICE_OK, i2c.write(LSM303_SIM_ADDRESS, &reg, 1, true));
+    CHECK_EQUAL(DEVICE_OK, i2c.read(LSM303_SIM_ADDRESS, &value, 1));
+
+    CHECK(twim_descheduled_us > descheduled);
+    CHECK_EQUAL(1, twim_events.i2cCompletions - events);
+    CHECK_EQUAL(1, completed);
+    CHECK_EQUAL(LSM303_A_WHOAMI_VAL, who);
+    CHECK_EQUAL(lsm303_registers[LSM303_CTRL_REG4_A], value);
+}
+
+static int test()
+{
+    lsm303_reset();
+
+    twim_scheduler_running = false;
+    NRF52I2C i2c(sda, scl, NRF_TWIM0);
+    i2c.setFrequency(400000);
+    check_before_scheduler(i2c);
+
+    TestAccelerometer acc(i2c, int1, space);
+
+    check_sampling(acc);
+    check_queue(i2c);
+    check_repeated_start(i2c);
+
+    return host_test_summary("NRF52I2CTest");
+}
+
+int main()
+{
+    return twim_main(test);
+}
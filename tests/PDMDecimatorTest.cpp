@@ -0,0 +1,200 @@
+// Feeds PDMDecimator with the PCM an nRF52 PDM peripheral makes of a microphone: a 2nd order sigma-delta
+// modulator produces a 1.032 MHz bitstream of a tone, and a 5th order CIC/64 model of the peripheral turns it
+// into 16 bit PCM at 16125 Hz, in 256 sample buffers. Checks the tone comes out at the right frequency and
+// level, with the expected noise floor for the output format, that tones above the output Nyquist frequency
+// are stopped rather than aliased, and that the DC offset of the microphone is removed.
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "PDMDecimator.h"
+#include "HostTest.h"
+
+#define PDM_CLOCK       1032000
+#define PCM_RATE        (PDM_CLOCK / 64)
+#define PCM_BUFFER      256
+
+class Source : public DataSource
+{
+    public:
+    DataSink *sink;
+    ManagedBuffer buffer;
+
+    Source() : sink(NULL) {}
+    virtual void connect(DataSink &s) { sink = &s; }
+    virtual int getFormat() { return DATASTREAM_FORMAT_16BIT_SIGNED; }
+    virtual ManagedBuffer pull() { return buffer; }
+};
+
+class Sink : public DataSink
+{
+    public:
+    DataSource &source;
+    std::vector<double> samples;
+
+    Sink(DataSource &s) : source(s) { s.connect(*this); }
+
+    virtual int pullRequest()
+    {
+        ManagedBuffer b = source.pull();
+        int bytes = DATASTREAM_FORMAT_BYTES_PER_SAMPLE(source.getFormat());
+
+        for (int i = 0; i < b.length() / bytes; i++)
+            samples.push_back(bytes == 1 ? (int8_t)b[i] : *(int16_t *)&b[i * 2]);
+
+        return DEVICE_OK;
+    }
+};
+
+// The tone found in a signal, by a least squares fit of mean + a sin + b cos; the residual is noise and distortion
+struct Tone
+{
+    double dc;
+    double amplitude;
+    double snr;
+};
+
+// A 2nd order sigma-delta modulator, as inside a PDM microphone, with a small DC offset
+static std::vector<int8_t> modulate(double frequency, double amplitude)
+{
+    std::vector<int8_t> bits(PDM_CLOCK);
+    double i1 = 0, i2 = 0, y = 0;
+
+    for (int k = 0; k < PDM_CLOCK; k++) {
+        double x = amplitude * sin(2 * M_PI * frequency * k / PDM_CLOCK) + 0.01;
+        i1 += x - y;
+        i2 += i1 - y;
+        y = i2 >= 0 ? 1 : -1;
+        bits[k] = (int8_t)y;
+    }
+
+    return bits;
+}
+
+// A 5th order CIC, ratio 64, scaled to 16 bit like the nRF52 PDM peripheral
+static std::vector<int16_t> cic(const std::vector<int8_t> &bits)
+{
+    int64_t integrator[5] = { 0 }, comb[5] = { 0 };
+    std::vector<int16_t> pcm;
+
+    for (size_t k = 0; k < bits.size(); k++) {
+        int64_t v = bits[k];
+
+        for (int s = 0; s < 5; s++) {
+            integrator[s] += v;
+            v = integrator[s];
+        }
+
+        if (k % 64 == 63) {
+            for (int s = 0; s < 5; s++) {
+                int64_t t = v;
+                v -= comb[s];
+                comb[s] = t;
+            }
+            pcm.push_back((int16_t)lrint((double)v / (1LL << 30) * 32767.0 * 0.5));
+        }
+    }
+
+    return pcm;
+}
+
+// Fit a tone on the last three quarters of a signal (the first quarter lets the DC blocker settle)
+static Tone fit(const std::vector<double> &y, double rate, double frequency)
+{
+    size_t start = y.size() / 4, n = y.size() - start;
+    double w = 2 * M_PI * frequency / rate;
+    double mean = 0, ss = 0, sc = 0, cc = 0, ys = 0, yc = 0, residual = 0;
+
+    for (size_t i = 0; i < n; i++)
+        mean += y[start + i];
+    mean /= n;
+
+    for (size_t i = 0; i < n; i++) {
+        double s = sin(w * i), c = cos(w * i), v = y[start + i] - mean;
+        ss += s * s;
+        sc += s * c;
+        cc += c * c;
+        ys += v * s;
+        yc += v * c;
+    }
+
+    double det = ss * cc - sc * sc;
+    double a = (ys * cc - yc * sc) / det;
+    double b = (yc * ss - ys * sc) / det;
+
+    for (size_t i = 0; i < n; i++) {
+        double v = y[start + i] - mean - a * sin(w * i) - b * cos(w * i);
+        residual += v * v;
+    }
+
+    Tone t;
+    t.dc = mean;
+    t.amplitude = sqrt(a * a + b * b);
+    t.snr = 10 * log10(t.amplitude * t.amplitude / 2 / (residual / n));
+    return t;
+}
+
+// Run a tone through the decimator, and fit it on the output (in fractions of full scale)
+static Tone decimate(double frequency, double amplitude, int rate, int format, float gain)
+{
+    std::vector<int16_t> pcm = cic(modulate(frequency, amplitude));
+    Source source;
+    PDMDecimator decimator(source, PCM_RATE, rate, format);
+    Sink sink(decimator.output);
+
+    decimator.setGain(gain);
+
+    for (size_t i = 0; i + PCM_BUFFER <= pcm.size(); i += PCM_BUFFER) {
+        source.buffer = ManagedBuffer((uint8_t *)&pcm[i], PCM_BUFFER * sizeof(int16_t));
+        source.sink->pullRequest();
+    }
+
+    // the rate the resampler actually runs at, from its Q16 step
+    double actual = PCM_RATE * 65536.0 / (uint32_t)(((uint64_t)PCM_RATE * 65536 + rate / 2) / rate);
+    double scale = format == DATASTREAM_FORMAT_8BIT_SIGNED ? 128.0 : 32768.0;
+    Tone t = fit(sink.samples, actual, frequency);
+
+    CHECK(fabs(sink.samples.size() - (double)rate) < rate / 50);
+
+    t.dc /= scale;
+    t.amplitude /= scale;
+
+    printf("%5.0f Hz at %.2f -> %5d Hz %s x%.0f: tone %.4f of full scale, SNR %4.1f dB, dc %+.5f\n", frequency,
+        amplitude, rate, format == DATASTREAM_FORMAT_8BIT_SIGNED ? "int8 " : "int16", gain, t.amplitude, t.snr, t.dc);
+
+    return t;
+}
+
+int main()
+{
+    // The peripheral output itself: a 0.5 tone comes out at 0.242 of full scale, with a DC offset of 0.005 (below
+    // one LSB of an 8 bit output, so that one is only checked to be under an LSB)
+    std::vector<int16_t> pcm = cic(modulate(1000, 0.5));
+    Tone raw = fit(std::vector<double>(pcm.begin(), pcm.end()), PCM_RATE, 1000);
+    raw.amplitude /= 32768.0;
+    raw.dc /= 32768.0;
+
+    Tone t = decimate(1000, 0.5, 16000, DATASTREAM_FORMAT_16BIT_SIGNED, 1.0f);
+    CHECK(fabs(t.amplitude - raw.amplitude) < 0.01 * raw.amplitude);
+    CHECK(t.snr > 68);
+    CHECK(fabs(t.dc) < raw.dc / 20);
+
+    t = decimate(1000, 0.5, 11000, DATASTREAM_FORMAT_8BIT_SIGNED, 1.0f);
+    CHECK(fabs(t.amplitude - raw.amplitude) < 0.01 * raw.amplitude);
+    CHECK(t.snr > 35);
+    CHECK(fabs(t.dc) < 1.0 / 128);
+
+    t = decimate(3000, 0.5, 11000, DATASTREAM_FORMAT_16BIT_SIGNED, 1.0f);
+    CHECK(t.amplitude > 0.7 * raw.amplitude);
+    CHECK(t.snr > 60);
+
+    // 7 kHz is above the 5.5 kHz Nyquist frequency of the output, and would alias to 4 kHz
+    t = decimate(7000, 0.5, 11000, DATASTREAM_FORMAT_16BIT_SIGNED, 1.0f);
+    CHECK(20 * log10(t.amplitude / raw.amplitude) < -45);
+
+    // A quiet tone, brought up by the gain
+    t = decimate(440, 0.02, 11000, DATASTREAM_FORMAT_8BIT_SIGNED, 8.0f);
+    CHECK(fabs(t.amplitude - 8 * 0.02 / 0.5 * raw.amplitude) < 0.05 * t.amplitude);
+    CHECK(t.snr > 24);
+
+    return host_test_summary("PDMDecimatorTest");
+}
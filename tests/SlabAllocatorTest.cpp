@@ -0,0 +1,221 @@
+// Stress test for CodalSlabAllocator: a million random allocations and releases of up to 700 bytes, checking that
+// blocks are aligned, never overlap and all return to their class. Also checks that a reference left over to a
+// released payload can't corrupt the free list, that releasing a block twice panics, and that an ADC ->
+// StreamNormalizer pipeline runs without touching the heap once it is going.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <vector>
+#include "CodalConfig.h"
+#include "CodalSlabAllocator.h"
+#include "ManagedBuffer.h"
+#include "StreamNormalizer.h"
+#include "HostTest.h"
+
+using namespace codal;
+
+#define OPERATIONS      1000000
+#define LIVE            40
+#define ADC_SAMPLES     256
+
+// Mimics NRF52ADC: two DMA buffers, a fresh one allocated at every completion, the full one handed downstream
+class Adc : public DataSource
+{
+    public:
+    DataSink *sink;
+    ManagedBuffer dma[2];
+    ManagedBuffer out;
+    int next;
+    uint32_t seed;
+
+    Adc() : sink(NULL), next(0), seed(1)
+    {
+        dma[0] = ManagedBuffer(ADC_SAMPLES * 2);
+        dma[1] = ManagedBuffer(ADC_SAMPLES * 2);
+    }
+
+    virtual void connect(DataSink &s) { sink = &s; }
+    virtual int getFormat() { return DATASTREAM_FORMAT_16BIT_UNSIGNED; }
+
+    virtual ManagedBuffer pull()
+    {
+        ManagedBuffer b = out;
+        out = ManagedBuffer();
+        return b;
+    }
+
+    void complete()
+    {
+        for (int i = 0; i < ADC_SAMPLES; i++) {
+            seed = seed * 1103515245 + 12345;
+            ((uint16_t *)&dma[next][0])[i] = (seed >> 8) & 1023;
+        }
+
+        out = dma[next];
+        dma[next] = ManagedBuffer(ADC_SAMPLES * 2);
+        next ^= 1;
+        sink->pullRequest();
+    }
+};
+
+// Holds on to the last two buffers, as a double buffered consumer does
+class Sink : public DataSink
+{
+    public:
+    DataSource &source;
+    ManagedBuffer held[2];
+    int n;
+
+    Sink(DataSource &s) : source(s), n(0) { s.connect(*this); }
+
+    virtual int pullRequest()
+    {
+        held[n++ & 1] = source.pull();
+        return DEVICE_OK;
+    }
+};
+
+static uint32_t heap_requests()
+{
+    uint32_t n = device_slab_oversized();
+
+    for (int c = 0; c < DEVICE_SLAB_CLASSES; c++) {
+        SlabStatistics s;
+        device_slab_statistics(c, &s);
+        n += s.fallbacks;
+    }
+
+    return n;
+}
+
+static void check_churn()
+{
+    std::vector<uint8_t *> live;
+    std::vector<size_t> sizes;
+    int misaligned = 0, overwritten = 0;
+
+    srand(1);
+
+    for (int k = 0; k < OPERATIONS; k++) {
+        if (live.size() < LIVE && (live.empty() || rand() % 2)) {
+            size_t size = 1 + rand() % 700;
+            uint8_t *p = (uint8_t *)device_slab_alloc(size);
+
+            misaligned += ((uintptr_t)p & 7) != 0;
+            memset(p, (int)size, size);
+            live.push_back(p);
+            sizes.push_back(size);
+        }
+        else {
+            int i = rand() % live.size();
+
+            for (size_t j = 0; j < sizes[i]; j++) {
+                if (live[i][j] != (uint8_t)sizes[i]) {
+                    overwritten++;
+                    break;
+                }
+            }
+
+            device_slab_free(live[i]);
+            live[i] = live.back();
+            sizes[i] = sizes.back();
+            live.pop_back();
+            sizes.pop_back();
+        }
+    }
+
+    for (size_t i = 0; i < live.size(); i++)
+        device_slab_free(live[i]);
+
+    CHECK_EQUAL(0, misaligned);
+    CHECK_EQUAL(0, overwritten);
+
+    for (int c = 0; c < DEVICE_SLAB_CLASSES; c++) {
+        SlabStatistics s;
+        CHECK_EQUAL(DEVICE_OK, device_slab_statistics(c, &s));
+        CHECK_EQUAL(0, s.used);
+        CHECK(s.allocations > 0);
+    }
+}
+
+// A reference to a payload that outlived it sees an object in flash, so it never touches the free list
+static void check_stale_reference()
+{
+    RefCounted *stale;
+    SlabStatistics before, after;
+
+    device_slab_statistics(0, &before);
+
+    {
+        ManagedBuffer b(8);
+        stale = (RefCounted *)((uint8_t *)b.getBytes() - sizeof(BufferData));
+    }
+
+    CHECK(stale->isReadOnly());
+    stale->incr();
+    stale->decr();
+    stale->decr();
+
+    // the class still hands out every block once, and takes them all back
+    std::vector<void *> blocks;
+    for (int i = 0; i < before.blocks; i++)
+        blocks.push_back(device_slab_alloc(8));
+    for (int i = 0; i < before.blocks; i++)
+        for (int j = 0; j < i; j++)
+            CHECK(blocks[i] != blocks[j]);
+    for (size_t i = 0; i < blocks.size(); i++)
+        device_slab_free(blocks[i]);
+
+    device_slab_statistics(0, &after);
+    CHECK_EQUAL(0, after.used);
+    CHECK_EQUAL(before.fallbacks, after.fallbacks);
+}
+
+// Releasing a block twice panics (in a child process, as target_panic() aborts)
+static void check_double_free()
+{
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        fclose(stdout);
+        void *p = device_slab_alloc(8);
+        device_slab_free(p);
+        device_slab_free(p);
+        _exit(0);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+}
+
+static void check_pipeline()
+{
+    Adc adc;
+    StreamNormalizer normalizer(adc, 1.0f, true, DATASTREAM_FORMAT_8BIT_SIGNED);
+    Sink sink(normalizer.output);
+
+    for (int i = 0; i < 10; i++)
+        adc.complete();
+
+    uint32_t before = heap_requests();
+
+    for (int i = 0; i < 100000; i++)
+        adc.complete();
+
+    printf("pipeline: %u heap allocations in 100000 DMA completions\n", heap_requests() - before);
+    CHECK_EQUAL(0u, heap_requests() - before);
+}
+
+int main()
+{
+    check_churn();
+    check_stale_reference();
+    check_double_free();
+    check_pipeline();
+
+    return host_test_summary("SlabAllocatorTest");
+}
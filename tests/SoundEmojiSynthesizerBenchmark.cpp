@@ -0,0 +1,253 @@
+// Renders all ten built in sound expressions with SoundEmojiSynthesizer, and with the renderer it replaced (a call
+// through the tonePrint and a float position for every sample, as pull() was before the wavetable), and reports the
+// time and cycles per sample of each. Also renders them with an exact (double) position, and compares the output
+// buffers of both renderers against it and against each other.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+#include "MicroBit.h"
+#include "SoundEmojiSynthesizer.h"
+#include "SoundExpressions.h"
+#include "HostTest.h"
+
+#define ROUNDS          20
+
+static const char *sounds[] = { "giggle", "happy", "hello", "mysterious", "sad", "slide", "soaring", "spring", "twinkle", "yawn" };
+
+#define SOUNDS          (int)(sizeof(sounds) / sizeof(sounds[0]))
+
+class Sink : public DataSink
+{
+    public:
+    virtual int pullRequest() { return DEVICE_OK; }
+};
+
+/**
+ * SoundEmojiSynthesizer::pull() as it was before the wavetable, with the position held in P.
+ */
+template <typename P> class PerSampleSynthesizer : public SoundEmojiSynthesizer
+{
+    P tonePosition;
+
+    public:
+    PerSampleSynthesizer() : SoundEmojiSynthesizer(DEVICE_ID_SOUND_EMOJI_SYNTHESIZER_0), tonePosition(0)
+    {
+    }
+
+    virtual ManagedBuffer pull() override
+    {
+        bool done = false;
+        uint16_t *sample = NULL;
+        uint16_t *bufferEnd;
+
+        while (!done)
+        {
+            if (samplesWritten == samplesToWrite || status & EMOJI_SYNTHESIZER_STATUS_STOPPING)
+            {
+                bool renderComplete = nextSoundEffect();
+
+                if (effect == NULL)
+                    tonePosition = 0;
+
+                if (samplesToWrite == 0 || status & EMOJI_SYNTHESIZER_STATUS_STOPPING)
+                {
+                    done = true;
+                    if (renderComplete || status & EMOJI_SYNTHESIZER_STATUS_STOPPING)
+                    {
+                        status &= ~EMOJI_SYNTHESIZER_STATUS_STOPPING;
+                        Event(id, DEVICE_SOUND_EMOJI_SYNTHESIZER_EVT_DONE);
+                        lock.notify();
+                    }
+                }
+            }
+
+            if (((samplesWritten < samplesToWrite) || !(status & EMOJI_SYNTHESIZER_STATUS_OUTPUT_SILENCE_AS_EMPTY)) && sample == NULL)
+            {
+                buffer = ManagedBuffer(bufferSize);
+                sample = (uint16_t *) &buffer[0];
+                bufferEnd = (uint16_t *) (&buffer[0] + buffer.length());
+            }
+
+            while(samplesWritten < samplesToWrite)
+            {
+                float skip = ((EMOJI_SYNTHESIZER_TONE_WIDTH_F * frequency) / sampleRate);
+                float gain = (sampleRange * volume) / 1024.0f;
+                float offset = 512.0f - (512.0f * gain);
+
+                int effectStepEnd[EMOJI_SYNTHESIZER_TONE_EFFECTS];
+
+                for (int i = 0; i < EMOJI_SYNTHESIZER_TONE_EFFECTS; i++)
+                {
+                    effectStepEnd[i] = (int) (samplesPerStep[i] * (effect->effects[i].step));
+                    if (effect->effects[i].step == effect->effects[i].steps - 1)
+                        effectStepEnd[i] = samplesToWrite;
+                }
+
+                int stepEndPosition = effectStepEnd[0];
+                for (int i = 1; i < EMOJI_SYNTHESIZER_TONE_EFFECTS; i++)
+                    stepEndPosition = min(stepEndPosition, effectStepEnd[i]);
+
+                while (samplesWritten < stepEndPosition)
+                {
+                    if (sample == bufferEnd)
+                    {
+                        downStream->pullRequest();
+                        return buffer;
+                    }
+
+                    float s = effect->tone.tonePrint(effect->tone.parameter, (int) tonePosition);
+
+                    *sample = ((uint16_t) ((s * gain) + offset)) | orMask;
+
+                    sample++;
+                    samplesWritten++;
+                    tonePosition += skip;
+
+                    while(tonePosition > EMOJI_SYNTHESIZER_TONE_WIDTH_F)
+                        tonePosition -= EMOJI_SYNTHESIZER_TONE_WIDTH_F;
+                }
+
+                for (int i = 0; i < EMOJI_SYNTHESIZER_TONE_EFFECTS; i++)
+                {
+                    if (samplesWritten == effectStepEnd[i])
+                    {
+                        if (effect->effects[i].step < effect->effects[i].steps)
+                        {
+                            if (effect->effects[i].effect)
+                                effect->effects[i].effect(this, &effect->effects[i]);
+
+                            effect->effects[i].step++;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (sample == NULL)
+        {
+            buffer = ManagedBuffer();
+        }
+        else
+        {
+            uint16_t silence = ((uint16_t) (sampleRange *0.5f)) | orMask;
+            while(sample < bufferEnd)
+            {
+                *sample = silence;
+                sample++;
+            }
+        }
+
+        downStream->pullRequest();
+        return buffer;
+    }
+};
+
+class WavetableSynthesizer : public SoundEmojiSynthesizer
+{
+    public:
+    WavetableSynthesizer() : SoundEmojiSynthesizer(DEVICE_ID_SOUND_EMOJI_SYNTHESIZER_0)
+    {
+    }
+};
+
+struct Timing
+{
+    double ns;
+    unsigned long long cycles;
+    long samples;
+};
+
+// Plays a sound expression on a new synthesizer, and pulls all of it, keeping the samples if asked to. The random
+// variations of the expression are the same every time.
+template <typename S> static void render(int sound, Timing &t, std::vector<uint16_t> *out)
+{
+    Sink sink;
+    S synth;
+    SoundExpressions fx(synth);
+
+    seed_random(sound + 1);
+    synth.connect(sink);
+    synth.allowEmptyBuffers(true);
+    fx.playAsync(ManagedString(sounds[sound]));
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned long long cycles = host_cycles();
+
+    for (ManagedBuffer b = synth.pull(); b.length() > 0; b = synth.pull()) {
+        t.samples += b.length() / sizeof(uint16_t);
+        if (out)
+            out->insert(out->end(), (uint16_t *)&b[0], (uint16_t *)(&b[0] + b.length()));
+    }
+
+    t.cycles += host_cycles() - cycles;
+    t.ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Difference
+{
+    long same, close, samples;
+    int worst;
+};
+
+static void compare(const std::vector<uint16_t> &a, const std::vector<uint16_t> &b, Difference &d)
+{
+    CHECK_EQUAL(a.size(), b.size());
+
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+        int diff = abs((int)a[i] - (int)b[i]);
+        d.same += diff == 0;
+        d.close += diff <= 1;
+        d.worst = max(d.worst, diff);
+    }
+    d.samples += a.size();
+}
+
+static void print(const char *name, const Difference &d)
+{
+    printf("%-30s %6.2f%% identical, %6.2f%% within 1 LSB, worst %d\n", name, d.same * 100.0 / d.samples,
+        d.close * 100.0 / d.samples, d.worst);
+}
+
+int main()
+{
+    Timing before = {}, after = {};
+    Difference beforeExact = {}, afterExact = {}, afterBefore = {};
+
+    // the same effects through each renderer, sample by sample
+    for (int s = 0; s < SOUNDS; s++) {
+        std::vector<uint16_t> perSample, wavetable, exact;
+        Timing unused = {};
+
+        render<PerSampleSynthesizer<float>>(s, unused, &perSample);
+        render<WavetableSynthesizer>(s, unused, &wavetable);
+        render<PerSampleSynthesizer<double>>(s, unused, &exact);
+
+        compare(perSample, exact, beforeExact);
+        compare(wavetable, exact, afterExact);
+        compare(wavetable, perSample, afterBefore);
+    }
+
+    // interleaved, so both see the same state of the host
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int s = 0; s < SOUNDS; s++) {
+            render<PerSampleSynthesizer<float>>(s, before, NULL);
+            render<WavetableSynthesizer>(s, after, NULL);
+        }
+    }
+
+    CHECK_EQUAL(before.samples, after.samples);
+    CHECK(after.ns < before.ns);
+    CHECK(afterExact.close * 1000 >= afterExact.samples * 999);
+
+    printf("%ld samples\n", after.samples);
+    printf("per sample tonePrint: %.2f ns, %.2f cycles per sample\n", before.ns / before.samples,
+        (double)before.cycles / before.samples);
+    printf("wavetable:            %.2f ns, %.2f cycles per sample\n", after.ns / after.samples,
+        (double)after.cycles / after.samples);
+    print("per sample tonePrint vs exact:", beforeExact);
+    print("wavetable vs exact:", afterExact);
+    print("wavetable vs per sample:", afterBefore);
+
+    return host_test_summary("SoundEmojiSynthesizerBenchmark");
+}
@@ -0,0 +1,137 @@
+// Renders sound effects with SoundEmojiSynthesizer by pulling on it, as the audio pipeline does, and checks that
+// its wavetables follow the tone of every effect: built in tones may be reused from the previous effect, but a
+// CustomTone array that is edited in place between two effects must be rendered again. Also checks that the tones
+// are rendered by play(), once for each distinct tone of a sequence, and never while pulling.
+#include <vector>
+#include "MicroBit.h"
+#include "Synthesizer.h"
+#include "SoundEmojiSynthesizer.h"
+#include "HostTest.h"
+
+class Sink : public DataSink
+{
+    public:
+    virtual int pullRequest() { return DEVICE_OK; }
+};
+
+static Sink sink;
+
+// The level the synthesizer pads its last buffer with, for the default sample range of 1023
+#define SILENCE     511
+
+// A single effect playing the given tone at a constant frequency and full volume
+static ManagedBuffer tone_effect(TonePrintFunction tonePrint, void *parameter)
+{
+    ManagedBuffer b(sizeof(SoundEffect));
+    SoundEffect *fx = (SoundEffect *)&b[0];
+
+    fx->frequency = 440;
+    fx->volume = 1.0f;
+    fx->duration = 20;
+    fx->tone.tonePrint = tonePrint;
+    fx->tone.parameter = parameter;
+
+    for (int i = 0; i < EMOJI_SYNTHESIZER_TONE_EFFECTS; i++) {
+        fx->effects[i].effect = NULL;
+        fx->effects[i].steps = 1;
+    }
+
+    return b;
+}
+
+static std::vector<uint16_t> render(SoundEmojiSynthesizer &synth, ManagedBuffer effect)
+{
+    std::vector<uint16_t> samples;
+
+    synth.play(effect);
+
+    for (ManagedBuffer b = synth.pull(); b.length() > 0; b = synth.pull())
+        samples.insert(samples.end(), (uint16_t *)&b[0], (uint16_t *)(&b[0] + b.length()));
+
+    // Drop the silence the last buffer was padded with
+    while (!samples.empty() && samples.back() == SILENCE)
+        samples.pop_back();
+
+    return samples;
+}
+
+// A flat tone at the level it is given, that counts how often it is called
+static int levelToneCalls;
+
+static uint16_t LevelTone(void *arg, int position)
+{
+    levelToneCalls++;
+    return (uint16_t)(uintptr_t)arg;
+}
+
+static void check_level(const std::vector<uint16_t> &samples, int level)
+{
+    CHECK(samples.size() > 0);
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (samples[i] < level - 1 || samples[i] > level + 1) {
+            CHECK_EQUAL(level, samples[i]);
+            break;
+        }
+    }
+}
+
+int main()
+{
+    SoundEmojiSynthesizer synth(DEVICE_ID_SOUND_EMOJI_SYNTHESIZER_0);
+    synth.connect(sink);
+    synth.allowEmptyBuffers(true);
+
+    // A custom tone, edited in place between two effects that point to the same array
+    static uint16_t custom[1024];
+
+    for (int i = 0; i < 1024; i++)
+        custom[i] = 800;
+
+    ManagedBuffer customEffect = tone_effect(Synthesizer::CustomTone, custom);
+    check_level(render(synth, customEffect), 800);
+
+    for (int i = 0; i < 1024; i++)
+        custom[i] = 200;
+
+    check_level(render(synth, customEffect), 200);
+
+    // Built in tones, switching back and forth: a reused wavetable renders exactly the same samples
+    std::vector<uint16_t> square = render(synth, tone_effect(Synthesizer::SquareWaveTone, NULL));
+    std::vector<uint16_t> saw = render(synth, tone_effect(Synthesizer::SawtoothTone, NULL));
+
+    CHECK(square != saw);
+    CHECK(square == render(synth, tone_effect(Synthesizer::SquareWaveTone, NULL)));
+    CHECK(square == render(synth, tone_effect(Synthesizer::SquareWaveTone, NULL)));
+
+    for (size_t i = 0; i < square.size(); i++) {
+        if (square[i] != 0 && square[i] != 1022) {
+            CHECK_EQUAL(1022, square[i]);
+            break;
+        }
+    }
+
+    // A sequence of three effects with two tones: each is rendered once, by play()
+    ManagedBuffer low = tone_effect(LevelTone, (void *)300), high = tone_effect(LevelTone, (void *)700);
+    ManagedBuffer sequence(3 * sizeof(SoundEffect));
+    sequence.writeBuffer(0, low);
+    sequence.writeBuffer(sizeof(SoundEffect), high);
+    sequence.writeBuffer(2 * sizeof(SoundEffect), low);
+
+    levelToneCalls = 0;
+    synth.play(sequence);
+    CHECK_EQUAL(2 * EMOJI_SYNTHESIZER_TONE_WIDTH, levelToneCalls);
+
+    std::vector<uint16_t> samples;
+    for (ManagedBuffer b = synth.pull(); b.length() > 0; b = synth.pull())
+        samples.insert(samples.end(), (uint16_t *)&b[0], (uint16_t *)(&b[0] + b.length()));
+
+    CHECK_EQUAL(2 * EMOJI_SYNTHESIZER_TONE_WIDTH, levelToneCalls);
+
+    size_t third = samples.size() / 3;
+    CHECK(samples.size() >= 3 * (size_t)(EMOJI_SYNTHESIZER_SAMPLE_RATE / 50));
+    check_level(std::vector<uint16_t>(samples.begin(), samples.begin() + third / 2), 300);
+    check_level(std::vector<uint16_t>(samples.begin() + third + third / 4, samples.begin() + 2 * third - third / 4), 700);
+
+    return host_test_summary("SoundEmojiSynthesizerTest");
+}
@@ -0,0 +1,106 @@
+// Compares ei::spectral::engine against feature::spectral_analysis on several block configurations (3 axes,
+// 3 peaks, 6 bands, with and without filters), on kiss FFT. Checks that both give the same features, and
+// reports the time per window of each.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "edge-impulse-sdk/dsp/spectral/spectral.hpp"
+#include "HostTest.h"
+
+#define AXES            3
+#define PEAKS           3
+#define ITERATIONS      2000
+
+using namespace ei;
+
+static const char *edges = "0.1, 0.5, 1.0, 2.0, 5.0, 10, 20";
+
+struct config {
+    size_t cols;
+    uint16_t fft_length;
+    spectral::filter_t filter;
+    float frequency;
+};
+
+static const config configs[] = {
+    { 125, 128, spectral::filter_none, 62.5f },
+    { 128, 128, spectral::filter_lowpass, 62.5f },
+    { 200, 128, spectral::filter_highpass, 100.0f },
+    { 100, 256, spectral::filter_lowpass, 50.0f },
+    { 300, 64, spectral::filter_none, 100.0f },
+    { 250, 100, spectral::filter_none, 100.0f },
+};
+
+// The edges, as the old path takes them
+static void parse_edges(matrix_t *m)
+{
+    size_t n = 0;
+    const char *p = edges;
+
+    while (p != NULL) {
+        m->buffer[n++] = strtof(p, NULL);
+        p = strchr(p, ',');
+        if (p != NULL)
+            p++;
+    }
+
+    m->rows = n;
+}
+
+static double elapsed_us(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        const config &cfg = configs[c];
+
+        matrix_t input(AXES, cfg.cols), a(AXES, cfg.cols), b(AXES, cfg.cols);
+        matrix_t edges_matrix(64, 1);
+
+        srand(1);
+        for (size_t i = 0; i < AXES * cfg.cols; i++)
+            input.buffer[i] = sinf(i * 0.3f) * 2 + (rand() % 1000) / 250.0f + 3;
+
+        parse_edges(&edges_matrix);
+
+        size_t features = spectral::feature::calculate_spectral_buffer_size(true, PEAKS, edges_matrix.rows);
+        matrix_t old_features(AXES, features), new_features(AXES, features);
+
+        spectral::engine engine;
+        CHECK_EQUAL(EIDSP_OK, engine.init(cfg.frequency, cfg.cols, cfg.filter, 3.0f, 6, cfg.fft_length, PEAKS, 0.1f, edges));
+
+        auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < ITERATIONS; k++) {
+            memcpy(a.buffer, input.buffer, AXES * cfg.cols * sizeof(float));
+            spectral::feature::spectral_analysis(&old_features, &a, cfg.frequency, cfg.filter, 3.0f, 6, cfg.fft_length,
+                PEAKS, 0.1f, &edges_matrix);
+        }
+        double old_us = elapsed_us(start) / ITERATIONS;
+
+        start = std::chrono::steady_clock::now();
+        for (int k = 0; k < ITERATIONS; k++) {
+            memcpy(b.buffer, input.buffer, AXES * cfg.cols * sizeof(float));
+            engine.extract(&new_features, &b);
+        }
+        double new_us = elapsed_us(start) / ITERATIONS;
+
+        float max_relative = 0;
+        for (size_t i = 0; i < AXES * features; i++) {
+            float d = fabsf(old_features.buffer[i] - new_features.buffer[i]) / (fabsf(old_features.buffer[i]) + 1e-3f);
+            if (d > max_relative)
+                max_relative = d;
+        }
+
+        CHECK(max_relative < 1e-5f);
+
+        printf("cols %3zu, fft %3u, filter %d: %5.1f us -> %5.1f us, max relative difference %.1e\n",
+            cfg.cols, cfg.fft_length, (int)cfg.filter, old_us, new_us, max_relative);
+    }
+
+    return host_test_summary("SpectralBenchmark");
+}
@@ -0,0 +1,215 @@
+// Drives a VoiceActivityGate into a ContinuousAudioStreamer with a synthetic recording (noise, then speech,
+// then a long silence, then speech again), and classifies queued slices at a realistic pace, as the inference
+// fiber of MicrophoneInferenceTest does. Checks that every pre-roll slice reaches the classifier, in order,
+// and that the slices are contiguous runs of the recording, with no stale audio at the start of a burst. Also
+// checks that a full ring drops new slices, rather than the one being classified.
+#include <math.h>
+#include <vector>
+#include "MicroBit.h"
+#include "VoiceActivityGate.h"
+#include "ContinuousAudioStreamer.h"
+#include "HostTest.h"
+
+#define SLICE_SIZE              256
+#define SLICES_PER_WINDOW       4
+#define PRE_ROLL                (SLICE_SIZE * (SLICES_PER_WINDOW - 1))
+#define HANGOVER                (SLICE_SIZE * SLICES_PER_WINDOW)
+#define BUFFER_SIZE             64          // As delivered by the microphone pipeline
+#define SLICE_BUFFERS           (SLICES_PER_WINDOW + 1)
+
+// Buffers that pass between two slices the classifier can take, i.e. it runs at twice real time
+#define BUFFERS_PER_CLASSIFICATION  (SLICE_SIZE / BUFFER_SIZE / 2)
+
+/**
+ * Replays a recording one buffer at a time, as the StreamNormalizer in front of the gate would.
+ */
+class Recording : public DataSource
+{
+    public:
+    DataSink *sink = NULL;
+    ManagedBuffer current;
+
+    virtual void connect(DataSink &s) { sink = &s; }
+    virtual ManagedBuffer pull() { return current; }
+    virtual int getFormat() { return DATASTREAM_FORMAT_8BIT_SIGNED; }
+
+    void push(const int8_t *data, int length)
+    {
+        current = ManagedBuffer((uint8_t *)data, length);
+        sink->pullRequest();
+    }
+};
+
+static std::vector<int8_t> audio;
+
+// Pseudo random bits for a position in the recording
+static uint32_t mix(uint32_t n)
+{
+    n ^= n >> 16;
+    n *= 0x85ebca6b;
+    n ^= n >> 13;
+    n *= 0xc2b2ae35;
+    return n ^ (n >> 16);
+}
+
+// Quiet broadband noise, that is unique for every position so slices can be located in the recording
+static void add_noise(int samples)
+{
+    for (int i = 0; i < samples; i++) {
+        uint32_t h = mix(audio.size());
+        audio.push_back((int8_t)((h & 1) ? 2 : -2) + (int8_t)((h >> 1) & 1));
+    }
+}
+
+// A loud, voiced-like tone, with a little noise so it doesn't repeat either
+static void add_speech(int samples)
+{
+    for (int i = 0; i < samples; i++) {
+        audio.push_back((int8_t)(60 * sin(2 * M_PI * 300 * audio.size() / 11000.0)) + (int8_t)(mix(audio.size()) & 1));
+    }
+}
+
+// Position of a slice in the recording, or -1
+static int locate(const int8_t *slice)
+{
+    for (size_t start = 0; start + SLICE_SIZE <= audio.size(); start++) {
+        if (memcmp(&audio[start], slice, SLICE_SIZE) == 0)
+            return (int)start;
+    }
+    return -1;
+}
+
+// Holds a slice for as long as the whole ring takes to fill, and twice more, as a slow classification would. The
+// slice being classified stays intact, the slices queued behind it are the ones right after it, and every slice
+// that didn't fit is counted as an overrun.
+static void check_overrun()
+{
+    static int8_t storage[SLICE_BUFFERS][SLICE_SIZE];
+    static int8_t *buffers[SLICE_BUFFERS];
+    for (int i = 0; i < SLICE_BUFFERS; i++)
+        buffers[i] = storage[i];
+
+    inference_t inference;
+    inference.buffers = buffers;
+    inference.n_buffers = SLICE_BUFFERS;
+    inference.buf_select = 0;
+    inference.buf_read = 0;
+    inference.buf_count = 0;
+    inference.n_samples = SLICE_SIZE;
+    inference.buf_ready = 0;
+    inference.overruns = 0;
+
+    Recording recording;
+    ContinuousAudioStreamer streamer(recording, &inference);
+
+    const int slices = 3 * SLICE_BUFFERS;
+    for (int offset = 0; offset < SLICE_SIZE; offset += BUFFER_SIZE)
+        recording.push(&audio[offset], BUFFER_SIZE);
+
+    int8_t *held = streamer.getSlice();
+    CHECK(held != NULL);
+
+    for (int offset = SLICE_SIZE; offset < slices * SLICE_SIZE; offset += BUFFER_SIZE)
+        recording.push(&audio[offset], BUFFER_SIZE);
+
+    CHECK_EQUAL(0, locate(held));
+    CHECK(held == streamer.getSlice());
+    CHECK_EQUAL(SLICE_BUFFERS - 1, streamer.getSlicesAvailable());
+    CHECK_EQUAL(slices - (SLICE_BUFFERS - 1), (int)inference.overruns);
+
+    for (int s = 0; s < SLICE_BUFFERS - 1; s++) {
+        CHECK_EQUAL(s * SLICE_SIZE, locate(streamer.getSlice()));
+        streamer.releaseSlice();
+    }
+
+    CHECK(streamer.getSlice() == NULL);
+
+    printf("%d slices held up, %d dropped\n", slices, (int)inference.overruns);
+}
+
+int main()
+{
+    // noise, speech starting mid-slice, a silence much longer than the pre-roll, and speech again
+    add_noise(41 * BUFFER_SIZE);
+    int onset1 = audio.size();
+    add_speech(30 * BUFFER_SIZE);
+    add_noise(70 * BUFFER_SIZE);
+    int onset2 = audio.size();
+    add_speech(30 * BUFFER_SIZE);
+    add_noise(40 * BUFFER_SIZE);
+
+    static int8_t storage[SLICE_BUFFERS][SLICE_SIZE];
+    static int8_t *buffers[SLICE_BUFFERS];
+    for (int i = 0; i < SLICE_BUFFERS; i++)
+        buffers[i] = storage[i];
+
+    inference_t inference;
+    inference.buffers = buffers;
+    inference.n_buffers = SLICE_BUFFERS;
+    inference.buf_select = 0;
+    inference.buf_read = 0;
+    inference.buf_count = 0;
+    inference.n_samples = SLICE_SIZE;
+    inference.buf_ready = 0;
+    inference.overruns = 0;
+
+    Recording recording;
+    VoiceActivityGate gate(recording, PRE_ROLL, HANGOVER);
+    gate.frameSize = SLICE_SIZE;
+    ContinuousAudioStreamer streamer(gate.output, &inference);
+
+    // the start of every slice that reached the classifier, in order
+    std::vector<int> classified;
+
+    for (size_t offset = 0; offset < audio.size(); offset += BUFFER_SIZE) {
+        recording.push(&audio[offset], BUFFER_SIZE);
+
+        // the inference fiber only gets to run between buffers, and takes a while per slice
+        if ((offset / BUFFER_SIZE) % BUFFERS_PER_CLASSIFICATION == 0) {
+            int8_t *slice = streamer.getSlice();
+
+            if (slice != NULL) {
+                classified.push_back(locate(slice));
+                streamer.releaseSlice();
+            }
+        }
+    }
+
+    while (streamer.getSlicesAvailable() > 0) {
+        classified.push_back(locate(streamer.getSlice()));
+        streamer.releaseSlice();
+    }
+
+    CHECK_EQUAL(0, inference.overruns);
+    CHECK(classified.size() > 2 * SLICES_PER_WINDOW);
+
+    // Two bursts, each a contiguous run of slices. Each starts with the full pre-roll ahead of the buffer that
+    // opened the gate (the onsets are on buffer boundaries), so the first window is made of real history.
+    int bursts = 0;
+    for (size_t i = 0; i < classified.size(); i++) {
+        CHECK(classified[i] >= 0);
+
+        if (i == 0 || classified[i] != classified[i - 1] + SLICE_SIZE) {
+            int onset = bursts == 0 ? onset1 : onset2;
+
+            CHECK_EQUAL(onset - PRE_ROLL, classified[i]);
+
+            // the whole pre-roll, and the slice the onset is in, were classified in order
+            for (int s = 1; s < SLICES_PER_WINDOW; s++) {
+                CHECK(i + s < classified.size());
+                CHECK_EQUAL(classified[i] + s * SLICE_SIZE, classified[i + s]);
+            }
+
+            bursts++;
+        }
+    }
+
+    CHECK_EQUAL(2, bursts);
+
+    printf("%d slices classified in %d bursts, %d skipped by the gate\n", (int)classified.size(), bursts,
+        gate.getSkippedPercentage());
+
+    check_overrun();
+
+    return host_test_summary("VoiceActivityGateTest");
+}
@@ -0,0 +1,14 @@
+// Stand-in for the anomaly block of an exported impulse (the model in this tree has none): 33 features,
+// as the spectral analysis block produces for 3 axes.
+#ifndef _EI_CLASSIFIER_ANOMALY_TYPES_H_
+#define _EI_CLASSIFIER_ANOMALY_TYPES_H_
+
+#include <stdint.h>
+
+typedef struct {
+    uint16_t index;
+    float centroid[33];
+    float max_error;
+} ei_classifier_anom_cluster_t;
+
+#endif // _EI_CLASSIFIER_ANOMALY_TYPES_H_
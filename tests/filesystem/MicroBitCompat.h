@@ -0,0 +1,17 @@
+// Host stand-in for the micro:bit compatibility layer, reduced to what the file system uses.
+#ifndef MICROBIT_COMPAT_H
+#define MICROBIT_COMPAT_H
+
+#include "CodalCompat.h"
+#include "ErrorNo.h"
+
+using namespace codal;
+
+#define MICROBIT_OK                     DEVICE_OK
+#define MICROBIT_INVALID_PARAMETER      DEVICE_INVALID_PARAMETER
+#define MICROBIT_NOT_SUPPORTED          DEVICE_NOT_SUPPORTED
+#define MICROBIT_NO_RESOURCES           DEVICE_NO_RESOURCES
+#define MICROBIT_NO_DATA                DEVICE_NO_DATA
+#define MICROBIT_CANCELLED              DEVICE_CANCELLED
+
+#endif
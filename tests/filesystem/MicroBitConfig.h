@@ -0,0 +1,25 @@
+// Host stand-in for the micro:bit configuration, force included ahead of the real one (which shares its guard).
+// The file system lives in a simulated flash, whose last page is the scratch page. See tests/MicroBitFileSystemTest.cpp.
+#ifndef MICROBIT_CONFIG_H
+#define MICROBIT_CONFIG_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HOST_FLASH_PAGES                64
+
+#define MICROBIT_CODEPAGESIZE           4096
+#define MBFS_BLOCK_SIZE                 256
+
+#ifndef MBFS_CACHE_SIZE
+#define MBFS_CACHE_SIZE                 0
+#endif
+
+extern uint8_t *host_flash;
+
+#define FLASH_PROGRAM_END               ((uint32_t)(uintptr_t)host_flash)
+#define MICROBIT_DEFAULT_SCRATCH_PAGE   ((uint32_t)(uintptr_t)host_flash + (HOST_FLASH_PAGES - 1) * MICROBIT_CODEPAGESIZE)
+#define MICROBIT_APP_REGION_END         ((uint32_t)(uintptr_t)host_flash + (HOST_FLASH_PAGES - 4) * MICROBIT_CODEPAGESIZE)
+
+#endif
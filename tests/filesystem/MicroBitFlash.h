@@ -0,0 +1,25 @@
+// Host stand-in for the NVMC driver, force included ahead of the real one. Like NOR flash, writes can only clear
+// bits until a page is erased.
+#ifndef MICROBIT_FLASH_H_
+#define MICROBIT_FLASH_H_
+
+#include "MicroBitConfig.h"
+
+class MicroBitFlash
+{
+    public:
+    int flash_write(void *address, void *buffer, int length, void *scratch_addr = NULL)
+    {
+        (void)scratch_addr;
+        for (int i = 0; i < length; i++)
+            ((uint8_t *)address)[i] &= ((uint8_t *)buffer)[i];
+        return 1;
+    }
+
+    void erase_page(uint32_t *page)
+    {
+        memset(page, 0xff, MICROBIT_CODEPAGESIZE);
+    }
+};
+
+#endif
@@ -0,0 +1,2 @@
+// Host stand-in: the file system doesn't use the key/value store.
+#include "MicroBitCompat.h"
@@ -0,0 +1,16 @@
+// Host stand-ins for the parts of CMSIS-DSP the Edge Impulse DSP code calls even when it runs on kiss FFT.
+// The fixed point FFT is only used by the MFCC/MFE blocks, which the host tests don't run.
+#include <stdio.h>
+#include <stdlib.h>
+#include "edge-impulse-sdk/CMSIS/DSP/Include/arm_math.h"
+
+arm_status arm_rfft_init_q15(arm_rfft_instance_q15 *, uint32_t, uint32_t, uint32_t)
+{
+    return ARM_MATH_ARGUMENT_ERROR;
+}
+
+void arm_rfft_q15(const arm_rfft_instance_q15 *, q15_t *, q15_t *)
+{
+    printf("arm_rfft_q15() called on the host\n");
+    abort();
+}
@@ -0,0 +1,146 @@
+// Host stand-ins for the context switching CodalFiber.cpp relies on (CortexContextSwitch.s and the TCB functions of
+// codal_target_hal_base.cpp on the device), so the scheduler itself can run in a test. Rather than paging stacks in
+// and out, every fiber runs on a host stack of its own, below 4 GB as EasyDMA requires (see i2c/TwimSimulator.h).
+// As on the device, a fiber whose link register is configured starts over at that function the next time it is
+// scheduled in, discarding what it was doing: the idle task is restarted this way every time it runs.
+// Fork on block (invoke()) is not supported.
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include "CodalConfig.h"
+#include "CodalFiber.h"
+#include "codal_target_hal.h"
+
+#define HOST_FIBER_STACK_SIZE   (256 * 1024)
+
+struct HostTcb
+{
+    ucontext_t context;
+    PROCESSOR_WORD_TYPE lr, sp, stackBase;
+    PROCESSOR_WORD_TYPE ep, cp, pm;
+    bool restart;                       // Start over at lr when next scheduled in
+    char *stack;                        // The host stack the fiber runs on, or NULL for the thread's own
+};
+
+static HostTcb *starting;
+
+static void start()
+{
+    HostTcb *t = starting;
+
+    ((void (*)(PROCESSOR_WORD_TYPE, PROCESSOR_WORD_TYPE, PROCESSOR_WORD_TYPE))t->lr)(t->ep, t->cp, t->pm);
+
+    printf("a fiber returned from its entry point\n");
+    abort();
+}
+
+PROCESSOR_WORD_TYPE fiber_initial_stack_base()
+{
+    pthread_attr_t attr;
+    void *stack;
+    size_t size;
+
+    pthread_getattr_np(pthread_self(), &attr);
+    pthread_attr_getstack(&attr, &stack, &size);
+    pthread_attr_destroy(&attr);
+
+    return (PROCESSOR_WORD_TYPE)stack + size;
+}
+
+void *tcb_allocate()
+{
+    return calloc(1, sizeof(HostTcb));
+}
+
+void tcb_configure_lr(void *tcb, PROCESSOR_WORD_TYPE function)
+{
+    ((HostTcb *)tcb)->lr = function;
+    ((HostTcb *)tcb)->restart = true;
+}
+
+void tcb_configure_sp(void *tcb, PROCESSOR_WORD_TYPE sp)
+{
+    ((HostTcb *)tcb)->sp = sp;
+}
+
+void tcb_configure_stack_base(void *tcb, PROCESSOR_WORD_TYPE stack_base)
+{
+    ((HostTcb *)tcb)->stackBase = stack_base;
+}
+
+PROCESSOR_WORD_TYPE tcb_get_stack_base(void *tcb)
+{
+    HostTcb *t = (HostTcb *)tcb;
+
+    return t->stack ? (PROCESSOR_WORD_TYPE)t->stack + HOST_FIBER_STACK_SIZE : t->stackBase;
+}
+
+PROCESSOR_WORD_TYPE get_current_sp()
+{
+    return (PROCESSOR_WORD_TYPE)__builtin_frame_address(0);
+}
+
+PROCESSOR_WORD_TYPE tcb_get_sp(void *tcb)
+{
+    return ((HostTcb *)tcb)->sp;
+}
+
+void tcb_configure_args(void *tcb, PROCESSOR_WORD_TYPE ep, PROCESSOR_WORD_TYPE cp, PROCESSOR_WORD_TYPE pm)
+{
+    HostTcb *t = (HostTcb *)tcb;
+
+    t->ep = ep;
+    t->cp = cp;
+    t->pm = pm;
+}
+
+extern "C" void swap_context(void *from_tcb, PROCESSOR_WORD_TYPE, void *to_tcb, PROCESSOR_WORD_TYPE)
+{
+    HostTcb *from = (HostTcb *)from_tcb, *to = (HostTcb *)to_tcb;
+
+    if (to->restart) {
+        if (to->stack == NULL) {
+            to->stack = (char *)mmap(NULL, HOST_FIBER_STACK_SIZE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+            if (to->stack == MAP_FAILED) {
+                printf("cannot allocate a fiber stack\n");
+                abort();
+            }
+        }
+
+        getcontext(&to->context);
+        to->context.uc_stack.ss_sp = to->stack;
+        to->context.uc_stack.ss_size = HOST_FIBER_STACK_SIZE;
+        to->context.uc_link = NULL;
+        makecontext(&to->context, start, 0);
+
+        to->restart = false;
+        starting = to;
+    }
+
+    // Without a TCB to save to, what the fiber being scheduled out was doing is discarded
+    if (from)
+        swapcontext(&from->context, &to->context);
+    else
+        setcontext(&to->context);
+}
+
+extern "C" void save_context(void *, PROCESSOR_WORD_TYPE)
+{
+    printf("fork on block is not supported on the host\n");
+    abort();
+}
+
+extern "C" void save_register_context(void *)
+{
+    printf("fork on block is not supported on the host\n");
+    abort();
+}
+
+extern "C" void restore_register_context(void *)
+{
+    printf("fork on block is not supported on the host\n");
+    abort();
+}
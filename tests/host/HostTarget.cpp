@@ -0,0 +1,107 @@
+// Host stand-ins for the target HAL and the scheduler. Interrupts don't exist on the host, so
+// masking them is a no-op; anything that would block a fiber is a test failure.
+#include <stdio.h>
+#include <stdlib.h>
+#include "CodalConfig.h"
+#include "codal_target_hal.h"
+#include "CodalFiber.h"
+#include "Timer.h"
+#include "MessageBus.h"
+
+using namespace codal;
+
+// Simulated time, advanced by the tests
+CODAL_TIMESTAMP host_time_us = 0;
+
+void target_enable_irq()
+{
+}
+
+void target_disable_irq()
+{
+}
+
+void target_wait(uint32_t milliseconds)
+{
+    host_time_us += (CODAL_TIMESTAMP)milliseconds * 1000;
+}
+
+void target_wait_us(uint32_t us)
+{
+    host_time_us += us;
+}
+
+void target_panic(int statusCode)
+{
+    printf("target_panic(%d)\n", statusCode);
+    abort();
+}
+
+CODAL_TIMESTAMP codal::system_timer_current_time()
+{
+    return host_time_us / 1000;
+}
+
+CODAL_TIMESTAMP codal::system_timer_current_time_us()
+{
+    return host_time_us;
+}
+
+void codal::schedule()
+{
+    printf("schedule() called on the host\n");
+    abort();
+}
+
+int codal::fiber_wake_on_event(uint16_t, uint16_t)
+{
+    return DEVICE_OK;
+}
+
+uint16_t codal::allocateNotifyEvent()
+{
+    static uint16_t notifyEvent = 1024;
+    return notifyEvent++;
+}
+
+int codal::system_timer_event_every_us(CODAL_TIMESTAMP, uint16_t, uint16_t)
+{
+    return DEVICE_OK;
+}
+
+Fiber *codal::create_fiber(void (*)(void *), void *, void (*)(void *))
+{
+    printf("create_fiber() called on the host\n");
+    abort();
+}
+
+void codal::release_fiber(void *)
+{
+    printf("release_fiber() called on the host\n");
+    abort();
+}
+
+// The scheduler never runs on the host, so locks don't block, as in codal's own monothreaded mode.
+FiberLock::FiberLock()
+{
+    queue = NULL;
+    owner = NULL;
+    locked = false;
+}
+
+void FiberLock::wait()
+{
+}
+
+void FiberLock::notify()
+{
+}
+
+void FiberLock::notifyAll()
+{
+}
+
+int FiberLock::getWaitCount()
+{
+    return 0;
+}
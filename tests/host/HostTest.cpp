@@ -0,0 +1,22 @@
+#include "HostTest.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+int host_test_failures = 0;
+
+int host_test_summary(const char *name)
+{
+    printf("%s: %s\n", name, host_test_failures ? "FAILED" : "OK");
+    return host_test_failures ? 1 : 0;
+}
+
+unsigned long long host_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
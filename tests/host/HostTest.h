@@ -0,0 +1,31 @@
+// Minimal checks for the host tests: every failed CHECK is reported, and the test exits non-zero.
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+extern int host_test_failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        host_test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQUAL(expected, actual) do { \
+    long long _e = (long long)(expected), _a = (long long)(actual); \
+    if (_e != _a) { \
+        printf("%s:%d: expected %s == %lld, got %lld\n", __FILE__, __LINE__, #actual, _e, _a); \
+        host_test_failures++; \
+    } \
+} while (0)
+
+// Prints the outcome, and returns the exit code of the test
+int host_test_summary(const char *name);
+
+// Reads the time stamp counter of the host processor, or returns 0 if it has none. On x86 this counts reference
+// cycles, at a constant rate whatever the clock of the core is.
+unsigned long long host_cycles();
+
+#endif
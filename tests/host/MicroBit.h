@@ -0,0 +1,17 @@
+// Host stand-in for MicroBit.h: the CODAL core types, without the board.
+#ifndef HOST_MICROBIT_H
+#define HOST_MICROBIT_H
+
+#include "CodalConfig.h"
+#include "CodalCompat.h"
+#include "CodalUtil.h"
+#include "ErrorNo.h"
+#include "ManagedBuffer.h"
+#include "DataStream.h"
+#include "Timer.h"
+
+using namespace codal;
+
+class MicroBit;
+
+#endif
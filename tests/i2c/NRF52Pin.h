@@ -0,0 +1,22 @@
+// Host stand-in for the nRF52 pin driver, force included ahead of the real one: just enough for NRF52I2C to drive
+// and release the bus.
+#ifndef CODAL_NRF52_PIN_H
+#define CODAL_NRF52_PIN_H
+
+#include "Pin.h"
+
+namespace codal
+{
+class NRF52Pin : public Pin
+{
+    public:
+    NRF52Pin(int id, PinNumber name) : Pin(id, name, PIN_CAPABILITY_DIGITAL) {}
+
+    int setDriveMode(int) { return DEVICE_OK; }
+    virtual int setDigitalValue(int) { return DEVICE_OK; }
+    virtual int getDigitalValue() { return 1; }
+    virtual int getDigitalValue(PullMode) { return 1; }
+};
+}
+
+#endif
@@ -0,0 +1,519 @@
+// The simulated TWIM peripheral and LSM303, and the HAL and scheduler stand-ins they run under (see TwimSimulator.h).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "TwimSimulator.h"
+#include "NRF52I2C.h"
+#include "LSM303Accelerometer.h"
+#include "peripheral_alloc.h"
+#include "codal_target_hal.h"
+#include "CodalFiber.h"
+#include "Timer.h"
+
+// The bus runs at 400 kHz: a byte and its acknowledge take 9 clocks, or 22.5 us
+#define BYTE_TIME_X2            45
+#define STACK_SIZE              (1 << 20)
+#define MAX_WAIT_US             1000000
+
+uint64_t twim_time_us = 0;
+uint64_t twim_busy_wait_us = 0;
+uint64_t twim_descheduled_us = 0;
+int twim_transfers = 0;
+int twim_nack = 0;
+bool twim_scheduler_running = true;
+SimulatedEventBus twim_events;
+
+uint8_t lsm303_registers[0x40];
+int lsm303_samples = 0;
+Lsm303SampleSource lsm303_source = lsm303_sample;
+int lsm303_sample_limit = 0;
+bool lsm303_shared_irq = false;
+int lsm303_fifo_lost = 0;
+int lsm303_fifo_src_reads = 0;
+
+enum TwimState { TWIM_IDLE, TWIM_TX, TWIM_RX, TWIM_SUSPENDED };
+
+static TwimState state = TWIM_IDLE;
+static int remaining = 0;
+static int interrupts = 0;
+static PUserCallback irqHandler = NULL;
+static void *irqData = NULL;
+
+static uint8_t pointer = 0;
+static bool dataReady = false;
+static uint64_t nextSample = 0;
+static int fifo[LSM303_A_FIFO_SIZE];        // The samples held by the FIFO, oldest first
+static int fifoLevel = 0;
+static bool overrun = false;
+
+static uint16_t awaitedId = 0, awaitedValue = 0;
+static bool awaiting = false;
+
+int16_t lsm303_sample(int k, int axis)
+{
+    return (int16_t)(((k * 37 + axis * 101) % 1000 - 500) * 32);
+}
+
+// The output data rate selected in CTRL_REG1_A, as a sample period
+static int samplePeriod()
+{
+    static const int rates[] = { 0, 1, 10, 25, 50, 100, 200, 400 };
+    int odr = lsm303_registers[LSM303_CTRL_REG1_A] >> 4;
+
+    return odr > 0 && odr < 8 ? 1000000 / rates[odr] : 0;
+}
+
+// The FIFO is enabled in CTRL_REG5_A, and collects samples in stream mode
+static bool fifoEnabled()
+{
+    return (lsm303_registers[LSM303_CTRL_REG5_A] & 0x40) && (lsm303_registers[LSM303_FIFO_CTRL_REG_A] & 0xc0) == 0x80;
+}
+
+static bool watermark()
+{
+    return fifoLevel > (lsm303_registers[LSM303_FIFO_CTRL_REG_A] & 0x1f);
+}
+
+static void loadOutput(int k)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        int16_t v = lsm303_source(k, axis);
+        lsm303_registers[LSM303_OUT_X_L_A + axis * 2] = v & 0xff;
+        lsm303_registers[LSM303_OUT_X_L_A + axis * 2 + 1] = (v >> 8) & 0xff;
+    }
+}
+
+static void sensorTick()
+{
+    static int lastPeriod = 0;
+    int period = samplePeriod();
+
+    // The first sample is ready one period after the sensor is enabled
+    if (period != 0 && lastPeriod == 0)
+        nextSample = twim_time_us + period;
+    lastPeriod = period;
+
+    if (period == 0 || twim_time_us < nextSample || (lsm303_sample_limit && lsm303_samples >= lsm303_sample_limit))
+        return;
+
+    nextSample = twim_time_us + period;
+    lsm303_samples++;
+
+    // Once full, the FIFO drops its oldest sample for the new one
+    if (fifoEnabled()) {
+        if (fifoLevel == LSM303_A_FIFO_SIZE) {
+            memmove(fifo, fifo + 1, (LSM303_A_FIFO_SIZE - 1) * sizeof(int));
+            fifoLevel--;
+            overrun = true;
+            lsm303_fifo_lost++;
+        }
+
+        fifo[fifoLevel++] = lsm303_samples;
+        if (fifoLevel == 1)
+            loadOutput(fifo[0]);
+
+        return;
+    }
+
+    loadOutput(lsm303_samples);
+    lsm303_registers[LSM303_STATUS_REG_A] |= LSM303_A_STATUS_DATA_READY;
+    dataReady = true;
+}
+
+// Register accesses auto-increment when bit 7 of the register address is set, rolling over from OUT_Z_H_A back to
+// OUT_X_L_A while the FIFO is enabled. Reading OUT_Z_H_A clears data ready, or moves on to the next sample in the FIFO.
+static uint8_t sensorRead()
+{
+    int r = pointer & 0x3f;
+    uint8_t v = lsm303_registers[r];
+
+    if (r == LSM303_FIFO_SRC_REG_A) {
+        lsm303_fifo_src_reads++;
+        v = (watermark() ? LSM303_A_FIFO_WTM : 0) | (overrun && fifoLevel == LSM303_A_FIFO_SIZE ? LSM303_A_FIFO_OVRN : 0) |
+            (fifoLevel & LSM303_A_FIFO_FSS) | (fifoLevel == 0 ? 0x20 : 0);
+    }
+
+    if (r == LSM303_OUT_Z_H_A && fifoEnabled()) {
+        if (fifoLevel > 0) {
+            memmove(fifo, fifo + 1, (fifoLevel - 1) * sizeof(int));
+            fifoLevel--;
+            overrun = false;
+            if (fifoLevel > 0)
+                loadOutput(fifo[0]);
+        }
+    }
+    else if (r == LSM303_OUT_Z_H_A) {
+        dataReady = false;
+        lsm303_registers[LSM303_STATUS_REG_A] &= ~LSM303_A_STATUS_DATA_READY;
+    }
+
+    if (pointer & 0x80) {
+        int next = r == LSM303_OUT_Z_H_A && (lsm303_registers[LSM303_CTRL_REG5_A] & 0x40) ? LSM303_OUT_X_L_A : r + 1;
+        pointer = 0x80 | (next & 0x3f);
+    }
+
+    return v;
+}
+
+static void sensorWrite(const uint8_t *data, int length)
+{
+    if (length == 0)
+        return;
+
+    pointer = data[0];
+
+    for (int i = 1; i < length; i++) {
+        lsm303_registers[pointer & 0x3f] = data[i];
+
+        // Bypass mode empties the FIFO
+        if ((pointer & 0x3f) == LSM303_FIFO_CTRL_REG_A && (data[i] & 0xc0) == 0) {
+            fifoLevel = 0;
+            overrun = false;
+        }
+
+        if (pointer & 0x80)
+            pointer = 0x80 | ((pointer + 1) & 0x3f);
+    }
+}
+
+static void startTx()
+{
+    NRF_TWIM_Type *t = NRF_TWIM0;
+
+    t->EVENTS_TXSTARTED = 1;
+    twim_transfers++;
+
+    if (twim_nack > 0) {
+        twim_nack--;
+        state = TWIM_IDLE;
+        t->ERRORSRC = TWIM_ERRORSRC_ANACK_Msk;
+        t->EVENTS_ERROR = 1;
+        return;
+    }
+
+    state = TWIM_TX;
+    remaining = (1 + t->TXD.MAXCNT) * BYTE_TIME_X2 / 2;
+}
+
+static void startRx()
+{
+    NRF_TWIM_Type *t = NRF_TWIM0;
+
+    t->EVENTS_RXSTARTED = 1;
+    state = TWIM_RX;
+    remaining = (1 + t->RXD.MAXCNT) * BYTE_TIME_X2 / 2;
+}
+
+static void stop()
+{
+    state = TWIM_IDLE;
+    NRF_TWIM0->EVENTS_STOPPED = 1;
+}
+
+static void twimTick()
+{
+    NRF_TWIM_Type *t = NRF_TWIM0;
+
+    t->INTEN = (t->INTEN & ~t->INTENCLR) | t->INTENSET;
+    t->INTENCLR = 0;
+    t->INTENSET = 0;
+
+    if (t->TASKS_STOP) {
+        t->TASKS_STOP = 0;
+        stop();
+    }
+    if (t->TASKS_RESUME) {
+        t->TASKS_RESUME = 0;
+        if (state == TWIM_SUSPENDED)
+            state = TWIM_IDLE;
+    }
+    if (t->TASKS_SUSPEND) {
+        t->TASKS_SUSPEND = 0;
+        if (state == TWIM_IDLE)
+            t->EVENTS_SUSPENDED = 1;
+    }
+    if (t->TASKS_STARTTX) {
+        t->TASKS_STARTTX = 0;
+        startTx();
+    }
+    if (t->TASKS_STARTRX) {
+        t->TASKS_STARTRX = 0;
+        startRx();
+    }
+
+    if ((state == TWIM_TX || state == TWIM_RX) && --remaining <= 0) {
+        if (state == TWIM_TX) {
+            sensorWrite((uint8_t *)(uintptr_t)t->TXD.PTR, t->TXD.MAXCNT);
+            t->EVENTS_LASTTX = 1;
+            state = TWIM_IDLE;
+
+            if (t->SHORTS & NRF_TWIM_SHORT_LASTTX_STARTRX_MASK)
+                startRx();
+            else if (t->SHORTS & NRF_TWIM_SHORT_LASTTX_STOP_MASK)
+                stop();
+            else if (t->SHORTS & NRF_TWIM_SHORT_LASTTX_SUSPEND_MASK) {
+                state = TWIM_SUSPENDED;
+                t->EVENTS_SUSPENDED = 1;
+            }
+        }
+        else {
+            uint8_t *p = (uint8_t *)(uintptr_t)t->RXD.PTR;
+            for (uint32_t i = 0; i < t->RXD.MAXCNT; i++)
+                p[i] = sensorRead();
+            t->EVENTS_LASTRX = 1;
+            state = TWIM_IDLE;
+
+            if (t->SHORTS & NRF_TWIM_SHORT_LASTRX_STOP_MASK)
+                stop();
+        }
+    }
+
+    // The interrupt handler runs in interrupt context, and can't preempt itself: while it runs, the interrupt
+    // stays pending
+    if ((((t->INTEN & NRF_TWIM_INT_STOPPED_MASK) && t->EVENTS_STOPPED) ||
+        ((t->INTEN & NRF_TWIM_INT_ERROR_MASK) && t->EVENTS_ERROR)) && !(SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk)) {
+        interrupts++;
+        SCB->ICSR |= SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn + 16;
+        irqHandler(irqData);
+        SCB->ICSR &= ~SCB_ICSR_VECTACTIVE_Msk;
+    }
+}
+
+static void tick()
+{
+    twim_time_us++;
+    sensorTick();
+    twimTick();
+}
+
+void twim_run_us(int us)
+{
+    for (int i = 0; i < us; i++)
+        tick();
+}
+
+int SimulatedEventBus::send(Event evt)
+{
+    if (evt.source == DEVICE_ID_ACCELEROMETER && evt.value == ACCELEROMETER_EVT_DATA_UPDATE)
+        accelerometerUpdates++;
+
+    if (evt.source == DEVICE_ID_I2C)
+        i2cCompletions++;
+
+    if (awaiting && evt.source == awaitedId && evt.value == awaitedValue)
+        awaiting = false;
+
+    return DEVICE_OK;
+}
+
+void lsm303_reset()
+{
+    memset(lsm303_registers, 0, sizeof(lsm303_registers));
+    lsm303_registers[LSM303_WHO_AM_I_A] = LSM303_A_WHOAMI_VAL;
+    lsm303_samples = 0;
+    lsm303_fifo_lost = 0;
+    lsm303_fifo_src_reads = 0;
+    lsm303_shared_irq = false;
+
+    pointer = 0;
+    dataReady = false;
+    nextSample = 0;
+    fifoLevel = 0;
+    overrun = false;
+}
+
+// INT1 signals data ready, or the FIFO watermark, as selected in CTRL_REG3_A. Time passes while it is polled.
+int SimulatedInterruptPin::getDigitalValue()
+{
+    tick();
+
+    uint8_t sources = lsm303_registers[LSM303_CTRL_REG3_A];
+    bool active = ((sources & 0x10) && dataReady) || ((sources & 0x04) && fifoEnabled() && watermark()) || lsm303_shared_irq;
+
+    return active ? 0 : 1;
+}
+
+struct TestThread
+{
+    int (*test)();
+    int result;
+};
+
+static void *run(void *p)
+{
+    TestThread *t = (TestThread *)p;
+
+    EventModel::defaultEventBus = &twim_events;
+    t->result = t->test();
+
+    return NULL;
+}
+
+int twim_main(int (*test)())
+{
+    if (mmap((void *)NRF_TWIM0_BASE, 0x1000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED ||
+        mmap((void *)SCS_BASE, 0x1000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        printf("cannot map the peripheral registers\n");
+        return 1;
+    }
+
+    // Keep the heap of every thread in the main arena, below the program
+    mallopt(M_ARENA_MAX, 1);
+
+    void *stack = mmap(NULL, STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    TestThread t = { test, 1 };
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, STACK_SIZE);
+    pthread_create(&thread, &attr, run, &t);
+    pthread_join(thread, NULL);
+
+    return t.result;
+}
+
+// The target HAL: interrupts are simulated synchronously, so masking them is a no-op
+void target_enable_irq()
+{
+}
+
+void target_disable_irq()
+{
+}
+
+void target_wait_us(uint32_t us)
+{
+    twim_busy_wait_us += us;
+    twim_run_us(us);
+}
+
+void target_wait(uint32_t milliseconds)
+{
+    target_wait_us(milliseconds * 1000);
+}
+
+void target_wait_for_event()
+{
+    int before = interrupts;
+
+    for (int i = 0; i < MAX_WAIT_US && interrupts == before; i++) {
+        twim_busy_wait_us++;
+        tick();
+    }
+}
+
+void target_panic(int statusCode)
+{
+    printf("target_panic(%d)\n", statusCode);
+    abort();
+}
+
+CODAL_TIMESTAMP codal::system_timer_current_time()
+{
+    return twim_time_us / 1000;
+}
+
+CODAL_TIMESTAMP codal::system_timer_current_time_us()
+{
+    return twim_time_us;
+}
+
+// The timer the scheduler wakes sleeping fibers with: no test sleeps
+int codal::system_timer_event_after_us(CODAL_TIMESTAMP, uint16_t, uint16_t)
+{
+    return DEVICE_NOT_SUPPORTED;
+}
+
+int codal::system_timer_cancel_event(uint16_t, uint16_t)
+{
+    return DEVICE_NOT_SUPPORTED;
+}
+
+int codal::system_timer_event_every_us(CODAL_TIMESTAMP, uint16_t, uint16_t)
+{
+    return DEVICE_OK;
+}
+
+#if !TWIM_CODAL_SCHEDULER
+
+// The scheduler: a fiber waiting for an event sleeps until it is raised, while time passes
+int codal::fiber_scheduler_running()
+{
+    return twim_scheduler_running;
+}
+
+int codal::fiber_can_block()
+{
+    return twim_scheduler_running;
+}
+
+int codal::fiber_wake_on_event(uint16_t id, uint16_t value)
+{
+    if (!twim_scheduler_running)
+        return DEVICE_NOT_SUPPORTED;
+
+    awaitedId = id;
+    awaitedValue = value;
+    awaiting = true;
+
+    return DEVICE_OK;
+}
+
+void codal::schedule()
+{
+    for (int i = 0; awaiting; i++) {
+        if (i == MAX_WAIT_US) {
+            printf("schedule(): event %d,%d never raised\n", awaitedId, awaitedValue);
+            abort();
+        }
+
+        twim_descheduled_us++;
+        tick();
+    }
+}
+
+uint16_t codal::allocateNotifyEvent()
+{
+    static uint16_t notifyEvent = 1024;
+    return notifyEvent++;
+}
+
+Fiber *codal::create_fiber(void (*)(void *), void *, void (*)(void *))
+{
+    printf("create_fiber() called on the host\n");
+    abort();
+}
+
+void codal::release_fiber(void *)
+{
+    printf("release_fiber() called on the host\n");
+    abort();
+}
+
+#endif // TWIM_CODAL_SCHEDULER
+
+// The peripheral allocator: there is one TWIM, and its interrupt handler is called by the simulation
+void *codal::allocate_peripheral(PeripheralMode)
+{
+    return NRF_TWIM0;
+}
+
+void *codal::allocate_peripheral(void *device)
+{
+    return device;
+}
+
+IRQn_Type codal::get_alloc_peri_irqn(void *)
+{
+    return SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn;
+}
+
+void codal::set_alloc_peri_irq(void *, PUserCallback fn, void *userdata)
+{
+    irqHandler = fn;
+    irqData = userdata;
+}
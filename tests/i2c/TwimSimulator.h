@@ -0,0 +1,70 @@
+// Host stand-ins for the nRF52 TWIM peripheral with an LSM303 accelerometer (and its FIFO) on its bus, and for the
+// target HAL and scheduler the drivers run under. Time is simulated, one microsecond at a time: the peripheral and the
+// sensor move on while the CPU busy waits (target_wait_us()), while a fiber is descheduled waiting for an event
+// (schedule()), and when a test lets time pass (twim_run_us()). Built with TWIM_CODAL_SCHEDULER=1, the scheduler
+// stand-ins are left out, for tests that run CodalFiber.cpp itself (see host/HostFiber.cpp).
+//
+// The peripheral registers live at the addresses the MDK gives them, and EasyDMA pointers are 32 bits wide, so the
+// tests run through twim_main(): on a stack below 4 GB, with the heap there too (link with -no-pie).
+#ifndef TWIM_SIMULATOR_H
+#define TWIM_SIMULATOR_H
+
+#include "CodalConfig.h"
+#include "EventModel.h"
+#include "Pin.h"
+
+using namespace codal;
+
+#define LSM303_SIM_ADDRESS      0x32
+
+// Counts the events raised, and wakes the fiber waiting for one
+class SimulatedEventBus : public EventModel
+{
+    public:
+    int accelerometerUpdates;
+    int i2cCompletions;
+
+    SimulatedEventBus() : accelerometerUpdates(0), i2cCompletions(0) {}
+    virtual int send(Event evt);
+};
+
+// The INT1 line of the LSM303, active low as on the micro:bit, and shared with another sensor
+class SimulatedInterruptPin : public Pin
+{
+    public:
+    SimulatedInterruptPin() : Pin(1, (PinNumber)1, PIN_CAPABILITY_DIGITAL) { setActiveLo(); }
+    virtual int getDigitalValue();
+};
+
+extern uint64_t twim_time_us;           // Simulated time
+extern uint64_t twim_busy_wait_us;      // Time spent in target_wait_us()
+extern uint64_t twim_descheduled_us;    // Time spent in schedule(), waiting for an event
+extern int twim_transfers;              // Transfers started by the peripheral
+extern int twim_nack;                   // Number of transfers still to be NACKed by the device
+extern bool twim_scheduler_running;     // Whether blocking calls may deschedule the calling fiber
+extern SimulatedEventBus twim_events;
+
+// The value the simulated LSM303 reports on the given axis for its k-th sample (from 1), left justified as by the sensor
+typedef int16_t (*Lsm303SampleSource)(int k, int axis);
+
+extern uint8_t lsm303_registers[0x40];
+extern int lsm303_samples;              // Samples produced since the sensor was enabled
+extern Lsm303SampleSource lsm303_source;    // The samples produced, lsm303_sample() by default
+extern int lsm303_sample_limit;         // Number of samples after which the sensor stops, or 0
+extern bool lsm303_shared_irq;          // Whether another sensor holds INT1 active
+extern int lsm303_fifo_lost;            // Samples dropped by the FIFO, as it was full
+extern int lsm303_fifo_src_reads;       // Reads of FIFO_SRC_REG_A
+
+// A test pattern, the default sample source
+int16_t lsm303_sample(int k, int axis);
+
+// Powers the sensor down, and empties its FIFO
+void lsm303_reset();
+
+// Lets simulated time pass
+void twim_run_us(int us);
+
+// Runs a test, as the simulation requires it (see above); returns its exit code
+int twim_main(int (*test)());
+
+#endif
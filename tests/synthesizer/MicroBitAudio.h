@@ -0,0 +1,14 @@
+// Host stand-in for the audio pipeline: the synthesizer only asks for it to be switched on.
+#ifndef MICROBIT_AUDIO_H
+#define MICROBIT_AUDIO_H
+
+namespace codal
+{
+    class MicroBitAudio
+    {
+        public:
+        static void requestActivation() {}
+    };
+}
+
+#endif
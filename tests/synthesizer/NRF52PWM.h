@@ -0,0 +1,10 @@
+// Host stand-in: sound expressions are rendered by pulling on the synthesizer directly, without a PWM output.
+// The real header brings the codal namespace into scope, which SoundExpressions.cpp relies on.
+#ifndef NRF52PWM_H
+#define NRF52PWM_H
+
+#include "CodalConfig.h"
+
+using namespace codal;
+
+#endif
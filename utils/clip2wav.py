@@ -0,0 +1,105 @@
+#!/usr/bin/env python
+
+"""Converts audio clips stored by ClipRecorder into WAV files.
+   The input is either a serial log holding "clip:<index>:<hex>" lines, as printed by
+   ClipRecorder::dump(), or the raw content of a single clip file.
+   USAGE: clip2wav.py [-o output_prefix] input_file
+"""
+
+import sys
+import struct
+import wave
+import argparse
+
+CLIP_MAGIC = 0x50494C43 # "CLIP"
+CLIP_VERSION = 1
+CLIP_HEADER = "<IBBHII8s"
+CLIP_HEADER_SIZE = struct.calcsize(CLIP_HEADER)
+
+
+def read_clips(data):
+    """Returns a list of (index, bytes) for every clip in the input."""
+    if len(data) >= 4 and struct.unpack("<I", data[:4])[0] == CLIP_MAGIC:
+        return [(0, data)]
+
+    clips = {}
+    for line in data.decode("ascii", "replace").splitlines():
+        line = line.strip()
+        # Lines may be interleaved with other output, so only look at our own.
+        start = line.find("clip:")
+        if start < 0:
+            continue
+
+        fields = line[start:].split(":")
+        if len(fields) != 3:
+            continue
+
+        try:
+            index = int(fields[1])
+            chunk = bytes.fromhex(fields[2])
+        except ValueError:
+            continue
+
+        clips.setdefault(index, bytearray()).extend(chunk)
+
+    return sorted((index, bytes(clip)) for index, clip in clips.items())
+
+
+def convert(clip, filename, labels=None):
+    if len(clip) < CLIP_HEADER_SIZE:
+        raise ValueError("clip is too short to hold a header")
+
+    magic, version, score_count, sample_rate, timestamp, sample_count, scores = struct.unpack(CLIP_HEADER, clip[:CLIP_HEADER_SIZE])
+
+    if magic != CLIP_MAGIC or version != CLIP_VERSION:
+        raise ValueError("not a version %d clip" % CLIP_VERSION)
+
+    samples = clip[CLIP_HEADER_SIZE:CLIP_HEADER_SIZE + sample_count]
+    if len(samples) < sample_count:
+        print("%s: clip truncated, %d of %d samples present" % (filename, len(samples), sample_count))
+
+    # Clips hold signed 8 bit samples; 8 bit WAV files are unsigned.
+    pcm = bytes((s + 128) & 0xff for s in samples)
+
+    out = wave.open(filename, "wb")
+    out.setnchannels(1)
+    out.setsampwidth(1)
+    out.setframerate(sample_rate)
+    out.writeframes(pcm)
+    out.close()
+
+    names = labels or ["score%d" % i for i in range(score_count)]
+    summary = ", ".join("%s %.2f" % (names[i] if i < len(names) else "score%d" % i, scores[i] / 255.0) for i in range(score_count))
+    print("%s: %d samples at %d Hz, frozen at %d ms (%s)" % (filename, len(samples), sample_rate, timestamp, summary))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert ClipRecorder dumps to WAV files.")
+    parser.add_argument("input", help="serial log, or raw clip file")
+    parser.add_argument("-o", "--output", default="clip", help="prefix of the WAV files to write (default: clip)")
+    parser.add_argument("-l", "--labels", help="comma separated classifier labels, in model order")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    clips = read_clips(data)
+    if not clips:
+        print("No clips found in %s" % args.input)
+        return 1
+
+    labels = args.labels.split(",") if args.labels else None
+    errors = 0
+
+    for index, clip in clips:
+        try:
+            convert(clip, "%s%d.wav" % (args.output, index), labels)
+        except ValueError as e:
+            print("clip %d: %s" % (index, e))
+            errors += 1
+
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
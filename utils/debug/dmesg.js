@@ -9,6 +9,36 @@ function fatal(msg) {
     process.exit(1)
 }
 
+// struct CodalLogStore: head, committed, tail, overwritten and dropped, followed by the ring itself.
+const headerSize = 5 * 4
+
+// Puts the ring back in order, oldest byte first.
+function reassemble(buf) {
+    let committed = buf.readUInt32LE(4)
+    let overwritten = buf.readUInt32LE(12)
+    let dropped = buf.readUInt32LE(16)
+    let ring = buf.slice(headerSize)
+    let size = ring.length
+
+    if (committed == 0 || size <= 0)
+        return null
+
+    let text
+    if (committed <= size) {
+        text = ring.slice(0, committed).toString("binary")
+    } else {
+        // The log has wrapped: the oldest byte follows the newest, and the oldest line is likely cut short.
+        let start = committed % size
+        text = Buffer.concat([ring.slice(start), ring.slice(0, start)]).toString("binary")
+        text = text.slice(text.indexOf("\n") + 1)
+    }
+
+    if (overwritten || dropped)
+        text = `(${overwritten} bytes overwritten before being read, ${dropped} messages dropped)\n` + text
+
+    return text
+}
+
 function main() {
     let mapFileName = process.argv[2]
     if (!mapFileName) {
@@ -18,8 +48,16 @@ function main() {
     console.log("Map file: " + mapFileName)
     let mapFile = fs.readFileSync(mapFileName, "utf8")
     let addr = 0
-    let logSize = 1024 * 4 + 4
-    for (let ln of mapFile.split(/\r?\n/)) {
+    let logSize = 1024 * 4 + headerSize
+    let lines = mapFile.split(/\r?\n/)
+    for (let i = 0; i < lines.length; ++i) {
+        let ln = lines[i]
+        // The size of the store is given with its input section, which may wrap onto the next line.
+        let s = /^\s*\.bss\.codalLogStore(\s+0x[0-9a-f]+\s+0x([0-9a-f]+))?/.exec(ln)
+        if (s) {
+            let sz = s[2] || (/^\s*0x[0-9a-f]+\s+0x([0-9a-f]+)/.exec(lines[i + 1] || "") || [])[1]
+            if (sz) logSize = parseInt(sz, 16)
+        }
         let m = /^\s*0x00000([0-9a-f]+)\s+(\S+)/.exec(ln)
         if (m && m[2] == "codalLogStore") {
             addr = parseInt(m[1], 16)
@@ -72,13 +110,13 @@ function main() {
                     buf[parseInt(m[1])] = parseInt(m[2])
                 }
             }
-            let len = buf.readUInt32LE(0)
-            if (len == 0 || len > buf.length) {
+            let text = reassemble(buf)
+            if (text == null) {
                 console.log(stderr)
                 console.log("No logs.")
             } else {
                 console.log("*\n* Logs\n*\n")
-                console.log(buf.slice(4, 4 + len).toString("binary"))
+                console.log(text)
             }
         })
 }